@@ -1,6 +1,154 @@
 #include "algebraic_elements.h"
+#include "multi_lane_exp.h"
 #include <openssl/rand.h>
 #include <assert.h>
+#include <string.h>
+#include <pthread.h>
+
+/**
+ *  BN_CTX Pool
+ */
+
+// Single BN_CTX per thread per variant (0 - non-secure, 1 - secure), nested usage is handled by BN_CTX_start/BN_CTX_end frames.
+// BN_CTX_end doesn't clear released values, so when the outermost secure frame is released, the secure pool's first bn_ctx_secure_size values are taken back and cleared.
+// Those are all values used (also by openssl internally) as long as the sentinel (pooled value right after them, holding a marker while unused) wasn't handed out, since handing out zeroes it.
+// Otherwise the pool is freed (cleared) and recreated twice as large on next acquire.
+#define BN_CTX_SECURE_INITIAL_SIZE 32
+#define BN_CTX_SENTINEL_MARKER 0x5e17e1a1c1ea4edbUL
+
+static __thread BN_CTX *bn_ctx_pool[2];
+static __thread uint64_t bn_ctx_secure_depth;
+static __thread uint64_t bn_ctx_secure_size;
+static __thread BIGNUM *bn_ctx_secure_sentinel;
+static pthread_key_t bn_ctx_pool_key;
+static pthread_once_t bn_ctx_pool_key_once = PTHREAD_ONCE_INIT;
+
+static void bn_ctx_pool_free (void *unused)
+{
+  (void) unused;
+  BN_CTX_free(bn_ctx_pool[0]);
+  BN_CTX_free(bn_ctx_pool[1]);
+  bn_ctx_pool[0] = NULL;
+  bn_ctx_pool[1] = NULL;
+  bn_ctx_secure_sentinel = NULL;
+}
+
+static void bn_ctx_pool_key_create () { pthread_key_create(&bn_ctx_pool_key, bn_ctx_pool_free); }
+
+// Secure BN_CTX with bn_ctx_secure_size pooled values, followed by the sentinel
+static BN_CTX *bn_ctx_secure_pool_new ()
+{
+  if (bn_ctx_secure_size == 0) bn_ctx_secure_size = BN_CTX_SECURE_INITIAL_SIZE;
+
+  BN_CTX *bn_ctx = BN_CTX_secure_new();
+  BN_CTX_start(bn_ctx);
+  for (uint64_t i = 0; i < bn_ctx_secure_size; ++i) BN_CTX_get(bn_ctx);
+  bn_ctx_secure_sentinel = BN_CTX_get(bn_ctx);
+  BN_CTX_end(bn_ctx);
+
+  BN_set_word(bn_ctx_secure_sentinel, BN_CTX_SENTINEL_MARKER);
+  BN_set_negative(bn_ctx_secure_sentinel, 1);
+
+  return bn_ctx;
+}
+
+BN_CTX *bn_ctx_acquire (int secure)
+{
+  secure = !!secure;
+
+  if (!bn_ctx_pool[secure])
+  {
+    bn_ctx_pool[secure] = (secure ? bn_ctx_secure_pool_new() : BN_CTX_new());
+
+    // Register for cleanup at thread exit (value is only a non-NULL marker)
+    pthread_once(&bn_ctx_pool_key_once, bn_ctx_pool_key_create);
+    pthread_setspecific(bn_ctx_pool_key, bn_ctx_pool);
+  }
+
+  if (secure) ++bn_ctx_secure_depth;
+
+  BN_CTX_start(bn_ctx_pool[secure]);
+  return bn_ctx_pool[secure];
+}
+
+void bn_ctx_release (BN_CTX *bn_ctx)
+{
+  BN_CTX_end(bn_ctx);
+
+  if ((bn_ctx != bn_ctx_pool[1]) || (--bn_ctx_secure_depth > 0)) return;
+
+  if (BN_is_negative(bn_ctx_secure_sentinel) && BN_abs_is_word(bn_ctx_secure_sentinel, BN_CTX_SENTINEL_MARKER))
+  {
+    BN_CTX_start(bn_ctx);
+    for (uint64_t i = 0; i < bn_ctx_secure_size; ++i) BN_clear(BN_CTX_get(bn_ctx));
+    BN_CTX_end(bn_ctx);
+  }
+  else
+  {
+    BN_CTX_free(bn_ctx);
+    bn_ctx_pool[1] = NULL;
+    bn_ctx_secure_sentinel = NULL;
+    bn_ctx_secure_size *= 2;
+  }
+}
+
+/**
+ *  Arena
+ */
+
+#define ARENA_INITIAL_CAPACITY 16
+
+arena_t arena_new ()
+{
+  arena_t arena = calloc(1, sizeof(arena_st));
+  arena->bn_ctx = bn_ctx_acquire(1);
+  return arena;
+}
+
+void arena_free (arena_t arena)
+{
+  if (!arena) return;
+
+  // BN_CTX_end doesn't clear, and pooled scalars are reused by later frames
+  for (uint64_t i = 0; i < arena->num_scalars; ++i) BN_clear(arena->scalars[i]);
+  for (uint64_t i = 0; i < arena->num_elements; ++i) group_elem_free(arena->elements[i]);
+
+  bn_ctx_release(arena->bn_ctx);
+  free(arena->scalars);
+  free(arena->elements);
+  free(arena);
+}
+
+scalar_t arena_scalar_new (arena_t arena)
+{
+  if (arena->num_scalars == arena->scalars_capacity)
+  {
+    arena->scalars_capacity = arena->scalars_capacity ? 2 * arena->scalars_capacity : ARENA_INITIAL_CAPACITY;
+    arena->scalars = realloc(arena->scalars, arena->scalars_capacity * sizeof(scalar_t));
+  }
+
+  scalar_t num = BN_CTX_get(arena->bn_ctx);
+  arena->scalars[arena->num_scalars++] = num;
+  return num;
+}
+
+gr_elem_t arena_group_elem_new (arena_t arena, const ec_group_t ec)
+{
+  if (arena->num_elements == arena->elements_capacity)
+  {
+    arena->elements_capacity = arena->elements_capacity ? 2 * arena->elements_capacity : ARENA_INITIAL_CAPACITY;
+    arena->elements = realloc(arena->elements, arena->elements_capacity * sizeof(gr_elem_t));
+  }
+
+  gr_elem_t el = group_elem_new(ec);
+  arena->elements[arena->num_elements++] = el;
+  return el;
+}
+
+/**
+ *  Scalars
+ */
+
 
 scalar_t  scalar_new    ()                                  { return BN_secure_new(); }
 void      scalar_free   (scalar_t num)                      { BN_clear_free(num); }
@@ -33,16 +181,16 @@ void scalar_coprime_from_bytes (scalar_t num, uint8_t **bytes, uint64_t byte_len
 
 void scalar_add (scalar_t result, const scalar_t first, const scalar_t second, const scalar_t modulus)
 {
-  BN_CTX *bn_ctx = BN_CTX_secure_new();
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
   BN_mod_add(result, first, second, modulus, bn_ctx);
-  BN_CTX_free(bn_ctx);
+  bn_ctx_release(bn_ctx);
 }
 
 void scalar_sub (scalar_t result, const scalar_t first, const scalar_t second, const scalar_t modulus)
 {
-  BN_CTX *bn_ctx = BN_CTX_secure_new();
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
   BN_mod_sub(result, first, second, modulus, bn_ctx);
-  BN_CTX_free(bn_ctx);
+  bn_ctx_release(bn_ctx);
 }
 
 void scalar_negate (scalar_t result, const scalar_t num)
@@ -61,23 +209,57 @@ void scalar_complement (scalar_t result, const scalar_t num, const scalar_t modu
 
 void scalar_mul (scalar_t result, const scalar_t first, const scalar_t second, const scalar_t modulus)
 {
-  BN_CTX *bn_ctx = BN_CTX_secure_new();
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
   BN_mod_mul(result, first, second, modulus, bn_ctx);
-  BN_CTX_free(bn_ctx);
+  bn_ctx_release(bn_ctx);
 }
 
 void scalar_inv (scalar_t result, const scalar_t num, const scalar_t modulus)
 {
-  BN_CTX *bn_ctx = BN_CTX_secure_new();
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
   BN_mod_inverse(result, num, modulus, bn_ctx);
-  BN_CTX_free(bn_ctx);
+  bn_ctx_release(bn_ctx);
+}
+
+void scalar_batch_inv (scalar_t *results, const scalar_t *nums, uint64_t count, const scalar_t modulus)
+{
+  if (count == 0) return;
+
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
+  scalar_t acc = BN_CTX_get(bn_ctx);
+  scalar_t temp = BN_CTX_get(bn_ctx);
+
+  // prefix[i] = nums[0] * ... * nums[i-1]
+  scalar_t *prefix = calloc(count, sizeof(scalar_t));
+
+  BN_one(acc);
+  for (uint64_t i = 0; i < count; ++i)
+  {
+    prefix[i] = scalar_new();
+    BN_copy(prefix[i], acc);
+    BN_mod_mul(acc, acc, nums[i], modulus, bn_ctx);
+  }
+
+  BN_mod_inverse(acc, acc, modulus, bn_ctx);
+
+  // acc holds inverse of nums[0] * ... * nums[i]
+  for (uint64_t i = count; i-- > 0; )
+  {
+    BN_mod_mul(temp, acc, prefix[i], modulus, bn_ctx);
+    BN_mod_mul(acc, acc, nums[i], modulus, bn_ctx);
+    BN_copy(results[i], temp);
+    scalar_free(prefix[i]);
+  }
+
+  free(prefix);
+  bn_ctx_release(bn_ctx);
 }
 
 void scalar_gcd (scalar_t result, const scalar_t first, const scalar_t second)
 {
-  BN_CTX *bn_ctx = BN_CTX_secure_new();
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
   BN_gcd(result, first, second, bn_ctx);
-  BN_CTX_free(bn_ctx);
+  bn_ctx_release(bn_ctx);
 }
 
 int scalar_coprime (const scalar_t first, const scalar_t second)
@@ -91,7 +273,7 @@ int scalar_coprime (const scalar_t first, const scalar_t second)
 
 void scalar_exp (scalar_t result, const scalar_t base, const scalar_t exp, const scalar_t modulus)
 {
-  BN_CTX *bn_ctx = BN_CTX_secure_new();
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
   
   scalar_t res = scalar_new();
   
@@ -102,7 +284,623 @@ void scalar_exp (scalar_t result, const scalar_t base, const scalar_t exp, const
   BN_copy(result, res);
   scalar_free(res);
   
-  BN_CTX_free(bn_ctx);
+  bn_ctx_release(bn_ctx);
+}
+
+void scalar_exp_mont (scalar_t result, const scalar_t base, const scalar_t exp, const scalar_t modulus, mont_ctx_t mont)
+{
+  if (!mont) 
+  {
+    scalar_exp(result, base, exp, modulus);
+    return;
+  }
+
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
+  
+  scalar_t res = scalar_new();
+  BN_MONT_CTX *bn_mont = BN_MONT_CTX_set_locked(&mont->bn_mont, mont->lock, modulus, bn_ctx);
+  
+  // Same as scalar_exp, exp sign is ignored by openssl and result is inverted
+  BN_mod_exp_mont(res, base, exp, modulus, bn_ctx, bn_mont);
+  if (BN_is_negative(exp)) BN_mod_inverse(res, res, modulus, bn_ctx);
+
+  BN_copy(result, res);
+  scalar_free(res);
+  
+  bn_ctx_release(bn_ctx);
+}
+
+void scalar_exp_vartime (scalar_t result, const scalar_t base, const scalar_t exp, const scalar_t modulus, mont_ctx_t mont)
+{
+  BN_CTX *bn_ctx = bn_ctx_acquire(0);
+  
+  scalar_t res = BN_CTX_get(bn_ctx);
+  BN_MONT_CTX *bn_mont = NULL;
+  if (mont) bn_mont = BN_MONT_CTX_set_locked(&mont->bn_mont, mont->lock, modulus, bn_ctx);
+
+  // Sliding window exponentiation, exp sign is ignored by openssl and result is inverted
+  if (BN_is_odd(modulus)) BN_mod_exp_mont(res, base, exp, modulus, bn_ctx, bn_mont);
+  else BN_mod_exp(res, base, exp, modulus, bn_ctx);
+  if (BN_is_negative(exp)) BN_mod_inverse(res, res, modulus, bn_ctx);
+
+  BN_copy(result, res);
+  
+  bn_ctx_release(bn_ctx);
+}
+
+void scalar_exp_batch (scalar_t *results, const scalar_t *bases, const scalar_t *exps, uint64_t count, const scalar_t modulus, mont_ctx_t mont)
+{
+  uint64_t i = 0;
+  if (BN_is_odd(modulus) && multi_lane_exp_available())
+  {
+    while (count - i >= MULTI_LANE_EXP_MIN_LANES)
+    {
+      uint64_t lanes = count - i < MULTI_LANE_EXP_LANES ? count - i : MULTI_LANE_EXP_LANES;
+      multi_lane_exp(results + i, bases + i, exps + i, lanes, modulus);
+
+      // Same as scalar_exp, inverse for negative exponents
+      BN_CTX *bn_ctx = bn_ctx_acquire(1);
+      for (uint64_t l = i; l < i + lanes; ++l) if (BN_is_negative(exps[l])) BN_mod_inverse(results[l], results[l], modulus, bn_ctx);
+      bn_ctx_release(bn_ctx);
+
+      i += lanes;
+    }
+  }
+
+  for (; i < count; ++i) scalar_exp_mont(results[i], bases[i], exps[i], modulus, mont);
+}
+
+// Window size by (maximal) exponent bit length, same thresholds as openssl's BN_window_bits_for_exponent_size
+static int multi_exp_window_bits (int exp_bits)
+{
+  if (exp_bits > 671) return 6;
+  if (exp_bits > 239) return 5;
+  if (exp_bits > 79)  return 4;
+  if (exp_bits > 23)  return 3;
+  return 1;
+}
+
+// Constant-time result = entries[index], reading all num_entries entries (num_words words each)
+static void words_table_select (uint64_t *result, const uint64_t *entries, uint64_t num_entries, uint64_t num_words, uint64_t index)
+{
+  memset(result, 0, num_words * sizeof(uint64_t));
+  for (uint64_t e = 0; e < num_entries; ++e)
+  {
+    uint64_t diff = e ^ index;
+    uint64_t mask = ((diff | (0 - diff)) >> 63) - 1;    // all ones iff e == index
+    for (uint64_t w = 0; w < num_words; ++w) result[w] |= entries[e * num_words + w] & mask;
+  }
+}
+
+// Returns window_bits bits of little-endian exp_bytes starting at bit_pos (bits beyond exp_bytes are 0)
+static uint64_t bytes_window_digit (const uint8_t *exp_bytes, uint64_t exp_byte_len, uint64_t bit_pos, uint64_t window_bits)
+{
+  uint64_t digit = 0;
+  for (uint64_t b = 0; b < window_bits; ++b, ++bit_pos)
+  {
+    if (bit_pos < 8*exp_byte_len) digit |= ((uint64_t) (exp_bytes[bit_pos / 8] >> (bit_pos % 8)) & 1) << b;
+  }
+  return digit;
+}
+
+/**
+ *  Shamir's trick over interleaved fixed windows of all exponents.
+ *  Variable time: windows by longest exponent, table indexed by digit and zero digits skipped.
+ *  Constant time: windows by max_exp_bits, every window multiplies by every base's entry (table[0] = 1 for zero digit),
+ *  read by masked scan over the whole table (kept as fixed width words), and inverted base for negative exponent selected by mask.
+ */
+static int scalar_multi_exp_tier (scalar_t result, const scalar_t *bases, const scalar_t *exps, uint64_t count, uint64_t max_exp_bits, const scalar_t modulus, mont_ctx_t mont, int vartime)
+{
+  assert(BN_is_odd(modulus));
+
+  BN_CTX *bn_ctx = bn_ctx_acquire(!vartime);
+
+  BN_MONT_CTX *temp_mont = NULL;
+  BN_MONT_CTX *bn_mont = NULL;
+  if (mont) bn_mont = BN_MONT_CTX_set_locked(&mont->bn_mont, mont->lock, modulus, bn_ctx);
+  if (!bn_mont)
+  {
+    temp_mont = BN_MONT_CTX_new();
+    BN_MONT_CTX_set(temp_mont, modulus, bn_ctx);
+    bn_mont = temp_mont;
+  }
+
+  // Longer exponents than max_exp_bits extend the bound (so their length isn't hidden)
+  uint64_t exp_bits = (vartime ? 0 : max_exp_bits);
+  for (uint64_t i = 0; i < count; ++i) if ((uint64_t) BN_num_bits(exps[i]) > exp_bits) exp_bits = BN_num_bits(exps[i]);
+
+  int window_bits = multi_exp_window_bits(exp_bits);
+  uint64_t table_size = 1 << window_bits;
+  int num_windows = (exp_bits + window_bits - 1) / window_bits;
+
+  // Montgomery form of 1 and of table[i][d] = bases[i]^d (inverted base for negative exponent), for d < table_size
+  scalar_t acc = BN_CTX_get(bn_ctx);
+  scalar_t mont_one = BN_CTX_get(bn_ctx);
+  scalar_t selected = BN_CTX_get(bn_ctx);
+  BN_to_montgomery(mont_one, BN_value_one(), bn_mont, bn_ctx);
+
+  uint64_t num_words = (BN_num_bytes(modulus) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+  // Some base with negative exponent not invertible (result is zero)
+  int is_error = 0;
+
+  scalar_t *table = calloc(count * table_size, sizeof(scalar_t));
+  for (uint64_t i = 0; i < count; ++i)
+  {
+    scalar_t *base_table = table + i * table_size;
+    for (uint64_t d = 0; d < table_size; ++d) base_table[d] = BN_CTX_get(bn_ctx);
+
+    BN_copy(base_table[0], mont_one);
+    BN_nnmod(base_table[1], bases[i], modulus, bn_ctx);
+    if (vartime)
+    {
+      if (BN_is_negative(exps[i]) && !BN_mod_inverse(base_table[1], base_table[1], modulus, bn_ctx)) is_error = 1;
+    }
+    else
+    {
+      // Both base and its inverse (base is public), selected by exponent's sign
+      uint64_t *choice = calloc(3 * num_words, sizeof(uint64_t));
+      BN_bn2lebinpad(base_table[1], (uint8_t *) choice, num_words * sizeof(uint64_t));
+      int is_invertible = (BN_mod_inverse(selected, base_table[1], modulus, bn_ctx) != NULL);
+      if (is_invertible) BN_bn2lebinpad(selected, (uint8_t *) (choice + num_words), num_words * sizeof(uint64_t));
+      else memcpy(choice + num_words, choice, num_words * sizeof(uint64_t));
+      is_error |= (!is_invertible) & (BN_is_negative(exps[i]) != 0);
+      words_table_select(choice + 2 * num_words, choice, 2, num_words, BN_is_negative(exps[i]) != 0);
+      BN_lebin2bn((uint8_t *) (choice + 2 * num_words), num_words * sizeof(uint64_t), base_table[1]);
+      OPENSSL_cleanse(choice, 3 * num_words * sizeof(uint64_t));
+      free(choice);
+    }
+    BN_to_montgomery(base_table[1], base_table[1], bn_mont, bn_ctx);
+    for (uint64_t d = 2; d < table_size; ++d) BN_mod_mul_montgomery(base_table[d], base_table[d-1], base_table[1], bn_mont, bn_ctx);
+  }
+
+  // Constant time: all entries and exponents (absolute value) as fixed width values
+  uint64_t exp_byte_len = (exp_bits + 7) / 8;
+  uint64_t *table_words = NULL;
+  uint64_t *selected_words = NULL;
+  uint8_t *exp_bytes = NULL;
+
+  if (!vartime)
+  {
+    table_words = calloc(count * table_size * num_words, sizeof(uint64_t));
+    selected_words = calloc(num_words, sizeof(uint64_t));
+    exp_bytes = calloc(count, exp_byte_len);
+    for (uint64_t i = 0; i < count * table_size; ++i) BN_bn2lebinpad(table[i], (uint8_t *) (table_words + i * num_words), num_words * sizeof(uint64_t));
+    for (uint64_t i = 0; i < count; ++i) BN_bn2lebinpad(exps[i], exp_bytes + i * exp_byte_len, exp_byte_len);
+  }
+
+  BN_copy(acc, mont_one);
+  for (int w = num_windows - 1; w >= 0; --w)
+  {
+    if (w != num_windows - 1) for (int b = 0; b < window_bits; ++b) BN_mod_mul_montgomery(acc, acc, acc, bn_mont, bn_ctx);
+
+    for (uint64_t i = 0; i < count; ++i)
+    {
+      if (vartime)
+      {
+        uint64_t digit = 0;
+        for (int b = window_bits - 1; b >= 0; --b) digit = (digit << 1) | BN_is_bit_set(exps[i], w * window_bits + b);
+
+        if (digit) BN_mod_mul_montgomery(acc, acc, table[i * table_size + digit], bn_mont, bn_ctx);
+      }
+      else
+      {
+        uint64_t digit = bytes_window_digit(exp_bytes + i * exp_byte_len, exp_byte_len, w * window_bits, window_bits);
+        words_table_select(selected_words, table_words + i * table_size * num_words, table_size, num_words, digit);
+        BN_lebin2bn((uint8_t *) selected_words, num_words * sizeof(uint64_t), selected);
+        BN_mod_mul_montgomery(acc, acc, selected, bn_mont, bn_ctx);
+      }
+    }
+  }
+
+  BN_from_montgomery(result, acc, bn_mont, bn_ctx);
+  if (is_error) BN_zero(result);
+
+  if (!vartime)
+  {
+    for (uint64_t i = 0; i < count * table_size; ++i) BN_clear(table[i]);
+    BN_clear(selected);
+    OPENSSL_cleanse(table_words, count * table_size * num_words * sizeof(uint64_t));
+    OPENSSL_cleanse(selected_words, num_words * sizeof(uint64_t));
+    OPENSSL_cleanse(exp_bytes, count * exp_byte_len);
+  }
+  free(table_words);
+  free(selected_words);
+  free(exp_bytes);
+  free(table);
+  BN_MONT_CTX_free(temp_mont);
+  bn_ctx_release(bn_ctx);
+
+  return is_error;
+}
+
+int scalar_multi_exp (scalar_t result, const scalar_t *bases, const scalar_t *exps, uint64_t count, uint64_t max_exp_bits, const scalar_t modulus, mont_ctx_t mont)
+{
+  return scalar_multi_exp_tier(result, bases, exps, count, max_exp_bits, modulus, mont, 0);
+}
+
+int scalar_multi_exp_vartime (scalar_t result, const scalar_t *bases, const scalar_t *exps, uint64_t count, const scalar_t modulus, mont_ctx_t mont)
+{
+  return scalar_multi_exp_tier(result, bases, exps, count, 0, modulus, mont, 1);
+}
+
+// Sliding window digits of exp from the top bit, returns number of steps. If squarings/digits are NULL only counts them.
+static uint64_t scalar_fixed_exp_recode (uint64_t *squarings, uint64_t *digits, uint64_t *final_squarings, const scalar_t exp, uint64_t window_bits)
+{
+  uint64_t num_steps = 0;
+  uint64_t pending = 0;
+
+  int i = BN_num_bits(exp) - 1;
+  while (i >= 0)
+  {
+    if (!BN_is_bit_set(exp, i))
+    {
+      ++pending;
+      --i;
+      continue;
+    }
+
+    // Longest window [i..l] ending with a set bit
+    int l = i - (int) window_bits + 1;
+    if (l < 0) l = 0;
+    while (!BN_is_bit_set(exp, l)) ++l;
+
+    uint64_t digit = 0;
+    for (int b = i; b >= l; --b) digit = (digit << 1) | BN_is_bit_set(exp, b);
+    pending += i - l + 1;
+
+    if (squarings) squarings[num_steps] = pending;
+    if (digits) digits[num_steps] = digit;
+    ++num_steps;
+
+    pending = 0;
+    i = l - 1;
+  }
+
+  if (final_squarings) *final_squarings = pending;
+  return num_steps;
+}
+
+fixed_exp_t scalar_fixed_exp_new (const scalar_t exp)
+{
+  assert(!BN_is_negative(exp));
+
+  fixed_exp_t recoding = malloc(sizeof(fixed_exp_st));
+
+  // Table of odd powers costs 2^(w-1) multiplications, each step one more
+  recoding->window_bits = 1;
+  uint64_t min_cost = scalar_fixed_exp_recode(NULL, NULL, NULL, exp, 1);
+  for (uint64_t w = 2; w <= 8; ++w)
+  {
+    uint64_t cost = (1 << (w - 1)) + scalar_fixed_exp_recode(NULL, NULL, NULL, exp, w);
+    if (cost < min_cost)
+    {
+      min_cost = cost;
+      recoding->window_bits = w;
+    }
+  }
+
+  recoding->num_steps = scalar_fixed_exp_recode(NULL, NULL, NULL, exp, recoding->window_bits);
+  recoding->squarings = calloc(recoding->num_steps + 1, sizeof(uint64_t));
+  recoding->digits = calloc(recoding->num_steps + 1, sizeof(uint64_t));
+  scalar_fixed_exp_recode(recoding->squarings, recoding->digits, &recoding->final_squarings, exp, recoding->window_bits);
+
+  return recoding;
+}
+
+void scalar_fixed_exp_free (fixed_exp_t recoding)
+{
+  if (!recoding) return;
+
+  free(recoding->squarings);
+  free(recoding->digits);
+  free(recoding);
+}
+
+void scalar_exp_fixed_exp (scalar_t result, const scalar_t base, const fixed_exp_t recoding, const scalar_t modulus, mont_ctx_t mont)
+{
+  assert(BN_is_odd(modulus));
+
+  if (recoding->num_steps == 0)
+  {
+    BN_one(result);
+    return;
+  }
+
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
+
+  BN_MONT_CTX *temp_mont = NULL;
+  BN_MONT_CTX *bn_mont = NULL;
+  if (mont) bn_mont = BN_MONT_CTX_set_locked(&mont->bn_mont, mont->lock, modulus, bn_ctx);
+  if (!bn_mont)
+  {
+    temp_mont = BN_MONT_CTX_new();
+    BN_MONT_CTX_set(temp_mont, modulus, bn_ctx);
+    bn_mont = temp_mont;
+  }
+
+  // Odd powers in Montgomery form, odd_powers[j] = base^(2j+1)
+  uint64_t table_size = 1 << (recoding->window_bits - 1);
+  scalar_t acc = BN_CTX_get(bn_ctx);
+  scalar_t base_sqr = BN_CTX_get(bn_ctx);
+  scalar_t *odd_powers = calloc(table_size, sizeof(scalar_t));
+  for (uint64_t j = 0; j < table_size; ++j) odd_powers[j] = BN_CTX_get(bn_ctx);
+
+  BN_nnmod(odd_powers[0], base, modulus, bn_ctx);
+  BN_to_montgomery(odd_powers[0], odd_powers[0], bn_mont, bn_ctx);
+  BN_mod_mul_montgomery(base_sqr, odd_powers[0], odd_powers[0], bn_mont, bn_ctx);
+  for (uint64_t j = 1; j < table_size; ++j) BN_mod_mul_montgomery(odd_powers[j], odd_powers[j-1], base_sqr, bn_mont, bn_ctx);
+
+  BN_copy(acc, odd_powers[recoding->digits[0] >> 1]);
+  for (uint64_t k = 1; k < recoding->num_steps; ++k)
+  {
+    for (uint64_t b = 0; b < recoding->squarings[k]; ++b) BN_mod_mul_montgomery(acc, acc, acc, bn_mont, bn_ctx);
+    BN_mod_mul_montgomery(acc, acc, odd_powers[recoding->digits[k] >> 1], bn_mont, bn_ctx);
+  }
+  for (uint64_t b = 0; b < recoding->final_squarings; ++b) BN_mod_mul_montgomery(acc, acc, acc, bn_mont, bn_ctx);
+
+  BN_from_montgomery(result, acc, bn_mont, bn_ctx);
+
+  for (uint64_t j = 0; j < table_size; ++j) BN_clear(odd_powers[j]);
+  BN_clear(base_sqr);
+  BN_clear(acc);
+  free(odd_powers);
+  BN_MONT_CTX_free(temp_mont);
+  bn_ctx_release(bn_ctx);
+}
+
+#define FIXED_BASE_WINDOW_BITS 4
+#define FIXED_BASE_ENTRIES ((1 << FIXED_BASE_WINDOW_BITS) - 1)
+
+// Words of each power (fixed width, enough for modulus)
+static uint64_t fixed_base_num_words (const scalar_t modulus) { return (BN_num_bytes(modulus) + sizeof(uint64_t) - 1) / sizeof(uint64_t); }
+
+fixed_base_t scalar_fixed_base_new (const scalar_t base, uint64_t max_exp_bits, const scalar_t modulus)
+{
+  BN_CTX *bn_ctx = bn_ctx_acquire(0);
+
+  fixed_base_t table = malloc(sizeof(fixed_base_st));
+  table->num_windows = (max_exp_bits + FIXED_BASE_WINDOW_BITS - 1) / FIXED_BASE_WINDOW_BITS;
+  table->num_words = fixed_base_num_words(modulus);
+  table->powers = calloc(table->num_windows * FIXED_BASE_ENTRIES * table->num_words, sizeof(uint64_t));
+  table->bn_mont = BN_MONT_CTX_new();
+  BN_MONT_CTX_set(table->bn_mont, modulus, bn_ctx);
+
+  // window_base = base^(2^(FIXED_BASE_WINDOW_BITS * i)) for current window i
+  scalar_t window_base = BN_CTX_get(bn_ctx);
+  scalar_t power = BN_CTX_get(bn_ctx);
+  BN_nnmod(window_base, base, modulus, bn_ctx);
+  BN_to_montgomery(window_base, window_base, table->bn_mont, bn_ctx);
+
+  for (uint64_t i = 0; i < table->num_windows; ++i)
+  {
+    uint64_t *window_powers = table->powers + i * FIXED_BASE_ENTRIES * table->num_words;
+
+    BN_copy(power, window_base);
+    for (uint64_t d = 0; d < FIXED_BASE_ENTRIES; ++d)
+    {
+      if (d > 0) BN_mod_mul_montgomery(power, power, window_base, table->bn_mont, bn_ctx);
+      BN_bn2lebinpad(power, (uint8_t *) (window_powers + d * table->num_words), table->num_words * sizeof(uint64_t));
+    }
+    BN_mod_mul_montgomery(window_base, power, window_base, table->bn_mont, bn_ctx);
+  }
+
+  bn_ctx_release(bn_ctx);
+  return table;
+}
+
+uint64_t scalar_fixed_base_max_exp_bits (const fixed_base_t table)
+{
+  return (table ? FIXED_BASE_WINDOW_BITS * table->num_windows : 0);
+}
+
+void scalar_fixed_base_free (fixed_base_t table)
+{
+  if (!table) return;
+
+  free(table->powers);
+  BN_MONT_CTX_free(table->bn_mont);
+  free(table);
+}
+
+fixed_base_t scalar_fixed_base_dup (const fixed_base_t table)
+{
+  if (!table) return NULL;
+
+  uint64_t powers_len = table->num_windows * FIXED_BASE_ENTRIES * table->num_words * sizeof(uint64_t);
+
+  fixed_base_t copy = malloc(sizeof(fixed_base_st));
+  copy->num_windows = table->num_windows;
+  copy->num_words = table->num_words;
+  copy->powers = malloc(powers_len);
+  memcpy(copy->powers, table->powers, powers_len);
+  copy->bn_mont = BN_MONT_CTX_new();
+  BN_MONT_CTX_copy(copy->bn_mont, table->bn_mont);
+
+  return copy;
+}
+
+void scalar_fixed_base_to_bytes (uint8_t **bytes, uint64_t *byte_len, const fixed_base_t table, uint64_t max_exp_bits, uint64_t modulus_bytes, int move_to_end)
+{
+  uint64_t num_powers = (max_exp_bits + FIXED_BASE_WINDOW_BITS - 1) / FIXED_BASE_WINDOW_BITS * FIXED_BASE_ENTRIES;
+  uint64_t needed_byte_len = num_powers * modulus_bytes;
+
+  if ((!bytes) || (!*bytes) || (needed_byte_len > *byte_len))
+  {
+    *byte_len = needed_byte_len;
+    return ;
+  }
+
+  uint8_t *set_bytes = *bytes;
+
+  if (table)
+  {
+    assert(table->num_windows * FIXED_BASE_ENTRIES == num_powers);
+
+    scalar_t power = BN_new();
+    for (uint64_t i = 0; i < num_powers; ++i)
+    {
+      BN_lebin2bn((const uint8_t *) (table->powers + i * table->num_words), table->num_words * sizeof(uint64_t), power);
+      scalar_to_bytes(&set_bytes, modulus_bytes, power, 1);
+    }
+    BN_free(power);
+  }
+  else
+  {
+    memset(set_bytes, 0, needed_byte_len);
+    set_bytes += needed_byte_len;
+  }
+
+  assert(set_bytes == *bytes + needed_byte_len);
+  *byte_len = needed_byte_len;
+  if (move_to_end) *bytes = set_bytes;
+}
+
+void scalar_fixed_base_from_bytes (fixed_base_t *table, uint8_t **bytes, uint64_t *byte_len, uint64_t max_exp_bits, const scalar_t modulus, uint64_t modulus_bytes, int move_to_end)
+{
+  uint64_t num_windows = (max_exp_bits + FIXED_BASE_WINDOW_BITS - 1) / FIXED_BASE_WINDOW_BITS;
+  uint64_t needed_byte_len = num_windows * FIXED_BASE_ENTRIES * modulus_bytes;
+
+  if ((!bytes) || (!*bytes) || (!table) || (needed_byte_len > *byte_len))
+  {
+    *byte_len = needed_byte_len;
+    return ;
+  }
+
+  uint8_t *read_bytes = *bytes;
+
+  scalar_fixed_base_free(*table);
+  *table = NULL;
+
+  // First power is the base itself (in Montgomery form), never zero for a stored table
+  int is_stored = 0;
+  for (uint64_t i = 0; (i < modulus_bytes) && (!is_stored); ++i) is_stored = (read_bytes[i] != 0);
+
+  if (is_stored)
+  {
+    BN_CTX *bn_ctx = bn_ctx_acquire(0);
+    scalar_t power = BN_CTX_get(bn_ctx);
+
+    fixed_base_t new_table = malloc(sizeof(fixed_base_st));
+    new_table->num_windows = num_windows;
+    new_table->num_words = fixed_base_num_words(modulus);
+    new_table->powers = calloc(num_windows * FIXED_BASE_ENTRIES * new_table->num_words, sizeof(uint64_t));
+    for (uint64_t i = 0; i < num_windows * FIXED_BASE_ENTRIES; ++i)
+    {
+      scalar_from_bytes(power, &read_bytes, modulus_bytes, 1);
+      BN_bn2lebinpad(power, (uint8_t *) (new_table->powers + i * new_table->num_words), new_table->num_words * sizeof(uint64_t));
+    }
+    new_table->bn_mont = BN_MONT_CTX_new();
+    BN_MONT_CTX_set(new_table->bn_mont, modulus, bn_ctx);
+    *table = new_table;
+
+    bn_ctx_release(bn_ctx);
+  }
+  else read_bytes += needed_byte_len;
+
+  assert(read_bytes == *bytes + needed_byte_len);
+  *byte_len = needed_byte_len;
+  if (move_to_end) *bytes = read_bytes;
+}
+
+/**
+ *  Multiplies one table entry per window of each exponent.
+ *  Variable time: entry indexed by digit, zero digits skipped.
+ *  Constant time: every window of every table multiplies by an entry read by masked scan over all its entries and one (for zero digit),
+ *  so the same multiplications and memory accesses for any exponents (of lengths within the tables, all padded to the tables' length).
+ *  With inv_tables (signed exponents), the scan covers entries of both tables[i] and inv_tables[i], and the exponent's sign selects by mask between them.
+ */
+static int scalar_fixed_base_multi_exp_tier (scalar_t result, const fixed_base_t *tables, const fixed_base_t *inv_tables, const scalar_t *exps, uint64_t count, int vartime)
+{
+  if (count == 0) return 1;
+  for (uint64_t i = 0; i < count; ++i)
+  {
+    if ((uint64_t) BN_num_bits(exps[i]) > FIXED_BASE_WINDOW_BITS * tables[i]->num_windows) return 1;
+    if (inv_tables && (inv_tables[i]->num_windows != tables[i]->num_windows)) return 1;
+  }
+
+  BN_MONT_CTX *bn_mont = tables[0]->bn_mont;
+  uint64_t num_words = tables[0]->num_words;
+  uint64_t num_signs = (inv_tables ? 2 : 1);
+  BN_CTX *bn_ctx = bn_ctx_acquire(!vartime);
+
+  scalar_t acc = BN_CTX_get(bn_ctx);
+  scalar_t mont_one = BN_CTX_get(bn_ctx);
+  scalar_t power = BN_CTX_get(bn_ctx);
+  BN_to_montgomery(mont_one, BN_value_one(), bn_mont, bn_ctx);
+  BN_copy(acc, mont_one);
+
+  // window_entries[0] is one, followed by current window's entries of table and of inverse's table (constant time only)
+  uint64_t *window_entries = calloc((num_signs * FIXED_BASE_ENTRIES + 1) * num_words, sizeof(uint64_t));
+  uint64_t *selected_words = calloc(num_words, sizeof(uint64_t));
+  BN_bn2lebinpad(mont_one, (uint8_t *) window_entries, num_words * sizeof(uint64_t));
+
+  for (uint64_t i = 0; i < count; ++i)
+  {
+    uint64_t exp_byte_len = (FIXED_BASE_WINDOW_BITS * tables[i]->num_windows + 7) / 8;
+    uint8_t *exp_bytes = calloc(exp_byte_len, 1);
+    BN_bn2lebinpad(exps[i], exp_bytes, exp_byte_len);
+
+    // Offset of inverse's entries for negative exponent, 0 otherwise (by mask)
+    uint64_t is_negative = (inv_tables != NULL) & (BN_is_negative(exps[i]) != 0);
+    uint64_t sign_offset = (0 - is_negative) & FIXED_BASE_ENTRIES;
+    const fixed_base_t table = (vartime && is_negative ? inv_tables[i] : tables[i]);
+
+    for (uint64_t w = 0; w < tables[i]->num_windows; ++w)
+    {
+      uint64_t digit = bytes_window_digit(exp_bytes, exp_byte_len, w * FIXED_BASE_WINDOW_BITS, FIXED_BASE_WINDOW_BITS);
+
+      if (vartime)
+      {
+        if (!digit) continue;
+        const uint64_t *powers = table->powers + w * FIXED_BASE_ENTRIES * num_words;
+        BN_lebin2bn((const uint8_t *) (powers + (digit - 1) * num_words), num_words * sizeof(uint64_t), power);
+      }
+      else
+      {
+        memcpy(window_entries + num_words, tables[i]->powers + w * FIXED_BASE_ENTRIES * num_words, FIXED_BASE_ENTRIES * num_words * sizeof(uint64_t));
+        if (inv_tables) memcpy(window_entries + (FIXED_BASE_ENTRIES + 1) * num_words, inv_tables[i]->powers + w * FIXED_BASE_ENTRIES * num_words, FIXED_BASE_ENTRIES * num_words * sizeof(uint64_t));
+
+        // Zero digit stays at one for either sign
+        uint64_t is_nonzero = (digit | (0 - digit)) >> 63;
+        words_table_select(selected_words, window_entries, num_signs * FIXED_BASE_ENTRIES + 1, num_words, digit + ((0 - is_nonzero) & sign_offset));
+        BN_lebin2bn((const uint8_t *) selected_words, num_words * sizeof(uint64_t), power);
+      }
+      BN_mod_mul_montgomery(acc, acc, power, bn_mont, bn_ctx);
+    }
+
+    OPENSSL_cleanse(exp_bytes, exp_byte_len);
+    free(exp_bytes);
+  }
+
+  BN_from_montgomery(result, acc, bn_mont, bn_ctx);
+
+  BN_clear(power);
+  OPENSSL_cleanse(selected_words, num_words * sizeof(uint64_t));
+  free(selected_words);
+  free(window_entries);
+  bn_ctx_release(bn_ctx);
+  return 0;
+}
+
+int scalar_fixed_base_multi_exp (scalar_t result, const fixed_base_t *tables, const scalar_t *exps, uint64_t count)
+{
+  return scalar_fixed_base_multi_exp_tier(result, tables, NULL, exps, count, 0);
+}
+
+int scalar_fixed_base_multi_exp_vartime (scalar_t result, const fixed_base_t *tables, const scalar_t *exps, uint64_t count)
+{
+  return scalar_fixed_base_multi_exp_tier(result, tables, NULL, exps, count, 1);
+}
+
+int scalar_fixed_base_signed_multi_exp (scalar_t result, const fixed_base_t *tables, const fixed_base_t *inv_tables, const scalar_t *exps, uint64_t count)
+{
+  return scalar_fixed_base_multi_exp_tier(result, tables, inv_tables, exps, count, 0);
+}
+
+int scalar_fixed_base_signed_multi_exp_vartime (scalar_t result, const fixed_base_t *tables, const fixed_base_t *inv_tables, const scalar_t *exps, uint64_t count)
+{
+  return scalar_fixed_base_multi_exp_tier(result, tables, inv_tables, exps, count, 1);
 }
 
 int scalar_equal (const scalar_t a, const scalar_t b)
@@ -119,21 +917,16 @@ void scalar_make_signed(scalar_t num, const scalar_t range)
 {
   assert((BN_cmp(num, range) <= 0) && (BN_is_negative(num) == 0));
 
-  BN_CTX *bn_ctx = BN_CTX_secure_new();
-  
   scalar_t half_range = BN_dup(range);
   BN_div_word(half_range, 2);
 
   if (BN_cmp(num, half_range) >= 0) BN_sub(num, num, range);
   
   scalar_free(half_range);
-  BN_CTX_free(bn_ctx);
 }
 
 void scalar_make_unsigned(scalar_t num, const scalar_t range)
 {
-  BN_CTX *bn_ctx = BN_CTX_secure_new();
-
   scalar_t half_range = BN_dup(range);
   BN_div_word(half_range, 2);
 
@@ -142,7 +935,6 @@ void scalar_make_unsigned(scalar_t num, const scalar_t range)
   assert((BN_cmp(num, range) <= 0) && (BN_is_negative(num) == 0));
   
   scalar_free(half_range);
-  BN_CTX_free(bn_ctx);
 }
 
 
@@ -152,7 +944,7 @@ void scalar_sample_in_range(scalar_t rnd, const scalar_t range_mod, int coprime)
 
   if (coprime)
   { 
-    BN_CTX * bn_ctx = BN_CTX_secure_new();
+    BN_CTX *bn_ctx = bn_ctx_acquire(1);
     BIGNUM *gcd = scalar_new();
     BN_gcd(gcd, range_mod, rnd, bn_ctx);
     
@@ -163,44 +955,322 @@ void scalar_sample_in_range(scalar_t rnd, const scalar_t range_mod, int coprime)
     }
     
     scalar_free(gcd);
-    BN_CTX_free(bn_ctx);
+    bn_ctx_release(bn_ctx);
   }
 }
 
+/**
+ *  Montgomery Precomputation
+ */
+
+mont_ctx_t mont_ctx_new ()
+{
+  mont_ctx_t mont = malloc(sizeof(mont_ctx_st));
+  mont->bn_mont = NULL;
+  mont->lock = CRYPTO_THREAD_lock_new();
+  return mont;
+}
+
+void mont_ctx_free (mont_ctx_t mont)
+{
+  if (!mont) return;
+
+  BN_MONT_CTX_free(mont->bn_mont);
+  CRYPTO_THREAD_lock_free(mont->lock);
+  free(mont);
+}
+
+void mont_ctx_reset (mont_ctx_t mont)
+{
+  if (!mont) return;
+
+  BN_MONT_CTX_free(mont->bn_mont);
+  mont->bn_mont = NULL;
+}
+
 /**
  *  EC Group 
  */
 
-ec_group_t  ec_group_new        ()                    { return EC_GROUP_new_by_curve_name(GROUP_ID); }
-void        ec_group_free       (ec_group_t ec)       { EC_GROUP_free(ec); }
-scalar_t    ec_group_order      (const ec_group_t ec) { return (scalar_t) EC_GROUP_get0_order(ec); }
-gr_elem_t   ec_group_generator  (const ec_group_t ec) { return (gr_elem_t) EC_GROUP_get0_generator(ec); }
+scalar_t    ec_group_order      (const ec_group_t ec) { return (scalar_t) EC_GROUP_get0_order(ec->group); }
+gr_elem_t   ec_group_generator  (const ec_group_t ec) { return ec->generator; }
+
+// Openssl EC_POINT backend (see secp256k1_native for the native one)
+#ifndef NATIVE_SECP256K1
+
+// Generator table holds digit * 2^(GEN_TABLE_WINDOW_BITS * i) * generator for each window i and non-zero digit
+#define GEN_TABLE_WINDOW_BITS 4
+#define GEN_TABLE_WINDOWS ((8*GROUP_ORDER_BYTES + GEN_TABLE_WINDOW_BITS - 1) / GEN_TABLE_WINDOW_BITS)
+#define GEN_TABLE_ENTRIES ((1 << GEN_TABLE_WINDOW_BITS) - 1)
+
+static void ec_group_generator_table_new (ec_group_t ec)
+{
+  BN_CTX *bn_ctx = bn_ctx_acquire(0);
+
+  ec->gen_table = calloc(GEN_TABLE_WINDOWS * GEN_TABLE_ENTRIES, sizeof(gr_elem_t));
+  gr_elem_t window_base = EC_POINT_dup(EC_GROUP_get0_generator(ec->group), ec->group);
+
+  for (uint64_t i = 0; i < GEN_TABLE_WINDOWS; ++i)
+  {
+    gr_elem_t *window = ec->gen_table + i * GEN_TABLE_ENTRIES;
+
+    window[0] = EC_POINT_dup(window_base, ec->group);
+    for (uint64_t d = 1; d < GEN_TABLE_ENTRIES; ++d)
+    {
+      window[d] = EC_POINT_new(ec->group);
+      EC_POINT_add(ec->group, window[d], window[d-1], window_base, bn_ctx);
+    }
+
+    for (uint64_t b = 0; b < GEN_TABLE_WINDOW_BITS; ++b) EC_POINT_dbl(ec->group, window_base, window_base, bn_ctx);
+  }
+
+  // Affine (Z=1) table entries allow cheaper mixed additions
+  EC_POINTs_make_affine(ec->group, GEN_TABLE_WINDOWS * GEN_TABLE_ENTRIES, ec->gen_table, bn_ctx);
+
+  EC_POINT_free(window_base);
+  bn_ctx_release(bn_ctx);
+}
+
+ec_group_t ec_group_new ()
+{
+  ec_group_t ec = malloc(sizeof(*ec));
+  ec->group = EC_GROUP_new_by_curve_name(GROUP_ID);
+  ec->generator = (gr_elem_t) EC_GROUP_get0_generator(ec->group);
+  ec_group_generator_table_new(ec);
+  return ec;
+}
+
+void ec_group_free (ec_group_t ec)
+{
+  if (!ec) return;
+  
+  for (uint64_t i = 0; i < GEN_TABLE_WINDOWS * GEN_TABLE_ENTRIES; ++i) EC_POINT_free(ec->gen_table[i]);
+  free(ec->gen_table);
+  EC_GROUP_free(ec->group);
+  free(ec);
+}
 
 /**
  *  Group Elements
  */
 
-gr_elem_t   group_elem_new (const ec_group_t ec)                  { return EC_POINT_new(ec); }
+gr_elem_t   group_elem_new (const ec_group_t ec)                  { return EC_POINT_new(ec->group); }
 void        group_elem_free (gr_elem_t el)                        { EC_POINT_clear_free(el); }
 void        group_elem_copy (gr_elem_t copy, const gr_elem_t el)  { EC_POINT_copy(copy, el);}
 
 void group_elem_to_bytes (uint8_t **bytes, uint64_t byte_len, gr_elem_t el, const ec_group_t ec, int move_to_end)
 {
-  BN_CTX *bn_ctx = BN_CTX_secure_new();
-  EC_POINT_point2oct(ec, el, POINT_CONVERSION_COMPRESSED, *bytes, byte_len, bn_ctx);
+  BN_CTX *bn_ctx = bn_ctx_acquire(0);
+  EC_POINT_point2oct(ec->group, el, POINT_CONVERSION_COMPRESSED, *bytes, byte_len, bn_ctx);
   if (move_to_end) *bytes += byte_len;
-  BN_CTX_free(bn_ctx);
+  bn_ctx_release(bn_ctx);
 }
 
 int group_elem_from_bytes (gr_elem_t el, uint8_t **bytes, uint64_t byte_len, const ec_group_t ec, int move_to_end)
 {
-  BN_CTX *bn_ctx = BN_CTX_secure_new();
-  int ret = EC_POINT_oct2point(ec, el, *bytes, byte_len, bn_ctx);
+  BN_CTX *bn_ctx = bn_ctx_acquire(0);
+  int ret = EC_POINT_oct2point(ec->group, el, *bytes, byte_len, bn_ctx);
   if (move_to_end) *bytes += byte_len;
-  BN_CTX_free(bn_ctx);
+  bn_ctx_release(bn_ctx);
   return ret != 1;
 }
 
+// Returns window_bits bits of little-endian encoded exponent, starting at bit_pos (bits beyond exponent are 0)
+static uint64_t exp_window_digit (const uint8_t exp_bytes[GROUP_ORDER_BYTES], uint64_t bit_pos, uint64_t window_bits)
+{
+  uint64_t digit = 0;
+  for (uint64_t b = 0; b < window_bits; ++b, ++bit_pos)
+  {
+    if (bit_pos < 8*GROUP_ORDER_BYTES) digit |= ((uint64_t) (exp_bytes[bit_pos / 8] >> (bit_pos % 8)) & 1) << b;
+  }
+  return digit;
+}
+
+void group_elem_batch_normalize (gr_elem_t *els, uint64_t count, const ec_group_t ec)
+{
+  BN_CTX *bn_ctx = bn_ctx_acquire(0);
+  EC_POINTs_make_affine(ec->group, count, els, bn_ctx);
+  bn_ctx_release(bn_ctx);
+}
+
+// Constant-time ladder of OpenSSL (only generator scalar is set). The generator table isn't used, as masked reads of it would still be added by EC_POINT_add, which isn't constant-time.
+void group_generator_mul (gr_elem_t result, const scalar_t exp, const ec_group_t ec)
+{
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
+  EC_POINT_mul(ec->group, result, exp, NULL, NULL, bn_ctx);
+  bn_ctx_release(bn_ctx);
+}
+
+/**
+ *  Computes generator^exp by adding a single table entry per window of exp (reduced modulo group order).
+ *  Table index and skipping of zero digits depend on exp, so only for public exp.
+ */
+void group_generator_mul_vartime (gr_elem_t result, const scalar_t exp, const ec_group_t ec)
+{
+  BN_CTX *bn_ctx = bn_ctx_acquire(0);
+
+  scalar_t reduced_exp = BN_CTX_get(bn_ctx);
+  BN_nnmod(reduced_exp, exp, ec_group_order(ec), bn_ctx);
+
+  uint8_t exp_bytes[GROUP_ORDER_BYTES];
+  BN_bn2lebinpad(reduced_exp, exp_bytes, GROUP_ORDER_BYTES);
+
+  EC_POINT_set_to_infinity(ec->group, result);
+
+  for (uint64_t i = 0; i < GEN_TABLE_WINDOWS; ++i)
+  {
+    uint64_t digit = exp_window_digit(exp_bytes, i * GEN_TABLE_WINDOW_BITS, GEN_TABLE_WINDOW_BITS);
+    if (digit) EC_POINT_add(ec->group, result, result, ec->gen_table[i * GEN_TABLE_ENTRIES + digit - 1], bn_ctx);
+  }
+
+  bn_ctx_release(bn_ctx);
+}
+
+#define STRAUS_WINDOW_BITS 4
+#define STRAUS_WINDOWS ((8*GROUP_ORDER_BYTES + STRAUS_WINDOW_BITS - 1) / STRAUS_WINDOW_BITS)
+#define STRAUS_ENTRIES ((1 << STRAUS_WINDOW_BITS) - 1)
+#define PIPPENGER_MIN_COUNT 64
+
+/**
+ *  Straus (interleaved fixed windows): table of base^d for each base, sharing the doublings between all bases.
+ */
+static void group_multi_exp_straus (gr_elem_t result, const gr_elem_t *bases, const uint8_t *exp_bytes, uint64_t count, const ec_group_t ec, BN_CTX *bn_ctx)
+{
+  gr_elem_t *table = calloc(count * STRAUS_ENTRIES, sizeof(gr_elem_t));
+
+  for (uint64_t i = 0; i < count; ++i)
+  {
+    gr_elem_t *base_table = table + i * STRAUS_ENTRIES;
+
+    base_table[0] = EC_POINT_dup(bases[i], ec->group);
+    for (uint64_t d = 1; d < STRAUS_ENTRIES; ++d)
+    {
+      base_table[d] = EC_POINT_new(ec->group);
+      EC_POINT_add(ec->group, base_table[d], base_table[d-1], bases[i], bn_ctx);
+    }
+  }
+  EC_POINTs_make_affine(ec->group, count * STRAUS_ENTRIES, table, bn_ctx);
+
+  EC_POINT_set_to_infinity(ec->group, result);
+
+  for (uint64_t w = STRAUS_WINDOWS; w-- > 0; )
+  {
+    for (uint64_t b = 0; b < STRAUS_WINDOW_BITS; ++b) EC_POINT_dbl(ec->group, result, result, bn_ctx);
+
+    for (uint64_t i = 0; i < count; ++i)
+    {
+      uint64_t digit = exp_window_digit(exp_bytes + i * GROUP_ORDER_BYTES, w * STRAUS_WINDOW_BITS, STRAUS_WINDOW_BITS);
+      if (digit) EC_POINT_add(ec->group, result, result, table[i * STRAUS_ENTRIES + digit - 1], bn_ctx);
+    }
+  }
+
+  for (uint64_t i = 0; i < count * STRAUS_ENTRIES; ++i) EC_POINT_free(table[i]);
+  free(table);
+}
+
+/**
+ *  Pippenger (bucket method): per window, sort bases into buckets by digit, then sum buckets weighted by digit using running sums.
+ */
+static void group_multi_exp_pippenger (gr_elem_t result, const gr_elem_t *bases, const uint8_t *exp_bytes, uint64_t count, const ec_group_t ec, BN_CTX *bn_ctx)
+{
+  uint64_t window_bits = 2;
+  while ((1UL << (window_bits + 2)) < count) ++window_bits;
+
+  uint64_t num_windows = (8*GROUP_ORDER_BYTES + window_bits - 1) / window_bits;
+  uint64_t num_buckets = (1UL << window_bits) - 1;
+
+  gr_elem_t *buckets = calloc(num_buckets, sizeof(gr_elem_t));
+  for (uint64_t d = 0; d < num_buckets; ++d) buckets[d] = EC_POINT_new(ec->group);
+  gr_elem_t running_sum = EC_POINT_new(ec->group);
+  gr_elem_t window_sum = EC_POINT_new(ec->group);
+
+  EC_POINT_set_to_infinity(ec->group, result);
+
+  for (uint64_t w = num_windows; w-- > 0; )
+  {
+    for (uint64_t b = 0; b < window_bits; ++b) EC_POINT_dbl(ec->group, result, result, bn_ctx);
+
+    for (uint64_t d = 0; d < num_buckets; ++d) EC_POINT_set_to_infinity(ec->group, buckets[d]);
+
+    for (uint64_t i = 0; i < count; ++i)
+    {
+      uint64_t digit = exp_window_digit(exp_bytes + i * GROUP_ORDER_BYTES, w * window_bits, window_bits);
+      if (digit) EC_POINT_add(ec->group, buckets[digit - 1], buckets[digit - 1], bases[i], bn_ctx);
+    }
+
+    // window_sum = sum of d * bucket[d]
+    EC_POINT_set_to_infinity(ec->group, running_sum);
+    EC_POINT_set_to_infinity(ec->group, window_sum);
+    for (uint64_t d = num_buckets; d-- > 0; )
+    {
+      EC_POINT_add(ec->group, running_sum, running_sum, buckets[d], bn_ctx);
+      EC_POINT_add(ec->group, window_sum, window_sum, running_sum, bn_ctx);
+    }
+
+    EC_POINT_add(ec->group, result, result, window_sum, bn_ctx);
+  }
+
+  for (uint64_t d = 0; d < num_buckets; ++d) EC_POINT_free(buckets[d]);
+  free(buckets);
+  EC_POINT_free(running_sum);
+  EC_POINT_free(window_sum);
+}
+
+/**
+ *  Computes product of bases[i]^scalars[i]. Unit exponents are just added, generator bases use the generator table,
+ *  and the rest are computed together by Straus (few bases) or Pippenger (many bases).
+ */
+void group_multi_exp (gr_elem_t result, const gr_elem_t *bases, const scalar_t *scalars, uint64_t count, const ec_group_t ec)
+{
+  BN_CTX *bn_ctx = bn_ctx_acquire(0);
+
+  // Accumulate separately, since result may be one of the bases
+  gr_elem_t acc = group_elem_new(ec);
+  gr_elem_t temp = group_elem_new(ec);
+  EC_POINT_set_to_infinity(ec->group, acc);
+
+  gr_elem_t *exp_bases = calloc(count, sizeof(gr_elem_t));
+  uint8_t *exp_bytes = calloc(count, GROUP_ORDER_BYTES);
+  uint64_t num_exp = 0;
+
+  scalar_t reduced_exp = BN_CTX_get(bn_ctx);
+
+  for (uint64_t i = 0; i < count; ++i)
+  {
+    if (!scalars || !scalars[i])
+    {
+      EC_POINT_add(ec->group, acc, acc, bases[i], bn_ctx);
+    }
+    else if (bases[i] == ec_group_generator(ec))
+    {
+      group_generator_mul_vartime(temp, scalars[i], ec);
+      EC_POINT_add(ec->group, acc, acc, temp, bn_ctx);
+    }
+    else
+    {
+      BN_nnmod(reduced_exp, scalars[i], ec_group_order(ec), bn_ctx);
+      BN_bn2lebinpad(reduced_exp, exp_bytes + num_exp * GROUP_ORDER_BYTES, GROUP_ORDER_BYTES);
+      exp_bases[num_exp++] = bases[i];
+    }
+  }
+
+  if (num_exp > 0)
+  {
+    if (num_exp >= PIPPENGER_MIN_COUNT) group_multi_exp_pippenger(temp, exp_bases, exp_bytes, num_exp, ec, bn_ctx);
+    else group_multi_exp_straus(temp, exp_bases, exp_bytes, num_exp, ec, bn_ctx);
+
+    EC_POINT_add(ec->group, acc, acc, temp, bn_ctx);
+  }
+
+  EC_POINT_copy(result, acc);
+
+  free(exp_bases);
+  free(exp_bytes);
+  group_elem_free(acc);
+  group_elem_free(temp);
+  bn_ctx_release(bn_ctx);
+}
+
 /**
  *  Computes initial * base^exp. If initial == NULL, assume identity. If initial and base are set, exp==NULL means exp=1
  */
@@ -208,51 +1278,89 @@ void group_operation (gr_elem_t result, const gr_elem_t initial, const gr_elem_t
 {
   if (!base) 
   {
-    EC_POINT_set_to_infinity(ec, result);
+    EC_POINT_set_to_infinity(ec->group, result);
     return;
   }
 
-  BN_CTX *bn_ctx = BN_CTX_secure_new();
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
   
   if (!initial)
   {
-    EC_POINT_mul(ec, result, NULL, base, exp, bn_ctx);
+    EC_POINT_mul(ec->group, result, NULL, base, exp, bn_ctx);
   }
   else  // initial and base are set
   {
     if (!exp)
     {
-      EC_POINT_add(ec, result, initial, base, bn_ctx);
+      EC_POINT_add(ec->group, result, initial, base, bn_ctx);
     }
     else // exp also set
     {
       gr_elem_t temp_res = group_elem_new(ec);
-      EC_POINT_mul(ec, temp_res, NULL, base, exp, bn_ctx);
-      EC_POINT_add(ec, result, initial, temp_res, bn_ctx);
+      EC_POINT_mul(ec->group, temp_res, NULL, base, exp, bn_ctx);
+      EC_POINT_add(ec->group, result, initial, temp_res, bn_ctx);
       group_elem_free(temp_res);
     }
   }
   
-  BN_CTX_free(bn_ctx);
+  bn_ctx_release(bn_ctx);
 }
 
 int group_elem_equal (const gr_elem_t a, const gr_elem_t b, const ec_group_t ec)
 {
-  BN_CTX *bn_ctx = BN_CTX_secure_new();
-  int equal = EC_POINT_cmp(ec, a, b, bn_ctx) == 0;
-  BN_CTX_free(bn_ctx);
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
+  int equal = EC_POINT_cmp(ec->group, a, b, bn_ctx) == 0;
+  bn_ctx_release(bn_ctx);
   return equal;
 }
 
 int group_elem_is_ident(const gr_elem_t a, const ec_group_t ec)
 {
-  return EC_POINT_is_at_infinity(ec, a) == 1;
+  return EC_POINT_is_at_infinity(ec->group, a) == 1;
 }
 
 void group_elem_get_x (scalar_t x, const gr_elem_t point, const ec_group_t ec, scalar_t modulus)
 {
-  BN_CTX *bn_ctx = BN_CTX_secure_new();
-  EC_POINT_get_affine_coordinates(ec, point, x, NULL, bn_ctx);
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
+  EC_POINT_get_affine_coordinates(ec->group, point, x, NULL, bn_ctx);
   BN_mod(x, x, modulus, bn_ctx);
-  BN_CTX_free(bn_ctx);
-}
\ No newline at end of file
+  bn_ctx_release(bn_ctx);
+}
+
+void group_elem_get_affine (scalar_t x, scalar_t y, const gr_elem_t point, const ec_group_t ec)
+{
+  if (group_elem_is_ident(point, ec))
+  {
+    if (x) BN_zero(x);
+    if (y) BN_zero(y);
+    return;
+  }
+
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
+  EC_POINT_get_affine_coordinates(ec->group, point, x, y, bn_ctx);
+  bn_ctx_release(bn_ctx);
+}
+
+#endif
+
+void group_elem_batch_to_bytes (uint8_t **bytes, uint64_t byte_len, gr_elem_t *els, uint64_t count, const ec_group_t ec, int move_to_end)
+{
+  group_elem_batch_normalize(els, count, ec);
+
+  uint8_t *write_bytes = *bytes;
+  for (uint64_t i = 0; i < count; ++i) group_elem_to_bytes(&write_bytes, byte_len, els[i], ec, 1);
+  if (move_to_end) *bytes = write_bytes;
+}
+
+void group_operation_vartime (gr_elem_t result, const gr_elem_t initial, const gr_elem_t base, const scalar_t exp, const ec_group_t ec)
+{
+  if (!base)
+  {
+    group_operation(result, initial, base, exp, ec);
+    return;
+  }
+
+  gr_elem_t bases[2] = {base, initial};
+  scalar_t  exps[2]  = {exp, NULL};
+  group_multi_exp(result, bases, exps, initial ? 2 : 1, ec);
+}
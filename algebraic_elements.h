@@ -6,6 +6,7 @@
  *  Description: 
  *  Working with basic algebraic elements: elliptic curve groups (multiplicative notation), ec group elements and modulus ring scalars.
  *  Most functions are just simple wrappers of corresponding openssl functions.
+ *  When built with NATIVE_SECP256K1, group elements and operations are implemented natively by secp256k1_native instead of openssl EC_POINT.
  *  Some functions are a bit more then a wrapper to openssl, and handle parameters in more care, e.g.:
  *  scalar_exp which supports negative exponenet (as opposed to openssl), and group_operation which allows for NULL parameters (see below).
  * 
@@ -13,6 +14,11 @@
  *  All three types (ec_group_t, gr_elem_t, scalar_t) have constructures/destructures <...>_new and <...>_free. Freeing NULL doesn't do anything.
  *  All scalars (especially in modulus ring) are returned as non-negative, aside from the functions scalar_negate and scalar_make_signed.
  *  In <...>_to_bytes functions, if byte_len is bigger then needed bytes for element encoding, bytes buffer is padded with zeros. If smaller, nothing is changed.
+ *  BN_CTX used by all primitives is taken from a thread-local pool (bn_ctx_acquire/bn_ctx_release), instead of allocating a new one per call.
+ *  Transient scalars and group elements of a round or proof can be taken from an arena_t instead of <...>_new, and are zeroized and released together by arena_free.
+ *  Functions suffixed _vartime are the public tier: variable time (sliding windows, wNAF/Straus) and non-secure memory. Use only when all inputs are public (verifiers).
+ *  Repeated exponentiations by the same public exponent (e.g. Paillier N) can precompute its recoding once (fixed_exp_t) and reuse it with scalar_exp_fixed_exp.
+ *  order_scalar_t is a fixed-width (stack/inline) scalar modulo the group order, for secrets and shares. Its arithmetic is constant-time and allocation free.
  * 
  */
 
@@ -23,15 +29,93 @@
 #include <openssl/bn.h>
 #include <openssl/ec.h>
 #include <openssl/objects.h>
+#include <openssl/crypto.h>
 
 #define GROUP_ID NID_secp256k1
 #define GROUP_ORDER_BYTES 32
 #define GROUP_ELEMENT_BYTES 33
 
-typedef EC_GROUP *ec_group_t;
+#ifdef NATIVE_SECP256K1
+#include "secp256k1_native.h"
+typedef secp256k1_point_t *gr_elem_t;
+#else
 typedef EC_POINT *gr_elem_t;
+#endif
+
 typedef BIGNUM *scalar_t;
 
+typedef struct
+{
+  EC_GROUP *group;
+  gr_elem_t generator;
+  gr_elem_t *gen_table;   // Precomputed multiples of the generator, used by group_generator_mul_vartime (and constant-time group_generator_mul of native backend)
+} ec_group_st;
+
+typedef ec_group_st *ec_group_t;
+
+// Scalars are bump allocated from the thread's pooled (secure) BN_CTX, so after warm-up they cost no allocation. Group elements are allocated and tracked.
+typedef struct
+{
+  BN_CTX *bn_ctx;
+  scalar_t *scalars;
+  uint64_t num_scalars;
+  uint64_t scalars_capacity;
+  gr_elem_t *elements;
+  uint64_t num_elements;
+  uint64_t elements_capacity;
+} arena_st;
+
+typedef arena_st *arena_t;
+
+// Montgomery precomputation of a fixed (odd) modulus, built lazily on first use (thread-safe). Kept alongside long lived keys.
+typedef struct
+{
+  BN_MONT_CTX *bn_mont;
+  CRYPTO_RWLOCK *lock;
+} mont_ctx_st;
+
+typedef mont_ctx_st *mont_ctx_t;
+
+// Precomputed powers of a fixed (public) base: base^(d * 2^(FIXED_BASE_WINDOW_BITS * i)) in Montgomery form, for each window i and digit 0 < d < 2^FIXED_BASE_WINDOW_BITS
+// Powers are stored flat, num_words words each (little-endian bytes as by BN_bn2lebinpad), so they can be read by masked scan.
+typedef struct
+{
+  uint64_t *powers;
+  uint64_t num_words;
+  uint64_t num_windows;
+  BN_MONT_CTX *bn_mont;
+} fixed_base_st;
+
+typedef fixed_base_st *fixed_base_t;
+
+// Sliding window recoding of a fixed (public) exponent: starting from base^digits[0], for each later step square squarings[k] times then multiply by base^digits[k] (odd digits < 2^window_bits), finally square final_squarings times
+typedef struct
+{
+  uint64_t window_bits;
+  uint64_t num_steps;
+  uint64_t *squarings;
+  uint64_t *digits;
+  uint64_t final_squarings;
+} fixed_exp_st;
+
+typedef fixed_exp_st *fixed_exp_t;
+
+// Scalar modulo the (secp256k1) group order, 4 little-endian 64-bit limbs, always fully reduced
+typedef uint64_t order_scalar_t[4];
+
+// Returns the calling thread's pooled BN_CTX (secure or non-secure variant), inside a new BN_CTX_start frame.
+// Each acquire must be matched by bn_ctx_release in the same thread, in reverse order. Pool is freed at thread exit, values of secure variant are cleared when its outermost frame is released.
+BN_CTX *  bn_ctx_acquire           (int secure);
+void      bn_ctx_release           (BN_CTX *bn_ctx);
+
+// Arena holds a bn_ctx_acquire frame, so arenas (and acquires) must be freed in reverse order of creation in the same thread.
+arena_t   arena_new                ();
+// Zeroizes and releases all scalars and group elements taken from the arena
+void      arena_free               (arena_t arena);
+// Same as scalar_new/group_elem_new, but owned by arena (must not be freed separately)
+scalar_t  arena_scalar_new         (arena_t arena);
+gr_elem_t arena_group_elem_new     (arena_t arena, const ec_group_t ec);
+
 scalar_t  scalar_new               ();
 void      scalar_free              (scalar_t num);
 void      scalar_copy              (scalar_t copy, const scalar_t num);
@@ -52,13 +136,66 @@ void      scalar_negate            (scalar_t result, const scalar_t num);
 void      scalar_complement        (scalar_t result, const scalar_t num, const scalar_t modulus);
 void      scalar_mul               (scalar_t result, const scalar_t first, const scalar_t second, const scalar_t modulus);
 void      scalar_inv               (scalar_t result, const scalar_t num, const scalar_t modulus);
+// Inverts all nums (modulo modulus) using a single modular inversion (Montgomery's trick). All nums must be invertible. results[i] can be nums[i].
+void      scalar_batch_inv         (scalar_t *results, const scalar_t *nums, uint64_t count, const scalar_t modulus);
 // Computes base^exp (mod modulus), supports exp negative coprime to modulus (fails if not coprime). 
 void      scalar_exp               (scalar_t result, const scalar_t base, const scalar_t exp, const scalar_t modulus);
+// Same as scalar_exp, reusing Montgomery precomputation of modulus kept in mont (built if needed). mont==NULL falls back to scalar_exp.
+void      scalar_exp_mont          (scalar_t result, const scalar_t base, const scalar_t exp, const scalar_t modulus, mont_ctx_t mont);
+// Same as scalar_exp_mont, for public inputs only (variable time, non-secure memory)
+void      scalar_exp_vartime       (scalar_t result, const scalar_t base, const scalar_t exp, const scalar_t modulus, mont_ctx_t mont);
+// Computes results[i] = bases[i]^exps[i] (mod odd modulus) for i < count, same as scalar_exp_mont on each. results[i] can be bases[i].
+// Runs up to MULTI_LANE_EXP_LANES exponentiations together on the multi-lane (SIMD) engine when the CPU supports it (see multi_lane_exp.h).
+void      scalar_exp_batch         (scalar_t *results, const scalar_t *bases, const scalar_t *exps, uint64_t count, const scalar_t modulus, mont_ctx_t mont);
+// Computes product of bases[i]^exps[i] (mod odd modulus) for i < count, with interleaved fixed windows over all exponents (Shamir's trick), so few bases cost close to a single exponentiation.
+// Exponents can be negative (base is inverted). mont==NULL computes Montgomery precomputation for this call only.
+// Returns 0/1 for success/error (some base with negative exponent isn't coprime to modulus, result is set to zero).
+// Operations and memory accesses depend only on count, modulus and max_exp_bits (public bound of exponents' bit length, a longer exponent extends it).
+// The _vartime variant windows by the longest exponent and skips zero windows, for public inputs only.
+int       scalar_multi_exp         (scalar_t result, const scalar_t *bases, const scalar_t *exps, uint64_t count, uint64_t max_exp_bits, const scalar_t modulus, mont_ctx_t mont);
+int       scalar_multi_exp_vartime (scalar_t result, const scalar_t *bases, const scalar_t *exps, uint64_t count, const scalar_t modulus, mont_ctx_t mont);
+
+// Table for exponents of up to max_exp_bits bits (absolute value)
+fixed_base_t  scalar_fixed_base_new     (const scalar_t base, uint64_t max_exp_bits, const scalar_t modulus);
+void          scalar_fixed_base_free    (fixed_base_t table);
+// Longest exponent (bits of absolute value) covered by table, 0 for NULL table
+uint64_t      scalar_fixed_base_max_exp_bits (const fixed_base_t table);
+// Copy of table (NULL if table is NULL)
+fixed_base_t  scalar_fixed_base_dup     (const fixed_base_t table);
+// Flat bytes of table for exponents up to max_exp_bits: all powers (in Montgomery form) of modulus_bytes each, all zero for NULL table. Read back without any exponentiation.
+void          scalar_fixed_base_to_bytes   (uint8_t **bytes, uint64_t *byte_len, const fixed_base_t table, uint64_t max_exp_bits, uint64_t modulus_bytes, int move_to_end);
+void          scalar_fixed_base_from_bytes (fixed_base_t *table, uint8_t **bytes, uint64_t *byte_len, uint64_t max_exp_bits, const scalar_t modulus, uint64_t modulus_bytes, int move_to_end);
+// Computes product of (base of tables[i])^|exps[i]| for i < count using only multiplications, all tables must be of the same modulus. 
+// Returns 0/1 for success/error (some exponent too long for its table, nothing computed). The _vartime variant skips zero digits, for public inputs only.
+int           scalar_fixed_base_multi_exp         (scalar_t result, const fixed_base_t *tables, const scalar_t *exps, uint64_t count);
+int           scalar_fixed_base_multi_exp_vartime (scalar_t result, const fixed_base_t *tables, const scalar_t *exps, uint64_t count);
+// Same for signed exps[i]: tables[i] of base for positive and inv_tables[i] (same length) of base's inverse for negative exponent. Constant time variant reads both, selected by exponent's sign by mask.
+int           scalar_fixed_base_signed_multi_exp         (scalar_t result, const fixed_base_t *tables, const fixed_base_t *inv_tables, const scalar_t *exps, uint64_t count);
+int           scalar_fixed_base_signed_multi_exp_vartime (scalar_t result, const fixed_base_t *tables, const fixed_base_t *inv_tables, const scalar_t *exps, uint64_t count);
+// Recoding of non-negative exp, window size chosen to minimize total multiplications for this exponent
+fixed_exp_t   scalar_fixed_exp_new      (const scalar_t exp);
+void          scalar_fixed_exp_free     (fixed_exp_t recoding);
+// Computes base^exp (mod odd modulus) following exp's recoding. Operations depend only on (public) exp, so base can be secret. mont==NULL same as in scalar_multi_exp.
+void          scalar_exp_fixed_exp      (scalar_t result, const scalar_t base, const fixed_exp_t recoding, const scalar_t modulus, mont_ctx_t mont);
 // Convert num (after modulus) from range  [0 ... modulus) to [-modulus/2 ... modulus/2) for modulos = 2^bits
 void      scalar_make_signed       (scalar_t num, const scalar_t range);
 // Inverse of scalar_make_signed
 void      scalar_make_unsigned     (scalar_t num, const scalar_t range);
 
+mont_ctx_t  mont_ctx_new        ();
+void        mont_ctx_free       (mont_ctx_t mont);
+// Drops precomputation, must be called whenever the modulus it was built for changes
+void        mont_ctx_reset      (mont_ctx_t mont);
+
+// Reduces any (also negative) scalar modulo the group order
+void      order_scalar_from_scalar (order_scalar_t result, const scalar_t num);
+void      order_scalar_to_scalar   (scalar_t result, const order_scalar_t num);
+void      order_scalar_add         (order_scalar_t result, const order_scalar_t first, const order_scalar_t second);
+void      order_scalar_sub         (order_scalar_t result, const order_scalar_t first, const order_scalar_t second);
+void      order_scalar_mul         (order_scalar_t result, const order_scalar_t first, const order_scalar_t second);
+// Inverse by Fermat's little theorem (inverse of zero is zero)
+void      order_scalar_inv         (order_scalar_t result, const order_scalar_t num);
+void      order_scalar_clear       (order_scalar_t num);
 
 ec_group_t  ec_group_new        ();
 void        ec_group_free       (ec_group_t ec);
@@ -71,11 +208,27 @@ void        group_elem_copy       (gr_elem_t copy, const gr_elem_t el);
 int         group_elem_equal      (const gr_elem_t a, const gr_elem_t b, const ec_group_t ec);
 int         group_elem_is_ident   (const gr_elem_t a, const ec_group_t ec);
 void        group_elem_get_x      (scalar_t x, const gr_elem_t a, const ec_group_t ec, scalar_t modulus);
+// Affine coordinates of a (zero for identity), x or y can be NULL
+void        group_elem_get_affine (scalar_t x, scalar_t y, const gr_elem_t a, const ec_group_t ec);
 // If byte_len too small, does nothing
 void        group_elem_to_bytes   (uint8_t **bytes, uint64_t byte_len, const gr_elem_t el, const ec_group_t ec, int move_to_end);
 // Returns 0/1 for success/error
 int         group_elem_from_bytes (gr_elem_t el, uint8_t **bytes, uint64_t byte_len, const ec_group_t ec, int move_to_end);
+// Converts all elements to affine representation (same values) with a single field inversion, making following encodings and comparisons cheaper.
+void        group_elem_batch_normalize (gr_elem_t *els, uint64_t count, const ec_group_t ec);
+// Encodes count elements consecutively (byte_len each), after batch normalizing them.
+void        group_elem_batch_to_bytes  (uint8_t **bytes, uint64_t byte_len, gr_elem_t *els, uint64_t count, const ec_group_t ec, int move_to_end);
 // Compute initial*(base^exp) in the group. base==NULL retuns identity element of the group. initial==NULL used as identity. exp==NULL used as 1.
 void        group_operation       (gr_elem_t result, const gr_elem_t initial, const gr_elem_t base, const scalar_t exp, const ec_group_t ec);
+// Same as group_operation, for public inputs only (variable time, using group_multi_exp)
+void        group_operation_vartime (gr_elem_t result, const gr_elem_t initial, const gr_elem_t base, const scalar_t exp, const ec_group_t ec);
+// Compute generator^exp (constant-time). exp can be any (also negative) scalar.
+// Native backend adds masked reads of the generator table, OpenSSL backend is EC_POINT_mul's ladder (its point addition isn't constant-time, so the table isn't used there).
+void        group_generator_mul   (gr_elem_t result, const scalar_t exp, const ec_group_t ec);
+// Same as group_generator_mul, using the table precomputed at ec_group_new, for public exp only (variable time).
+void        group_generator_mul_vartime (gr_elem_t result, const scalar_t exp, const ec_group_t ec);
+// Compute product of bases[i]^scalars[i] for i < count (Straus for small count, Pippenger for large). scalars==NULL or scalars[i]==NULL used as 1.
+// Variable time, only for public values (verification, aggregation).
+void        group_multi_exp       (gr_elem_t result, const gr_elem_t *bases, const scalar_t *scalars, uint64_t count, const ec_group_t ec);
 
 #endif
\ No newline at end of file
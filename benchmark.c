@@ -2,6 +2,7 @@
 #include "common.h"
 #include "tests.h"
 #include "cmp_protocol.h"
+#include "cmp_keystore.h"
 
 #include <assert.h>
 #include <time.h>
@@ -71,6 +72,63 @@ ring_pedersen_private_t *time_ring_pedersen_generate_param(uint64_t rped_modulus
   return priv;
 }
 
+// Sets key (key_bytes) from hex digits of environment variable, returns 0 if not set or wrong length
+int read_key_from_env(uint8_t *key, uint64_t key_bytes, const char *env_name)
+{
+  const char *key_hex = getenv(env_name);
+  if (!key_hex || (strlen(key_hex) != 2 * key_bytes))
+  {
+    printf("%s must be %lu hex digits\n", env_name, 2 * key_bytes);
+    return 0;
+  }
+  for (uint64_t i = 0; i < key_bytes; ++i) sscanf(key_hex + 2*i, "%2hhx", &key[i]);
+  return 1;
+}
+
+// Prime pool file and key (64 hex digits) are given by environment variables, returns NULL if not set or failed to open
+prime_pool_t *open_prime_pool_from_env()
+{
+  const char *path = getenv("CMP_PRIME_POOL");
+  if (!path) return NULL;
+
+  uint8_t key[PRIME_POOL_KEY_BYTES];
+  if (!read_key_from_env(key, PRIME_POOL_KEY_BYTES, "CMP_PRIME_POOL_KEY")) return NULL;
+
+  prime_pool_t *pool = prime_pool_open(path, key);
+  OPENSSL_cleanse(key, sizeof(key));
+  if (!pool) printf("Failed opening prime pool %s (wrong key?)\n", path);
+
+  return pool;
+}
+
+void print_prime_pool_metrics(prime_pool_t *pool)
+{
+  prime_pool_metrics_t metrics;
+  prime_pool_get_metrics(pool, &metrics);
+
+  printf("# prime pool: %lu available (%lu paillier, %lu ring pedersen)\n", metrics.available,
+    prime_pool_available(pool, 4*PAILLIER_MODULUS_BYTES, PRIME_KIND_BLUM), prime_pool_available(pool, 4*RING_PED_MODULUS_BYTES, PRIME_KIND_SAFE));
+  printf("# appended: %lu, popped: %lu, pop misses: %lu, rejected: %lu\n", metrics.appended, metrics.popped, metrics.pop_misses, metrics.rejected);
+  printf("# generated: %lu, generation time: %lu msec (wall)\n", metrics.generated, metrics.generation_ms);
+}
+
+void time_safe_primes(uint64_t reps, uint64_t prime_bits)
+{
+  scalar_t prime = scalar_new();
+
+  start = clock();
+  for (uint64_t i = 0; i < reps; ++i) BN_generate_prime_ex(prime, prime_bits, 1, NULL, NULL, NULL);
+  diff = clock() - start;
+  printf("# safe primes (%lu bits) by BN_generate_prime_ex\n%lu repetitions, time: %lu msec, avg: %f msec\n", prime_bits, reps, diff * 1000/ CLOCKS_PER_SEC, ((double) diff * 1000/ CLOCKS_PER_SEC) / reps);
+
+  start = clock();
+  for (uint64_t i = 0; i < reps; ++i) prime_generate(prime, prime_bits, PRIME_KIND_SAFE, 1);
+  diff = clock() - start;
+  printf("# safe primes (%lu bits) by combined sieve\n%lu repetitions, time: %lu msec, avg: %f msec\n", prime_bits, reps, diff * 1000/ CLOCKS_PER_SEC, ((double) diff * 1000/ CLOCKS_PER_SEC) / reps);
+
+  scalar_free(prime);
+}
+
 void time_hashing(uint64_t reps, const uint8_t* data, uint64_t data_len)
 { 
   unsigned char digest[512];
@@ -122,10 +180,71 @@ void time_paillier_encrypt(uint64_t reps, paillier_public_key_t *pub, unsigned l
   scalar_free(randomness);
 }
 
+// Regular vs short exponent randomness: encryption (public and own key), and verifier's Enc(z, w) * C^e with response sized randomness
+void time_paillier_short_exp(uint64_t reps, const paillier_private_key_t *priv)
+{
+  paillier_private_key_t *short_priv = paillier_encryption_private_new();
+  paillier_public_key_t *pubs[2] = {paillier_encryption_public_new(), paillier_encryption_public_new()};
+  paillier_encryption_copy_keys(short_priv, pubs[0], priv, NULL);
+
+  start = clock();
+  paillier_encryption_short_exp_setup(short_priv);
+  paillier_encryption_copy_keys(NULL, pubs[1], short_priv, NULL);
+  diff = clock() - start;
+  printf("# Paillier short exponent setup (h_N and tables of private and public key), time: %lu msec\n", diff * 1000/ CLOCKS_PER_SEC);
+
+  const paillier_private_key_t *privs[2] = {priv, short_priv};
+  const char *mode_names[2] = {"regular", "short exponent"};
+
+  scalar_t plaintext = scalar_new();
+  scalar_t ciphertext = scalar_new();
+  scalar_t randomness = scalar_new();
+  scalar_t e = scalar_new();
+  scalar_sample_in_range(plaintext, priv->N, 0);
+  BN_rand(e, 256, BN_RAND_TOP_ANY, BN_RAND_BOTTOM_ANY);
+
+  for (int mode = 0; mode < 2; ++mode)
+  {
+    start = clock();
+    for (uint64_t i = 0; i < reps; ++i)
+    {
+      paillier_encryption_sample(randomness, pubs[mode]);
+      paillier_encryption_encrypt(ciphertext, plaintext, randomness, pubs[mode]);
+    }
+    diff = clock() - start;
+    printf("# Paillier %s sample and encrypt\n%lu repetitions, time: %lu msec, avg: %f msec\n", mode_names[mode], reps, diff * 1000/ CLOCKS_PER_SEC, ((double) diff * 1000/ CLOCKS_PER_SEC) / reps);
+
+    start = clock();
+    for (uint64_t i = 0; i < reps; ++i)
+    {
+      paillier_encryption_sample(randomness, pubs[mode]);
+      paillier_encryption_encrypt_private(ciphertext, plaintext, randomness, privs[mode]);
+    }
+    diff = clock() - start;
+    printf("# Paillier %s sample and encrypt under own key\n%lu repetitions, time: %lu msec, avg: %f msec\n", mode_names[mode], reps, diff * 1000/ CLOCKS_PER_SEC, ((double) diff * 1000/ CLOCKS_PER_SEC) / reps);
+
+    start = clock();
+    for (uint64_t i = 0; i < reps; ++i)
+    {
+      paillier_encryption_sample_mask(randomness, pubs[mode]);
+      paillier_encryption_encrypt_multi_exp_vartime(ciphertext, plaintext, randomness, &ciphertext, &e, 1, pubs[mode]);
+    }
+    diff = clock() - start;
+    printf("# Paillier %s verifier Enc(z, w) * C^e\n%lu repetitions, time: %lu msec, avg: %f msec\n", mode_names[mode], reps, diff * 1000/ CLOCKS_PER_SEC, ((double) diff * 1000/ CLOCKS_PER_SEC) / reps);
+  }
+
+  scalar_free(plaintext);
+  scalar_free(ciphertext);
+  scalar_free(randomness);
+  scalar_free(e);
+  paillier_encryption_free_keys(short_priv, pubs[0]);
+  paillier_encryption_free_keys(NULL, pubs[1]);
+}
+
 void time_bn_ctx(uint64_t reps)
 {
   ec_group_t ec = ec_group_new();
-  gr_elem_t el = group_elem_new(ec);
+  EC_POINT *el = EC_POINT_new(ec->group);
   //uint8_t el_bytes[GROUP_ELEMENT_BYTES];
 
   scalar_t a[10];
@@ -147,7 +266,7 @@ void time_bn_ctx(uint64_t reps)
   for (uint64_t i = 0; i < reps; ++i)
   {
     bn_ctx_arr[i] = BN_CTX_secure_new();
-    EC_POINT_mul(ec, el, a[0], NULL, NULL, bn_ctx_arr[i]);
+    EC_POINT_mul(ec->group, el, a[0], NULL, NULL, bn_ctx_arr[i]);
     scalar_add(a[0], a[0], a[1], ec_group_order(ec));
   }
 
@@ -167,15 +286,33 @@ void time_bn_ctx(uint64_t reps)
   BN_CTX *bn_ctx = BN_CTX_secure_new();
   for (uint64_t i = 0; i < reps; ++i)
   {
-    EC_POINT_mul(ec, el, a[0], NULL, NULL, bn_ctx);
+    EC_POINT_mul(ec->group, el, a[0], NULL, NULL, bn_ctx);
     scalar_add(a[0], a[0], a[1], ec_group_order(ec));
   }
   BN_CTX_free(bn_ctx);
   diff = clock() - start;
   
+  printf("# %lu repetitions, time: %lu msec, avg: %f msec\n", reps, diff * 1000/ CLOCKS_PER_SEC, ((double) diff * 1000/ CLOCKS_PER_SEC) / reps);
+
+  printf("# timing thread-local pooled bn_ctx_acquire + operation, each acquired\n");
+
+  BN_copy(a[0], a[5]);
+
+  start = clock();
+
+  for (uint64_t i = 0; i < reps; ++i)
+  {
+    bn_ctx = bn_ctx_acquire(1);
+    EC_POINT_mul(ec->group, el, a[0], NULL, NULL, bn_ctx);
+    scalar_add(a[0], a[0], a[1], ec_group_order(ec));
+    bn_ctx_release(bn_ctx);
+  }
+
+  diff = clock() - start;
+  
   printf("# %lu repetitions, time: %lu msec, avg: %f msec\n", reps, diff * 1000/ CLOCKS_PER_SEC, ((double) diff * 1000/ CLOCKS_PER_SEC) / reps);
   for (uint64_t i = 0; i < 10; ++i) scalar_free(a[i]);
-  group_elem_free(el);
+  EC_POINT_free(el);
   ec_group_free(ec);
 }
 
@@ -219,7 +356,48 @@ int main(int argc, char* argv[])
 
       printf("\n### Party %lu executing protocol, out of %lu parties\n", party_index, num_parties);
       
-      test_protocol(party_index, num_parties, print_values != 0, print_values > 1);
+      prime_pool_t *prime_pool = open_prime_pool_from_env();
+
+      // Keystore file (per party) and key are given by environment variables, party restarts from it after refresh
+      const char *keystore_path = getenv("CMP_KEYSTORE");
+      uint8_t keystore_key[CMP_KEYSTORE_KEY_BYTES];
+      if (keystore_path && !read_key_from_env(keystore_key, CMP_KEYSTORE_KEY_BYTES, "CMP_KEYSTORE_KEY")) keystore_path = NULL;
+
+      char keystore_party_path[256];
+      if (keystore_path) snprintf(keystore_party_path, sizeof(keystore_party_path), "%s.%lu", keystore_path, party_index);
+
+      test_protocol(party_index, num_parties, print_values != 0, print_values > 1, prime_pool, (keystore_path ? keystore_party_path : NULL), keystore_key);
+      OPENSSL_cleanse(keystore_key, sizeof(keystore_key));
+
+      if (prime_pool)
+      {
+        print_prime_pool_metrics(prime_pool);
+        prime_pool_close(prime_pool);
+      }
+
+      return 0;
+    }
+    else if (strcmp(argv[1], "primes") == 0)
+    {
+      // Fill prime pool with primes for this many refreshes
+      uint64_t num_refresh = 1;
+      uint64_t num_threads = 4;
+      if (argc >= 3) num_refresh = strtoul(argv[2], NULL, 10);
+      if (argc >= 4) num_threads = strtoul(argv[3], NULL, 10);
+
+      prime_pool_t *prime_pool = open_prime_pool_from_env();
+      if (!prime_pool) goto USAGE;
+
+      prime_pool_target_t targets[2] = {{ .bits = 4*PAILLIER_MODULUS_BYTES, .kind = PRIME_KIND_BLUM, .count = 2*num_refresh },
+                                        { .bits = 4*RING_PED_MODULUS_BYTES, .kind = PRIME_KIND_SAFE, .count = 2*num_refresh }};
+      
+      // Safe primes aren't used when ring pedersen parameters are derived from paillier primes
+      prime_pool_generator_start(prime_pool, targets, (RING_PED_FROM_PAILLIER_PRIMES ? 1 : 2), num_threads);
+      prime_pool_generator_wait(prime_pool);
+      prime_pool_generator_stop(prime_pool);
+
+      print_prime_pool_metrics(prime_pool);
+      prime_pool_close(prime_pool);
 
       return 0;
     }
@@ -230,9 +408,15 @@ int main(int argc, char* argv[])
       paillier_private_key_t *priv = time_paillier_generate_keys(modulus_bits);
 
       test_paillier_operations(priv);
+      test_paillier_rand_pool(priv);
+      test_paillier_aggregated_decryption(priv);
 
       // time_paillier_encrypt(100, &priv->pub, 0, 0);
 
+      uint64_t reps = 100;
+      if (argc >= 4) reps = strtoul(argv[3], NULL, 10);
+      time_paillier_short_exp(reps, priv);
+
       paillier_encryption_free_keys(priv, NULL);
 
       return 0;
@@ -244,6 +428,21 @@ int main(int argc, char* argv[])
       ring_pedersen_private_t *priv = time_ring_pedersen_generate_param(modulus_bits);
 
       ring_pedersen_free_param(priv, NULL);
+
+      test_prime_generation(modulus_bits/2);
+
+      scalar_t p = scalar_new();
+      scalar_t q = scalar_new();
+      prime_gen_job_t jobs[2] = {{ .prime = p, .bits = modulus_bits/2, .kind = PRIME_KIND_SAFE },
+                                 { .prime = q, .bits = modulus_bits/2, .kind = PRIME_KIND_SAFE }};
+      prime_generate_batch(jobs, 2, 4);
+      test_ring_pedersen(p, q);
+      scalar_free(p);
+      scalar_free(q);
+
+      uint64_t reps = 10;
+      if (argc >= 4) reps = strtoul(argv[3], NULL, 10);
+      time_safe_primes(reps, modulus_bits/2);
     }
     else if (strcmp(argv[1], "zkp") == 0)
     {
@@ -258,10 +457,29 @@ int main(int argc, char* argv[])
       ring_pedersen_copy_param(NULL, rped_pub, rped_priv, NULL);
 
       test_zkp_encryption_in_range(paillier_pub, rped_pub, CALIGRAPHIC_I_ZKP_RANGE_BYTES);
+
+      // Again with short exponent randomness
+      paillier_encryption_short_exp_setup(paillier_priv);
+      paillier_encryption_copy_keys(NULL, paillier_pub, paillier_priv, NULL);
+      test_zkp_encryption_in_range(paillier_pub, rped_pub, CALIGRAPHIC_I_ZKP_RANGE_BYTES);
     
       paillier_encryption_free_keys(paillier_priv, paillier_pub);
       ring_pedersen_free_param(rped_priv, rped_pub);
     }
+    else if (strcmp(argv[1], "primitives") == 0)
+    {
+      ec_group_t ec = ec_group_new();
+      test_scalars(ec_group_order(ec), GROUP_ORDER_BYTES);
+      ec_group_free(ec);
+
+      test_group_elements();
+      test_order_scalars();
+      test_bn_ctx_pool();
+      test_multi_lane_exp();
+      test_fiat_shamir(100, 1000);
+
+      return 0;
+    }
     else if (strcmp(argv[1], "write") == 0)
     {
       int from_index = strtoul(argv[2], NULL, 10);
@@ -287,7 +505,12 @@ int main(int argc, char* argv[])
 USAGE:
   printf("\nUsage options:\n");
   printf("%s cmp <party_index> <num_parties (%lu)> [print_values (%lu)]\n", argv[0], num_parties, print_values); 
-  printf("%s paillier <modulus_bits (%lu)>\n", argv[0], modulus_bits); 
+  printf("%s paillier <modulus_bits (%lu)> [encrypt_reps (100)]\n", argv[0], modulus_bits); 
+  printf("%s pedersen <modulus_bits (%lu)> [safe_prime_reps (10)]\n", argv[0], modulus_bits); 
+  printf("%s primes [num_refresh (1)] [num_threads (4)]\n", argv[0]); 
+  printf("%s primitives\n", argv[0]); 
+  printf("Prime pool (used by cmp, filled by primes) is set by environment CMP_PRIME_POOL=<file> CMP_PRIME_POOL_KEY=<%d hex digits>\n", 2 * PRIME_POOL_KEY_BYTES); 
+  printf("Keystore (cmp saves after refresh and restarts from <file>.<party_index>) is set by environment CMP_KEYSTORE=<file> CMP_KEYSTORE_KEY=<%d hex digits>\n", 2 * CMP_KEYSTORE_KEY_BYTES); 
   //printf("%s\n zkp <paillier_modulus_bits (%ul)>\n", argv[0], modulus_bits); 
 
   return 1;
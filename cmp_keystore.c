@@ -0,0 +1,316 @@
+#include "cmp_keystore.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+#define KEYSTORE_MAGIC "CMPKEYS"
+#define KEYSTORE_VERSION 1
+#define HEADER_BYTES 64
+#define NONCE_BYTES 12
+#define TAG_BYTES 16
+
+// Ring pedersen tables are stored for commitments of range proofs (as built by refresh)
+#define KEYSTORE_RPED_TABLE_BITS (8*RING_PED_COMMIT_EXP_BYTES)
+
+/**
+ *  File layout (integers little-endian):
+ *  header:  magic (8), version (4), paillier modulus bytes (4), ring pedersen modulus bytes (4), ring pedersen table bits (4),
+ *           num_parties (8), index (8), id (8), public section bytes (8), secret section bytes (8)
+ *  nonce:   (12)
+ *  public:  parties ids (8 each), sid, srid, public X (all parties), paillier public keys (stored), ring pedersen parameters (stored)
+ *  secret:  secret x, paillier private key (stored), encrypted
+ *  tag:     (16), of header, nonce and public section (additional data) and secret section
+ */
+
+static void put_le (uint8_t *bytes, uint64_t val, uint64_t num_bytes)
+{
+  for (uint64_t i = 0; i < num_bytes; ++i) bytes[i] = (uint8_t) (val >> (8*i));
+}
+
+static uint64_t get_le (const uint8_t *bytes, uint64_t num_bytes)
+{
+  uint64_t val = 0;
+  for (uint64_t i = 0; i < num_bytes; ++i) val |= ((uint64_t) bytes[i]) << (8*i);
+  return val;
+}
+
+static void keystore_header (uint8_t *header, const cmp_party_t *party, uint64_t public_len, uint64_t secret_len)
+{
+  memset(header, 0, HEADER_BYTES);
+  memcpy(header, KEYSTORE_MAGIC, sizeof(KEYSTORE_MAGIC));
+  put_le(header + 8, KEYSTORE_VERSION, 4);
+  put_le(header + 12, PAILLIER_MODULUS_BYTES, 4);
+  put_le(header + 16, RING_PED_MODULUS_BYTES, 4);
+  put_le(header + 20, KEYSTORE_RPED_TABLE_BITS, 4);
+  put_le(header + 24, party->num_parties, 8);
+  put_le(header + 32, party->index, 8);
+  put_le(header + 40, party->id, 8);
+  put_le(header + 48, public_len, 8);
+  put_le(header + 56, secret_len, 8);
+}
+
+// Writes public section to bytes (if not NULL), returns its byte length
+static uint64_t keystore_public_to_bytes (uint8_t *bytes, const cmp_party_t *party)
+{
+  uint64_t byte_len = party->num_parties * (sizeof(uint64_t) + GROUP_ELEMENT_BYTES) + 2*sizeof(hash_chunk);
+  uint64_t curr_len;
+
+  for (uint64_t i = 0; i < party->num_parties; ++i)
+  {
+    paillier_public_stored_to_bytes(NULL, &curr_len, party->paillier_pub[i], PAILLIER_MODULUS_BYTES, 0);
+    byte_len += curr_len;
+    ring_pedersen_public_stored_to_bytes(NULL, &curr_len, party->rped_pub[i], RING_PED_MODULUS_BYTES, KEYSTORE_RPED_TABLE_BITS, 0);
+    byte_len += curr_len;
+  }
+
+  if (!bytes) return byte_len;
+
+  uint8_t *set_bytes = bytes;
+
+  for (uint64_t i = 0; i < party->num_parties; ++i)
+  {
+    put_le(set_bytes, party->parties_ids[i], sizeof(uint64_t));
+    set_bytes += sizeof(uint64_t);
+  }
+  memcpy(set_bytes, party->sid, sizeof(hash_chunk));
+  set_bytes += sizeof(hash_chunk);
+  memcpy(set_bytes, party->srid, sizeof(hash_chunk));
+  set_bytes += sizeof(hash_chunk);
+
+  for (uint64_t i = 0; i < party->num_parties; ++i) group_elem_to_bytes(&set_bytes, GROUP_ELEMENT_BYTES, party->public_X[i], party->ec, 1);
+
+  for (uint64_t i = 0; i < party->num_parties; ++i)
+  {
+    curr_len = UINT64_MAX;
+    paillier_public_stored_to_bytes(&set_bytes, &curr_len, party->paillier_pub[i], PAILLIER_MODULUS_BYTES, 1);
+    curr_len = UINT64_MAX;
+    ring_pedersen_public_stored_to_bytes(&set_bytes, &curr_len, party->rped_pub[i], RING_PED_MODULUS_BYTES, KEYSTORE_RPED_TABLE_BITS, 1);
+  }
+
+  assert(set_bytes == bytes + byte_len);
+  return byte_len;
+}
+
+// Writes secret section (plaintext) to bytes (if not NULL), returns its byte length
+static uint64_t keystore_secret_to_bytes (uint8_t *bytes, const cmp_party_t *party)
+{
+  uint64_t curr_len;
+  paillier_private_stored_to_bytes(NULL, &curr_len, party->paillier_priv, PAILLIER_MODULUS_BYTES, 0);
+  uint64_t byte_len = GROUP_ORDER_BYTES + curr_len;
+
+  if (!bytes) return byte_len;
+
+  uint8_t *set_bytes = bytes;
+
+  scalar_to_bytes(&set_bytes, GROUP_ORDER_BYTES, party->secret_x, 1);
+  paillier_private_stored_to_bytes(&set_bytes, &curr_len, party->paillier_priv, PAILLIER_MODULUS_BYTES, 1);
+
+  assert(set_bytes == bytes + byte_len);
+  return byte_len;
+}
+
+// Reads public section into party, returns 1 if it doesn't match party (ids, sid) or is malformed
+static int keystore_public_from_bytes (cmp_party_t *party, const uint8_t *bytes, uint64_t byte_len)
+{
+  uint8_t *read_bytes = (uint8_t *) bytes;
+  uint64_t left_len = party->num_parties * (sizeof(uint64_t) + GROUP_ELEMENT_BYTES) + 2*sizeof(hash_chunk);
+  uint64_t curr_len;
+
+  if (byte_len < left_len) return 1;
+
+  for (uint64_t i = 0; i < party->num_parties; ++i)
+  {
+    if (get_le(read_bytes, sizeof(uint64_t)) != party->parties_ids[i]) return 1;
+    read_bytes += sizeof(uint64_t);
+  }
+  if (memcmp(read_bytes, party->sid, sizeof(hash_chunk)) != 0) return 1;
+  read_bytes += sizeof(hash_chunk);
+  memcpy(party->srid, read_bytes, sizeof(hash_chunk));
+  read_bytes += sizeof(hash_chunk);
+
+  for (uint64_t i = 0; i < party->num_parties; ++i)
+  {
+    if (group_elem_from_bytes(party->public_X[i], &read_bytes, GROUP_ELEMENT_BYTES, party->ec, 1) != 0) return 1;
+  }
+
+  for (uint64_t i = 0; i < party->num_parties; ++i)
+  {
+    left_len = byte_len - (read_bytes - bytes);
+    curr_len = left_len;
+    paillier_public_stored_from_bytes(party->paillier_pub[i], &read_bytes, &curr_len, PAILLIER_MODULUS_BYTES, 1);
+    if (curr_len > left_len) return 1;
+
+    left_len = byte_len - (read_bytes - bytes);
+    curr_len = left_len;
+    ring_pedersen_public_stored_from_bytes(party->rped_pub[i], &read_bytes, &curr_len, RING_PED_MODULUS_BYTES, KEYSTORE_RPED_TABLE_BITS, 1);
+    if (curr_len > left_len) return 1;
+  }
+
+  return read_bytes != bytes + byte_len;
+}
+
+// Reads secret section (plaintext) into party, returns 1 if malformed
+static int keystore_secret_from_bytes (cmp_party_t *party, const uint8_t *bytes, uint64_t byte_len)
+{
+  uint8_t *read_bytes = (uint8_t *) bytes;
+
+  if (byte_len < GROUP_ORDER_BYTES) return 1;
+  scalar_from_bytes(party->secret_x, &read_bytes, GROUP_ORDER_BYTES, 1);
+
+  uint64_t left_len = byte_len - GROUP_ORDER_BYTES;
+  uint64_t curr_len = left_len;
+  paillier_private_stored_from_bytes(party->paillier_priv, &read_bytes, &curr_len, PAILLIER_MODULUS_BYTES, 1);
+  if (curr_len != left_len) return 1;
+
+  return 0;
+}
+
+int cmp_keystore_save (const cmp_party_t *party, const char *path, const uint8_t key[CMP_KEYSTORE_KEY_BYTES])
+{
+  uint64_t public_len = keystore_public_to_bytes(NULL, party);
+  uint64_t secret_len = keystore_secret_to_bytes(NULL, party);
+  uint64_t file_len = HEADER_BYTES + NONCE_BYTES + public_len + secret_len + TAG_BYTES;
+
+  uint8_t *data = malloc(file_len);
+  uint8_t *header = data;
+  uint8_t *nonce = header + HEADER_BYTES;
+  uint8_t *public_bytes = nonce + NONCE_BYTES;
+  uint8_t *ciphertext = public_bytes + public_len;
+  uint8_t *tag = ciphertext + secret_len;
+
+  keystore_header(header, party, public_len, secret_len);
+  RAND_bytes(nonce, NONCE_BYTES);
+  keystore_public_to_bytes(public_bytes, party);
+
+  uint8_t *plaintext = OPENSSL_secure_malloc(secret_len);
+  keystore_secret_to_bytes(plaintext, party);
+
+  int len;
+  uint8_t final_block[16];
+  EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+  EVP_EncryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, key, nonce);
+  EVP_EncryptUpdate(ctx, NULL, &len, header, HEADER_BYTES + NONCE_BYTES + public_len);
+  EVP_EncryptUpdate(ctx, ciphertext, &len, plaintext, secret_len);
+  EVP_EncryptFinal_ex(ctx, final_block, &len);
+  EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, TAG_BYTES, tag);
+  EVP_CIPHER_CTX_free(ctx);
+
+  OPENSSL_secure_clear_free(plaintext, secret_len);
+
+  // Written to temporary file, renamed over path once complete
+  uint64_t temp_path_len = strlen(path) + 5;
+  char *temp_path = malloc(temp_path_len);
+  snprintf(temp_path, temp_path_len, "%s.tmp", path);
+
+  int failed = 1;
+  int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  if (fd >= 0)
+  {
+    uint64_t written = 0;
+    while (written < file_len)
+    {
+      ssize_t curr = write(fd, data + written, file_len - written);
+      if (curr <= 0) break;
+      written += curr;
+    }
+    failed = (written != file_len) || (fsync(fd) != 0);
+    close(fd);
+
+    if (!failed) failed = rename(temp_path, path) != 0;
+    if (failed) unlink(temp_path);
+  }
+
+  // Rename is durable only after its directory is synced
+  if (!failed)
+  {
+    char *dir_path = strdup(path);
+    int dir_fd = open(dirname(dir_path), O_RDONLY | O_DIRECTORY);
+    failed = (dir_fd < 0) || (fsync(dir_fd) != 0);
+    if (dir_fd >= 0) close(dir_fd);
+    free(dir_path);
+  }
+
+  free(temp_path);
+  free(data);
+
+  return failed;
+}
+
+int cmp_keystore_load (cmp_party_t *party, const char *path, const uint8_t key[CMP_KEYSTORE_KEY_BYTES])
+{
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return 1;
+
+  struct stat st;
+  if ((fstat(fd, &st) != 0) || ((uint64_t) st.st_size < HEADER_BYTES + NONCE_BYTES + TAG_BYTES))
+  {
+    close(fd);
+    return 1;
+  }
+
+  uint64_t file_len = st.st_size;
+  const uint8_t *data = mmap(NULL, file_len, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) return 1;
+
+  const uint8_t *header = data;
+  const uint8_t *nonce = header + HEADER_BYTES;
+  uint64_t public_len = get_le(header + 48, 8);
+  uint64_t secret_len = get_le(header + 56, 8);
+
+  int matching = (memcmp(header, KEYSTORE_MAGIC, sizeof(KEYSTORE_MAGIC)) == 0)
+              && (get_le(header + 8, 4) == KEYSTORE_VERSION)
+              && (get_le(header + 12, 4) == PAILLIER_MODULUS_BYTES)
+              && (get_le(header + 16, 4) == RING_PED_MODULUS_BYTES)
+              && (get_le(header + 20, 4) == KEYSTORE_RPED_TABLE_BITS)
+              && (get_le(header + 24, 8) == party->num_parties)
+              && (get_le(header + 32, 8) == party->index)
+              && (get_le(header + 40, 8) == party->id)
+              && (public_len <= file_len) && (secret_len <= file_len)
+              && (HEADER_BYTES + NONCE_BYTES + public_len + secret_len + TAG_BYTES == file_len);
+
+  if (!matching)
+  {
+    munmap((void *) data, file_len);
+    return 1;
+  }
+
+  const uint8_t *public_bytes = nonce + NONCE_BYTES;
+  const uint8_t *ciphertext = public_bytes + public_len;
+  uint8_t tag[TAG_BYTES];
+  memcpy(tag, ciphertext + secret_len, TAG_BYTES);
+
+  uint8_t *plaintext = OPENSSL_secure_malloc(secret_len + 1);
+
+  int len;
+  uint8_t final_block[16];
+  EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+  EVP_DecryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, key, nonce);
+  EVP_DecryptUpdate(ctx, NULL, &len, header, HEADER_BYTES + NONCE_BYTES + public_len);
+  if (secret_len > 0) EVP_DecryptUpdate(ctx, plaintext, &len, ciphertext, secret_len);
+  EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, TAG_BYTES, tag);
+  int authentic = EVP_DecryptFinal_ex(ctx, final_block, &len) > 0;
+  EVP_CIPHER_CTX_free(ctx);
+
+  int failed = !authentic;
+  if (!failed) failed = keystore_public_from_bytes(party, public_bytes, public_len);
+  if (!failed) failed = keystore_secret_from_bytes(party, plaintext, secret_len);
+
+  OPENSSL_secure_clear_free(plaintext, secret_len + 1);
+  munmap((void *) data, file_len);
+
+  if (failed) return 1;
+
+  cmp_party_start_rand_pools(party);
+  cmp_set_sid_hash(party, 2);
+
+  return 0;
+}
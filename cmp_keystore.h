@@ -0,0 +1,33 @@
+/**
+ *
+ *  Name:
+ *  cmp_keystore
+ *
+ *  Description:
+ *  Binary keystore of a party's long term data after refresh, including all precomputation, so a restarted party is ready to presign without recomputing anything.
+ *  File is a versioned flat layout: header, public section and secret section. Public section holds parties' ids, sid, srid, public key shares,
+ *  all paillier public keys (with short exponent tables) and all ring pedersen parameters (with fixed-base tables of s, t and inverses).
+ *  Secret section holds the key share and own paillier private key (with CRT precomputation), encrypted by AES-256-GCM. Header and public section are authenticated as additional data.
+ *  Loading maps the file (mmap) and deserializes values and tables from the mapping with plain copies (no exponentiation or other recomputation), only Montgomery contexts
+ *  are rebuilt (on first use) and randomness pools started.
+ *
+ *  Usage:
+ *  Save party after refresh (finalized) by cmp_keystore_save, file is written to a temporary file and renamed (never partially written), then the directory is synced.
+ *  Load into a new party (cmp_party_new with same index, parties ids and sid) by cmp_keystore_load, instead of key generation and refresh.
+ *
+ */
+
+#ifndef __CMP20_ECDSA_MPC_KEYSTORE_H__
+#define __CMP20_ECDSA_MPC_KEYSTORE_H__
+
+#include "cmp_protocol.h"
+
+#define CMP_KEYSTORE_KEY_BYTES 32
+
+// Returns 0 on success, 1 if file can't be written
+int cmp_keystore_save (const cmp_party_t *party, const char *path, const uint8_t key[CMP_KEYSTORE_KEY_BYTES]);
+// Returns 0 on success, 1 if file can't be read, isn't a keystore of this version, doesn't match party (index, ids, sid) or fails authentication (wrong key or corrupted).
+// Party's long term data is undefined after a failure after authentication (malformed content), party should be freed.
+int cmp_keystore_load (cmp_party_t *party, const char *path, const uint8_t key[CMP_KEYSTORE_KEY_BYTES]);
+
+#endif
@@ -114,6 +114,8 @@ void cmp_set_sid_hash(cmp_party_t *party, int phase)
     {
       scalar_to_bytes(&temp_bytes, PAILLIER_MODULUS_BYTES, party->paillier_pub[i]->N, 0);
       SHA512_Update(&sha_ctx, temp_bytes, PAILLIER_MODULUS_BYTES);
+      scalar_to_bytes(&temp_bytes, PAILLIER_MODULUS_BYTES, party->paillier_pub[i]->h, 0);
+      SHA512_Update(&sha_ctx, temp_bytes, PAILLIER_MODULUS_BYTES);
       scalar_to_bytes(&temp_bytes, RING_PED_MODULUS_BYTES, party->rped_pub[i]->N, 0);
       SHA512_Update(&sha_ctx, temp_bytes, RING_PED_MODULUS_BYTES);
       scalar_to_bytes(&temp_bytes, RING_PED_MODULUS_BYTES, party->rped_pub[i]->s, 0);
@@ -142,6 +144,7 @@ cmp_party_t *cmp_party_new (uint64_t party_index, uint64_t num_parties, const ui
   party->paillier_priv = NULL;
   party->paillier_pub  = calloc(num_parties, sizeof(paillier_public_key_t *));
   party->rped_pub      = calloc(num_parties, sizeof(ring_pedersen_public_t *));
+  party->prime_pool    = NULL;
   
   party->ec       = ec_group_new();
   party->ec_gen   = ec_group_generator(party->ec);
@@ -170,6 +173,16 @@ cmp_party_t *cmp_party_new (uint64_t party_index, uint64_t num_parties, const ui
   return party;
 }
 
+// Randomness pools for encryptions under all parties' keys (own key filled by CRT), until next refresh
+void cmp_party_start_rand_pools (cmp_party_t *party)
+{
+  for (uint64_t i = 0; i < party->num_parties; ++i)
+  {
+    uint64_t depth = (i == party->index ? PAILLIER_RAND_POOL_OWN_DEPTH : PAILLIER_RAND_POOL_DEPTH);
+    paillier_encryption_pool_start(party->paillier_pub[i], (i == party->index ? party->paillier_priv : NULL), depth, depth * PAILLIER_RAND_POOL_REFILL_PERCENT / 100, PAILLIER_RAND_POOL_WORKERS);
+  }
+}
+
 void cmp_party_free (cmp_party_t *party)
 {
   for (uint64_t i = 0; i < party->num_parties; ++i)
@@ -276,7 +289,7 @@ void  cmp_key_generation_round_1_exec (cmp_party_t *party)
   cmp_key_generation_data_t *kgd = party->key_generation_data;
 
   scalar_sample_in_range(kgd->secret_x, party->ec_order, 0);
-  group_operation(kgd->public_X, NULL, party->ec_gen, kgd->secret_x, party->ec);
+  group_generator_mul(kgd->public_X, kgd->secret_x, party->ec);
 
   zkp_schnorr_public_t psi_sch_public;
   psi_sch_public.G = party->ec;
@@ -729,6 +742,8 @@ void cmp_refresh_round_1_commit(hash_chunk commit_digest, const hash_chunk sid_h
 
   scalar_to_bytes(&temp_bytes, PAILLIER_MODULUS_BYTES, re_payload->paillier_pub->N, 0);
   SHA512_Update(&sha_ctx, temp_bytes, GROUP_ELEMENT_BYTES);
+  scalar_to_bytes(&temp_bytes, PAILLIER_MODULUS_BYTES, re_payload->paillier_pub->h, 0);
+  SHA512_Update(&sha_ctx, temp_bytes, PAILLIER_MODULUS_BYTES);
   scalar_to_bytes(&temp_bytes, PAILLIER_MODULUS_BYTES, re_payload->rped_pub->N, 0);
   SHA512_Update(&sha_ctx, temp_bytes, GROUP_ELEMENT_BYTES);
   scalar_to_bytes(&temp_bytes, PAILLIER_MODULUS_BYTES, re_payload->rped_pub->s, 0);
@@ -752,8 +767,26 @@ void cmp_refresh_aux_info_round_1_exec (cmp_party_t *party)
 
   cmp_refresh_data_t *reda = party->refresh_data;
 
-  paillier_encryption_generate_private(reda->paillier_priv, 4*PAILLIER_MODULUS_BYTES);
-  ring_pedersen_generate_private(reda->rped_priv, 4*RING_PED_MODULUS_BYTES);
+  // All primes (paillier p,q and ring pedersen p,q) are popped from party's prime pool, missing ones are generated concurrently
+  // Ring pedersen parameters can be derived from the paillier primes, then only those two are needed
+  uint64_t num_primes = RING_PED_FROM_PAILLIER_PRIMES ? 2 : 4;
+  scalar_t primes[4];
+  prime_gen_job_t prime_jobs[4];
+  for (uint64_t i = 0; i < num_primes; ++i)
+  {
+    primes[i] = scalar_new();
+    prime_jobs[i].prime = primes[i];
+    prime_jobs[i].bits = i < 2 ? 4*PAILLIER_MODULUS_BYTES : 4*RING_PED_MODULUS_BYTES;
+    prime_jobs[i].kind = i < 2 ? PRIME_KIND_BLUM : PRIME_KIND_SAFE;
+  }
+  prime_pool_pop_or_generate(party->prime_pool, prime_jobs, num_primes, PRIME_GEN_THREADS);
+
+  paillier_encryption_private_from_primes(reda->paillier_priv, primes[0], primes[1]);
+  ring_pedersen_private_from_primes(reda->rped_priv, primes[num_primes - 2], primes[num_primes - 1]);
+  for (uint64_t i = 0; i < num_primes; ++i) scalar_free(primes[i]);
+
+  if (PAILLIER_SHORT_EXP_RANDOMNESS) paillier_encryption_short_exp_setup(reda->paillier_priv);
+
   paillier_encryption_copy_keys(NULL, reda->paillier_pub, reda->paillier_priv, NULL);
   ring_pedersen_copy_param(NULL, reda->rped_pub, reda->rped_priv, NULL);
   
@@ -779,10 +812,15 @@ void cmp_refresh_aux_info_round_1_exec (cmp_party_t *party)
     if (j == party->index) continue; 
 
     scalar_sample_in_range(reda->reshare_secret_x_j[j], party->ec_order, 0);
-    group_operation(reda->reshare_public_X_j[j], NULL, party->ec_gen, reda->reshare_secret_x_j[j], party->ec);
+    group_generator_mul(reda->reshare_public_X_j[j], reda->reshare_secret_x_j[j], party->ec);
     scalar_sub(reda->reshare_secret_x_j[party->index], reda->reshare_secret_x_j[party->index], reda->reshare_secret_x_j[j], party->ec_order);
   }
-  group_operation(reda->reshare_public_X_j[party->index], NULL, party->ec_gen, reda->reshare_secret_x_j[party->index], party->ec);
+  group_generator_mul(reda->reshare_public_X_j[party->index], reda->reshare_secret_x_j[party->index], party->ec);
+
+  // Normalize once (single inversion each), so commitment and sending encode affine points
+  group_elem_batch_normalize(reda->reshare_public_X_j, party->num_parties, party->ec);
+  group_elem_batch_normalize(reda->commited_A_j, party->num_parties, party->ec);
+
   cmp_sample_bytes(reda->rho, sizeof(hash_chunk));
   cmp_sample_bytes(reda->u, sizeof(hash_chunk));
 
@@ -884,11 +922,8 @@ void  cmp_refresh_aux_info_round_2_exec (cmp_party_t *party)
   paillier_public_to_bytes(&curr_send, &paillier_bytelen, reda->paillier_pub, PAILLIER_MODULUS_BYTES, 1);
   ring_pedersen_public_to_bytes(&curr_send, &rped_bytelen, reda->rped_pub, RING_PED_MODULUS_BYTES, 1);
 
-  for (uint64_t j = 0; j < party->num_parties; ++j)
-  {
-    group_elem_to_bytes(&curr_send, GROUP_ELEMENT_BYTES, reda->reshare_public_X_j[j], party->ec, 1);
-    group_elem_to_bytes(&curr_send, GROUP_ELEMENT_BYTES, reda->commited_A_j[j], party->ec, 1);
-  }
+  group_elem_batch_to_bytes(&curr_send, GROUP_ELEMENT_BYTES, reda->reshare_public_X_j, party->num_parties, party->ec, 1);
+  group_elem_batch_to_bytes(&curr_send, GROUP_ELEMENT_BYTES, reda->commited_A_j, party->num_parties, party->ec, 1);
   
   assert(curr_send == send_bytes + send_bytes_len);
 
@@ -902,7 +937,7 @@ void  cmp_refresh_aux_info_round_2_exec (cmp_party_t *party)
 
   // Print 
 
-  printf("### Publish (X_i^{1...n}, A_i^{1...n}, Paillier N_i, Pedersen N_i, s_i, t_i, rho_i, u_i, echo_broadcast).\t>>> %lu B, %lu ms\n", send_bytes_len, time_diff);
+  printf("### Publish (X_i^{1...n}, A_i^{1...n}, Paillier N_i, h_i, Pedersen N_i, s_i, t_i, rho_i, u_i, echo_broadcast).\t>>> %lu B, %lu ms\n", send_bytes_len, time_diff);
   if (PRINT_VALUES)
   {
     printf("echo_broadcast_%lu = ", party->index); printHexBytes("echo_broadcast = 0x", reda->echo_broadcast, sizeof(hash_chunk), "\n", 0);
@@ -951,11 +986,8 @@ void  cmp_refresh_aux_info_round_3_exec (cmp_party_t *party)
     paillier_public_from_bytes(reda->payload[j]->paillier_pub, &curr_recv, &paillier_bytelen, PAILLIER_MODULUS_BYTES, 1);
     ring_pedersen_public_from_bytes(reda->payload[j]->rped_pub, &curr_recv, &rped_bytelen, RING_PED_MODULUS_BYTES, 1);
   
-    for (uint64_t k = 0; k < party->num_parties; ++k)
-    {
-      group_elem_from_bytes(reda->payload[j]->reshare_public_X_k[k], &curr_recv, GROUP_ELEMENT_BYTES, party->ec, 1);
-      group_elem_from_bytes(reda->payload[j]->commited_A_k[k], &curr_recv, GROUP_ELEMENT_BYTES, party->ec, 1);
-    }
+    for (uint64_t k = 0; k < party->num_parties; ++k) group_elem_from_bytes(reda->payload[j]->reshare_public_X_k[k], &curr_recv, GROUP_ELEMENT_BYTES, party->ec, 1);
+    for (uint64_t k = 0; k < party->num_parties; ++k) group_elem_from_bytes(reda->payload[j]->commited_A_k[k], &curr_recv, GROUP_ELEMENT_BYTES, party->ec, 1);
 
     assert(curr_recv == recv_bytes + recv_bytes_len);
   }
@@ -984,10 +1016,7 @@ void  cmp_refresh_aux_info_round_3_exec (cmp_party_t *party)
     verified_modulus_size[j] = scalar_bitlength(reda->payload[j]->paillier_pub->N) >= 8*PAILLIER_MODULUS_BYTES-1;
 
     // Verify shared public X_j^k is valid from party j
-    group_operation(combined_public, NULL, NULL, NULL, party->ec);
-    for (uint64_t k = 0; k < party->num_parties; ++k) {
-      group_operation(combined_public, combined_public, reda->payload[j]->reshare_public_X_k[k], NULL, party->ec);
-    }
+    group_multi_exp(combined_public, reda->payload[j]->reshare_public_X_k, NULL, party->num_parties, party->ec);
     verified_public_shares[j] = group_elem_is_ident(combined_public, party->ec) == 1;
 
     // Verify commited V_i
@@ -1173,15 +1202,49 @@ void cmp_refresh_aux_info_final_exec(cmp_party_t *party)
 
   // Sum all secret reshares, self and generated by others for self
   scalar_copy(sum_received_reshares, reda->reshare_secret_x_j[party->index]);
+
+  // Reshares from others are decrypted together from the product of their ciphertexts (honest sum is below (n-1)*q, far from wrapping mod N), verified against the product of their public values.
+  // Only if that fails, each reshare is decrypted and verified separately, to find the inconsistent parties.
+  int is_reshare_aggregated = 0;
+  if (PAILLIER_AGGREGATE_DECRYPTION && (party->num_parties > 2))
+  {
+    gr_elem_t combined_public = group_elem_new(party->ec);
+    gr_elem_t *reshare_public = calloc(party->num_parties, sizeof(gr_elem_t));
+    scalar_t *reshare_cipher = calloc(party->num_parties, sizeof(scalar_t));
+    uint64_t num_reshares = 0;
+
+    for (uint64_t j = 0; j < party->num_parties; ++j)
+    {
+      if (j == party->index) continue;
+
+      reshare_cipher[num_reshares] = reda->payload[j]->encrypted_reshare_k[party->index];
+      reshare_public[num_reshares++] = reda->payload[j]->reshare_public_X_k[party->index];
+    }
+
+    paillier_encryption_decrypt_sum(received_reshare, reshare_cipher, num_reshares, reda->paillier_priv);
+    group_generator_mul(ver_public, received_reshare, party->ec);
+    group_multi_exp(combined_public, reshare_public, NULL, num_reshares, party->ec);
+    is_reshare_aggregated = group_elem_equal(ver_public, combined_public, party->ec) == 1;
+    if (is_reshare_aggregated) scalar_add(sum_received_reshares, sum_received_reshares, received_reshare, party->ec_order);
+
+    group_elem_free(combined_public);
+    free(reshare_public);
+    free(reshare_cipher);
+  }
+
   for (uint64_t j = 0; j < party->num_parties; ++j)
   { 
     if (j == party->index) continue; 
 
-    // Decrypt and verify reshare secret vs public   
-    paillier_encryption_decrypt(received_reshare, reda->payload[j]->encrypted_reshare_k[party->index], reda->paillier_priv);
-    scalar_add(sum_received_reshares, sum_received_reshares, received_reshare, party->ec_order);
-    group_operation(ver_public, NULL, party->ec_gen, received_reshare, party->ec);
-    verified_reshare[j] = group_elem_equal(ver_public, reda->payload[j]->reshare_public_X_k[party->index], party->ec) == 1;
+    // Decrypt and verify reshare secret vs public (unless verified by aggregate)
+    if (is_reshare_aggregated) verified_reshare[j] = 1;
+    else
+    {
+      paillier_encryption_decrypt(received_reshare, reda->payload[j]->encrypted_reshare_k[party->index], reda->paillier_priv);
+      scalar_add(sum_received_reshares, sum_received_reshares, received_reshare, party->ec_order);
+      group_generator_mul(ver_public, received_reshare, party->ec);
+      verified_reshare[j] = group_elem_equal(ver_public, reda->payload[j]->reshare_public_X_k[party->index], party->ec) == 1;
+    }
 
     // Verify ZKP
 
@@ -1229,18 +1292,31 @@ void cmp_refresh_aux_info_final_exec(cmp_party_t *party)
   scalar_add(party->secret_x, party->secret_x, sum_received_reshares, party->ec_order);
   scalar_free(sum_received_reshares);
 
-  for (uint64_t i = 0; i < party->num_parties; ++i)
+  // X_k <- X_k * prod_i (X_k^i)
+  gr_elem_t *updated_X_k = calloc(party->num_parties + 1, sizeof(gr_elem_t));
+  for (uint64_t k = 0; k < party->num_parties; ++k)
   {
-    for (uint64_t k = 0; k < party->num_parties; ++k) group_operation(party->public_X[k], party->public_X[k], reda->payload[i]->reshare_public_X_k[k], NULL, party->ec);
+    updated_X_k[0] = party->public_X[k];
+    for (uint64_t i = 0; i < party->num_parties; ++i) updated_X_k[i+1] = reda->payload[i]->reshare_public_X_k[k];
+    group_multi_exp(party->public_X[k], updated_X_k, NULL, party->num_parties + 1, party->ec);
+  }
+  free(updated_X_k);
 
+  for (uint64_t i = 0; i < party->num_parties; ++i)
+  {
     if (i == party->index) continue; // Self copied before loop
     paillier_encryption_copy_keys(NULL, party->paillier_pub[i], NULL, reda->payload[i]->paillier_pub);
     ring_pedersen_copy_param(NULL, party->rped_pub[i], NULL, reda->payload[i]->rped_pub);
   }
 
+  // Fixed-base tables for s,t of all parties, used by every range proof commitment until next refresh
+  for (uint64_t i = 0; i < party->num_parties; ++i) ring_pedersen_public_precompute(party->rped_pub[i], 8*RING_PED_COMMIT_EXP_BYTES);
+
+  cmp_party_start_rand_pools(party);
+
   // UDIBUG: Sanity Check of self public key vs private
   gr_elem_t check_my_public = group_elem_new(party->ec);
-  group_operation(check_my_public, NULL, party->ec_gen, party->secret_x, party->ec);
+  group_generator_mul(check_my_public, party->secret_x, party->ec);
   assert( group_elem_equal(check_my_public, party->public_X[party->index], party->ec) == 1);
   group_elem_free(check_my_public);
 
@@ -1442,11 +1518,11 @@ void cmp_ecdsa_presign_round_1_exec (cmp_party_t *party)
 
   paillier_encryption_sample(preda->rho, party->paillier_pub[party->index]);
   scalar_sample_in_range(preda->k, party->ec_order, 0);
-  paillier_encryption_encrypt(preda->K, preda->k, preda->rho, party->paillier_pub[party->index]);
+  paillier_encryption_encrypt_private(preda->K, preda->k, preda->rho, party->paillier_priv);
 
   paillier_encryption_sample(preda->nu, party->paillier_pub[party->index]);
   scalar_sample_in_range(preda->gamma, party->ec_order, 0);
-  paillier_encryption_encrypt(preda->G, preda->gamma, preda->nu, party->paillier_pub[party->index]);
+  paillier_encryption_encrypt_private(preda->G, preda->gamma, preda->nu, party->paillier_priv);
 
   // Aux Info for ZKP (ssid, i)
   zkp_aux_info_t *aux = zkp_aux_info_new(sizeof(uint64_t) + sizeof(hash_chunk), NULL);
@@ -1464,6 +1540,7 @@ void cmp_ecdsa_presign_round_1_exec (cmp_party_t *party)
   zkp_encryption_in_range_secret_t psi_enc_secret;
   psi_enc_secret.k = preda->k;
   psi_enc_secret.rho = preda->rho;
+  psi_enc_secret.paillier_priv = party->paillier_priv;
   
   for (uint64_t j = 0; j < party->num_parties; ++j) 
   {
@@ -1622,17 +1699,52 @@ void  cmp_ecdsa_presign_round_2_exec (cmp_party_t *party)
 
   zkp_aux_info_update(aux, sizeof(hash_chunk), &party->id, sizeof(uint64_t));
 
-  group_operation(preda->Gamma, NULL, party->ec_gen, preda->gamma, party->ec);
+  group_generator_mul(preda->Gamma, preda->gamma, party->ec);
 
-  // Executing MtA with relevant ZKP
+  // Executing MtA with relevant ZKP (transient values from arena, released with the round)
 
-  scalar_t r          = scalar_new();
-  scalar_t s          = scalar_new();
-  scalar_t temp_enc   = scalar_new();
-  scalar_t beta_range = scalar_new();
+  arena_t arena = arena_new();
+  scalar_t s          = arena_scalar_new(arena);
+  scalar_t temp_enc   = arena_scalar_new(arena);
+  scalar_t beta_range = arena_scalar_new(arena);
+  scalar_t *r_j       = calloc(party->num_parties, sizeof(scalar_t));
+  scalar_t *rhat_j    = calloc(party->num_parties, sizeof(scalar_t));
 
   scalar_set_power_of_2(beta_range, 8*CALIGRAPHIC_J_ZKP_RANGE_BYTES);
 
+  // All F_j and Fhat_j are encrypted under own key, so they are computed together (batched exponentiations, by CRT)
+  uint64_t num_own_enc = 0;
+  scalar_t *own_enc_plain  = calloc(2*party->num_parties, sizeof(scalar_t));
+  scalar_t *own_enc_rand   = calloc(2*party->num_parties, sizeof(scalar_t));
+  scalar_t *own_enc_cipher = calloc(2*party->num_parties, sizeof(scalar_t));
+
+  for (uint64_t j = 0; j < party->num_parties; ++j)
+  {
+    if (j == party->index) continue;
+
+    r_j[j] = arena_scalar_new(arena);
+    rhat_j[j] = arena_scalar_new(arena);
+
+    scalar_sample_in_range(preda->beta_j[j], beta_range, 0);
+    scalar_make_signed(preda->beta_j[j], beta_range);
+    paillier_encryption_sample(r_j[j], party->paillier_pub[party->index]);
+    own_enc_plain[num_own_enc] = preda->beta_j[j];
+    own_enc_rand[num_own_enc] = r_j[j];
+    own_enc_cipher[num_own_enc++] = preda->F_j[j];
+
+    scalar_sample_in_range(preda->betahat_j[j], beta_range, 0);
+    scalar_make_signed(preda->betahat_j[j], beta_range);
+    paillier_encryption_sample(rhat_j[j], party->paillier_pub[party->index]);
+    own_enc_plain[num_own_enc] = preda->betahat_j[j];
+    own_enc_rand[num_own_enc] = rhat_j[j];
+    own_enc_cipher[num_own_enc++] = preda->Fhat_j[j];
+  }
+
+  paillier_encryption_encrypt_private_batch(own_enc_cipher, own_enc_plain, own_enc_rand, num_own_enc, party->paillier_priv);
+  free(own_enc_plain);
+  free(own_enc_rand);
+  free(own_enc_cipher);
+
   zkp_oper_paillier_commit_range_public_t psi_affp_public_j;
   psi_affp_public_j.x_range_bytes = CALIGRAPHIC_I_ZKP_RANGE_BYTES;
   psi_affp_public_j.y_range_bytes = CALIGRAPHIC_J_ZKP_RANGE_BYTES;
@@ -1643,6 +1755,7 @@ void  cmp_ecdsa_presign_round_2_exec (cmp_party_t *party)
   zkp_oper_paillier_commit_range_secret_t psi_affp_secret_j;
   psi_affp_secret_j.x = preda->gamma;
   psi_affp_secret_j.rho_x = preda->nu;
+  psi_affp_secret_j.paillier_priv_1 = party->paillier_priv;
 
   zkp_oper_group_commit_range_public_t psi_affg_public_j;
   psi_affg_public_j.x_range_bytes = CALIGRAPHIC_I_ZKP_RANGE_BYTES;
@@ -1654,6 +1767,7 @@ void  cmp_ecdsa_presign_round_2_exec (cmp_party_t *party)
 
   zkp_oper_group_commit_range_secret_t psi_affg_secret_j;
   psi_affg_secret_j.x = party->secret_x;
+  psi_affg_secret_j.paillier_priv_1 = party->paillier_priv;
 
   zkp_group_vs_paillier_range_public_t psi_logG_public_j;
   psi_logG_public_j.x_range_bytes = CALIGRAPHIC_I_ZKP_RANGE_BYTES;
@@ -1666,17 +1780,13 @@ void  cmp_ecdsa_presign_round_2_exec (cmp_party_t *party)
   zkp_group_vs_paillier_range_secret_t psi_logG_secret;
   psi_logG_secret.x = preda->gamma;
   psi_logG_secret.rho = preda->nu;
+  psi_logG_secret.paillier_priv = party->paillier_priv;
 
   for (uint64_t j = 0; j < party->num_parties; ++j)
   {
     if (j == party->index) continue;
     
-    // Create ZKP Paillier homomorphic operation against Paillier commitment
-
-    scalar_sample_in_range(preda->beta_j[j], beta_range, 0);
-    scalar_make_signed(preda->beta_j[j], beta_range);
-    paillier_encryption_sample(r, party->paillier_pub[party->index]);
-    paillier_encryption_encrypt(preda->F_j[j], preda->beta_j[j], r, party->paillier_pub[party->index]);
+    // Create ZKP Paillier homomorphic operation against Paillier commitment (F_j computed above)
 
     // ARTICLE-MOD: using \beta (and not -\beta) for both F and affine operation (later will compute \alpha-\beta in summation)
     paillier_encryption_sample(s, party->paillier_pub[j]);
@@ -1690,16 +1800,11 @@ void  cmp_ecdsa_presign_round_2_exec (cmp_party_t *party)
     psi_affp_public_j.Y = preda->F_j[j];
 
     psi_affp_secret_j.y = preda->beta_j[j];
-    psi_affp_secret_j.rho_y = r;
+    psi_affp_secret_j.rho_y = r_j[j];
     psi_affp_secret_j.rho = s;
     zkp_oper_paillier_commit_range_prove(preda->psi_affp_j[j], &psi_affp_secret_j, &psi_affp_public_j, aux);
 
-    // Create ZKP Paillier homomorphic operation against Group commitment
-
-    scalar_sample_in_range(preda->betahat_j[j], beta_range, 0);
-    scalar_make_signed(preda->betahat_j[j], beta_range);
-    paillier_encryption_sample(r, party->paillier_pub[party->index]);
-    paillier_encryption_encrypt(preda->Fhat_j[j], preda->betahat_j[j], r, party->paillier_pub[party->index]);
+    // Create ZKP Paillier homomorphic operation against Group commitment (Fhat_j computed above)
 
     // ARTICLE-MOD: using \betahat (and not -\betahat) for both F and affine operation (later will compute \alphahat-\betahat in summation)
     paillier_encryption_sample(s, party->paillier_pub[j]);
@@ -1712,7 +1817,7 @@ void  cmp_ecdsa_presign_round_2_exec (cmp_party_t *party)
     psi_affg_public_j.D = preda->Dhat_j[j];
     psi_affg_public_j.Y = preda->Fhat_j[j];
 
-    psi_affg_secret_j.rho_y = r;
+    psi_affg_secret_j.rho_y = rhat_j[j];
     psi_affg_secret_j.rho = s;
     psi_affg_secret_j.y = preda->betahat_j[j];
     zkp_oper_group_commit_range_prove(preda->psi_affg_j[j], &psi_affg_secret_j, &psi_affg_public_j, aux);
@@ -1721,10 +1826,9 @@ void  cmp_ecdsa_presign_round_2_exec (cmp_party_t *party)
     zkp_group_vs_paillier_range_prove(preda->psi_logG_j[j], &psi_logG_secret, &psi_logG_public_j, aux);
   }
   zkp_aux_info_free(aux);
-  scalar_free(beta_range);
-  scalar_free(temp_enc);
-  scalar_free(r);
-  scalar_free(s);
+  free(r_j);
+  free(rhat_j);
+  arena_free(arena);
 
   time_diff = (clock() - time_start) * 1000 /CLOCKS_PER_SEC;
   preda->run_time += time_diff;
@@ -1878,33 +1982,60 @@ void  cmp_ecdsa_presign_round_3_exec (cmp_party_t *party)
   psi_logG_public_j.G = party->ec;
   psi_logG_public_j.g = party->ec_gen;
   
-  int *verified_psi_affp     = calloc(party->num_parties, sizeof(int));
-  int *verified_psi_affg     = calloc(party->num_parties, sizeof(int));
-  int *verified_psi_logG     = calloc(party->num_parties, sizeof(int));
+  // Challenges of all proofs are computed together (batch of Fiat-Shamir hashes), then each proof is verified with its own
+  zkp_oper_paillier_commit_range_public_t *psi_affp_public = calloc(party->num_parties, sizeof(zkp_oper_paillier_commit_range_public_t));
+  zkp_oper_group_commit_range_public_t    *psi_affg_public = calloc(party->num_parties, sizeof(zkp_oper_group_commit_range_public_t));
+  zkp_group_vs_paillier_range_public_t    *psi_logG_public = calloc(party->num_parties, sizeof(zkp_group_vs_paillier_range_public_t));
+  uint64_t *challenge_index = calloc(3*party->num_parties, sizeof(uint64_t));
+  zkp_challenge_batch_t *challenges = zkp_challenge_batch_new(3*party->num_parties);
+
   for (uint64_t j = 0; j < party->num_parties; ++j)
   {
     if (j == party->index) continue; 
 
     zkp_aux_info_update(aux, sizeof(hash_chunk), &party->parties_ids[j], sizeof(uint64_t));
 
-    psi_affp_public_j.paillier_pub_1 = party->paillier_pub[j];
-    psi_affp_public_j.D = preda->payload[j]->D;
-    psi_affp_public_j.X = preda->payload[j]->G;
-    psi_affp_public_j.Y = preda->payload[j]->F;
-    verified_psi_affp[j] = zkp_oper_paillier_commit_range_verify(preda->payload[j]->psi_affp, &psi_affp_public_j, aux);
+    psi_affp_public[j] = psi_affp_public_j;
+    psi_affp_public[j].paillier_pub_1 = party->paillier_pub[j];
+    psi_affp_public[j].D = preda->payload[j]->D;
+    psi_affp_public[j].X = preda->payload[j]->G;
+    psi_affp_public[j].Y = preda->payload[j]->F;
+    challenge_index[3*j] = zkp_oper_paillier_commit_range_verify_add_challenge(challenges, preda->payload[j]->psi_affp, &psi_affp_public[j], aux);
     
-    psi_affg_public_j.paillier_pub_1 = party->paillier_pub[j];
-    psi_affg_public_j.D = preda->payload[j]->Dhat;
-    psi_affg_public_j.X = party->public_X[j];
-    psi_affg_public_j.Y = preda->payload[j]->Fhat;
-    verified_psi_affg[j] = zkp_oper_group_commit_range_verify(preda->payload[j]->psi_affg, &psi_affg_public_j, aux);
+    psi_affg_public[j] = psi_affg_public_j;
+    psi_affg_public[j].paillier_pub_1 = party->paillier_pub[j];
+    psi_affg_public[j].D = preda->payload[j]->Dhat;
+    psi_affg_public[j].X = party->public_X[j];
+    psi_affg_public[j].Y = preda->payload[j]->Fhat;
+    challenge_index[3*j + 1] = zkp_oper_group_commit_range_verify_add_challenge(challenges, preda->payload[j]->psi_affg, &psi_affg_public[j], aux);
 
-    psi_logG_public_j.paillier_pub = party->paillier_pub[j];
-    psi_logG_public_j.X = preda->payload[j]->Gamma;
-    psi_logG_public_j.C = preda->payload[j]->G;
-    verified_psi_logG[j] = zkp_group_vs_paillier_range_verify(preda->payload[j]->psi_logG, &psi_logG_public_j, aux);
+    psi_logG_public[j] = psi_logG_public_j;
+    psi_logG_public[j].paillier_pub = party->paillier_pub[j];
+    psi_logG_public[j].X = preda->payload[j]->Gamma;
+    psi_logG_public[j].C = preda->payload[j]->G;
+    challenge_index[3*j + 2] = zkp_group_vs_paillier_range_verify_add_challenge(challenges, preda->payload[j]->psi_logG, &psi_logG_public[j], aux);
   }
 
+  zkp_challenge_batch_compute(challenges);
+
+  int *verified_psi_affp     = calloc(party->num_parties, sizeof(int));
+  int *verified_psi_affg     = calloc(party->num_parties, sizeof(int));
+  int *verified_psi_logG     = calloc(party->num_parties, sizeof(int));
+  for (uint64_t j = 0; j < party->num_parties; ++j)
+  {
+    if (j == party->index) continue; 
+
+    verified_psi_affp[j] = zkp_oper_paillier_commit_range_verify_batched(preda->payload[j]->psi_affp, &psi_affp_public[j], challenges, challenge_index[3*j]);
+    verified_psi_affg[j] = zkp_oper_group_commit_range_verify_batched(preda->payload[j]->psi_affg, &psi_affg_public[j], challenges, challenge_index[3*j + 1]);
+    verified_psi_logG[j] = zkp_group_vs_paillier_range_verify_batched(preda->payload[j]->psi_logG, &psi_logG_public[j], challenges, challenge_index[3*j + 2]);
+  }
+
+  zkp_challenge_batch_free(challenges);
+  free(challenge_index);
+  free(psi_affp_public);
+  free(psi_affg_public);
+  free(psi_logG_public);
+
   for (uint64_t j = 0; j < party->num_parties; ++j)
   {
     if (j == party->index) continue; 
@@ -1913,16 +2044,38 @@ void  cmp_ecdsa_presign_round_3_exec (cmp_party_t *party)
     if (verified_psi_affg[j] != 1) printf("%sParty %lu: failed verification of psi_affg from Party %lu\n",ERR_STR, party->index, j);
     if (verified_psi_logG[j] != 1) printf("%sParty %lu: failed verification of psi_logG from Party %lu\n",ERR_STR, party->index, j);
   }
+
+  // D_j (and Dhat_j) with verified affine operation proofs are aggregated, as their plaintexts k*gamma_j + beta_j (k*x_j + betahat_j) are proven in range.
+  // The signed sum of all of them must stay within +-N/2, so it is decrypted without wrapping mod N. Otherwise (or with unverified proofs) they are decrypted separately.
+  uint64_t alpha_bits = 8*CALIGRAPHIC_I_ZKP_RANGE_BYTES + 8*EPS_ZKP_SLACK_PARAMETER_BYTES + scalar_bitlength(party->ec_order);
+  if (alpha_bits < 8*CALIGRAPHIC_J_ZKP_RANGE_BYTES + 8*EPS_ZKP_SLACK_PARAMETER_BYTES) alpha_bits = 8*CALIGRAPHIC_J_ZKP_RANGE_BYTES + 8*EPS_ZKP_SLACK_PARAMETER_BYTES;
+  alpha_bits += 1;
+
+  int *aggregated_alpha = calloc(party->num_parties, sizeof(int));
+  uint64_t num_aggregated_alpha = 0;
+  for (uint64_t j = 0; j < party->num_parties; ++j)
+  {
+    if (j == party->index) continue; 
+
+    aggregated_alpha[j] = PAILLIER_AGGREGATE_DECRYPTION && verified_psi_affp[j] && verified_psi_affg[j];
+    num_aggregated_alpha += aggregated_alpha[j];
+  }
+  uint64_t sum_alpha_bits = alpha_bits;
+  for (uint64_t terms = num_aggregated_alpha; terms > 1; terms = (terms + 1) / 2) ++sum_alpha_bits;
+  if ((num_aggregated_alpha < 2) || (sum_alpha_bits + 1 >= (uint64_t) scalar_bitlength(party->paillier_pub[party->index]->N)))
+  {
+    memset(aggregated_alpha, 0, party->num_parties * sizeof(int));
+    num_aggregated_alpha = 0;
+  }
   
   free(verified_psi_affp);
   free(verified_psi_affg);
   free(verified_psi_logG);
 
-  group_operation(preda->combined_Gamma, NULL, NULL, NULL, party->ec);
-  for (uint64_t i = 0; i < party->num_parties; ++i) 
-  {
-    group_operation(preda->combined_Gamma, preda->combined_Gamma, preda->payload[i]->Gamma, NULL, party->ec);
-  }
+  gr_elem_t *Gamma_i = calloc(party->num_parties, sizeof(gr_elem_t));
+  for (uint64_t i = 0; i < party->num_parties; ++i) Gamma_i[i] = preda->payload[i]->Gamma;
+  group_multi_exp(preda->combined_Gamma, Gamma_i, NULL, party->num_parties, party->ec);
+  free(Gamma_i);
   
   group_operation(preda->Delta, NULL, preda->combined_Gamma, preda->k, party->ec);
 
@@ -1930,8 +2083,16 @@ void  cmp_ecdsa_presign_round_3_exec (cmp_party_t *party)
 
   scalar_t alpha_j = scalar_new();
 
-  scalar_mul(preda->delta, preda->gamma, preda->k, party->ec_order);
-  scalar_mul(preda->chi, party->secret_x, preda->k, party->ec_order);
+  // Accumulate delta_i and chi_i as fixed-width scalars, written back after the loop
+  order_scalar_t k_i;
+  order_scalar_t delta_i;
+  order_scalar_t chi_i;
+  order_scalar_t term;
+  order_scalar_from_scalar(k_i, preda->k);
+  order_scalar_from_scalar(term, preda->gamma);
+  order_scalar_mul(delta_i, term, k_i);
+  order_scalar_from_scalar(term, party->secret_x);
+  order_scalar_mul(chi_i, term, k_i);
 
   zkp_group_vs_paillier_range_public_t psi_logK_public_j;
   psi_logK_public_j.x_range_bytes = CALIGRAPHIC_I_ZKP_RANGE_BYTES;
@@ -1944,22 +2105,62 @@ void  cmp_ecdsa_presign_round_3_exec (cmp_party_t *party)
   zkp_group_vs_paillier_range_secret_t psi_logK_secret;
   psi_logK_secret.x = preda->k;
   psi_logK_secret.rho = preda->rho;
+  psi_logK_secret.paillier_priv = party->paillier_priv;
+
+  // Sum of aggregated alpha_j (and alphahat_j) by a single decryption of product of D_j (Dhat_j)
+  if (num_aggregated_alpha > 0)
+  {
+    scalar_t *D = calloc(num_aggregated_alpha, sizeof(scalar_t));
+    scalar_t *Dhat = calloc(num_aggregated_alpha, sizeof(scalar_t));
+    uint64_t num_D = 0;
+
+    for (uint64_t j = 0; j < party->num_parties; ++j)
+    {
+      if (!aggregated_alpha[j]) continue;
+
+      D[num_D] = preda->payload[j]->D;
+      Dhat[num_D++] = preda->payload[j]->Dhat;
+    }
+
+    paillier_encryption_decrypt_sum(alpha_j, D, num_D, party->paillier_priv);
+    scalar_make_signed(alpha_j, party->paillier_pub[party->index]->N);
+    order_scalar_from_scalar(term, alpha_j);
+    order_scalar_add(delta_i, delta_i, term);
+
+    paillier_encryption_decrypt_sum(alpha_j, Dhat, num_D, party->paillier_priv);
+    scalar_make_signed(alpha_j, party->paillier_pub[party->index]->N);
+    order_scalar_from_scalar(term, alpha_j);
+    order_scalar_add(chi_i, chi_i, term);
+
+    free(D);
+    free(Dhat);
+  }
 
   for (uint64_t j = 0; j < party->num_parties; ++j) 
   {
     if (j == party->index) continue;
     
     // Compute delta_i
-    paillier_encryption_decrypt(alpha_j, preda->payload[j]->D, party->paillier_priv);
-    scalar_make_signed(alpha_j, party->paillier_pub[party->index]->N);
-    scalar_add(preda->delta, preda->delta, alpha_j, party->ec_order);
-    scalar_sub(preda->delta, preda->delta, preda->beta_j[j], party->ec_order);
+    if (!aggregated_alpha[j])
+    {
+      paillier_encryption_decrypt(alpha_j, preda->payload[j]->D, party->paillier_priv);
+      scalar_make_signed(alpha_j, party->paillier_pub[party->index]->N);
+      order_scalar_from_scalar(term, alpha_j);
+      order_scalar_add(delta_i, delta_i, term);
+    }
+    order_scalar_from_scalar(term, preda->beta_j[j]);
+    order_scalar_sub(delta_i, delta_i, term);
 
     // Compute chi_i
-    paillier_encryption_decrypt(alpha_j, preda->payload[j]->Dhat, party->paillier_priv);
-    scalar_make_signed(alpha_j, party->paillier_pub[party->index]->N);
-    scalar_add(preda->chi, preda->chi, alpha_j, party->ec_order);
-    scalar_sub(preda->chi, preda->chi, preda->betahat_j[j], party->ec_order);
+    if (!aggregated_alpha[j])
+    {
+      paillier_encryption_decrypt(alpha_j, preda->payload[j]->Dhat, party->paillier_priv);
+      scalar_make_signed(alpha_j, party->paillier_pub[party->index]->N);
+      order_scalar_from_scalar(term, alpha_j);
+      order_scalar_add(chi_i, chi_i, term);
+    }
+    order_scalar_from_scalar(term, preda->betahat_j[j]);
+    order_scalar_sub(chi_i, chi_i, term);
 
     // Create Group vs Paillier range ZKP for K against Gamma and Delta
 
@@ -1968,6 +2169,14 @@ void  cmp_ecdsa_presign_round_3_exec (cmp_party_t *party)
   }
   zkp_aux_info_free(aux);
   scalar_free(alpha_j);
+  free(aggregated_alpha);
+
+  order_scalar_to_scalar(preda->delta, delta_i);
+  order_scalar_to_scalar(preda->chi, chi_i);
+  order_scalar_clear(k_i);
+  order_scalar_clear(delta_i);
+  order_scalar_clear(chi_i);
+  order_scalar_clear(term);
   
   time_diff = (clock() - time_start) * 1000 /CLOCKS_PER_SEC;
   preda->run_time += time_diff;
@@ -2089,14 +2298,17 @@ void  cmp_ecdsa_presign_final_exec (cmp_party_t *party)
   gr_elem_t gen_to_delta = group_elem_new(party->ec);
   gr_elem_t combined_Delta = group_elem_new(party->ec);
   
+  gr_elem_t *Delta_i = calloc(party->num_parties, sizeof(gr_elem_t));
+  
   scalar_set_ul(combined_delta, 0);
-  group_operation(combined_Delta, NULL, NULL, NULL, party->ec);
   for (uint64_t i = 0; i < party->num_parties; ++i) 
   {
     scalar_add(combined_delta, combined_delta, preda->payload[i]->delta, party->ec_order);
-    group_operation(combined_Delta, combined_Delta, preda->payload[i]->Delta, NULL, party->ec);
+    Delta_i[i] = preda->payload[i]->Delta;
   }
-  group_operation(gen_to_delta, NULL, party->ec_gen, combined_delta, party->ec);
+  group_multi_exp(combined_Delta, Delta_i, NULL, party->num_parties, party->ec);
+  free(Delta_i);
+  group_generator_mul_vartime(gen_to_delta, combined_delta, party->ec);
   
   assert(PAILLIER_MODULUS_BYTES >= CALIGRAPHIC_J_ZKP_RANGE_BYTES);    // The following ZKP is valid when N is bigger then beta's range)
 
@@ -2105,7 +2317,7 @@ void  cmp_ecdsa_presign_final_exec (cmp_party_t *party)
   if (verified_delta != 1) printf("%sParty %lu: failed equality of g^{delta} = combined_Delta\n",ERR_STR, party->index);
 
   scalar_inv(combined_delta, combined_delta, party->ec_order);
-  group_operation(party->R, NULL, preda->combined_Gamma, combined_delta, party->ec);
+  group_operation_vartime(party->R, NULL, preda->combined_Gamma, combined_delta, party->ec);
   
   scalar_free(combined_delta);
   group_elem_free(combined_Delta);
@@ -2211,7 +2423,7 @@ void cmp_schnorr_presign_round_1_exec (cmp_party_t *party)
   cmp_schnorr_presign_data_t *preda = party->schnorr_presign_data;
   paillier_encryption_sample(preda->rho, party->paillier_pub[party->index]);
   scalar_sample_in_range(preda->k, party->ec_order, 0);
-  paillier_encryption_encrypt(preda->K, preda->k, preda->rho, party->paillier_pub[party->index]);
+  paillier_encryption_encrypt_private(preda->K, preda->k, preda->rho, party->paillier_priv);
   
   // Aux Info for ZKP (ssid, i)
   zkp_aux_info_t *aux = zkp_aux_info_new(sizeof(uint64_t) + sizeof(hash_chunk), NULL);
@@ -2229,6 +2441,7 @@ void cmp_schnorr_presign_round_1_exec (cmp_party_t *party)
   zkp_encryption_in_range_secret_t psi_enc_secret;
   psi_enc_secret.k = preda->k;
   psi_enc_secret.rho = preda->rho;
+  psi_enc_secret.paillier_priv = party->paillier_priv;
 
   for (uint64_t j = 0; j < party->num_parties; ++j) 
   {
@@ -2371,7 +2584,7 @@ void  cmp_schnorr_presign_round_2_exec (cmp_party_t *party)
 
   zkp_aux_info_update(aux, sizeof(hash_chunk), &party->id, sizeof(uint64_t));
   
-  group_operation(preda->R, NULL, party->ec_gen, preda->k, party->ec);
+  group_generator_mul(preda->R, preda->k, party->ec);
 
   // Generate ZKP
 
@@ -2386,6 +2599,7 @@ void  cmp_schnorr_presign_round_2_exec (cmp_party_t *party)
   zkp_group_vs_paillier_range_secret_t psi_logK_secret;
   psi_logK_secret.x = preda->k;
   psi_logK_secret.rho = preda->rho;
+  psi_logK_secret.paillier_priv = party->paillier_priv;
 
   for (uint64_t j = 0; j < party->num_parties; ++j)
   {
@@ -2507,11 +2721,10 @@ void  cmp_schnorr_presign_final_exec (cmp_party_t *party)
   
   // Store R,k for party
 
-  group_operation(party->R, NULL, NULL, NULL, party->ec);
-  for (uint64_t i = 0; i < party->num_parties; ++i) 
-  {
-    group_operation(party->R, party->R, preda->payload[i]->R, NULL, party->ec);
-  }
+  gr_elem_t *R_i = calloc(party->num_parties, sizeof(gr_elem_t));
+  for (uint64_t i = 0; i < party->num_parties; ++i) R_i[i] = preda->payload[i]->R;
+  group_multi_exp(party->R, R_i, NULL, party->num_parties, party->ec);
+  free(R_i);
 
   scalar_copy(party->k, preda->k);
 
@@ -2564,15 +2777,21 @@ void cmp_ecdsa_signing_round_1_exec (const cmp_party_t *party, const scalar_t ms
 
   group_elem_get_x(sida->r, party->R, party->ec, party->ec_order);
 
-  // Set current player's sigma
-
-  scalar_t first_term = scalar_new();
-  scalar_t second_term = scalar_new();
-  scalar_mul(first_term, party->k, msg, party->ec_order);
-  scalar_mul(second_term, party->chi, sida->r, party->ec_order);
-  scalar_add(sida->sigma, first_term, second_term, party->ec_order);
-  scalar_free(first_term);
-  scalar_free(second_term);
+  // Set current player's sigma = k*msg + chi*r
+
+  order_scalar_t first_term;
+  order_scalar_t second_term;
+  order_scalar_t temp;
+  order_scalar_from_scalar(first_term, party->k);
+  order_scalar_from_scalar(temp, msg);
+  order_scalar_mul(first_term, first_term, temp);
+  order_scalar_from_scalar(second_term, party->chi);
+  order_scalar_from_scalar(temp, sida->r);
+  order_scalar_mul(second_term, second_term, temp);
+  order_scalar_add(first_term, first_term, second_term);
+  order_scalar_to_scalar(sida->sigma, first_term);
+  order_scalar_clear(first_term);
+  order_scalar_clear(second_term);
 
   // Send sigma to others
 
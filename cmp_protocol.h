@@ -51,6 +51,37 @@
 // Random Oracle input and output byte size (SHA512).
 typedef uint8_t hash_chunk[64];
 
+// Paillier randomness pools, started for all parties' keys when finalizing refresh (can be set at build, depth 0 disables).
+// Own key is used for most encryptions of a presign (about 8 per other party), each other party's key for 4.
+#ifndef PAILLIER_RAND_POOL_DEPTH
+#define PAILLIER_RAND_POOL_DEPTH 16
+#endif
+#ifndef PAILLIER_RAND_POOL_OWN_DEPTH
+#define PAILLIER_RAND_POOL_OWN_DEPTH 64
+#endif
+// Pool is refilled (to full depth) when it drops to this percentage of its depth
+#ifndef PAILLIER_RAND_POOL_REFILL_PERCENT
+#define PAILLIER_RAND_POOL_REFILL_PERCENT 25
+#endif
+#ifndef PAILLIER_RAND_POOL_WORKERS
+#define PAILLIER_RAND_POOL_WORKERS 1
+#endif
+
+// Worker threads generating the primes of refresh (one per prime by default, can be set at build)
+#ifndef PRIME_GEN_THREADS
+#define PRIME_GEN_THREADS 4
+#endif
+
+// Refresh sets short exponent randomness mode of new paillier keys (published h, encryption randomness h^x for short x)
+#ifndef PAILLIER_SHORT_EXP_RANDOMNESS
+#define PAILLIER_SHORT_EXP_RANDOMNESS 0
+#endif
+
+// Ciphertexts under own key are multiplied and decrypted once (D_j and Dhat_j of presign round 3, reshares of refresh), instead of decrypting each
+#ifndef PAILLIER_AGGREGATE_DECRYPTION
+#define PAILLIER_AGGREGATE_DECRYPTION 1
+#endif
+
 
 /****************************** 
  * 
@@ -322,6 +353,9 @@ typedef struct cmp_party_t
   paillier_public_key_t  **paillier_pub;   
   ring_pedersen_public_t **rped_pub;
 
+  // Source of refresh primes (not owned), NULL generates them in refresh
+  prime_pool_t *prime_pool;
+
   ec_group_t ec;
   gr_elem_t ec_gen;
   scalar_t ec_order;
@@ -350,6 +384,10 @@ typedef struct cmp_party_t
 
 cmp_party_t *cmp_party_new  (uint64_t party_index, uint64_t num_parties, const uint64_t *parties_ids, const hash_chunk sid);
 void         cmp_party_free (cmp_party_t *party);
+// Set sid hash from relevant existing party values (phases: 0/1/2 - init/keygen/refresh)
+void         cmp_set_sid_hash           (cmp_party_t *party, int phase);
+// Starts paillier randomness pools of all parties' keys (done by refresh, and when party's keys are loaded)
+void         cmp_party_start_rand_pools (cmp_party_t *party);
 
 void cmp_key_generation_init         (cmp_party_t *party);
 void cmp_key_generation_clean        (cmp_party_t *party);
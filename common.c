@@ -23,27 +23,30 @@ void printBIGNUM(const char * prefix, const BIGNUM *bn, const char * suffix)
   free(bn_str);
 }
 
-void printECPOINT(const char * prefix, const EC_POINT *p, const EC_GROUP *ec, const char * suffix, int print_uncompressed)
+void printECPOINT(const char * prefix, const gr_elem_t p, const ec_group_t ec, const char * suffix, int print_uncompressed)
 {
-  BN_CTX *bn_ctx = BN_CTX_secure_new();
-  
-  uint64_t p_byte_len = EC_POINT_point2oct(ec, p, (print_uncompressed ? POINT_CONVERSION_UNCOMPRESSED: POINT_CONVERSION_COMPRESSED), NULL, 0, bn_ctx);
-  uint8_t *p_bytes = malloc(p_byte_len);
-  EC_POINT_point2oct(ec, p, (print_uncompressed ? POINT_CONVERSION_UNCOMPRESSED: POINT_CONVERSION_COMPRESSED), p_bytes, p_byte_len, bn_ctx);
+  uint8_t p_bytes[GROUP_ELEMENT_BYTES] = {0};
+  uint8_t *p_pos = p_bytes;
 
   if (print_uncompressed)
   {
+    BIGNUM *x = BN_new();
+    BIGNUM *y = BN_new();
+    group_elem_get_affine(x, y, p, ec);
+
     printf("%s", prefix);
-    printHexBytes("point(0x", p_bytes+1, (p_byte_len-1)/2, ",", 0);
-    printHexBytes("0x", p_bytes + (p_byte_len +1)/2, (p_byte_len-1)/2, ")", 0);
+    BN_bn2binpad(x, p_bytes, GROUP_ELEMENT_BYTES-1);
+    printHexBytes("point(0x", p_bytes, GROUP_ELEMENT_BYTES-1, ",", 0);
+    BN_bn2binpad(y, p_bytes, GROUP_ELEMENT_BYTES-1);
+    printHexBytes("0x", p_bytes, GROUP_ELEMENT_BYTES-1, ")", 0);
     printf("%s", suffix);
+
+    BN_free(x);
+    BN_free(y);
   }
   else
   {
-    EC_POINT_point2oct(ec, p, POINT_CONVERSION_COMPRESSED, p_bytes, p_byte_len, bn_ctx);
-    printHexBytes(prefix, p_bytes, p_byte_len, suffix, 0);
+    group_elem_to_bytes(&p_pos, GROUP_ELEMENT_BYTES, p, ec, 0);
+    printHexBytes(prefix, p_bytes, GROUP_ELEMENT_BYTES, suffix, 0);
   }
-  
-  free(p_bytes);
-  BN_CTX_free(bn_ctx);
-}
\ No newline at end of file
+}
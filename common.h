@@ -16,8 +16,10 @@
 #include <openssl/bn.h>
 #include <openssl/ec.h>
 
+#include "algebraic_elements.h"
+
 void printHexBytes(const char * prefix, const uint8_t *src, unsigned len, const char * suffix, int print_len);
 void printBIGNUM(const char * prefix, const BIGNUM *bn, const char * suffix);
-void printECPOINT(const char * prefix, const EC_POINT *p, const EC_GROUP *ec, const char * suffix, int print_uncompressed);
+void printECPOINT(const char * prefix, const gr_elem_t p, const ec_group_t ec, const char * suffix, int print_uncompressed);
 
 #endif
\ No newline at end of file
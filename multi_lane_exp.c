@@ -0,0 +1,217 @@
+#include "multi_lane_exp.h"
+#include "algebraic_elements.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <openssl/crypto.h>
+
+#define LIMB_BITS 52
+#define LIMB_MASK ((1ULL << LIMB_BITS) - 1)
+#define WINDOW_BITS 4
+#define TABLE_SIZE (1 << WINDOW_BITS)
+
+#if defined(__x86_64__) && defined(__GNUC__)
+
+#include <immintrin.h>
+
+#define IFMA_TARGET __attribute__((target("avx512f,avx512ifma")))
+
+int multi_lane_exp_available ()
+{
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512ifma");
+}
+
+// Number of 52-bit limbs, such that 4*modulus < 2^(52*num_limbs) (needed for Montgomery multiplication without final subtraction)
+static uint64_t num_limbs_for (const BIGNUM *modulus)
+{
+  return (BN_num_bits(modulus) + 2 + LIMB_BITS - 1) / LIMB_BITS;
+}
+
+// Sets lane of limbs from num (non-negative, less than 2^(52*num_limbs))
+static void limbs_set_lane (__m512i *limbs, uint64_t lane, const BIGNUM *num, uint64_t num_limbs, uint8_t *buffer, uint64_t buffer_len)
+{
+  BN_bn2lebinpad(num, buffer, buffer_len);
+
+  for (uint64_t j = 0; j < num_limbs; ++j)
+  {
+    uint64_t bit_pos = j * LIMB_BITS;
+    uint64_t word;
+    memcpy(&word, buffer + bit_pos / 8, sizeof(word));
+    ((uint64_t *) &limbs[j])[lane] = (word >> (bit_pos % 8)) & LIMB_MASK;
+  }
+}
+
+static void limbs_get_lane (BIGNUM *num, const __m512i *limbs, uint64_t lane, uint64_t num_limbs, uint8_t *buffer, uint64_t buffer_len)
+{
+  memset(buffer, 0, buffer_len);
+
+  for (uint64_t j = 0; j < num_limbs; ++j)
+  {
+    uint64_t bit_pos = j * LIMB_BITS;
+    uint64_t word;
+    memcpy(&word, buffer + bit_pos / 8, sizeof(word));
+    word |= ((const uint64_t *) &limbs[j])[lane] << (bit_pos % 8);
+    memcpy(buffer + bit_pos / 8, &word, sizeof(word));
+  }
+
+  BN_lebin2bn(buffer, buffer_len, num);
+}
+
+// res = a*b/2^(52*num_limbs) mod m, for a,b < 2m (result < 2m). Limbs of a,b are less than 2^52. res can be a or b. t has 2*num_limbs+1 entries.
+IFMA_TARGET
+static void mont_mul_x8 (__m512i *res, const __m512i *a, const __m512i *b, const __m512i *m, __m512i m_inv, uint64_t num_limbs, __m512i *t)
+{
+  const __m512i zero = _mm512_setzero_si512();
+  const __m512i mask = _mm512_set1_epi64(LIMB_MASK);
+
+  for (uint64_t j = 0; j < 2 * num_limbs + 1; ++j) t[j] = zero;
+
+  // Accumulators are 64 bit, each gets at most 4*num_limbs additions of 52 bits, so carries are propagated only at the end.
+  // Instead of shifting the accumulator every iteration, it is read from offset i.
+  for (uint64_t i = 0; i < num_limbs; ++i)
+  {
+    __m512i *acc = t + i;
+
+    for (uint64_t j = 0; j < num_limbs; ++j)
+    {
+      acc[j]   = _mm512_madd52lo_epu64(acc[j], a[j], b[i]);
+      acc[j+1] = _mm512_madd52hi_epu64(acc[j+1], a[j], b[i]);
+    }
+
+    __m512i q = _mm512_madd52lo_epu64(zero, acc[0], m_inv);
+
+    for (uint64_t j = 0; j < num_limbs; ++j)
+    {
+      acc[j]   = _mm512_madd52lo_epu64(acc[j], m[j], q);
+      acc[j+1] = _mm512_madd52hi_epu64(acc[j+1], m[j], q);
+    }
+
+    // Lowest limb is now divisible by 2^52
+    acc[1] = _mm512_add_epi64(acc[1], _mm512_srli_epi64(acc[0], LIMB_BITS));
+  }
+
+  __m512i *acc = t + num_limbs;
+  for (uint64_t j = 0; j < num_limbs - 1; ++j)
+  {
+    acc[j+1] = _mm512_add_epi64(acc[j+1], _mm512_srli_epi64(acc[j], LIMB_BITS));
+    res[j] = _mm512_and_si512(acc[j], mask);
+  }
+  res[num_limbs - 1] = acc[num_limbs - 1];
+}
+
+// res = table[digits] (per lane), reading all table entries
+IFMA_TARGET
+static void table_select_x8 (__m512i *res, const __m512i *table, __m512i digits, uint64_t num_limbs)
+{
+  for (uint64_t j = 0; j < num_limbs; ++j) res[j] = table[j];
+
+  for (uint64_t d = 1; d < TABLE_SIZE; ++d)
+  {
+    __mmask8 is_digit = _mm512_cmpeq_epi64_mask(digits, _mm512_set1_epi64(d));
+    const __m512i *entry = table + d * num_limbs;
+    for (uint64_t j = 0; j < num_limbs; ++j) res[j] = _mm512_mask_mov_epi64(res[j], is_digit, entry[j]);
+  }
+}
+
+IFMA_TARGET
+void multi_lane_exp (BIGNUM **results, BIGNUM *const *bases, BIGNUM *const *exps, uint64_t count, const BIGNUM *modulus)
+{
+  assert(count <= MULTI_LANE_EXP_LANES);
+  assert(BN_is_odd(modulus));
+
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
+  BIGNUM *temp = BN_CTX_get(bn_ctx);
+
+  uint64_t num_limbs = num_limbs_for(modulus);
+  uint64_t buffer_len = num_limbs * LIMB_BITS / 8 + sizeof(uint64_t);
+  uint8_t *buffer = OPENSSL_secure_malloc(buffer_len);
+
+  int exp_bits = 0;
+  for (uint64_t l = 0; l < count; ++l) if (BN_num_bits(exps[l]) > exp_bits) exp_bits = BN_num_bits(exps[l]);
+  uint64_t num_windows = (exp_bits + WINDOW_BITS - 1) / WINDOW_BITS;
+
+  // m, R^2 mod m (R = 2^(52*num_limbs)), table of TABLE_SIZE entries, accumulator, constant one, multiplication scratch
+  uint64_t num_vectors = 2 * num_limbs + TABLE_SIZE * num_limbs + 3 * num_limbs + 2 * num_limbs + 1;
+  uint64_t vectors_size = num_vectors * sizeof(__m512i);
+  __m512i *vectors = aligned_alloc(sizeof(__m512i), vectors_size);
+  memset(vectors, 0, vectors_size);
+
+  __m512i *m     = vectors;
+  __m512i *r2    = m + num_limbs;
+  __m512i *table = r2 + num_limbs;
+  __m512i *acc   = table + TABLE_SIZE * num_limbs;
+  __m512i *entry = acc + num_limbs;
+  __m512i *one   = entry + num_limbs;
+  __m512i *t     = one + num_limbs;
+
+  BN_one(temp);
+  BN_lshift(temp, temp, 2 * LIMB_BITS * num_limbs);
+  BN_mod(temp, temp, modulus, bn_ctx);
+  for (uint64_t l = 0; l < MULTI_LANE_EXP_LANES; ++l)
+  {
+    limbs_set_lane(m, l, modulus, num_limbs, buffer, buffer_len);
+    limbs_set_lane(r2, l, temp, num_limbs, buffer, buffer_len);
+    ((uint64_t *) &one[0])[l] = 1;
+  }
+
+  // -m^(-1) mod 2^52 by Newton iteration (each doubles correct bits)
+  uint64_t m_0 = ((uint64_t *) &m[0])[0];
+  uint64_t inv = 1;
+  for (int k = 0; k < 6; ++k) inv *= 2 - m_0 * inv;
+  __m512i m_inv = _mm512_set1_epi64((0 - inv) & LIMB_MASK);
+
+  // table[d] = base^d in Montgomery form. Unused lanes compute 1^0.
+  mont_mul_x8(table, one, r2, m, m_inv, num_limbs, t);
+  for (uint64_t l = 0; l < MULTI_LANE_EXP_LANES; ++l)
+  {
+    if (l < count) BN_nnmod(temp, bases[l], modulus, bn_ctx);
+    else BN_one(temp);
+    limbs_set_lane(entry, l, temp, num_limbs, buffer, buffer_len);
+  }
+  mont_mul_x8(table + num_limbs, entry, r2, m, m_inv, num_limbs, t);
+  for (uint64_t d = 2; d < TABLE_SIZE; ++d) mont_mul_x8(table + d * num_limbs, table + (d - 1) * num_limbs, table + num_limbs, m, m_inv, num_limbs, t);
+
+  // Fixed windows from the top, acc starts as 1
+  for (uint64_t j = 0; j < num_limbs; ++j) acc[j] = table[j];
+  for (uint64_t w = num_windows; w-- > 0; )
+  {
+    for (int b = 0; b < WINDOW_BITS; ++b) mont_mul_x8(acc, acc, acc, m, m_inv, num_limbs, t);
+
+    uint64_t lane_digits[MULTI_LANE_EXP_LANES] = {0};
+    for (uint64_t l = 0; l < count; ++l)
+    {
+      for (int b = WINDOW_BITS - 1; b >= 0; --b) lane_digits[l] = (lane_digits[l] << 1) | BN_is_bit_set(exps[l], w * WINDOW_BITS + b);
+    }
+
+    table_select_x8(entry, table, _mm512_loadu_si512(lane_digits), num_limbs);
+    mont_mul_x8(acc, acc, entry, m, m_inv, num_limbs, t);
+  }
+
+  // Out of Montgomery form, result is at most m (equal only when zero mod m)
+  mont_mul_x8(acc, acc, one, m, m_inv, num_limbs, t);
+  for (uint64_t l = 0; l < count; ++l)
+  {
+    limbs_get_lane(temp, acc, l, num_limbs, buffer, buffer_len);
+    if (BN_cmp(temp, modulus) >= 0) BN_sub(temp, temp, modulus);
+    BN_copy(results[l], temp);
+  }
+
+  OPENSSL_cleanse(vectors, vectors_size);
+  free(vectors);
+  OPENSSL_secure_clear_free(buffer, buffer_len);
+  bn_ctx_release(bn_ctx);
+}
+
+#else
+
+int multi_lane_exp_available () { return 0; }
+
+void multi_lane_exp (BIGNUM **results, BIGNUM *const *bases, BIGNUM *const *exps, uint64_t count, const BIGNUM *modulus)
+{
+  (void) results; (void) bases; (void) exps; (void) count; (void) modulus;
+  assert(0 && "multi_lane_exp not available");
+}
+
+#endif
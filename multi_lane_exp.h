@@ -0,0 +1,31 @@
+/**
+ *
+ *  Name:
+ *  multi_lane_exp
+ *
+ *  Description:
+ *  Multi-lane modular exponentiation: up to MULTI_LANE_EXP_LANES independent exponentiations modulo the same odd modulus, run together in SIMD lanes.
+ *  Implemented with AVX-512 IFMA (52-bit limbs, vertical layout: each vector holds the same limb of all lanes), Montgomery multiplication without final subtraction.
+ *  Fixed 4-bit windows, table entries selected by masked moves over the whole table, so operations and memory access depend only on the bit length of exponents.
+ *
+ *  Usage:
+ *  Not used directly, backend of scalar_exp_batch (algebraic_elements.h) when multi_lane_exp_available() at runtime. Otherwise (or not x86-64) only portable code is used.
+ *  Built optimized, IFMA code is enabled by target attributes only on its functions, so the rest of the object runs on any x86-64.
+ *
+ */
+
+#ifndef __CMP20_ECDSA_MPC_MULTI_LANE_EXP_H__
+#define __CMP20_ECDSA_MPC_MULTI_LANE_EXP_H__
+
+#include <stdint.h>
+#include <openssl/bn.h>
+
+#define MULTI_LANE_EXP_LANES 8
+// Less lanes are faster as separate exponentiations
+#define MULTI_LANE_EXP_MIN_LANES 4
+
+int  multi_lane_exp_available ();
+// results[i] = bases[i]^|exps[i]| (mod modulus) for i < count <= MULTI_LANE_EXP_LANES, modulus odd. results[i] can be bases[i].
+void multi_lane_exp           (BIGNUM **results, BIGNUM *const *bases, BIGNUM *const *exps, uint64_t count, const BIGNUM *modulus);
+
+#endif
@@ -1,4 +1,37 @@
 #include "paillier_cryptosystem.h"
+#include "prime_generation.h"
+
+#include <pthread.h>
+#include <openssl/crypto.h>
+
+struct paillier_rand_pool_st
+{
+  paillier_public_key_t  *pub;          // Own copies of the keys, so workers never read the keys the pool is attached to
+  paillier_private_key_t *priv;         // NULL if not own key
+  paillier_private_key_t *linked_priv;  // Private key attached to the pool (not owned), NULL if none
+  uint64_t rho_bytes;
+
+  uint64_t depth;
+  uint64_t low_watermark;
+  int filling;
+  int stop;
+
+  // Ring of ready (rho, rho^N) pairs
+  scalar_t *ready_rho;
+  scalar_t *ready_rho_to_N;
+  uint64_t ready_head;
+  uint64_t num_ready;
+
+  // Pairs handed out by paillier_encryption_sample, until rho is used by encryption (by bytes of rho)
+  scalar_t *taken_rho_to_N;
+  uint8_t **taken_rho_bytes;
+  uint64_t num_taken;
+
+  pthread_mutex_t lock;
+  pthread_cond_t  refill;
+  pthread_t *workers;
+  uint64_t num_workers;
+};
 
 paillier_private_key_t *paillier_encryption_private_new ()
 {
@@ -11,12 +44,129 @@ paillier_private_key_t *paillier_encryption_private_new ()
   priv->N     = scalar_new();
   priv->N2    = scalar_new(); 
 
+  priv->p2      = scalar_new();
+  priv->q2      = scalar_new();
+  priv->hp      = scalar_new();
+  priv->hq      = scalar_new();
+  priv->p_inv_q = scalar_new();
+  priv->phi_p2  = scalar_new();
+  priv->phi_q2  = scalar_new();
+  priv->N_mod_phi_p2 = scalar_new();
+  priv->N_mod_phi_q2 = scalar_new();
+  priv->p2_inv_q2    = scalar_new();
+
+  priv->mont_N  = mont_ctx_new();
+  priv->mont_N2 = mont_ctx_new();
+  priv->mont_p2 = mont_ctx_new();
+  priv->mont_q2 = mont_ctx_new();
+
+  priv->rand_pool = NULL;
+
+  priv->h         = scalar_new();
+  priv->h_N       = scalar_new();
+  priv->h_N_table = NULL;
+
   return priv;
 }
 
+// h = L_prime((1+N)^(prime-1) mod prime^2)^(-1) mod prime, where L_prime(x) = (x-1)/prime
+static void paillier_crt_factor (scalar_t h, const scalar_t prime, const scalar_t prime2, const scalar_t N, BN_CTX *bn_ctx)
+{
+  BN_copy(h, prime);
+  BN_sub_word(h, 1);
+
+  // (1+N)^(prime-1) = 1 + (prime-1)*N (mod prime^2)
+  BN_mod_mul(h, h, N, prime2, bn_ctx);
+  BN_div(h, NULL, h, prime, bn_ctx);
+  BN_mod_inverse(h, h, prime, bn_ctx);
+}
+
+/**
+ *  Short exponent randomness
+ */
+
+// Mode off (key set)
+static void paillier_short_exp_clear (scalar_t h, scalar_t h_N, fixed_base_t *h_N_table)
+{
+  BN_zero(h);
+  BN_zero(h_N);
+  scalar_fixed_base_free(*h_N_table);
+  *h_N_table = NULL;
+}
+
+// Table covers exponents up to masked responses in proofs (mask + e*x)
+#define PAILLIER_SHORT_EXP_TABLE_BITS (PAILLIER_SHORT_EXP_MASK_BITS + 1)
+
+static void paillier_short_exp_set_table (fixed_base_t *h_N_table, const scalar_t h_N, const scalar_t N2)
+{
+  scalar_fixed_base_free(*h_N_table);
+  *h_N_table = scalar_fixed_base_new(h_N, PAILLIER_SHORT_EXP_TABLE_BITS, N2);
+}
+
+static void paillier_short_exp_copy (scalar_t h, scalar_t h_N, fixed_base_t *h_N_table, const scalar_t from_h, const scalar_t from_h_N, const fixed_base_t from_h_N_table)
+{
+  BN_copy(h, from_h);
+  BN_copy(h_N, from_h_N);
+  scalar_fixed_base_free(*h_N_table);
+  *h_N_table = scalar_fixed_base_dup(from_h_N_table);
+}
+
+// rho_to_N = h_N^x mod N^2 for short exponent x, by table (exponentiation if x is too long for it)
+static void paillier_short_exp_to_N (scalar_t rho_to_N, const scalar_t x, const scalar_t h_N, const fixed_base_t h_N_table, const scalar_t N2, mont_ctx_t mont_N2, int vartime)
+{
+  int is_error = (vartime ? scalar_fixed_base_multi_exp_vartime(rho_to_N, &h_N_table, &x, 1) : scalar_fixed_base_multi_exp(rho_to_N, &h_N_table, &x, 1));
+  if (!is_error) return;
+
+  if (vartime) scalar_exp_vartime(rho_to_N, h_N, x, N2, mont_N2);
+  else scalar_exp_mont(rho_to_N, h_N, x, N2, mont_N2);
+}
+
+static void paillier_short_exp_sample (scalar_t x)
+{
+  BN_priv_rand(x, PAILLIER_SHORT_EXP_BITS, BN_RAND_TOP_ANY, BN_RAND_BOTTOM_ANY);
+}
+
+// Randomness pool of the (public) key isn't valid for the private key after it is set or freed, stays with the public key
+static void paillier_private_detach_pool (paillier_private_key_t *priv)
+{
+  if (!priv->rand_pool) return;
+
+  priv->rand_pool->linked_priv = NULL;
+  priv->rand_pool = NULL;
+}
+
+// Resets and computes precomputation, after p, q, N and N2 of private key are set
+static void paillier_private_precompute (paillier_private_key_t *priv)
+{
+  paillier_private_detach_pool(priv);
+
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
+
+  BN_sqr(priv->p2, priv->p, bn_ctx);
+  BN_sqr(priv->q2, priv->q, bn_ctx);
+  paillier_crt_factor(priv->hp, priv->p, priv->p2, priv->N, bn_ctx);
+  paillier_crt_factor(priv->hq, priv->q, priv->q2, priv->N, bn_ctx);
+  BN_mod_inverse(priv->p_inv_q, priv->p, priv->q, bn_ctx);
+
+  BN_sub(priv->phi_p2, priv->p2, priv->p);
+  BN_sub(priv->phi_q2, priv->q2, priv->q);
+  BN_nnmod(priv->N_mod_phi_p2, priv->N, priv->phi_p2, bn_ctx);
+  BN_nnmod(priv->N_mod_phi_q2, priv->N, priv->phi_q2, bn_ctx);
+  BN_mod_inverse(priv->p2_inv_q2, priv->p2, priv->q2, bn_ctx);
+
+  mont_ctx_reset(priv->mont_N);
+  mont_ctx_reset(priv->mont_N2);
+  mont_ctx_reset(priv->mont_p2);
+  mont_ctx_reset(priv->mont_q2);
+
+  paillier_short_exp_clear(priv->h, priv->h_N, &priv->h_N_table);
+
+  bn_ctx_release(bn_ctx);
+}
+
 void paillier_encryption_private_from_primes (paillier_private_key_t *priv, const scalar_t p, const scalar_t q)
 {
-  BN_CTX *bn_ctx = BN_CTX_secure_new();
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
 
   BN_copy(priv->p, p);
   BN_copy(priv->q, q);
@@ -29,8 +179,10 @@ void paillier_encryption_private_from_primes (paillier_private_key_t *priv, cons
   BN_add_word(priv->phi_N, 1);
 
   BN_mod_inverse(priv->mu, priv->phi_N, priv->N, bn_ctx);
+
+  paillier_private_precompute(priv);
   
-  BN_CTX_free(bn_ctx);
+  bn_ctx_release(bn_ctx);
 }
 
 void paillier_encryption_generate_private (paillier_private_key_t *priv, uint64_t prime_bits)
@@ -54,22 +206,62 @@ void paillier_encryption_generate_private (paillier_private_key_t *priv, uint64_
   scalar_free(four);
 }
 
+void paillier_encryption_generate_private_threaded (paillier_private_key_t *priv, uint64_t prime_bits, uint64_t num_threads)
+{
+  scalar_t p = scalar_new();
+  scalar_t q = scalar_new();
+
+  prime_gen_job_t jobs[2] = {{ .prime = p, .bits = prime_bits, .kind = PRIME_KIND_BLUM },
+                             { .prime = q, .bits = prime_bits, .kind = PRIME_KIND_BLUM }};
+  prime_generate_batch(jobs, 2, num_threads);
+
+  paillier_encryption_private_from_primes(priv, p, q);
+
+  scalar_free(p);
+  scalar_free(q);
+}
+
 paillier_public_key_t *paillier_encryption_public_new ()
 {
   paillier_public_key_t *pub = malloc(sizeof(paillier_public_key_t));
 
   pub->N  = scalar_new();
   pub->N2 = scalar_new();
+
+  pub->mont_N  = mont_ctx_new();
+  pub->mont_N2 = mont_ctx_new();
+  pub->exp_N   = NULL;
+  pub->rand_pool = NULL;
+
+  pub->h         = scalar_new();
+  pub->h_N       = scalar_new();
+  pub->h_N_table = NULL;
   
   return pub;
 }
 
+// Resets precomputation, after N and N2 of public key are set
+static void paillier_public_precompute (paillier_public_key_t *pub)
+{
+  paillier_encryption_pool_stop(pub);
+
+  mont_ctx_reset(pub->mont_N);
+  mont_ctx_reset(pub->mont_N2);
+
+  scalar_fixed_exp_free(pub->exp_N);
+  pub->exp_N = scalar_fixed_exp_new(pub->N);
+
+  paillier_short_exp_clear(pub->h, pub->h_N, &pub->h_N_table);
+}
+
 void paillier_encryption_copy_keys (paillier_private_key_t *copy_priv, paillier_public_key_t *copy_pub, const paillier_private_key_t *priv, const paillier_public_key_t *pub)
 {
   if (pub && copy_pub)
   {
     BN_copy(copy_pub->N, pub->N);
     BN_copy(copy_pub->N2, pub->N2);
+    paillier_public_precompute(copy_pub);
+    paillier_short_exp_copy(copy_pub->h, copy_pub->h_N, &copy_pub->h_N_table, pub->h, pub->h_N, pub->h_N_table);
   }
 
   if (priv)
@@ -82,12 +274,16 @@ void paillier_encryption_copy_keys (paillier_private_key_t *copy_priv, paillier_
       BN_copy(copy_priv->phi_N, priv->phi_N);
       BN_copy(copy_priv->N, priv->N);
       BN_copy(copy_priv->N2, priv->N2);
+      paillier_private_precompute(copy_priv);
+      paillier_short_exp_copy(copy_priv->h, copy_priv->h_N, &copy_priv->h_N_table, priv->h, priv->h_N, priv->h_N_table);
     }
 
     if (!pub && copy_pub)
     {
       BN_copy(copy_pub->N, priv->N);
       BN_copy(copy_pub->N2, priv->N2);
+      paillier_public_precompute(copy_pub);
+      paillier_short_exp_copy(copy_pub->h, copy_pub->h_N, &copy_pub->h_N_table, priv->h, priv->h_N, priv->h_N_table);
     }
   }
 }
@@ -96,76 +292,598 @@ void paillier_encryption_free_keys (paillier_private_key_t *priv, paillier_publi
 {
   if (priv) 
   {
+    paillier_private_detach_pool(priv);
+
     scalar_free(priv->p);
     scalar_free(priv->q);
     scalar_free(priv->phi_N);
     scalar_free(priv->mu);
     scalar_free(priv->N);
     scalar_free(priv->N2);
+    scalar_free(priv->p2);
+    scalar_free(priv->q2);
+    scalar_free(priv->hp);
+    scalar_free(priv->hq);
+    scalar_free(priv->p_inv_q);
+    scalar_free(priv->phi_p2);
+    scalar_free(priv->phi_q2);
+    scalar_free(priv->N_mod_phi_p2);
+    scalar_free(priv->N_mod_phi_q2);
+    scalar_free(priv->p2_inv_q2);
+    mont_ctx_free(priv->mont_N);
+    mont_ctx_free(priv->mont_N2);
+    mont_ctx_free(priv->mont_p2);
+    mont_ctx_free(priv->mont_q2);
+    scalar_free(priv->h);
+    scalar_free(priv->h_N);
+    scalar_fixed_base_free(priv->h_N_table);
 
     free(priv);
   }
 
   if (pub)
   {
+    paillier_encryption_pool_stop(pub);
+
     scalar_free(pub->N);
     scalar_free(pub->N2);
+    mont_ctx_free(pub->mont_N);
+    mont_ctx_free(pub->mont_N2);
+    scalar_fixed_exp_free(pub->exp_N);
+    scalar_free(pub->h);
+    scalar_free(pub->h_N);
+    scalar_fixed_base_free(pub->h_N_table);
 
     free(pub);
   }
 }
 
 
+// result = x mod N^2, where x = x_p2 (mod p^2) and x = x_q2 (mod q^2). result can be x_p2 or x_q2.
+static void paillier_crt_combine (scalar_t result, const scalar_t x_p2, const scalar_t x_q2, const paillier_private_key_t *priv)
+{
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
+  BIGNUM *diff = BN_CTX_get(bn_ctx);
+
+  BN_mod_sub(diff, x_q2, x_p2, priv->q2, bn_ctx);
+  BN_mod_mul(diff, diff, priv->p2_inv_q2, priv->q2, bn_ctx);
+  BN_mul(diff, diff, priv->p2, bn_ctx);
+  BN_add(result, x_p2, diff);
+
+  bn_ctx_release(bn_ctx);
+}
+
+// result = base^exp mod N^2 by CRT, where exp_p2 and exp_q2 are exp reduced modulo p(p-1) and q(q-1). base coprime to N.
+static void paillier_exp_private (scalar_t result, const scalar_t base, const scalar_t exp_p2, const scalar_t exp_q2, const paillier_private_key_t *priv)
+{
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
+  BIGNUM *x_p2 = BN_CTX_get(bn_ctx);
+  BIGNUM *x_q2 = BN_CTX_get(bn_ctx);
+
+  BN_nnmod(x_p2, base, priv->p2, bn_ctx);
+  scalar_exp_mont(x_p2, x_p2, exp_p2, priv->p2, priv->mont_p2);
+  BN_nnmod(x_q2, base, priv->q2, bn_ctx);
+  scalar_exp_mont(x_q2, x_q2, exp_q2, priv->q2, priv->mont_q2);
+
+  paillier_crt_combine(result, x_p2, x_q2, priv);
+
+  bn_ctx_release(bn_ctx);
+}
+
+void paillier_encryption_short_exp_setup (paillier_private_key_t *priv)
+{
+  paillier_private_detach_pool(priv);
+
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
+
+  // h = -y^2 mod N for random y in Z_N^*, h_N = h^N mod N^2 by CRT
+  scalar_sample_in_range(priv->h, priv->N, 1);
+  BN_mod_sqr(priv->h, priv->h, priv->N, bn_ctx);
+  BN_sub(priv->h, priv->N, priv->h);
+  paillier_exp_private(priv->h_N, priv->h, priv->N_mod_phi_p2, priv->N_mod_phi_q2, priv);
+  paillier_short_exp_set_table(&priv->h_N_table, priv->h_N, priv->N2);
+
+  bn_ctx_release(bn_ctx);
+}
+
+/**
+ *  Randomness pool
+ */
+
+static void *paillier_rand_pool_worker (void *arg)
+{
+  paillier_rand_pool_t pool = arg;
+
+  scalar_t rho = scalar_new();
+  scalar_t rho_to_N = scalar_new();
+
+  pthread_mutex_lock(&pool->lock);
+  while (1)
+  {
+    while (!pool->stop && !pool->filling) pthread_cond_wait(&pool->refill, &pool->lock);
+    if (pool->stop) break;
+    pthread_mutex_unlock(&pool->lock);
+
+    if (pool->pub->h_N_table)
+    {
+      paillier_short_exp_sample(rho);
+      paillier_short_exp_to_N(rho_to_N, rho, pool->pub->h_N, pool->pub->h_N_table, pool->pub->N2, pool->pub->mont_N2, 0);
+    }
+    else
+    {
+      scalar_sample_in_range(rho, pool->pub->N, 1);
+      if (pool->priv) paillier_exp_private(rho_to_N, rho, pool->priv->N_mod_phi_p2, pool->priv->N_mod_phi_q2, pool->priv);
+      else scalar_exp_fixed_exp(rho_to_N, rho, pool->pub->exp_N, pool->pub->N2, pool->pub->mont_N2);
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->num_ready < pool->depth)
+    {
+      uint64_t slot = (pool->ready_head + pool->num_ready) % pool->depth;
+      BN_copy(pool->ready_rho[slot], rho);
+      BN_copy(pool->ready_rho_to_N[slot], rho_to_N);
+      pool->num_ready++;
+    }
+    if (pool->num_ready == pool->depth) pool->filling = 0;
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  scalar_free(rho);
+  scalar_free(rho_to_N);
+
+  return NULL;
+}
+
+void paillier_encryption_pool_start (paillier_public_key_t *pub, paillier_private_key_t *priv, uint64_t depth, uint64_t low_watermark, uint64_t num_workers)
+{
+  paillier_encryption_pool_stop(pub);
+
+  if ((depth == 0) || (num_workers == 0)) return;
+  if (priv) assert(BN_cmp(priv->N, pub->N) == 0);
+
+  paillier_rand_pool_t pool = malloc(sizeof(*pool));
+
+  pool->pub = paillier_encryption_public_new();
+  paillier_encryption_copy_keys(NULL, pool->pub, NULL, pub);
+  pool->priv = NULL;
+  pool->linked_priv = NULL;
+  if (priv)
+  {
+    pool->priv = paillier_encryption_private_new();
+    paillier_encryption_copy_keys(pool->priv, NULL, priv, NULL);
+    paillier_private_detach_pool(priv);
+    pool->linked_priv = priv;
+    priv->rand_pool = pool;
+  }
+  pool->rho_bytes = BN_num_bytes(pub->N);
+
+  pool->depth = depth;
+  pool->low_watermark = (low_watermark < depth ? low_watermark : depth - 1);
+  pool->filling = 1;
+  pool->stop = 0;
+
+  pool->ready_rho       = calloc(depth, sizeof(scalar_t));
+  pool->ready_rho_to_N  = calloc(depth, sizeof(scalar_t));
+  pool->taken_rho_to_N  = calloc(depth, sizeof(scalar_t));
+  pool->taken_rho_bytes = calloc(depth, sizeof(uint8_t *));
+  for (uint64_t i = 0; i < depth; ++i)
+  {
+    pool->ready_rho[i]       = scalar_new();
+    pool->ready_rho_to_N[i]  = scalar_new();
+    pool->taken_rho_to_N[i]  = scalar_new();
+    pool->taken_rho_bytes[i] = OPENSSL_secure_zalloc(pool->rho_bytes);
+  }
+  pool->ready_head = 0;
+  pool->num_ready = 0;
+  pool->num_taken = 0;
+
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->refill, NULL);
+
+  pool->num_workers = num_workers;
+  pool->workers = calloc(num_workers, sizeof(pthread_t));
+  for (uint64_t i = 0; i < num_workers; ++i) pthread_create(&pool->workers[i], NULL, paillier_rand_pool_worker, pool);
+
+  pub->rand_pool = pool;
+}
+
+void paillier_encryption_pool_stop (paillier_public_key_t *pub)
+{
+  paillier_rand_pool_t pool = pub->rand_pool;
+  if (!pool) return;
+
+  pthread_mutex_lock(&pool->lock);
+  pool->stop = 1;
+  pthread_cond_broadcast(&pool->refill);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (uint64_t i = 0; i < pool->num_workers; ++i) pthread_join(pool->workers[i], NULL);
+
+  if (pool->linked_priv) pool->linked_priv->rand_pool = NULL;
+
+  for (uint64_t i = 0; i < pool->depth; ++i)
+  {
+    scalar_free(pool->ready_rho[i]);
+    scalar_free(pool->ready_rho_to_N[i]);
+    scalar_free(pool->taken_rho_to_N[i]);
+    OPENSSL_secure_clear_free(pool->taken_rho_bytes[i], pool->rho_bytes);
+  }
+  free(pool->ready_rho);
+  free(pool->ready_rho_to_N);
+  free(pool->taken_rho_to_N);
+  free(pool->taken_rho_bytes);
+  free(pool->workers);
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->refill);
+  paillier_encryption_free_keys(pool->priv, pool->pub);
+  free(pool);
+
+  pub->rand_pool = NULL;
+}
+
+uint64_t paillier_encryption_pool_available (const paillier_public_key_t *pub)
+{
+  paillier_rand_pool_t pool = pub->rand_pool;
+  if (!pool) return 0;
+
+  pthread_mutex_lock(&pool->lock);
+  uint64_t num_ready = pool->num_ready;
+  pthread_mutex_unlock(&pool->lock);
+
+  return num_ready;
+}
+
+// Sets rho from a ready pair (which is kept as taken), returns 0 if pool is empty (or NULL)
+static int paillier_rand_pool_sample (paillier_rand_pool_t pool, scalar_t rho)
+{
+  if (!pool) return 0;
+
+  pthread_mutex_lock(&pool->lock);
+
+  int is_sampled = (pool->num_ready > 0);
+  if (is_sampled)
+  {
+    uint64_t slot = pool->ready_head;
+    pool->ready_head = (pool->ready_head + 1) % pool->depth;
+    pool->num_ready--;
+
+    // Oldest taken pair is dropped when full (rho never used for encryption)
+    if (pool->num_taken == pool->depth)
+    {
+      scalar_t dropped_rho_to_N = pool->taken_rho_to_N[0];
+      uint8_t *dropped_rho_bytes = pool->taken_rho_bytes[0];
+      memmove(pool->taken_rho_to_N, pool->taken_rho_to_N + 1, (pool->depth - 1) * sizeof(scalar_t));
+      memmove(pool->taken_rho_bytes, pool->taken_rho_bytes + 1, (pool->depth - 1) * sizeof(uint8_t *));
+      pool->taken_rho_to_N[pool->depth - 1] = dropped_rho_to_N;
+      pool->taken_rho_bytes[pool->depth - 1] = dropped_rho_bytes;
+      pool->num_taken--;
+    }
+
+    BN_copy(rho, pool->ready_rho[slot]);
+    BN_bn2binpad(pool->ready_rho[slot], pool->taken_rho_bytes[pool->num_taken], pool->rho_bytes);
+    BN_copy(pool->taken_rho_to_N[pool->num_taken], pool->ready_rho_to_N[slot]);
+    pool->num_taken++;
+
+    BN_clear(pool->ready_rho[slot]);
+    BN_clear(pool->ready_rho_to_N[slot]);
+  }
+
+  if (!pool->filling && (pool->num_ready <= pool->low_watermark))
+  {
+    pool->filling = 1;
+    pthread_cond_broadcast(&pool->refill);
+  }
+
+  pthread_mutex_unlock(&pool->lock);
+
+  return is_sampled;
+}
+
+// If rho was sampled from pool, sets rho_to_N = rho^N (mod N^2) and removes it from taken pairs. Returns 0 if not found.
+static int paillier_rand_pool_lookup (paillier_rand_pool_t pool, scalar_t rho_to_N, const scalar_t rho)
+{
+  if (!pool) return 0;
+
+  uint8_t *rho_bytes = OPENSSL_secure_malloc(pool->rho_bytes);
+  if (BN_bn2binpad(rho, rho_bytes, pool->rho_bytes) < 0)
+  {
+    OPENSSL_secure_free(rho_bytes);
+    return 0;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+
+  int is_found = 0;
+  for (uint64_t i = 0; (i < pool->num_taken) && (!is_found); ++i)
+  {
+    if (CRYPTO_memcmp(rho_bytes, pool->taken_rho_bytes[i], pool->rho_bytes) != 0) continue;
+
+    is_found = 1;
+    BN_copy(rho_to_N, pool->taken_rho_to_N[i]);
+
+    // Move last taken pair to its place
+    scalar_t found_rho_to_N = pool->taken_rho_to_N[i];
+    uint8_t *found_rho_bytes = pool->taken_rho_bytes[i];
+    BN_clear(found_rho_to_N);
+    OPENSSL_cleanse(found_rho_bytes, pool->rho_bytes);
+
+    pool->num_taken--;
+    pool->taken_rho_to_N[i] = pool->taken_rho_to_N[pool->num_taken];
+    pool->taken_rho_bytes[i] = pool->taken_rho_bytes[pool->num_taken];
+    pool->taken_rho_to_N[pool->num_taken] = found_rho_to_N;
+    pool->taken_rho_bytes[pool->num_taken] = found_rho_bytes;
+  }
+
+  pthread_mutex_unlock(&pool->lock);
+
+  OPENSSL_secure_clear_free(rho_bytes, pool->rho_bytes);
+  return is_found;
+}
+
 void paillier_encryption_sample (scalar_t rho, const paillier_public_key_t *pub)
 {
-  scalar_sample_in_range(rho, pub->N, 1);
+  if (paillier_rand_pool_sample(pub->rand_pool, rho)) return;
+
+  if (pub->h_N_table) paillier_short_exp_sample(rho);
+  else scalar_sample_in_range(rho, pub->N, 1);
 }
 
+void paillier_encryption_sample_mask (scalar_t mask, const paillier_public_key_t *pub)
+{
+  // Top bit set, so mask + e*x > 0 for |e*x| < 2^(MASK_BITS-1)
+  if (pub->h_N_table) BN_priv_rand(mask, PAILLIER_SHORT_EXP_MASK_BITS, BN_RAND_TOP_ONE, BN_RAND_BOTTOM_ANY);
+  else paillier_encryption_sample(mask, pub);
+}
 
-void paillier_encryption_encrypt (scalar_t ciphertext, const scalar_t plaintext, const scalar_t rho, const paillier_public_key_t *pub)
+void paillier_encryption_randomness_response (scalar_t response, const scalar_t mask, const scalar_t rho, const scalar_t e, const paillier_public_key_t *pub)
 {
-  BN_CTX *bn_ctx = BN_CTX_secure_new(); 
-  BIGNUM *first_factor = scalar_new();
-  BIGNUM *res_ciphertext = scalar_new();
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
+  BIGNUM *temp = BN_CTX_get(bn_ctx);
+
+  if (pub->h_N_table)
+  {
+    BN_mul(temp, e, rho, bn_ctx);
+    BN_add(response, mask, temp);
+  }
+  else
+  {
+    scalar_exp_mont(temp, rho, e, pub->N, pub->mont_N);
+    BN_mod_mul(response, mask, temp, pub->N, bn_ctx);
+  }
+
+  bn_ctx_release(bn_ctx);
+}
+
+
+static void paillier_encryption_encrypt_tier (scalar_t ciphertext, const scalar_t plaintext, const scalar_t rho, const paillier_public_key_t *pub, int vartime)
+{
+  BN_CTX *bn_ctx = bn_ctx_acquire(!vartime); 
+  BIGNUM *first_factor = BN_CTX_get(bn_ctx);
+  BIGNUM *res_ciphertext = BN_CTX_get(bn_ctx);
   
   BN_mod_mul(first_factor, pub->N, plaintext, pub->N2, bn_ctx);
   BN_add_word(first_factor, 1);
-  scalar_exp(res_ciphertext, rho, pub->N, pub->N2);
+  if (!vartime && paillier_rand_pool_lookup(pub->rand_pool, res_ciphertext, rho)) ;
+  else if (pub->h_N_table) paillier_short_exp_to_N(res_ciphertext, rho, pub->h_N, pub->h_N_table, pub->N2, pub->mont_N2, vartime);
+  else if (pub->exp_N) scalar_exp_fixed_exp(res_ciphertext, rho, pub->exp_N, pub->N2, pub->mont_N2);
+  else if (vartime) scalar_exp_vartime(res_ciphertext, rho, pub->N, pub->N2, pub->mont_N2);
+  else scalar_exp_mont(res_ciphertext, rho, pub->N, pub->N2, pub->mont_N2);
   BN_mod_mul(res_ciphertext, first_factor, res_ciphertext, pub->N2, bn_ctx);
   BN_copy(ciphertext, res_ciphertext);
 
-  scalar_free(res_ciphertext);
-  scalar_free(first_factor);
-  BN_CTX_free(bn_ctx);
+  bn_ctx_release(bn_ctx);
+}
+
+void paillier_encryption_encrypt (scalar_t ciphertext, const scalar_t plaintext, const scalar_t rho, const paillier_public_key_t *pub)
+{
+  paillier_encryption_encrypt_tier(ciphertext, plaintext, rho, pub, 0);
+}
+
+void paillier_encryption_encrypt_vartime (scalar_t ciphertext, const scalar_t plaintext, const scalar_t rho, const paillier_public_key_t *pub)
+{
+  paillier_encryption_encrypt_tier(ciphertext, plaintext, rho, pub, 1);
+}
+
+void paillier_encryption_encrypt_batch (scalar_t *ciphertexts, const scalar_t *plaintexts, const scalar_t *rhos, uint64_t count, const paillier_public_key_t *pub)
+{
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
+
+  // Randomness from pool is already exponentiated, short exponents are by table, the rest is batched
+  uint64_t num_exp = 0;
+  scalar_t *rho_to_N = calloc(count, sizeof(scalar_t));
+  scalar_t *exp_results = calloc(count, sizeof(scalar_t));
+  scalar_t *exp_bases = calloc(count, sizeof(scalar_t));
+  scalar_t *exps = calloc(count, sizeof(scalar_t));
+  for (uint64_t i = 0; i < count; ++i)
+  {
+    rho_to_N[i] = BN_CTX_get(bn_ctx);
+    if (paillier_rand_pool_lookup(pub->rand_pool, rho_to_N[i], rhos[i])) continue;
+    if (pub->h_N_table)
+    {
+      paillier_short_exp_to_N(rho_to_N[i], rhos[i], pub->h_N, pub->h_N_table, pub->N2, pub->mont_N2, 0);
+      continue;
+    }
+
+    exp_results[num_exp] = rho_to_N[i];
+    exp_bases[num_exp] = rhos[i];
+    exps[num_exp++] = pub->N;
+  }
+
+  scalar_exp_batch(exp_results, exp_bases, exps, num_exp, pub->N2, pub->mont_N2);
+
+  scalar_t first_factor = BN_CTX_get(bn_ctx);
+  for (uint64_t i = 0; i < count; ++i)
+  {
+    BN_mod_mul(first_factor, pub->N, plaintexts[i], pub->N2, bn_ctx);
+    BN_add_word(first_factor, 1);
+    BN_mod_mul(ciphertexts[i], first_factor, rho_to_N[i], pub->N2, bn_ctx);
+  }
+
+  free(rho_to_N);
+  free(exp_results);
+  free(exp_bases);
+  free(exps);
+  bn_ctx_release(bn_ctx);
 }
 
+void paillier_encryption_encrypt_private (scalar_t ciphertext, const scalar_t plaintext, const scalar_t rho, const paillier_private_key_t *priv)
+{
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
+  BIGNUM *first_factor = BN_CTX_get(bn_ctx);
+  BIGNUM *res_ciphertext = BN_CTX_get(bn_ctx);
+
+  BN_mod_mul(first_factor, priv->N, plaintext, priv->N2, bn_ctx);
+  BN_add_word(first_factor, 1);
+  if (paillier_rand_pool_lookup(priv->rand_pool, res_ciphertext, rho)) ;
+  else if (priv->h_N_table) paillier_short_exp_to_N(res_ciphertext, rho, priv->h_N, priv->h_N_table, priv->N2, priv->mont_N2, 0);
+  else paillier_exp_private(res_ciphertext, rho, priv->N_mod_phi_p2, priv->N_mod_phi_q2, priv);
+  BN_mod_mul(ciphertext, first_factor, res_ciphertext, priv->N2, bn_ctx);
+
+  bn_ctx_release(bn_ctx);
+}
+
+void paillier_encryption_encrypt_private_batch (scalar_t *ciphertexts, const scalar_t *plaintexts, const scalar_t *rhos, uint64_t count, const paillier_private_key_t *priv)
+{
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
+
+  // Randomness from pool is already exponentiated, short exponents are by table. For the rest, exponentiations modulo p^2 (and q^2) are all with the same modulus, so batched.
+  uint64_t num_exp = 0;
+  scalar_t *rho_to_N = calloc(count, sizeof(scalar_t));
+  uint64_t *exp_index = calloc(count, sizeof(uint64_t));
+  scalar_t *rho_p2 = calloc(count, sizeof(scalar_t));
+  scalar_t *rho_q2 = calloc(count, sizeof(scalar_t));
+  scalar_t *exps_p2 = calloc(count, sizeof(scalar_t));
+  scalar_t *exps_q2 = calloc(count, sizeof(scalar_t));
+  for (uint64_t i = 0; i < count; ++i)
+  {
+    rho_to_N[i] = BN_CTX_get(bn_ctx);
+    if (paillier_rand_pool_lookup(priv->rand_pool, rho_to_N[i], rhos[i])) continue;
+    if (priv->h_N_table)
+    {
+      paillier_short_exp_to_N(rho_to_N[i], rhos[i], priv->h_N, priv->h_N_table, priv->N2, priv->mont_N2, 0);
+      continue;
+    }
+
+    rho_p2[num_exp] = BN_CTX_get(bn_ctx);
+    rho_q2[num_exp] = BN_CTX_get(bn_ctx);
+    BN_nnmod(rho_p2[num_exp], rhos[i], priv->p2, bn_ctx);
+    BN_nnmod(rho_q2[num_exp], rhos[i], priv->q2, bn_ctx);
+    exps_p2[num_exp] = priv->N_mod_phi_p2;
+    exps_q2[num_exp] = priv->N_mod_phi_q2;
+    exp_index[num_exp++] = i;
+  }
+
+  scalar_exp_batch(rho_p2, rho_p2, exps_p2, num_exp, priv->p2, priv->mont_p2);
+  scalar_exp_batch(rho_q2, rho_q2, exps_q2, num_exp, priv->q2, priv->mont_q2);
+  for (uint64_t k = 0; k < num_exp; ++k) paillier_crt_combine(rho_to_N[exp_index[k]], rho_p2[k], rho_q2[k], priv);
+
+  scalar_t first_factor = BN_CTX_get(bn_ctx);
+  for (uint64_t i = 0; i < count; ++i)
+  {
+    BN_mod_mul(first_factor, priv->N, plaintexts[i], priv->N2, bn_ctx);
+    BN_add_word(first_factor, 1);
+    BN_mod_mul(ciphertexts[i], first_factor, rho_to_N[i], priv->N2, bn_ctx);
+  }
+
+  free(rho_to_N);
+  free(exp_index);
+  free(rho_p2);
+  free(rho_q2);
+  free(exps_p2);
+  free(exps_q2);
+  bn_ctx_release(bn_ctx);
+}
+
+int  paillier_encryption_encrypt_multi_exp_vartime (scalar_t result, const scalar_t plaintext, const scalar_t rho, const scalar_t *bases, const scalar_t *exps, uint64_t count, const paillier_public_key_t *pub)
+{
+  BN_CTX *bn_ctx = bn_ctx_acquire(0);
+  scalar_t first_factor = BN_CTX_get(bn_ctx);
+  scalar_t rand_factor = BN_CTX_get(bn_ctx);
+
+  // Randomness factor rho^N, or h_N^rho in short exponent mode (by table, unless rho is too long for it)
+  int is_rand_by_table = pub->h_N_table && (scalar_fixed_base_multi_exp_vartime(rand_factor, &pub->h_N_table, &rho, 1) == 0);
+
+  uint64_t num_bases = 0;
+  scalar_t *all_bases = calloc(count + 1, sizeof(scalar_t));
+  scalar_t *all_exps = calloc(count + 1, sizeof(scalar_t));
+  if (!is_rand_by_table)
+  {
+    all_bases[num_bases] = (pub->h_N_table ? pub->h_N : rho);
+    all_exps[num_bases++] = (pub->h_N_table ? rho : pub->N);
+  }
+  for (uint64_t i = 0; i < count; ++i)
+  {
+    all_bases[num_bases] = bases[i];
+    all_exps[num_bases++] = exps[i];
+  }
+
+  // (1+N)^plaintext = 1 + plaintext*N (mod N^2)
+  BN_mod_mul(first_factor, pub->N, plaintext, pub->N2, bn_ctx);
+  BN_add_word(first_factor, 1);
+  if (is_rand_by_table) BN_mod_mul(first_factor, first_factor, rand_factor, pub->N2, bn_ctx);
+  int is_error = 0;
+  if (num_bases > 0) is_error = scalar_multi_exp_vartime(result, all_bases, all_exps, num_bases, pub->N2, pub->mont_N2);
+  else BN_one(result);
+  BN_mod_mul(result, first_factor, result, pub->N2, bn_ctx);
+
+  free(all_bases);
+  free(all_exps);
+  bn_ctx_release(bn_ctx);
+
+  return is_error;
+}
+
+// m_prime = L_prime(c^(prime-1) mod prime^2) * h mod prime
+static void paillier_decrypt_mod_prime (scalar_t m_prime, const scalar_t ciphertext, const scalar_t prime, const scalar_t prime2, const scalar_t h, mont_ctx_t mont_prime2, BN_CTX *bn_ctx)
+{
+  BIGNUM *exp = BN_CTX_get(bn_ctx);
+
+  BN_copy(exp, prime);
+  BN_sub_word(exp, 1);
+
+  BN_nnmod(m_prime, ciphertext, prime2, bn_ctx);
+  scalar_exp_mont(m_prime, m_prime, exp, prime2, mont_prime2);
+  BN_sub_word(m_prime, 1);
+  BN_div(m_prime, NULL, m_prime, prime, bn_ctx);
+  BN_mod_mul(m_prime, m_prime, h, prime, bn_ctx);
+}
 
 void paillier_encryption_decrypt (scalar_t plaintext, const scalar_t ciphertext, const paillier_private_key_t *priv)
 {
-  BN_CTX *bn_ctx = BN_CTX_secure_new();
-  BIGNUM *res_plaintext = scalar_new();
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
+  BIGNUM *m_p = BN_CTX_get(bn_ctx);
+  BIGNUM *m_q = BN_CTX_get(bn_ctx);
+
+  paillier_decrypt_mod_prime(m_p, ciphertext, priv->p, priv->p2, priv->hp, priv->mont_p2, bn_ctx);
+  paillier_decrypt_mod_prime(m_q, ciphertext, priv->q, priv->q2, priv->hq, priv->mont_q2, bn_ctx);
 
-  BN_mod_exp(res_plaintext, ciphertext, priv->phi_N, priv->N2, bn_ctx);
-  BN_sub_word(res_plaintext, 1);
-  BN_div(res_plaintext, NULL, res_plaintext, priv->N, bn_ctx);
-  BN_mod_mul(res_plaintext, res_plaintext, priv->mu, priv->N, bn_ctx);
+  // CRT: m = m_p + p * ((m_q - m_p) * p^(-1) mod q)
+  BN_mod_sub(m_q, m_q, m_p, priv->q, bn_ctx);
+  BN_mod_mul(m_q, m_q, priv->p_inv_q, priv->q, bn_ctx);
+  BN_mul(m_q, m_q, priv->p, bn_ctx);
+  BN_add(plaintext, m_p, m_q);
 
-  BN_copy(plaintext, res_plaintext);
-  scalar_free(res_plaintext);
-  BN_CTX_free(bn_ctx);
+  bn_ctx_release(bn_ctx);
+}
+
+void paillier_encryption_decrypt_sum (scalar_t plaintext, const scalar_t *ciphertexts, uint64_t count, const paillier_private_key_t *priv)
+{
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
+  BIGNUM *product = BN_CTX_get(bn_ctx);
+
+  BN_one(product);
+  for (uint64_t i = 0; i < count; ++i) BN_mod_mul(product, product, ciphertexts[i], priv->N2, bn_ctx);
+  paillier_encryption_decrypt(plaintext, product, priv);
+
+  bn_ctx_release(bn_ctx);
 }
 
 void paillier_encryption_homomorphic (scalar_t new_cipher, const scalar_t ciphertext, const scalar_t factor, const scalar_t add_cipher, const paillier_public_key_t *pub)
 {
-  BN_CTX *bn_ctx = BN_CTX_secure_new();
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
   BIGNUM *res_new_cipher = BN_dup(ciphertext);
 
-  if (factor)
-  {
-    // If exp negative, it ignores and uses positive, and invert result (fail if result isn't coprime to modulus)
-    BN_mod_exp(res_new_cipher, res_new_cipher, factor, pub->N2, bn_ctx);
-    if (BN_is_negative(factor)) BN_mod_inverse(res_new_cipher, res_new_cipher, pub->N2, bn_ctx);
-  }
+  if (factor) scalar_exp_mont(res_new_cipher, res_new_cipher, factor, pub->N2, pub->mont_N2);
   
   if (add_cipher)
   {
@@ -174,13 +892,36 @@ void paillier_encryption_homomorphic (scalar_t new_cipher, const scalar_t cipher
 
   BN_copy(new_cipher, res_new_cipher);
   scalar_free(res_new_cipher);
-  BN_CTX_free(bn_ctx);
+  bn_ctx_release(bn_ctx);
 }
 
 
+void paillier_encryption_homomorphic_private (scalar_t new_cipher, const scalar_t ciphertext, const scalar_t factor, const scalar_t add_cipher, const paillier_private_key_t *priv)
+{
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
+  BIGNUM *res_new_cipher = BN_CTX_get(bn_ctx);
+  BIGNUM *factor_p2 = BN_CTX_get(bn_ctx);
+  BIGNUM *factor_q2 = BN_CTX_get(bn_ctx);
+
+  BN_copy(res_new_cipher, ciphertext);
+
+  if (factor)
+  {
+    // Negative factor is reduced to positive exponent in the group order
+    BN_nnmod(factor_p2, factor, priv->phi_p2, bn_ctx);
+    BN_nnmod(factor_q2, factor, priv->phi_q2, bn_ctx);
+    paillier_exp_private(res_new_cipher, res_new_cipher, factor_p2, factor_q2, priv);
+  }
+
+  if (add_cipher) BN_mod_mul(res_new_cipher, res_new_cipher, add_cipher, priv->N2, bn_ctx);
+
+  BN_copy(new_cipher, res_new_cipher);
+  bn_ctx_release(bn_ctx);
+}
+
 void paillier_public_to_bytes (uint8_t **bytes, uint64_t *byte_len, const paillier_public_key_t *pub, uint64_t paillier_modulus_bytes, int move_to_end)
 {
-  uint64_t needed_byte_len = paillier_modulus_bytes;
+  uint64_t needed_byte_len = 2*paillier_modulus_bytes;
 
   if ((!bytes) || (!*bytes) || (!pub) || (needed_byte_len > *byte_len))
   {
@@ -191,6 +932,7 @@ void paillier_public_to_bytes (uint8_t **bytes, uint64_t *byte_len, const pailli
   uint8_t *set_bytes = *bytes;
   
   scalar_to_bytes(&set_bytes, paillier_modulus_bytes, pub->N, 1);
+  scalar_to_bytes(&set_bytes, paillier_modulus_bytes, pub->h, 1);
   
   assert(set_bytes == *bytes + needed_byte_len);
   *byte_len = needed_byte_len;
@@ -199,7 +941,7 @@ void paillier_public_to_bytes (uint8_t **bytes, uint64_t *byte_len, const pailli
 
 void paillier_public_from_bytes (paillier_public_key_t *pub, uint8_t **bytes, uint64_t *byte_len, uint64_t paillier_modulus_bytes, int move_to_end)
 {
-  uint64_t needed_byte_len = paillier_modulus_bytes;
+  uint64_t needed_byte_len = 2*paillier_modulus_bytes;
 
   if ((!bytes) || (!*bytes) || (!pub) || (needed_byte_len > *byte_len))
   {
@@ -209,13 +951,189 @@ void paillier_public_from_bytes (paillier_public_key_t *pub, uint8_t **bytes, ui
 
   uint8_t *read_bytes = *bytes;
   
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
+  BIGNUM *h = BN_CTX_get(bn_ctx);
+
   scalar_from_bytes(pub->N, &read_bytes, paillier_modulus_bytes, 1);
+  scalar_from_bytes(h, &read_bytes, paillier_modulus_bytes, 1);
   
-  BN_CTX *bn_ctx = BN_CTX_secure_new();
   BN_sqr(pub->N2, pub->N, bn_ctx);
-  BN_CTX_free(bn_ctx);
+
+  paillier_public_precompute(pub);
+
+  // Short exponent mode, h_N is computed (not received) so it is an N-th power
+  if (!BN_is_zero(h) && (BN_cmp(h, pub->N) < 0) && scalar_coprime(h, pub->N))
+  {
+    BN_copy(pub->h, h);
+    scalar_exp_fixed_exp(pub->h_N, pub->h, pub->exp_N, pub->N2, pub->mont_N2);
+    paillier_short_exp_set_table(&pub->h_N_table, pub->h_N, pub->N2);
+  }
+
+  bn_ctx_release(bn_ctx);
   
   assert(read_bytes == *bytes + needed_byte_len);
   *byte_len = needed_byte_len;
   if (move_to_end) *bytes = read_bytes;
-}
\ No newline at end of file
+}
+
+/**
+ *  Stored keys (with precomputation)
+ */
+
+static int paillier_stored_is_zero (const uint8_t *bytes, uint64_t byte_len)
+{
+  uint8_t acc = 0;
+  for (uint64_t i = 0; i < byte_len; ++i) acc |= bytes[i];
+  return acc == 0;
+}
+
+// Stored h, h_N and h_N's table (only for non-zero h)
+static void paillier_short_exp_to_bytes (uint8_t **bytes, const scalar_t h, const scalar_t h_N, const fixed_base_t h_N_table, uint64_t paillier_modulus_bytes)
+{
+  uint64_t table_byte_len = UINT64_MAX;
+
+  scalar_to_bytes(bytes, paillier_modulus_bytes, h, 1);
+  scalar_to_bytes(bytes, 2*paillier_modulus_bytes, h_N, 1);
+  if (!BN_is_zero(h)) scalar_fixed_base_to_bytes(bytes, &table_byte_len, h_N_table, PAILLIER_SHORT_EXP_TABLE_BITS, 2*paillier_modulus_bytes, 1);
+}
+
+static void paillier_short_exp_from_bytes (scalar_t h, scalar_t h_N, fixed_base_t *h_N_table, uint8_t **bytes, const scalar_t N2, uint64_t paillier_modulus_bytes)
+{
+  uint64_t table_byte_len = UINT64_MAX;
+
+  scalar_from_bytes(h, bytes, paillier_modulus_bytes, 1);
+  scalar_from_bytes(h_N, bytes, 2*paillier_modulus_bytes, 1);
+  if (!BN_is_zero(h)) scalar_fixed_base_from_bytes(h_N_table, bytes, &table_byte_len, PAILLIER_SHORT_EXP_TABLE_BITS, N2, 2*paillier_modulus_bytes, 1);
+}
+
+// Bytes of stored key starting with fixed_byte_len fixed fields, h at h_offset, followed by table if h is non-zero
+static uint64_t paillier_stored_byte_len (const uint8_t *bytes, uint64_t byte_len, int has_table, uint64_t fixed_byte_len, uint64_t h_offset, uint64_t paillier_modulus_bytes)
+{
+  uint64_t table_byte_len;
+  scalar_fixed_base_to_bytes(NULL, &table_byte_len, NULL, PAILLIER_SHORT_EXP_TABLE_BITS, 2*paillier_modulus_bytes, 0);
+
+  if (bytes && (byte_len >= fixed_byte_len)) has_table = !paillier_stored_is_zero(bytes + h_offset, paillier_modulus_bytes);
+  return fixed_byte_len + (has_table ? table_byte_len : 0);
+}
+
+void paillier_public_stored_to_bytes (uint8_t **bytes, uint64_t *byte_len, const paillier_public_key_t *pub, uint64_t paillier_modulus_bytes, int move_to_end)
+{
+  uint64_t needed_byte_len = paillier_stored_byte_len(NULL, 0, pub && !BN_is_zero(pub->h), 6*paillier_modulus_bytes, 3*paillier_modulus_bytes, paillier_modulus_bytes);
+
+  if ((!bytes) || (!*bytes) || (!pub) || (needed_byte_len > *byte_len))
+  {
+    *byte_len = needed_byte_len;
+    return ;
+  }
+
+  uint8_t *set_bytes = *bytes;
+
+  scalar_to_bytes(&set_bytes, paillier_modulus_bytes, pub->N, 1);
+  scalar_to_bytes(&set_bytes, 2*paillier_modulus_bytes, pub->N2, 1);
+  paillier_short_exp_to_bytes(&set_bytes, pub->h, pub->h_N, pub->h_N_table, paillier_modulus_bytes);
+
+  assert(set_bytes == *bytes + needed_byte_len);
+  *byte_len = needed_byte_len;
+  if (move_to_end) *bytes = set_bytes;
+}
+
+void paillier_public_stored_from_bytes (paillier_public_key_t *pub, uint8_t **bytes, uint64_t *byte_len, uint64_t paillier_modulus_bytes, int move_to_end)
+{
+  uint64_t needed_byte_len = paillier_stored_byte_len((bytes ? *bytes : NULL), *byte_len, 1, 6*paillier_modulus_bytes, 3*paillier_modulus_bytes, paillier_modulus_bytes);
+
+  if ((!bytes) || (!*bytes) || (!pub) || (needed_byte_len > *byte_len))
+  {
+    *byte_len = needed_byte_len;
+    return ;
+  }
+
+  uint8_t *read_bytes = *bytes;
+
+  scalar_from_bytes(pub->N, &read_bytes, paillier_modulus_bytes, 1);
+  scalar_from_bytes(pub->N2, &read_bytes, 2*paillier_modulus_bytes, 1);
+  paillier_public_precompute(pub);
+  paillier_short_exp_from_bytes(pub->h, pub->h_N, &pub->h_N_table, &read_bytes, pub->N2, paillier_modulus_bytes);
+
+  assert(read_bytes == *bytes + needed_byte_len);
+  *byte_len = needed_byte_len;
+  if (move_to_end) *bytes = read_bytes;
+}
+
+void paillier_private_stored_to_bytes (uint8_t **bytes, uint64_t *byte_len, const paillier_private_key_t *priv, uint64_t paillier_modulus_bytes, int move_to_end)
+{
+  uint64_t needed_byte_len = paillier_stored_byte_len(NULL, 0, priv && !BN_is_zero(priv->h), 20*paillier_modulus_bytes, 17*paillier_modulus_bytes, paillier_modulus_bytes);
+
+  if ((!bytes) || (!*bytes) || (!priv) || (needed_byte_len > *byte_len))
+  {
+    *byte_len = needed_byte_len;
+    return ;
+  }
+
+  uint8_t *set_bytes = *bytes;
+
+  scalar_to_bytes(&set_bytes, paillier_modulus_bytes, priv->N, 1);
+  scalar_to_bytes(&set_bytes, 2*paillier_modulus_bytes, priv->N2, 1);
+  scalar_to_bytes(&set_bytes, paillier_modulus_bytes, priv->p, 1);
+  scalar_to_bytes(&set_bytes, paillier_modulus_bytes, priv->q, 1);
+  scalar_to_bytes(&set_bytes, paillier_modulus_bytes, priv->phi_N, 1);
+  scalar_to_bytes(&set_bytes, paillier_modulus_bytes, priv->mu, 1);
+  scalar_to_bytes(&set_bytes, paillier_modulus_bytes, priv->p2, 1);
+  scalar_to_bytes(&set_bytes, paillier_modulus_bytes, priv->q2, 1);
+  scalar_to_bytes(&set_bytes, paillier_modulus_bytes, priv->hp, 1);
+  scalar_to_bytes(&set_bytes, paillier_modulus_bytes, priv->hq, 1);
+  scalar_to_bytes(&set_bytes, paillier_modulus_bytes, priv->p_inv_q, 1);
+  scalar_to_bytes(&set_bytes, paillier_modulus_bytes, priv->phi_p2, 1);
+  scalar_to_bytes(&set_bytes, paillier_modulus_bytes, priv->phi_q2, 1);
+  scalar_to_bytes(&set_bytes, paillier_modulus_bytes, priv->N_mod_phi_p2, 1);
+  scalar_to_bytes(&set_bytes, paillier_modulus_bytes, priv->N_mod_phi_q2, 1);
+  scalar_to_bytes(&set_bytes, paillier_modulus_bytes, priv->p2_inv_q2, 1);
+  paillier_short_exp_to_bytes(&set_bytes, priv->h, priv->h_N, priv->h_N_table, paillier_modulus_bytes);
+
+  assert(set_bytes == *bytes + needed_byte_len);
+  *byte_len = needed_byte_len;
+  if (move_to_end) *bytes = set_bytes;
+}
+
+void paillier_private_stored_from_bytes (paillier_private_key_t *priv, uint8_t **bytes, uint64_t *byte_len, uint64_t paillier_modulus_bytes, int move_to_end)
+{
+  uint64_t needed_byte_len = paillier_stored_byte_len((bytes ? *bytes : NULL), *byte_len, 1, 20*paillier_modulus_bytes, 17*paillier_modulus_bytes, paillier_modulus_bytes);
+
+  if ((!bytes) || (!*bytes) || (!priv) || (needed_byte_len > *byte_len))
+  {
+    *byte_len = needed_byte_len;
+    return ;
+  }
+
+  uint8_t *read_bytes = *bytes;
+
+  paillier_private_detach_pool(priv);
+
+  scalar_from_bytes(priv->N, &read_bytes, paillier_modulus_bytes, 1);
+  scalar_from_bytes(priv->N2, &read_bytes, 2*paillier_modulus_bytes, 1);
+  scalar_from_bytes(priv->p, &read_bytes, paillier_modulus_bytes, 1);
+  scalar_from_bytes(priv->q, &read_bytes, paillier_modulus_bytes, 1);
+  scalar_from_bytes(priv->phi_N, &read_bytes, paillier_modulus_bytes, 1);
+  scalar_from_bytes(priv->mu, &read_bytes, paillier_modulus_bytes, 1);
+  scalar_from_bytes(priv->p2, &read_bytes, paillier_modulus_bytes, 1);
+  scalar_from_bytes(priv->q2, &read_bytes, paillier_modulus_bytes, 1);
+  scalar_from_bytes(priv->hp, &read_bytes, paillier_modulus_bytes, 1);
+  scalar_from_bytes(priv->hq, &read_bytes, paillier_modulus_bytes, 1);
+  scalar_from_bytes(priv->p_inv_q, &read_bytes, paillier_modulus_bytes, 1);
+  scalar_from_bytes(priv->phi_p2, &read_bytes, paillier_modulus_bytes, 1);
+  scalar_from_bytes(priv->phi_q2, &read_bytes, paillier_modulus_bytes, 1);
+  scalar_from_bytes(priv->N_mod_phi_p2, &read_bytes, paillier_modulus_bytes, 1);
+  scalar_from_bytes(priv->N_mod_phi_q2, &read_bytes, paillier_modulus_bytes, 1);
+  scalar_from_bytes(priv->p2_inv_q2, &read_bytes, paillier_modulus_bytes, 1);
+
+  mont_ctx_reset(priv->mont_N);
+  mont_ctx_reset(priv->mont_N2);
+  mont_ctx_reset(priv->mont_p2);
+  mont_ctx_reset(priv->mont_q2);
+
+  paillier_short_exp_clear(priv->h, priv->h_N, &priv->h_N_table);
+  paillier_short_exp_from_bytes(priv->h, priv->h_N, &priv->h_N_table, &read_bytes, priv->N2, paillier_modulus_bytes);
+
+  assert(read_bytes == *bytes + needed_byte_len);
+  *byte_len = needed_byte_len;
+  if (move_to_end) *bytes = read_bytes;
+}
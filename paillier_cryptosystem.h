@@ -10,6 +10,18 @@
  *  Generate private key of wanted (prime) bit size, public key can be extracted from it.
  *  Plaintext and ciphertexts are scalars in the relevant modulus rings (N, N^2).
  *  To encrypt, need to sample randomness frst to be used in encrpytion.
+ *  Keys hold Montgomery precomputation for N and N^2 (built on first use), which is reset whenever the key is set (generated, copied or read from bytes).
+ *  Public key also holds the recoding of N (exponent of the randomness in every encryption), recomputed whenever the key is set.
+ *  Private key also holds the CRT precomputation (p^2, q^2, hp, hq), so decryption exponentiates modulo p^2 and q^2 separately.
+ *  Encryption and homomorphic operation under one's own key can use it as well (<...>_private), with exponents reduced modulo p(p-1) and q(q-1).
+ *  A public key can have a randomness pool: worker threads keep a ring of precomputed (rho, rho^N mod N^2) pairs, refilled to full depth once it drops to the low watermark.
+ *  Then paillier_encryption_sample hands out pooled rho, and encryption with it (also <...>_private, when the private key was given at start) only multiplies by the stored rho^N.
+ *  The pool holds its own copy of the keys, and is stopped whenever the public key is set or freed.
+ *  Optional short exponent randomness mode (set up by the private key's owner): key has h = -y^2 mod N and h_N = h^N mod N^2 (with fixed-base table).
+ *  Randomness is then a short exponent x (instead of element rho of Z_N^*), and encryption computes rho^N as h_N^x, i.e. rho = h^x mod N.
+ *  Public key bytes carry h (zero when mode is off), h_N is recomputed by receiver so it is always an N-th power.
+ *  Proofs' randomness responses (z_2, w) become integers mask + e*x, see paillier_encryption_sample_mask and paillier_encryption_randomness_response.
+ *  Keys can also be stored with all their precomputation (<...>_stored_to_bytes, for keystore), and read back without any exponentiation or inversion.
  * 
  */
 
@@ -19,10 +31,27 @@
 #include "algebraic_elements.h"
 #include <assert.h>
 
+// Pool of precomputed encryption randomness (rho, rho^N mod N^2) of a key, filled by background threads
+typedef struct paillier_rand_pool_st *paillier_rand_pool_t;
+
+// Short exponent randomness mode: bits of sampled exponents, and of masks hiding exponent times challenge (up to 256 bits) in proofs, with statistical slack
+#define PAILLIER_SHORT_EXP_BITS       256
+#define PAILLIER_SHORT_EXP_MASK_BITS  1024
+
 typedef struct 
 {
   scalar_t N;
   scalar_t N2;
+
+  mont_ctx_t mont_N;
+  mont_ctx_t mont_N2;
+  fixed_exp_t exp_N;           // NULL until key is set
+  paillier_rand_pool_t rand_pool;   // NULL unless started (paillier_encryption_pool_start)
+
+  // Short exponent randomness mode, h is zero and h_N_table NULL when off
+  scalar_t h;
+  scalar_t h_N;                // h^N mod N^2
+  fixed_base_t h_N_table;
 } paillier_public_key_t;
 
 typedef struct 
@@ -36,6 +65,29 @@ typedef struct
   scalar_t q;
   scalar_t phi_N;              // exponent in decryption
   scalar_t mu;                 // multiplicative factor in decryption
+
+  // CRT decryption (mod p^2 and q^2), computed whenever the key is set
+  scalar_t p2;
+  scalar_t q2;
+  scalar_t hp;                 // L_p((1+N)^(p-1) mod p^2)^(-1) mod p
+  scalar_t hq;                 // L_q((1+N)^(q-1) mod q^2)^(-1) mod q
+  scalar_t p_inv_q;            // p^(-1) mod q
+  scalar_t phi_p2;             // p(p-1), order of multiplicative group mod p^2
+  scalar_t phi_q2;             // q(q-1)
+  scalar_t N_mod_phi_p2;       // exponent of randomness mod p^2 in encryption
+  scalar_t N_mod_phi_q2;
+  scalar_t p2_inv_q2;          // p^(-2) mod q^2
+
+  mont_ctx_t mont_N;
+  mont_ctx_t mont_N2;
+  mont_ctx_t mont_p2;
+  mont_ctx_t mont_q2;
+  paillier_rand_pool_t rand_pool;   // Pool of own public key (not owned), NULL unless started with this key
+
+  // Short exponent randomness mode (as in public key)
+  scalar_t h;
+  scalar_t h_N;
+  fixed_base_t h_N_table;
 } paillier_private_key_t;
 
 
@@ -43,19 +95,58 @@ paillier_private_key_t *
      paillier_encryption_private_new      ();
 paillier_public_key_t *
      paillier_encryption_public_new       ();
+// p,q Blum primes (3 mod 4) of same bit size
+void paillier_encryption_private_from_primes
+                                          (paillier_private_key_t *priv, const scalar_t p, const scalar_t q);
 void paillier_encryption_generate_private (paillier_private_key_t *priv, uint64_t prime_bits);
+// Same as paillier_encryption_generate_private, both primes searched concurrently by num_threads workers
+void paillier_encryption_generate_private_threaded
+                                          (paillier_private_key_t *priv, uint64_t prime_bits, uint64_t num_threads);
+// Sets short exponent randomness mode of the key (new h), after key is set and before public key is copied from it. Setting the key again turns the mode off.
+void paillier_encryption_short_exp_setup  (paillier_private_key_t *priv);
 // If pub==NULL and priv!=NULL, copy_pub from priv
 void paillier_encryption_copy_keys        (paillier_private_key_t *copy_priv, paillier_public_key_t *copy_pub, const paillier_private_key_t *priv, const paillier_public_key_t *pub);
 // Free keys, each can be NULL and ignored. Public inside private is freed with private, shouldn't be freeed seperately
 void paillier_encryption_free_keys        (paillier_private_key_t *priv, paillier_public_key_t *pub);
-// Sample randomness to be used in encryption
+// Start (restart) randomness pool of pub with num_workers threads. priv (optional) is the private key of pub, to fill the pool by CRT and use it in <...>_private.
+void paillier_encryption_pool_start       (paillier_public_key_t *pub, paillier_private_key_t *priv, uint64_t depth, uint64_t low_watermark, uint64_t num_workers);
+void paillier_encryption_pool_stop        (paillier_public_key_t *pub);
+// Number of ready pairs in pool (0 if not started)
+uint64_t
+     paillier_encryption_pool_available   (const paillier_public_key_t *pub);
+// Sample randomness to be used in encryption (from pool if started and not empty). Short exponent of PAILLIER_SHORT_EXP_BITS in short exponent mode.
 void paillier_encryption_sample           (scalar_t rho, const paillier_public_key_t *pub);
+// Sample mask of randomness rho in proofs, used for encryption as well. Short exponent mode: in [2^(MASK_BITS-1), 2^MASK_BITS), so responses stay positive (and below N).
+void paillier_encryption_sample_mask      (scalar_t mask, const paillier_public_key_t *pub);
+// Proof's response for randomness rho with mask and (signed) challenge e: mask * rho^e mod N, or mask + e * rho in short exponent mode
+void paillier_encryption_randomness_response (scalar_t response, const scalar_t mask, const scalar_t rho, const scalar_t e, const paillier_public_key_t *pub);
 void paillier_encryption_encrypt          (scalar_t ciphertext, const scalar_t plaintext, const scalar_t rho, const paillier_public_key_t *pub);
-// Doesn't check cipher text is coprime to paillier modulus
+// Encrypts plaintexts[i] with rhos[i] for i < count, all randomness exponentiations together by scalar_exp_batch. ciphertexts[i] can be plaintexts[i] or rhos[i].
+void paillier_encryption_encrypt_batch    (scalar_t *ciphertexts, const scalar_t *plaintexts, const scalar_t *rhos, uint64_t count, const paillier_public_key_t *pub);
+// Same as paillier_encryption_encrypt (and _batch) under own key, by CRT with the factorization
+void paillier_encryption_encrypt_private  (scalar_t ciphertext, const scalar_t plaintext, const scalar_t rho, const paillier_private_key_t *priv);
+void paillier_encryption_encrypt_private_batch (scalar_t *ciphertexts, const scalar_t *plaintexts, const scalar_t *rhos, uint64_t count, const paillier_private_key_t *priv);
+// Same as paillier_encryption_encrypt, for public plaintext and randomness only (verifiers)
+void paillier_encryption_encrypt_vartime  (scalar_t ciphertext, const scalar_t plaintext, const scalar_t rho, const paillier_public_key_t *pub);
+// Computes Enc(plaintext, rho) * product of bases[i]^exps[i] (mod N^2) for i < count, with a single multi-exponentiation (and h_N's table in short exponent mode). For public inputs only (verifiers).
+// Returns 0/1 for success/error (some base with negative exponent isn't coprime to N^2).
+int  paillier_encryption_encrypt_multi_exp_vartime (scalar_t result, const scalar_t plaintext, const scalar_t rho, const scalar_t *bases, const scalar_t *exps, uint64_t count, const paillier_public_key_t *pub);
+// Doesn't check cipher text is coprime to paillier modulus. Uses CRT (mod p^2 and q^2).
 void paillier_encryption_decrypt          (scalar_t plaintext, const scalar_t ciphertext, const paillier_private_key_t *priv);
+// Sum of plaintexts of ciphertexts[i] (mod N) for i < count, by a single decryption of their product
+void paillier_encryption_decrypt_sum      (scalar_t plaintext, const scalar_t *ciphertexts, uint64_t count, const paillier_private_key_t *priv);
 // Computed ciphertext*factor + add_cipher (with paillier homomorphic operations). factor==NULL used as 1. add_cipher==NULL, assume as 0.
 void paillier_encryption_homomorphic      (scalar_t new_cipher, const scalar_t ciphertext, const scalar_t factor, const scalar_t add_cipher, const paillier_public_key_t *pub);       
+// Same as paillier_encryption_homomorphic under own key, by CRT. Ciphertext must be coprime to N.
+void paillier_encryption_homomorphic_private (scalar_t new_cipher, const scalar_t ciphertext, const scalar_t factor, const scalar_t add_cipher, const paillier_private_key_t *priv);
+// Bytes are N || h (h zero when short exponent mode is off). h not coprime to N is read as mode off.
 void paillier_public_to_bytes             (uint8_t **bytes, uint64_t *byte_len, const paillier_public_key_t *pub, uint64_t paillier_modulus_bytes, int move_to_end);
 void paillier_public_from_bytes           (paillier_public_key_t *pub, uint8_t **bytes, uint64_t *byte_len, uint64_t paillier_modulus_bytes, int move_to_end);
+// Flat bytes with precomputation: N, N^2, h, h_N and h_N's table (only when h is non-zero). Montgomery contexts are rebuilt on first use.
+void paillier_public_stored_to_bytes      (uint8_t **bytes, uint64_t *byte_len, const paillier_public_key_t *pub, uint64_t paillier_modulus_bytes, int move_to_end);
+void paillier_public_stored_from_bytes    (paillier_public_key_t *pub, uint8_t **bytes, uint64_t *byte_len, uint64_t paillier_modulus_bytes, int move_to_end);
+// Same for private key: N, N^2, p, q, phi_N, mu, CRT precomputation, then short exponent mode as in public key
+void paillier_private_stored_to_bytes     (uint8_t **bytes, uint64_t *byte_len, const paillier_private_key_t *priv, uint64_t paillier_modulus_bytes, int move_to_end);
+void paillier_private_stored_from_bytes   (paillier_private_key_t *priv, uint8_t **bytes, uint64_t *byte_len, uint64_t paillier_modulus_bytes, int move_to_end);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,243 @@
+#include "prime_generation.h"
+
+#include <string.h>
+#include <pthread.h>
+
+typedef struct
+{
+  prime_gen_job_t *jobs;
+  uint64_t num_jobs;
+  uint64_t num_done;
+  int *done;                // Read without lock by generation callbacks
+  uint64_t *searchers;      // Number of workers currently searching for each job
+  const int *cancel;        // Optional, read without lock
+
+  pthread_mutex_t lock;
+} prime_gen_state_t;
+
+typedef struct
+{
+  const prime_gen_state_t *state;
+  uint64_t job;
+} prime_gen_search_t;
+
+static int prime_gen_cancelled (const prime_gen_state_t *state)
+{
+  return state->cancel && __atomic_load_n(state->cancel, __ATOMIC_ACQUIRE);
+}
+
+// Cancels search once the prime was found by another worker (or the whole generation is cancelled)
+static int prime_gen_callback (int a, int b, BN_GENCB *cb)
+{
+  (void) a; (void) b;
+  const prime_gen_search_t *search = BN_GENCB_get_arg(cb);
+  return !__atomic_load_n(&search->state->done[search->job], __ATOMIC_ACQUIRE) && !prime_gen_cancelled(search->state);
+}
+
+/**
+ *  Safe Prime Sieve
+ */
+
+// Candidates q (of p = 2q+1) in a window, starting from random q0: q = q0 + 2k for k < SIEVE_WINDOW
+#define SIEVE_WINDOW (1 << 16)
+// Small primes up to this are sieved (from 3)
+#define SIEVE_SMALL_PRIMES_BOUND (1 << 16)
+
+static uint32_t *sieve_small_primes;
+static uint64_t sieve_num_small_primes;
+static pthread_once_t sieve_small_primes_once = PTHREAD_ONCE_INIT;
+
+static void sieve_small_primes_init ()
+{
+  uint8_t *composite = calloc(SIEVE_SMALL_PRIMES_BOUND, 1);
+  sieve_small_primes = malloc(SIEVE_SMALL_PRIMES_BOUND / 2 * sizeof(uint32_t));
+  sieve_num_small_primes = 0;
+
+  for (uint64_t r = 3; r < SIEVE_SMALL_PRIMES_BOUND; r += 2)
+  {
+    if (composite[r]) continue;
+    sieve_small_primes[sieve_num_small_primes++] = r;
+    for (uint64_t m = r * r; m < SIEVE_SMALL_PRIMES_BOUND; m += 2 * r) composite[m] = 1;
+  }
+
+  free(composite);
+}
+
+// Sets prime (of bits size, top two bits set) to p = 2q+1 with q prime. Returns 0 if cancelled by cb.
+// Candidates with q or 2q+1 divisible by a small prime are removed together by one sieve over the window.
+// Survivors pass base 2 Fermat tests on q and p, then Miller-Rabin on q (BN_check_prime). Then p is prime by Pocklington: p-1 = 2q, q prime > sqrt(p), 2^(p-1) = 1 mod p and gcd(2^2-1, p) = 1 (sieved by 3).
+static int prime_generate_safe_sieved (scalar_t prime, uint64_t bits, BN_GENCB *cb)
+{
+  pthread_once(&sieve_small_primes_once, sieve_small_primes_init);
+
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
+  scalar_t q0 = BN_CTX_get(bn_ctx);
+  scalar_t q  = BN_CTX_get(bn_ctx);
+  scalar_t p  = BN_CTX_get(bn_ctx);
+  scalar_t exp = BN_CTX_get(bn_ctx);
+  scalar_t result = BN_CTX_get(bn_ctx);
+  scalar_t two = BN_CTX_get(bn_ctx);
+  BN_set_word(two, 2);
+
+  uint8_t *removed = malloc(SIEVE_WINDOW);
+  uint64_t num_tested = 0;
+  int found = 0;
+  int cancelled = 0;
+
+  while (!found && !cancelled)
+  {
+    BN_priv_rand(q0, bits - 1, BN_RAND_TOP_TWO, BN_RAND_BOTTOM_ODD);
+    memset(removed, 0, SIEVE_WINDOW);
+
+    for (uint64_t i = 0; i < sieve_num_small_primes; ++i)
+    {
+      uint64_t r = sieve_small_primes[i];
+      uint64_t q0_mod_r = BN_mod_word(q0, r);
+      uint64_t inv_2 = (r + 1) / 2;
+
+      // k such that q0 + 2k = 0 (q divisible) or = (r-1)/2 (2q+1 divisible) mod r
+      uint64_t bad_residues[2] = {0, (r - 1) / 2};
+      for (int b = 0; b < 2; ++b)
+      {
+        uint64_t k = ((bad_residues[b] + r - q0_mod_r) % r) * inv_2 % r;
+        for (; k < SIEVE_WINDOW; k += r) removed[k] = 1;
+      }
+    }
+
+    for (uint64_t k = 0; (k < SIEVE_WINDOW) && !found; ++k)
+    {
+      if (removed[k]) continue;
+
+      if (BN_GENCB_call(cb, 0, num_tested++) == 0)
+      {
+        cancelled = 1;
+        break;
+      }
+
+      BN_copy(q, q0);
+      BN_add_word(q, 2 * k);
+      if ((uint64_t) BN_num_bits(q) != bits - 1) break;
+
+      // Fermat base 2 on q
+      BN_sub(exp, q, BN_value_one());
+      BN_mod_exp_mont(result, two, exp, q, bn_ctx, NULL);
+      if (!BN_is_one(result)) continue;
+
+      // Fermat base 2 on p = 2q+1 (also Pocklington's condition)
+      BN_lshift1(p, q);
+      BN_add_word(p, 1);
+      BN_lshift1(exp, q);
+      BN_mod_exp_mont(result, two, exp, p, bn_ctx, NULL);
+      if (!BN_is_one(result)) continue;
+
+      int q_prime = BN_check_prime(q, bn_ctx, cb);
+      if (q_prime < 0)
+      {
+        cancelled = 1;
+        break;
+      }
+      if (q_prime == 1)
+      {
+        BN_copy(prime, p);
+        found = 1;
+      }
+    }
+  }
+
+  free(removed);
+  bn_ctx_release(bn_ctx);
+
+  return found;
+}
+
+static void *prime_gen_worker (void *arg)
+{
+  prime_gen_state_t *state = arg;
+
+  BN_GENCB *cb = BN_GENCB_new();
+  prime_gen_search_t search = { .state = state };
+  scalar_t candidate = scalar_new();
+  scalar_t three     = scalar_new();
+  scalar_t four      = scalar_new();
+
+  scalar_set_ul(three, 3);
+  scalar_set_ul(four, 4);
+
+  pthread_mutex_lock(&state->lock);
+  while ((state->num_done < state->num_jobs) && !prime_gen_cancelled(state))
+  {
+    // Unfinished job with least searchers
+    uint64_t job = state->num_jobs;
+    for (uint64_t j = 0; j < state->num_jobs; ++j)
+    {
+      if (state->done[j]) continue;
+      if ((job == state->num_jobs) || (state->searchers[j] < state->searchers[job])) job = j;
+    }
+    state->searchers[job]++;
+    pthread_mutex_unlock(&state->lock);
+
+    // Every search starts from its own random candidate
+    search.job = job;
+    BN_GENCB_set(cb, prime_gen_callback, &search);
+    int found;
+    if (state->jobs[job].kind == PRIME_KIND_SAFE) found = prime_generate_safe_sieved(candidate, state->jobs[job].bits, cb);
+    else found = BN_generate_prime_ex(candidate, state->jobs[job].bits, 0, four, three, cb);
+
+    pthread_mutex_lock(&state->lock);
+    state->searchers[job]--;
+    if (found && !state->done[job])
+    {
+      BN_copy(state->jobs[job].prime, candidate);
+      __atomic_store_n(&state->done[job], 1, __ATOMIC_RELEASE);
+      state->num_done++;
+    }
+  }
+  pthread_mutex_unlock(&state->lock);
+
+  scalar_free(candidate);
+  scalar_free(three);
+  scalar_free(four);
+  BN_GENCB_free(cb);
+
+  return NULL;
+}
+
+int prime_generate_batch_until (prime_gen_job_t *jobs, uint64_t num_jobs, uint64_t num_threads, const int *cancel)
+{
+  if (num_threads == 0) num_threads = 1;
+
+  prime_gen_state_t state;
+  state.jobs = jobs;
+  state.num_jobs = num_jobs;
+  state.num_done = 0;
+  state.cancel = cancel;
+  state.done = calloc(num_jobs, sizeof(int));
+  state.searchers = calloc(num_jobs, sizeof(uint64_t));
+  pthread_mutex_init(&state.lock, NULL);
+
+  // Calling thread is one of the workers
+  pthread_t *workers = calloc(num_threads, sizeof(pthread_t));
+  for (uint64_t i = 1; i < num_threads; ++i) pthread_create(&workers[i], NULL, prime_gen_worker, &state);
+  prime_gen_worker(&state);
+  for (uint64_t i = 1; i < num_threads; ++i) pthread_join(workers[i], NULL);
+
+  int all_done = state.num_done == num_jobs;
+
+  pthread_mutex_destroy(&state.lock);
+  free(workers);
+  free(state.done);
+  free(state.searchers);
+
+  return all_done;
+}
+
+void prime_generate_batch (prime_gen_job_t *jobs, uint64_t num_jobs, uint64_t num_threads)
+{
+  prime_generate_batch_until(jobs, num_jobs, num_threads, NULL);
+}
+
+void prime_generate (scalar_t prime, uint64_t bits, prime_kind_t kind, uint64_t num_threads)
+{
+  prime_gen_job_t job = { .prime = prime, .bits = bits, .kind = kind };
+  prime_generate_batch(&job, 1, num_threads);
+}
@@ -0,0 +1,45 @@
+/**
+ *
+ *  Name:
+ *  prime_generation
+ *
+ *  Description:
+ *  Generation of the primes used by paillier and ring pedersen keys, several primes concurrently on a pool of worker threads.
+ *  Each prime is searched by several workers at once, every one from its own random candidate range.
+ *  Blum primes are searched by openssl's BN_generate_prime_ex. Safe primes p = 2q+1 by a dedicated search: one small-prime sieve removes candidates with q or 2q+1 divisible
+ *  over a large window, survivors are tested by Fermat (base 2) on q and p, then Miller-Rabin on q only, as p then follows by Pocklington's criterion.
+ *  Once a worker finds a prime, the other workers searching for the same prime are cancelled (by generation callback), and move to help with an unfinished prime.
+ *
+ *  Usage:
+ *  Set a job (bits and kind) for every wanted prime and call prime_generate_batch, results are set in order of jobs.
+ *  Used by the threaded variants of paillier_encryption_generate_private and ring_pedersen_generate_private.
+ *
+ */
+
+#ifndef __CMP20_ECDSA_MPC_PRIME_GENERATION_H__
+#define __CMP20_ECDSA_MPC_PRIME_GENERATION_H__
+
+#include <stdint.h>
+#include "algebraic_elements.h"
+
+typedef enum
+{
+  PRIME_KIND_BLUM,      // p = 3 mod 4 (paillier)
+  PRIME_KIND_SAFE,      // p = 2q+1 for prime q (ring pedersen)
+} prime_kind_t;
+
+typedef struct
+{
+  scalar_t     prime;   // Result
+  uint64_t     bits;
+  prime_kind_t kind;
+} prime_gen_job_t;
+
+// Generates primes of all jobs with num_threads workers (at least one). Workers are split evenly between unfinished primes.
+void prime_generate_batch       (prime_gen_job_t *jobs, uint64_t num_jobs, uint64_t num_threads);
+// Same as prime_generate_batch, stops early once *cancel is set (by another thread). Returns 1 if all primes were generated.
+int  prime_generate_batch_until (prime_gen_job_t *jobs, uint64_t num_jobs, uint64_t num_threads, const int *cancel);
+// Single prime with num_threads workers
+void prime_generate             (scalar_t prime, uint64_t bits, prime_kind_t kind, uint64_t num_threads);
+
+#endif
@@ -0,0 +1,562 @@
+#include "prime_pool.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+#define POOL_MAGIC "CMPPRIME"
+#define POOL_VERSION 1
+#define HEADER_BYTES 16
+#define NONCE_BYTES 12
+#define TAG_BYTES 16
+// File header (magic, version) followed by nonce and tag of empty plaintext (key check)
+#define FILE_HEADER_BYTES (HEADER_BYTES + NONCE_BYTES + TAG_BYTES)
+
+#define RECORD_PRIME 1
+// Marks prime as popped, plaintext is the nonce of the prime's record (so copies of a record are also used)
+#define RECORD_USED  2
+
+// Generator rechecks targets at least this often (primes can be popped by other processes)
+#define GENERATOR_RECHECK_SEC 1
+
+struct prime_pool_st
+{
+  int fd;
+  uint8_t *key;
+  prime_pool_metrics_t metrics;
+  pthread_mutex_t lock;           // File operations (between threads, flock is between processes) and metrics
+
+  // Background generator
+  pthread_t generator;
+  int generator_running;
+  int generator_stop;             // Read without lock by generation callbacks
+  int generator_idle;             // All targets available
+  prime_pool_target_t *targets;
+  uint64_t num_targets;
+  uint64_t num_threads;
+  pthread_mutex_t generator_lock;
+  pthread_cond_t  generator_cond;
+};
+
+// Parsed record, pointers into file data
+typedef struct
+{
+  uint8_t  type;
+  uint8_t  kind;
+  uint32_t bits;
+  const uint8_t *header;
+  const uint8_t *nonce;
+  const uint8_t *ciphertext;
+  uint32_t ciphertext_len;
+  const uint8_t *tag;
+} pool_record_t;
+
+static void put_le (uint8_t *bytes, uint64_t val, uint64_t num_bytes)
+{
+  for (uint64_t i = 0; i < num_bytes; ++i) bytes[i] = (uint8_t) (val >> (8*i));
+}
+
+static uint64_t get_le (const uint8_t *bytes, uint64_t num_bytes)
+{
+  uint64_t val = 0;
+  for (uint64_t i = 0; i < num_bytes; ++i) val |= ((uint64_t) bytes[i]) << (8*i);
+  return val;
+}
+
+static uint64_t elapsed_ms (const struct timespec *start)
+{
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) * 1000 + (end.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+// Sets nonce (random), ciphertext and tag, header is authenticated as additional data
+static void pool_seal (const prime_pool_t *pool, uint8_t *nonce, uint8_t *ciphertext, uint8_t *tag, const uint8_t *header, const uint8_t *plaintext, uint64_t plaintext_len)
+{
+  int len;
+  uint8_t final_block[16];
+  RAND_bytes(nonce, NONCE_BYTES);
+
+  EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+  EVP_EncryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, pool->key, nonce);
+  EVP_EncryptUpdate(ctx, NULL, &len, header, HEADER_BYTES);
+  if (plaintext_len > 0) EVP_EncryptUpdate(ctx, ciphertext, &len, plaintext, plaintext_len);
+  EVP_EncryptFinal_ex(ctx, final_block, &len);
+  EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, TAG_BYTES, tag);
+  EVP_CIPHER_CTX_free(ctx);
+}
+
+// Returns 1 and sets plaintext (can be NULL for empty) if authentic
+static int pool_open_sealed (const prime_pool_t *pool, uint8_t *plaintext, const uint8_t *header, const uint8_t *nonce, const uint8_t *ciphertext, uint64_t ciphertext_len, const uint8_t *tag)
+{
+  int len;
+  uint8_t final_block[16];
+  uint8_t tag_copy[TAG_BYTES];
+  memcpy(tag_copy, tag, TAG_BYTES);
+
+  EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+  EVP_DecryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, pool->key, nonce);
+  EVP_DecryptUpdate(ctx, NULL, &len, header, HEADER_BYTES);
+  if (ciphertext_len > 0) EVP_DecryptUpdate(ctx, plaintext, &len, ciphertext, ciphertext_len);
+  EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, TAG_BYTES, tag_copy);
+  int authentic = EVP_DecryptFinal_ex(ctx, final_block, &len) > 0;
+  EVP_CIPHER_CTX_free(ctx);
+
+  return authentic;
+}
+
+static void pool_record_header (uint8_t *header, uint8_t type, prime_kind_t kind, uint64_t bits, uint64_t ciphertext_len)
+{
+  memset(header, 0, HEADER_BYTES);
+  header[0] = type;
+  header[1] = (uint8_t) kind;
+  put_le(header + 4, bits, 4);
+  put_le(header + 8, ciphertext_len, 4);
+}
+
+// Parses record at *offset and advances it. Returns 0 at end of data (or truncated last record, from interrupted append).
+static int pool_next_record (pool_record_t *rec, const uint8_t *data, uint64_t data_len, uint64_t *offset)
+{
+  if (*offset + HEADER_BYTES > data_len) return 0;
+
+  const uint8_t *header = data + *offset;
+  uint64_t ciphertext_len = get_le(header + 8, 4);
+  uint64_t record_len = HEADER_BYTES + NONCE_BYTES + ciphertext_len + TAG_BYTES;
+  if (*offset + record_len > data_len) return 0;
+
+  rec->header = header;
+  rec->type = header[0];
+  rec->kind = header[1];
+  rec->bits = get_le(header + 4, 4);
+  rec->nonce = header + HEADER_BYTES;
+  rec->ciphertext = rec->nonce + NONCE_BYTES;
+  rec->ciphertext_len = ciphertext_len;
+  rec->tag = rec->ciphertext + ciphertext_len;
+
+  *offset += record_len;
+  return 1;
+}
+
+// Whole file (including file header), must be freed by caller
+static uint8_t *pool_read_file (const prime_pool_t *pool, uint64_t *data_len)
+{
+  struct stat st;
+  fstat(pool->fd, &st);
+
+  uint8_t *data = malloc(st.st_size + 1);
+  uint64_t read_len = 0;
+  while (read_len < (uint64_t) st.st_size)
+  {
+    ssize_t curr = pread(pool->fd, data + read_len, st.st_size - read_len, read_len);
+    if (curr <= 0) break;
+    read_len += curr;
+  }
+
+  *data_len = read_len;
+  return data;
+}
+
+// Returns 0 if record was appended and fsynced, 1 otherwise (a partially written record is truncated). File lock must be held exclusively.
+static int pool_write_record (const prime_pool_t *pool, uint8_t type, prime_kind_t kind, uint64_t bits, const uint8_t *plaintext, uint64_t plaintext_len)
+{
+  uint64_t record_len = HEADER_BYTES + NONCE_BYTES + plaintext_len + TAG_BYTES;
+  uint8_t *record = malloc(record_len);
+
+  pool_record_header(record, type, kind, bits, plaintext_len);
+  pool_seal(pool, record + HEADER_BYTES, record + HEADER_BYTES + NONCE_BYTES, record + HEADER_BYTES + NONCE_BYTES + plaintext_len, record, plaintext, plaintext_len);
+
+  // Size before the append to roll back to (nothing is written without it)
+  struct stat st;
+  int has_size = (fstat(pool->fd, &st) == 0);
+  int failed = !has_size;
+
+  // Single append write, file is opened with O_APPEND
+  if (!failed) failed = write(pool->fd, record, record_len) != (ssize_t) record_len;
+  if (!failed) failed = fsync(pool->fd) != 0;
+
+  if (failed)
+  {
+    fprintf(stderr, "prime_pool: failed appending record\n");
+    if (has_size && (ftruncate(pool->fd, st.st_size) != 0)) fprintf(stderr, "prime_pool: failed truncating partial record\n");
+  }
+
+  free(record);
+  return failed;
+}
+
+// Nonces of all (authentic) used records, must be freed by caller
+static uint8_t *pool_used_nonces (const prime_pool_t *pool, const uint8_t *data, uint64_t data_len, uint64_t *num_used)
+{
+  pool_record_t rec;
+  uint64_t offset = FILE_HEADER_BYTES;
+  uint64_t max_used = 0;
+  while (pool_next_record(&rec, data, data_len, &offset)) max_used += (rec.type == RECORD_USED);
+
+  uint8_t *used = malloc(max_used * NONCE_BYTES + 1);
+  *num_used = 0;
+
+  offset = FILE_HEADER_BYTES;
+  while (pool_next_record(&rec, data, data_len, &offset))
+  {
+    if ((rec.type != RECORD_USED) || (rec.ciphertext_len != NONCE_BYTES)) continue;
+
+    if (pool_open_sealed(pool, used + *num_used * NONCE_BYTES, rec.header, rec.nonce, rec.ciphertext, rec.ciphertext_len, rec.tag)) (*num_used)++;
+  }
+
+  return used;
+}
+
+// Returns 1 if record is of known type and authentic
+static int pool_record_valid (const prime_pool_t *pool, const pool_record_t *rec)
+{
+  if ((rec->type != RECORD_PRIME) && (rec->type != RECORD_USED)) return 0;
+  if ((rec->type == RECORD_USED) && (rec->ciphertext_len != NONCE_BYTES)) return 0;
+
+  uint8_t *plaintext = malloc(rec->ciphertext_len + 1);
+  int authentic = pool_open_sealed(pool, plaintext, rec->header, rec->nonce, rec->ciphertext, rec->ciphertext_len, rec->tag);
+  OPENSSL_cleanse(plaintext, rec->ciphertext_len);
+  free(plaintext);
+
+  return authentic;
+}
+
+static int pool_nonce_used (const uint8_t *used, uint64_t num_used, const uint8_t *nonce)
+{
+  for (uint64_t i = 0; i < num_used; ++i) if (memcmp(used + i * NONCE_BYTES, nonce, NONCE_BYTES) == 0) return 1;
+  return 0;
+}
+
+static int pool_record_matches (const pool_record_t *rec, uint64_t bits, prime_kind_t kind, int any_kind)
+{
+  if (rec->type != RECORD_PRIME) return 0;
+  if (any_kind) return 1;
+  return (rec->bits == bits) && (rec->kind == (uint8_t) kind) && (rec->ciphertext_len == (bits + 7) / 8);
+}
+
+// Unused prime records (only headers are checked, authenticated when popped). Pool lock must be held.
+static uint64_t pool_count_available (prime_pool_t *pool, uint64_t bits, prime_kind_t kind, int any_kind)
+{
+  flock(pool->fd, LOCK_SH);
+
+  uint64_t data_len;
+  uint8_t *data = pool_read_file(pool, &data_len);
+  uint64_t num_used;
+  uint8_t *used = pool_used_nonces(pool, data, data_len, &num_used);
+
+  uint64_t available = 0;
+  pool_record_t rec;
+  uint64_t offset = FILE_HEADER_BYTES;
+  while (pool_next_record(&rec, data, data_len, &offset))
+  {
+    if (pool_record_matches(&rec, bits, kind, any_kind) && !pool_nonce_used(used, num_used, rec.nonce)) available++;
+  }
+
+  flock(pool->fd, LOCK_UN);
+
+  free(used);
+  free(data);
+
+  return available;
+}
+
+prime_pool_t *prime_pool_open (const char *path, const uint8_t key[PRIME_POOL_KEY_BYTES])
+{
+  int fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0600);
+  if (fd < 0) return NULL;
+
+  prime_pool_t *pool = calloc(1, sizeof(prime_pool_t));
+  pool->fd = fd;
+  pool->key = OPENSSL_secure_malloc(PRIME_POOL_KEY_BYTES);
+  memcpy(pool->key, key, PRIME_POOL_KEY_BYTES);
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_mutex_init(&pool->generator_lock, NULL);
+  pthread_cond_init(&pool->generator_cond, NULL);
+
+  uint8_t file_header[FILE_HEADER_BYTES];
+  memset(file_header, 0, HEADER_BYTES);
+  memcpy(file_header, POOL_MAGIC, 8);
+  put_le(file_header + 8, POOL_VERSION, 4);
+
+  flock(fd, LOCK_EX);
+
+  struct stat st;
+  fstat(fd, &st);
+  int valid;
+  if (st.st_size == 0)
+  {
+    pool_seal(pool, file_header + HEADER_BYTES, NULL, file_header + HEADER_BYTES + NONCE_BYTES, file_header, NULL, 0);
+    valid = (write(fd, file_header, FILE_HEADER_BYTES) == FILE_HEADER_BYTES) && (fsync(fd) == 0);
+  }
+  else
+  {
+    uint8_t read_header[FILE_HEADER_BYTES];
+    valid = (pread(fd, read_header, FILE_HEADER_BYTES, 0) == FILE_HEADER_BYTES)
+         && (memcmp(read_header, file_header, HEADER_BYTES) == 0)
+         && pool_open_sealed(pool, NULL, read_header, read_header + HEADER_BYTES, NULL, 0, read_header + HEADER_BYTES + NONCE_BYTES);
+
+    // All complete records must be valid (any other corruption fails the open). Only a torn tail (shorter than a header or than its declared record, from interrupted append)
+    // is removed, otherwise records appended after it would be misparsed.
+    if (valid)
+    {
+      uint64_t data_len;
+      uint8_t *data = pool_read_file(pool, &data_len);
+
+      pool_record_t rec;
+      uint64_t offset = FILE_HEADER_BYTES;
+      while (valid && pool_next_record(&rec, data, data_len, &offset)) valid = pool_record_valid(pool, &rec);
+      if (!valid) fprintf(stderr, "prime_pool: corrupted record\n");
+      else if (offset < data_len) valid = (ftruncate(fd, offset) == 0) && (fsync(fd) == 0);
+
+      free(data);
+    }
+  }
+
+  flock(fd, LOCK_UN);
+
+  if (!valid)
+  {
+    prime_pool_close(pool);
+    return NULL;
+  }
+
+  return pool;
+}
+
+void prime_pool_close (prime_pool_t *pool)
+{
+  if (!pool) return;
+
+  prime_pool_generator_stop(pool);
+
+  close(pool->fd);
+  OPENSSL_secure_clear_free(pool->key, PRIME_POOL_KEY_BYTES);
+  pthread_mutex_destroy(&pool->lock);
+  pthread_mutex_destroy(&pool->generator_lock);
+  pthread_cond_destroy(&pool->generator_cond);
+  free(pool);
+}
+
+int prime_pool_append (prime_pool_t *pool, const scalar_t prime, uint64_t bits, prime_kind_t kind)
+{
+  uint64_t prime_bytes = (bits + 7) / 8;
+  uint8_t *plaintext = OPENSSL_secure_malloc(prime_bytes);
+  BN_bn2binpad(prime, plaintext, prime_bytes);
+
+  pthread_mutex_lock(&pool->lock);
+  flock(pool->fd, LOCK_EX);
+
+  int failed = pool_write_record(pool, RECORD_PRIME, kind, bits, plaintext, prime_bytes);
+  if (!failed) pool->metrics.appended++;
+
+  flock(pool->fd, LOCK_UN);
+  pthread_mutex_unlock(&pool->lock);
+
+  OPENSSL_secure_clear_free(plaintext, prime_bytes);
+
+  return failed;
+}
+
+int prime_pool_pop (prime_pool_t *pool, scalar_t prime, uint64_t bits, prime_kind_t kind)
+{
+  uint64_t prime_bytes = (bits + 7) / 8;
+  uint8_t *plaintext = OPENSSL_secure_malloc(prime_bytes);
+  int found = 0;
+
+  pthread_mutex_lock(&pool->lock);
+  flock(pool->fd, LOCK_EX);
+
+  uint64_t data_len;
+  uint8_t *data = pool_read_file(pool, &data_len);
+  uint64_t num_used;
+  uint8_t *used = pool_used_nonces(pool, data, data_len, &num_used);
+
+  pool_record_t rec;
+  uint64_t offset = FILE_HEADER_BYTES;
+  while (!found && pool_next_record(&rec, data, data_len, &offset))
+  {
+    if (!pool_record_matches(&rec, bits, kind, 0) || pool_nonce_used(used, num_used, rec.nonce)) continue;
+
+    if (!pool_open_sealed(pool, plaintext, rec.header, rec.nonce, rec.ciphertext, rec.ciphertext_len, rec.tag))
+    {
+      pool->metrics.rejected++;
+      continue;
+    }
+
+    // Returned only if marked used (durably), otherwise it could be handed out again. Failed write is a miss.
+    if (pool_write_record(pool, RECORD_USED, kind, bits, rec.nonce, NONCE_BYTES) != 0) break;
+    BN_bin2bn(plaintext, prime_bytes, prime);
+    found = 1;
+  }
+
+  if (found) pool->metrics.popped++;
+  else pool->metrics.pop_misses++;
+
+  flock(pool->fd, LOCK_UN);
+  pthread_mutex_unlock(&pool->lock);
+
+  free(used);
+  free(data);
+  OPENSSL_secure_clear_free(plaintext, prime_bytes);
+
+  return found;
+}
+
+void prime_pool_pop_or_generate (prime_pool_t *pool, prime_gen_job_t *jobs, uint64_t num_jobs, uint64_t num_threads)
+{
+  prime_gen_job_t *missing = calloc(num_jobs, sizeof(prime_gen_job_t));
+  uint64_t num_missing = 0;
+
+  for (uint64_t i = 0; i < num_jobs; ++i)
+  {
+    if (pool && prime_pool_pop(pool, jobs[i].prime, jobs[i].bits, jobs[i].kind)) continue;
+    missing[num_missing++] = jobs[i];
+  }
+
+  if (num_missing > 0)
+  {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    prime_generate_batch(missing, num_missing, num_threads);
+
+    if (pool)
+    {
+      pthread_mutex_lock(&pool->lock);
+      pool->metrics.generated += num_missing;
+      pool->metrics.generation_ms += elapsed_ms(&start);
+      pthread_mutex_unlock(&pool->lock);
+    }
+  }
+
+  free(missing);
+}
+
+uint64_t prime_pool_available (prime_pool_t *pool, uint64_t bits, prime_kind_t kind)
+{
+  pthread_mutex_lock(&pool->lock);
+  uint64_t available = pool_count_available(pool, bits, kind, 0);
+  pthread_mutex_unlock(&pool->lock);
+
+  return available;
+}
+
+void prime_pool_get_metrics (prime_pool_t *pool, prime_pool_metrics_t *metrics)
+{
+  pthread_mutex_lock(&pool->lock);
+  pool->metrics.available = pool_count_available(pool, 0, 0, 1);
+  *metrics = pool->metrics;
+  pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ *  Background Generator
+ */
+
+static void *prime_pool_generator (void *arg)
+{
+  prime_pool_t *pool = arg;
+
+  // Each round generates up to num_threads missing primes, so they are appended without waiting for all targets
+  prime_gen_job_t *jobs = calloc(pool->num_threads, sizeof(prime_gen_job_t));
+  for (uint64_t i = 0; i < pool->num_threads; ++i) jobs[i].prime = scalar_new();
+
+  pthread_mutex_lock(&pool->generator_lock);
+  while (!pool->generator_stop)
+  {
+    pthread_mutex_unlock(&pool->generator_lock);
+
+    uint64_t num_jobs = 0;
+    for (uint64_t t = 0; t < pool->num_targets; ++t)
+    {
+      uint64_t available = prime_pool_available(pool, pool->targets[t].bits, pool->targets[t].kind);
+      for (uint64_t c = available; (c < pool->targets[t].count) && (num_jobs < pool->num_threads); ++c)
+      {
+        jobs[num_jobs].bits = pool->targets[t].bits;
+        jobs[num_jobs].kind = pool->targets[t].kind;
+        num_jobs++;
+      }
+    }
+
+    if (num_jobs > 0)
+    {
+      struct timespec start;
+      clock_gettime(CLOCK_MONOTONIC, &start);
+
+      int generated = prime_generate_batch_until(jobs, num_jobs, pool->num_threads, &pool->generator_stop);
+      if (generated) for (uint64_t i = 0; i < num_jobs; ++i) prime_pool_append(pool, jobs[i].prime, jobs[i].bits, jobs[i].kind);
+
+      pthread_mutex_lock(&pool->lock);
+      if (generated) pool->metrics.generated += num_jobs;
+      pool->metrics.generation_ms += elapsed_ms(&start);
+      pthread_mutex_unlock(&pool->lock);
+    }
+
+    pthread_mutex_lock(&pool->generator_lock);
+    pool->generator_idle = (num_jobs == 0);
+    if (pool->generator_idle)
+    {
+      pthread_cond_broadcast(&pool->generator_cond);
+
+      struct timespec until;
+      clock_gettime(CLOCK_REALTIME, &until);
+      until.tv_sec += GENERATOR_RECHECK_SEC;
+      if (!pool->generator_stop) pthread_cond_timedwait(&pool->generator_cond, &pool->generator_lock, &until);
+    }
+  }
+  pthread_mutex_unlock(&pool->generator_lock);
+
+  for (uint64_t i = 0; i < pool->num_threads; ++i) scalar_free(jobs[i].prime);
+  free(jobs);
+
+  return NULL;
+}
+
+void prime_pool_generator_start (prime_pool_t *pool, const prime_pool_target_t *targets, uint64_t num_targets, uint64_t num_threads)
+{
+  prime_pool_generator_stop(pool);
+
+  pool->targets = calloc(num_targets, sizeof(prime_pool_target_t));
+  memcpy(pool->targets, targets, num_targets * sizeof(prime_pool_target_t));
+  pool->num_targets = num_targets;
+  pool->num_threads = num_threads > 0 ? num_threads : 1;
+  pool->generator_stop = 0;
+  pool->generator_idle = 0;
+  pool->generator_running = 1;
+
+  pthread_create(&pool->generator, NULL, prime_pool_generator, pool);
+}
+
+void prime_pool_generator_wait (prime_pool_t *pool)
+{
+  pthread_mutex_lock(&pool->generator_lock);
+  while (pool->generator_running && !pool->generator_idle) pthread_cond_wait(&pool->generator_cond, &pool->generator_lock);
+  pthread_mutex_unlock(&pool->generator_lock);
+}
+
+void prime_pool_generator_stop (prime_pool_t *pool)
+{
+  if (!pool->generator_running) return;
+
+  pthread_mutex_lock(&pool->generator_lock);
+  __atomic_store_n(&pool->generator_stop, 1, __ATOMIC_RELEASE);
+  pthread_cond_broadcast(&pool->generator_cond);
+  pthread_mutex_unlock(&pool->generator_lock);
+
+  pthread_join(pool->generator, NULL);
+
+  pthread_mutex_lock(&pool->generator_lock);
+  pool->generator_running = 0;
+  pthread_cond_broadcast(&pool->generator_cond);
+  pthread_mutex_unlock(&pool->generator_lock);
+
+  free(pool->targets);
+  pool->targets = NULL;
+  pool->num_targets = 0;
+}
@@ -0,0 +1,73 @@
+/**
+ *
+ *  Name:
+ *  prime_pool
+ *
+ *  Description:
+ *  Persistent pool of pregenerated primes (Blum for paillier, safe for ring pedersen), kept in an encrypted append-only local file.
+ *  Every prime is a record encrypted by AES-256-GCM (random nonce per record), its header (kind and bit size) is authenticated as additional data.
+ *  Popping a prime appends an (authenticated) used record referencing it, so records are never modified and a popped prime is never handed out again.
+ *  Records failing authentication (wrong key or corrupted) are skipped, a truncated last record (interrupted append) is removed when the pool is opened. The file is locked (flock) during each operation, so several processes can share a pool.
+ *  Popped primes remain (encrypted) in the file, which only grows. It should be deleted when no longer needed.
+ *
+ *  Usage:
+ *  Open pool with path and key (file is created if missing, opening fails if key doesn't match the file's key check).
+ *  Fill it either by prime_pool_append, or by a background generator keeping wanted targets of available primes.
+ *  Take primes by prime_pool_pop, or prime_pool_pop_or_generate which generates missing primes (refresh round 1 of cmp uses it when a party has a pool).
+ *
+ */
+
+#ifndef __CMP20_ECDSA_MPC_PRIME_POOL_H__
+#define __CMP20_ECDSA_MPC_PRIME_POOL_H__
+
+#include <stdint.h>
+#include "algebraic_elements.h"
+#include "prime_generation.h"
+
+#define PRIME_POOL_KEY_BYTES 32
+
+typedef struct prime_pool_st prime_pool_t;
+
+// Wanted number of available primes of given bits and kind (for background generator)
+typedef struct
+{
+  uint64_t     bits;
+  prime_kind_t kind;
+  uint64_t     count;
+} prime_pool_target_t;
+
+// Counters are of this pool handle (since open), except available which is read from file
+typedef struct
+{
+  uint64_t available;           // Unused primes in file (all kinds)
+  uint64_t appended;
+  uint64_t popped;
+  uint64_t pop_misses;          // Pops without an available prime of wanted kind
+  uint64_t rejected;            // Prime records failing authentication (when popped)
+  uint64_t generated;
+  uint64_t generation_ms;       // Wall time spent by background generator and pop_or_generate on generation
+} prime_pool_metrics_t;
+
+// Returns NULL if file can't be opened or created, key doesn't match or some complete record is corrupted (a torn last record is removed)
+prime_pool_t *
+     prime_pool_open              (const char *path, const uint8_t key[PRIME_POOL_KEY_BYTES]);
+// Stops background generator (if started)
+void prime_pool_close             (prime_pool_t *pool);
+// Returns 0 on success, 1 if record can't be written (and fsynced)
+int  prime_pool_append            (prime_pool_t *pool, const scalar_t prime, uint64_t bits, prime_kind_t kind);
+// Returns 1 and sets prime if an unused prime of bits and kind was found and marked used (used record written and fsynced), 0 otherwise (counted as miss)
+int  prime_pool_pop               (prime_pool_t *pool, scalar_t prime, uint64_t bits, prime_kind_t kind);
+// Pops prime of every job from pool, missing primes are generated (pool==NULL generates all)
+void prime_pool_pop_or_generate   (prime_pool_t *pool, prime_gen_job_t *jobs, uint64_t num_jobs, uint64_t num_threads);
+uint64_t
+     prime_pool_available         (prime_pool_t *pool, uint64_t bits, prime_kind_t kind);
+void prime_pool_get_metrics       (prime_pool_t *pool, prime_pool_metrics_t *metrics);
+
+// Starts (restarts) background generation (with num_threads workers) until every target is available. Generator rechecks targets periodically, as other processes may pop.
+void prime_pool_generator_start   (prime_pool_t *pool, const prime_pool_target_t *targets, uint64_t num_targets, uint64_t num_threads);
+// Waits until all targets are available (returns immediately if generator not started)
+void prime_pool_generator_wait    (prime_pool_t *pool);
+// Cancels ongoing generation
+void prime_pool_generator_stop    (prime_pool_t *pool);
+
+#endif
@@ -1,4 +1,6 @@
 #include "algebraic_elements.h"
+#include "prime_generation.h"
+#include "prime_pool.h"
 #include "paillier_cryptosystem.h"
 #include "ring_pedersen_parameters.h"
 #include "zkp_common.h"
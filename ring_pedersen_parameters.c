@@ -1,4 +1,6 @@
 #include "ring_pedersen_parameters.h"
+#include "prime_generation.h"
+#include "zkp_common.h"
 #include <assert.h>
 
 ring_pedersen_private_t *ring_pedersen_private_new ()
@@ -10,15 +12,17 @@ ring_pedersen_private_t *ring_pedersen_private_new ()
   priv->N = scalar_new();
   priv->s = scalar_new();
   priv->t = scalar_new();
+  priv->mont_N = mont_ctx_new();
 
   return priv;
 }
 
 void ring_pedersen_private_from_primes  (ring_pedersen_private_t *priv, const scalar_t p, const scalar_t q)
 {
-  BN_CTX *bn_ctx = BN_CTX_secure_new();
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
   
   BN_mul(priv->N, p, q, bn_ctx);
+  mont_ctx_reset(priv->mont_N);
 
   BN_sub(priv->phi_N, priv->N, p);
   BN_sub(priv->phi_N, priv->phi_N, q);
@@ -29,10 +33,10 @@ void ring_pedersen_private_from_primes  (ring_pedersen_private_t *priv, const sc
   scalar_t r = scalar_new();
   scalar_sample_in_range(r, priv->N, 1);
   BN_mod_mul(priv->t, r, r, priv->N, bn_ctx);
-  BN_mod_exp(priv->s, priv->t, priv->lam, priv->N, bn_ctx);
+  scalar_exp_mont(priv->s, priv->t, priv->lam, priv->N, priv->mont_N);
   scalar_free(r);
   
-  BN_CTX_free(bn_ctx);
+  bn_ctx_release(bn_ctx);
 }
 
 void ring_pedersen_generate_private (ring_pedersen_private_t *priv, uint64_t prime_bits) 
@@ -40,8 +44,23 @@ void ring_pedersen_generate_private (ring_pedersen_private_t *priv, uint64_t pri
   scalar_t p = scalar_new();
   scalar_t q = scalar_new();
 
-  BN_generate_prime_ex(p, prime_bits, 1, NULL, NULL, NULL);
-  BN_generate_prime_ex(q, prime_bits, 1, NULL, NULL, NULL);
+  prime_generate(p, prime_bits, PRIME_KIND_SAFE, 1);
+  prime_generate(q, prime_bits, PRIME_KIND_SAFE, 1);
+
+  ring_pedersen_private_from_primes(priv, p, q);
+
+  scalar_free(p);
+  scalar_free(q);
+}
+
+void ring_pedersen_generate_private_threaded (ring_pedersen_private_t *priv, uint64_t prime_bits, uint64_t num_threads)
+{
+  scalar_t p = scalar_new();
+  scalar_t q = scalar_new();
+
+  prime_gen_job_t jobs[2] = {{ .prime = p, .bits = prime_bits, .kind = PRIME_KIND_SAFE },
+                             { .prime = q, .bits = prime_bits, .kind = PRIME_KIND_SAFE }};
+  prime_generate_batch(jobs, 2, num_threads);
 
   ring_pedersen_private_from_primes(priv, p, q);
 
@@ -56,9 +75,43 @@ ring_pedersen_public_t  *ring_pedersen_public_new()
   pub->N = scalar_new();
   pub->s = scalar_new();
   pub->t = scalar_new();
+  pub->mont_N = mont_ctx_new();
+  pub->s_table = NULL;
+  pub->t_table = NULL;
+  pub->s_inv_table = NULL;
+  pub->t_inv_table = NULL;
 
   return pub;
 }
+
+// Drops all precomputation, when parameters are set
+static void ring_pedersen_public_reset (ring_pedersen_public_t *pub)
+{
+  mont_ctx_reset(pub->mont_N);
+
+  scalar_fixed_base_free(pub->s_table);
+  scalar_fixed_base_free(pub->t_table);
+  scalar_fixed_base_free(pub->s_inv_table);
+  scalar_fixed_base_free(pub->t_inv_table);
+  pub->s_table = NULL;
+  pub->t_table = NULL;
+  pub->s_inv_table = NULL;
+  pub->t_inv_table = NULL;
+}
+
+void ring_pedersen_public_precompute (ring_pedersen_public_t *rped_pub, uint64_t max_exp_bits)
+{
+  ring_pedersen_public_reset(rped_pub);
+
+  scalar_t inv = scalar_new();
+  rped_pub->s_table = scalar_fixed_base_new(rped_pub->s, max_exp_bits, rped_pub->N);
+  rped_pub->t_table = scalar_fixed_base_new(rped_pub->t, max_exp_bits, rped_pub->N);
+  scalar_inv(inv, rped_pub->s, rped_pub->N);
+  rped_pub->s_inv_table = scalar_fixed_base_new(inv, max_exp_bits, rped_pub->N);
+  scalar_inv(inv, rped_pub->t, rped_pub->N);
+  rped_pub->t_inv_table = scalar_fixed_base_new(inv, max_exp_bits, rped_pub->N);
+  scalar_free(inv);
+}
 void ring_pedersen_copy_param (ring_pedersen_private_t *copy_priv, ring_pedersen_public_t *copy_pub, const ring_pedersen_private_t *priv, const ring_pedersen_public_t *pub)
 {
   if (pub && copy_pub)
@@ -66,6 +119,7 @@ void ring_pedersen_copy_param (ring_pedersen_private_t *copy_priv, ring_pedersen
     BN_copy(copy_pub->N, pub->N);
     BN_copy(copy_pub->s, pub->s);
     BN_copy(copy_pub->t, pub->t);
+    ring_pedersen_public_reset(copy_pub);
   }
 
   if (priv)
@@ -77,6 +131,7 @@ void ring_pedersen_copy_param (ring_pedersen_private_t *copy_priv, ring_pedersen
       BN_copy(copy_priv->t, priv->t);
       BN_copy(copy_priv->lam, priv->lam);
       BN_copy(copy_priv->phi_N, priv->phi_N);
+      mont_ctx_reset(copy_priv->mont_N);
     }
 
     if (!pub && copy_pub)
@@ -84,6 +139,7 @@ void ring_pedersen_copy_param (ring_pedersen_private_t *copy_priv, ring_pedersen
       BN_copy(copy_pub->N, priv->N);
       BN_copy(copy_pub->s, priv->s);
       BN_copy(copy_pub->t, priv->t);
+      ring_pedersen_public_reset(copy_pub);
     }
   }
 }
@@ -97,6 +153,7 @@ void  ring_pedersen_free_param(ring_pedersen_private_t *priv, ring_pedersen_publ
     scalar_free(priv->N);
     scalar_free(priv->s);
     scalar_free(priv->t);
+    mont_ctx_free(priv->mont_N);
 
     free(priv);
   }
@@ -106,28 +163,82 @@ void  ring_pedersen_free_param(ring_pedersen_private_t *priv, ring_pedersen_publ
     scalar_free(pub->N);
     scalar_free(pub->s);
     scalar_free(pub->t);
+    ring_pedersen_public_reset(pub);
+    mont_ctx_free(pub->mont_N);
 
     free(pub);
   }
 }
 
+// Returns 0/1 for success/error (no tables, or exponents too long for them).
+// Constant time: tables are used only if they cover the public bound of exponents (8*RING_PED_COMMIT_EXP_BYTES bits), decided without exponents' lengths.
+// Exponents are padded to tables' length and read with their inverses' tables, selected by sign by mask. Only an exponent beyond the bound falls back.
+static int ring_pedersen_commit_fixed_base (scalar_t rped_commitment, const scalar_t s_exp, const scalar_t t_exp, const ring_pedersen_public_t *rped_pub, int vartime)
+{
+  if (!rped_pub->s_table) return 1;
+
+  fixed_base_t tables[2]     = {rped_pub->s_table, rped_pub->t_table};
+  fixed_base_t inv_tables[2] = {rped_pub->s_inv_table, rped_pub->t_inv_table};
+  scalar_t exps[2] = {s_exp, t_exp};
+
+  if (vartime) return scalar_fixed_base_signed_multi_exp_vartime(rped_commitment, tables, inv_tables, exps, 2);
+
+  if (scalar_fixed_base_max_exp_bits(rped_pub->s_table) < 8*RING_PED_COMMIT_EXP_BYTES) return 1;
+  return scalar_fixed_base_signed_multi_exp(rped_commitment, tables, inv_tables, exps, 2);
+}
+
 void  ring_pedersen_commit(scalar_t rped_commitment, const scalar_t s_exp, const scalar_t t_exp, const ring_pedersen_public_t *rped_pub)
 {
-  BN_CTX *bn_ctx = BN_CTX_secure_new();
+  if (ring_pedersen_commit_fixed_base(rped_commitment, s_exp, t_exp, rped_pub, 0) == 0) return;
+
+  scalar_t bases[2] = {rped_pub->s, rped_pub->t};
+  scalar_t exps[2]  = {s_exp, t_exp};
+  scalar_multi_exp(rped_commitment, bases, exps, 2, 8*RING_PED_COMMIT_EXP_BYTES, rped_pub->N, rped_pub->mont_N);
+}
+
+void  ring_pedersen_commit_vartime(scalar_t rped_commitment, const scalar_t s_exp, const scalar_t t_exp, const ring_pedersen_public_t *rped_pub)
+{
+  if (ring_pedersen_commit_fixed_base(rped_commitment, s_exp, t_exp, rped_pub, 1) == 0) return;
+
+  scalar_t bases[2] = {rped_pub->s, rped_pub->t};
+  scalar_t exps[2]  = {s_exp, t_exp};
+  scalar_multi_exp_vartime(rped_commitment, bases, exps, 2, rped_pub->N, rped_pub->mont_N);
+}
+
+int   ring_pedersen_commit_multi_exp_vartime (scalar_t result, const scalar_t s_exp, const scalar_t t_exp, const scalar_t *bases, const scalar_t *exps, uint64_t count, const ring_pedersen_public_t *rped_pub)
+{
+  BN_CTX *bn_ctx = bn_ctx_acquire(0);
+  scalar_t commitment = BN_CTX_get(bn_ctx);
+
+  scalar_t *all_bases = calloc(count + 2, sizeof(scalar_t));
+  scalar_t *all_exps = calloc(count + 2, sizeof(scalar_t));
+  for (uint64_t i = 0; i < count; ++i)
+  {
+    all_bases[i] = bases[i];
+    all_exps[i] = exps[i];
+  }
 
-  scalar_t first_factor = scalar_new();
-  scalar_t res_rped_commitment = scalar_new();
+  int is_error;
+  if (ring_pedersen_commit_fixed_base(commitment, s_exp, t_exp, rped_pub, 1) == 0)
+  {
+    is_error = scalar_multi_exp_vartime(result, all_bases, all_exps, count, rped_pub->N, rped_pub->mont_N);
+    BN_mod_mul(result, result, commitment, rped_pub->N, bn_ctx);
+  }
+  else
+  {
+    // Single multi-exponentiation including s and t
+    all_bases[count] = rped_pub->s;
+    all_exps[count] = s_exp;
+    all_bases[count + 1] = rped_pub->t;
+    all_exps[count + 1] = t_exp;
+    is_error = scalar_multi_exp_vartime(result, all_bases, all_exps, count + 2, rped_pub->N, rped_pub->mont_N);
+  }
 
-  BN_mod_exp(first_factor, rped_pub->s, s_exp, rped_pub->N, bn_ctx);
-  if (BN_is_negative(s_exp)) BN_mod_inverse(first_factor, first_factor, rped_pub->N, bn_ctx);
-  BN_mod_exp(res_rped_commitment, rped_pub->t, t_exp, rped_pub->N, bn_ctx);
-  if (BN_is_negative(t_exp)) BN_mod_inverse(res_rped_commitment, res_rped_commitment, rped_pub->N, bn_ctx);
-  BN_mod_mul(res_rped_commitment, first_factor, res_rped_commitment, rped_pub->N, bn_ctx);
+  free(all_bases);
+  free(all_exps);
+  bn_ctx_release(bn_ctx);
 
-  BN_copy(rped_commitment, res_rped_commitment);
-  scalar_free(res_rped_commitment);
-  scalar_free(first_factor);
-  BN_CTX_free(bn_ctx);
+  return is_error;
 }
 
 void ring_pedersen_public_to_bytes (uint8_t **bytes, uint64_t *byte_len, const ring_pedersen_public_t *rped_pub, uint64_t rped_modulus_bytes, int move_to_end)
@@ -166,8 +277,64 @@ void ring_pedersen_public_from_bytes (ring_pedersen_public_t *rped_pub, uint8_t
   scalar_from_bytes(rped_pub->N, &read_bytes, rped_modulus_bytes, 1);
   scalar_from_bytes(rped_pub->s, &read_bytes, rped_modulus_bytes, 1);
   scalar_from_bytes(rped_pub->t, &read_bytes, rped_modulus_bytes, 1);
+  ring_pedersen_public_reset(rped_pub);
 
   assert(read_bytes == *bytes + needed_byte_len);
   *byte_len = needed_byte_len;
   if (move_to_end) *bytes = read_bytes;
-}
\ No newline at end of file
+}
+
+void ring_pedersen_public_stored_to_bytes (uint8_t **bytes, uint64_t *byte_len, const ring_pedersen_public_t *rped_pub, uint64_t rped_modulus_bytes, uint64_t max_exp_bits, int move_to_end)
+{
+  uint64_t table_byte_len;
+  scalar_fixed_base_to_bytes(NULL, &table_byte_len, NULL, max_exp_bits, rped_modulus_bytes, 0);
+  uint64_t needed_byte_len = 3*rped_modulus_bytes + 4*table_byte_len;
+
+  if ((!bytes) || (!*bytes) || (!rped_pub) || (needed_byte_len > *byte_len))
+  {
+    *byte_len = needed_byte_len;
+    return ;
+  }
+
+  uint8_t *set_bytes = *bytes;
+
+  scalar_to_bytes(&set_bytes, rped_modulus_bytes, rped_pub->N, 1);
+  scalar_to_bytes(&set_bytes, rped_modulus_bytes, rped_pub->s, 1);
+  scalar_to_bytes(&set_bytes, rped_modulus_bytes, rped_pub->t, 1);
+  scalar_fixed_base_to_bytes(&set_bytes, &table_byte_len, rped_pub->s_table, max_exp_bits, rped_modulus_bytes, 1);
+  scalar_fixed_base_to_bytes(&set_bytes, &table_byte_len, rped_pub->t_table, max_exp_bits, rped_modulus_bytes, 1);
+  scalar_fixed_base_to_bytes(&set_bytes, &table_byte_len, rped_pub->s_inv_table, max_exp_bits, rped_modulus_bytes, 1);
+  scalar_fixed_base_to_bytes(&set_bytes, &table_byte_len, rped_pub->t_inv_table, max_exp_bits, rped_modulus_bytes, 1);
+
+  assert(set_bytes == *bytes + needed_byte_len);
+  *byte_len = needed_byte_len;
+  if (move_to_end) *bytes = set_bytes;
+}
+
+void ring_pedersen_public_stored_from_bytes (ring_pedersen_public_t *rped_pub, uint8_t **bytes, uint64_t *byte_len, uint64_t rped_modulus_bytes, uint64_t max_exp_bits, int move_to_end)
+{
+  uint64_t table_byte_len;
+  scalar_fixed_base_to_bytes(NULL, &table_byte_len, NULL, max_exp_bits, rped_modulus_bytes, 0);
+  uint64_t needed_byte_len = 3*rped_modulus_bytes + 4*table_byte_len;
+
+  if ((!bytes) || (!*bytes) || (!rped_pub) || (needed_byte_len > *byte_len))
+  {
+    *byte_len = needed_byte_len;
+    return ;
+  }
+
+  uint8_t *read_bytes = *bytes;
+
+  scalar_from_bytes(rped_pub->N, &read_bytes, rped_modulus_bytes, 1);
+  scalar_from_bytes(rped_pub->s, &read_bytes, rped_modulus_bytes, 1);
+  scalar_from_bytes(rped_pub->t, &read_bytes, rped_modulus_bytes, 1);
+  ring_pedersen_public_reset(rped_pub);
+  scalar_fixed_base_from_bytes(&rped_pub->s_table, &read_bytes, &table_byte_len, max_exp_bits, rped_pub->N, rped_modulus_bytes, 1);
+  scalar_fixed_base_from_bytes(&rped_pub->t_table, &read_bytes, &table_byte_len, max_exp_bits, rped_pub->N, rped_modulus_bytes, 1);
+  scalar_fixed_base_from_bytes(&rped_pub->s_inv_table, &read_bytes, &table_byte_len, max_exp_bits, rped_pub->N, rped_modulus_bytes, 1);
+  scalar_fixed_base_from_bytes(&rped_pub->t_inv_table, &read_bytes, &table_byte_len, max_exp_bits, rped_pub->N, rped_modulus_bytes, 1);
+
+  assert(read_bytes == *bytes + needed_byte_len);
+  *byte_len = needed_byte_len;
+  if (move_to_end) *bytes = read_bytes;
+}
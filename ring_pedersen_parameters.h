@@ -9,6 +9,9 @@
  *  Usage:
  *  Generate private key from given two prime (computed N and sample random s,t,lam as required), from which also public key can be extracted.
  *  Compute ring pedersen commitments.
+ *  Parameters hold Montgomery precomputation for N (built on first use), which is reset whenever they are set.
+ *  Fixed-base tables of s, t (and their inverses) can be built for long lived public parameters by ring_pedersen_public_precompute, after which commitments use them automatically.
+ *  Public parameters can be stored with their tables (<...>_stored_to_bytes, for keystore) and read back without recomputing them.
  * 
  */
 
@@ -26,6 +29,14 @@ typedef struct
   scalar_t N;
   scalar_t s;
   scalar_t t;
+
+  mont_ctx_t mont_N;
+
+  // Optional, NULL until ring_pedersen_public_precompute
+  fixed_base_t s_table;
+  fixed_base_t t_table;
+  fixed_base_t s_inv_table;
+  fixed_base_t t_inv_table;
 } ring_pedersen_public_t;
 
 
@@ -39,6 +50,8 @@ typedef struct
   // Private 
   scalar_t lam;
   scalar_t phi_N;
+
+  mont_ctx_t mont_N;
 } ring_pedersen_private_t;
 
 
@@ -48,11 +61,26 @@ ring_pedersen_public_t *
       ring_pedersen_public_new          ();
 void  ring_pedersen_private_from_primes (ring_pedersen_private_t *priv, const scalar_t p, const scalar_t q);
 void  ring_pedersen_generate_private    (ring_pedersen_private_t *priv, uint64_t prime_bits);
+// Same as ring_pedersen_generate_private, both primes searched concurrently by num_threads workers
+void  ring_pedersen_generate_private_threaded
+                                        (ring_pedersen_private_t *priv, uint64_t prime_bits, uint64_t num_threads);
 void  ring_pedersen_copy_param          (ring_pedersen_private_t *copy_priv, ring_pedersen_public_t *copy_pub, const ring_pedersen_private_t *priv, const ring_pedersen_public_t *pub);
 // Free keys, each can be NULL and ignored. Public inside private is freed with private, shouldn't be freeed seperately
 void  ring_pedersen_free_param          (ring_pedersen_private_t *priv, ring_pedersen_public_t *pub);
+// Builds fixed-base tables for commitments with exponents up to max_exp_bits (longer exponents fall back to multi-exponentiation).
+// ring_pedersen_commit uses them only if max_exp_bits is at least 8*RING_PED_COMMIT_EXP_BYTES.
+void  ring_pedersen_public_precompute   (ring_pedersen_public_t *rped_pub, uint64_t max_exp_bits);
+// Operations and memory accesses don't depend on exponents (signed) of up to 8*RING_PED_COMMIT_EXP_BYTES bits
 void  ring_pedersen_commit              (scalar_t rped_commitment, const scalar_t s_exp, const scalar_t t_exp, const ring_pedersen_public_t *rped_pub);
+// Same as ring_pedersen_commit, for public exponents only (verifiers)
+void  ring_pedersen_commit_vartime      (scalar_t rped_commitment, const scalar_t s_exp, const scalar_t t_exp, const ring_pedersen_public_t *rped_pub);
+// Computes commitment (s^s_exp * t^t_exp) times product of bases[i]^exps[i] (mod N) for i < count. For public inputs only (verifiers).
+// Returns 0/1 for success/error (some base with negative exponent isn't coprime to N).
+int   ring_pedersen_commit_multi_exp_vartime (scalar_t result, const scalar_t s_exp, const scalar_t t_exp, const scalar_t *bases, const scalar_t *exps, uint64_t count, const ring_pedersen_public_t *rped_pub);
 void  ring_pedersen_public_to_bytes     (uint8_t **bytes, uint64_t *byte_len, const ring_pedersen_public_t *rped_pub, uint64_t rped_modulus_bytes, int move_to_end);
 void  ring_pedersen_public_from_bytes   (ring_pedersen_public_t *rped_pub, uint8_t **bytes, uint64_t *byte_len, uint64_t rped_modulus_bytes, int move_to_end);
+// Flat bytes with precomputation: N, s, t followed by tables of s, t, s^-1, t^-1 for exponents up to max_exp_bits (all zero if not precomputed)
+void  ring_pedersen_public_stored_to_bytes   (uint8_t **bytes, uint64_t *byte_len, const ring_pedersen_public_t *rped_pub, uint64_t rped_modulus_bytes, uint64_t max_exp_bits, int move_to_end);
+void  ring_pedersen_public_stored_from_bytes (ring_pedersen_public_t *rped_pub, uint8_t **bytes, uint64_t *byte_len, uint64_t rped_modulus_bytes, uint64_t max_exp_bits, int move_to_end);
 
 #endif
@@ -0,0 +1,1116 @@
+#include "algebraic_elements.h"
+
+#include <string.h>
+#include <assert.h>
+#include <openssl/crypto.h>
+
+typedef unsigned __int128 uint128_t;
+
+/**
+ *  Group Order Scalars (constant-time, Montgomery multiplication)
+ */
+
+static const order_scalar_t ORDER_Q         = {0xBFD25E8CD0364141ULL, 0xBAAEDCE6AF48A03BULL, 0xFFFFFFFFFFFFFFFEULL, 0xFFFFFFFFFFFFFFFFULL};
+static const order_scalar_t ORDER_Q_MINUS_2 = {0xBFD25E8CD036413FULL, 0xBAAEDCE6AF48A03BULL, 0xFFFFFFFFFFFFFFFEULL, 0xFFFFFFFFFFFFFFFFULL};
+static const order_scalar_t ORDER_R         = {0x402DA1732FC9BEBFULL, 0x4551231950B75FC4ULL, 0x0000000000000001ULL, 0x0000000000000000ULL};   // 2^256 mod q
+static const order_scalar_t ORDER_R2        = {0x896CF21467D7D140ULL, 0x741496C20E7CF878ULL, 0xE697F5E45BCD07C6ULL, 0x9D671CD581C69BC5ULL};   // 2^512 mod q
+static const order_scalar_t ORDER_2_320     = {0x0000000000000000ULL, 0x402DA1732FC9BEBFULL, 0x4551231950B75FC4ULL, 0x0000000000000001ULL};   // 2^320 mod q
+static const order_scalar_t ORDER_ZERO      = {0, 0, 0, 0};
+static const order_scalar_t ORDER_ONE       = {1, 0, 0, 0};
+#define ORDER_Q_INV 0x4B0DFF665588B13FULL     // -q^(-1) mod 2^64
+
+// Sets r = a mod q, for a + carry*2^256 < 2q
+static void order_reduce_once (order_scalar_t r, const uint64_t a[4], uint64_t carry)
+{
+  uint64_t d[4];
+  uint64_t borrow = 0;
+  for (int i = 0; i < 4; ++i)
+  {
+    uint128_t diff = (uint128_t) a[i] - ORDER_Q[i] - borrow;
+    d[i] = (uint64_t) diff;
+    borrow = (uint64_t) (diff >> 64) & 1;
+  }
+
+  uint64_t mask = 0 - (carry | (borrow ^ 1));
+  for (int i = 0; i < 4; ++i) r[i] = (d[i] & mask) | (a[i] & ~mask);
+}
+
+// Sets r = a*b/2^256 mod q
+static void order_mont_mul (order_scalar_t r, const order_scalar_t a, const order_scalar_t b)
+{
+  uint64_t t[6] = {0};
+  for (int i = 0; i < 4; ++i)
+  {
+    uint128_t acc = 0;
+    for (int j = 0; j < 4; ++j) { acc += (uint128_t) a[j] * b[i] + t[j]; t[j] = (uint64_t) acc; acc >>= 64; }
+    acc += t[4];
+    t[4] = (uint64_t) acc;
+    t[5] = (uint64_t) (acc >> 64);
+
+    uint64_t m = t[0] * ORDER_Q_INV;
+    acc = ((uint128_t) m * ORDER_Q[0] + t[0]) >> 64;
+    for (int j = 1; j < 4; ++j) { acc += (uint128_t) m * ORDER_Q[j] + t[j]; t[j-1] = (uint64_t) acc; acc >>= 64; }
+    acc += t[4];
+    t[3] = (uint64_t) acc;
+    t[4] = t[5] + (uint64_t) (acc >> 64);
+  }
+
+  order_reduce_once(r, t, t[4]);
+}
+
+void order_scalar_add (order_scalar_t result, const order_scalar_t first, const order_scalar_t second)
+{
+  uint64_t s[4];
+  uint128_t acc = 0;
+  for (int i = 0; i < 4; ++i) { acc += (uint128_t) first[i] + second[i]; s[i] = (uint64_t) acc; acc >>= 64; }
+  order_reduce_once(result, s, (uint64_t) acc);
+}
+
+void order_scalar_sub (order_scalar_t result, const order_scalar_t first, const order_scalar_t second)
+{
+  uint64_t d[4];
+  uint64_t borrow = 0;
+  for (int i = 0; i < 4; ++i)
+  {
+    uint128_t diff = (uint128_t) first[i] - second[i] - borrow;
+    d[i] = (uint64_t) diff;
+    borrow = (uint64_t) (diff >> 64) & 1;
+  }
+
+  // Add q back on borrow
+  uint64_t mask = 0 - borrow;
+  uint128_t acc = 0;
+  for (int i = 0; i < 4; ++i) { acc += (uint128_t) d[i] + (ORDER_Q[i] & mask); result[i] = (uint64_t) acc; acc >>= 64; }
+}
+
+void order_scalar_mul (order_scalar_t result, const order_scalar_t first, const order_scalar_t second)
+{
+  order_scalar_t temp;
+  order_mont_mul(temp, first, second);
+  order_mont_mul(result, temp, ORDER_R2);
+}
+
+void order_scalar_inv (order_scalar_t result, const order_scalar_t num)
+{
+  // Exponent q-2 is public, so branching on its bits is fine
+  order_scalar_t base;
+  order_scalar_t res;
+  order_mont_mul(base, num, ORDER_R2);
+  memcpy(res, ORDER_R, sizeof(order_scalar_t));
+
+  for (int i = 255; i >= 0; --i)
+  {
+    order_mont_mul(res, res, res);
+    if ((ORDER_Q_MINUS_2[i / 64] >> (i % 64)) & 1) order_mont_mul(res, res, base);
+  }
+
+  order_mont_mul(result, res, ORDER_ONE);
+  order_scalar_clear(base);
+  order_scalar_clear(res);
+}
+
+void order_scalar_clear (order_scalar_t num) { OPENSSL_cleanse(num, sizeof(order_scalar_t)); }
+
+void order_scalar_from_scalar (order_scalar_t result, const scalar_t num)
+{
+  // Horner over 64-bit limbs of |num| from the top: res = res*2^64 + limb (mod q). At least 4 limbs, so shorter values take the same time.
+  uint64_t num_limbs = (BN_num_bytes(num) + 7) / 8;
+  if (num_limbs < 4) num_limbs = 4;
+  uint8_t stack_bytes[2*GROUP_ORDER_BYTES];
+  uint8_t *bytes = stack_bytes;
+  if (8*num_limbs > sizeof(stack_bytes)) bytes = malloc(8*num_limbs);
+  BN_bn2lebinpad(num, bytes, 8*num_limbs);
+
+  order_scalar_t res = {0, 0, 0, 0};
+  order_scalar_t limb = {0, 0, 0, 0};
+  for (uint64_t i = num_limbs; i-- > 0; )
+  {
+    limb[0] = 0;
+    for (int b = 7; b >= 0; --b) limb[0] = (limb[0] << 8) | bytes[8*i + b];
+    order_mont_mul(res, res, ORDER_2_320);
+    order_scalar_add(res, res, limb);
+  }
+
+  // Negated by mask of the sign
+  order_scalar_t negated;
+  order_scalar_sub(negated, ORDER_ZERO, res);
+  uint64_t mask = 0 - (uint64_t) (BN_is_negative(num) != 0);
+  for (int i = 0; i < 4; ++i) result[i] = (negated[i] & mask) | (res[i] & ~mask);
+  order_scalar_clear(negated);
+
+  OPENSSL_cleanse(bytes, 8*num_limbs);
+  if (bytes != stack_bytes) free(bytes);
+  order_scalar_clear(res);
+  order_scalar_clear(limb);
+}
+
+void order_scalar_to_scalar (scalar_t result, const order_scalar_t num)
+{
+  uint8_t bytes[GROUP_ORDER_BYTES];
+  for (int i = 0; i < GROUP_ORDER_BYTES; ++i) bytes[i] = (uint8_t) (num[i / 8] >> (8 * (i % 8)));
+  BN_lebin2bn(bytes, GROUP_ORDER_BYTES, result);
+  OPENSSL_cleanse(bytes, sizeof(bytes));
+}
+
+#ifdef NATIVE_SECP256K1
+
+typedef uint64_t fe_t[4];
+typedef secp256k1_point_t point_t;
+
+#define FIELD_BYTES 32
+#define FIELD_R 0x1000003D1ULL        // p = 2^256 - FIELD_R
+#define CURVE_B 7
+
+static const fe_t FIELD_P              = {0xFFFFFFFEFFFFFC2FULL, 0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFFFFFFFFFFULL};
+static const fe_t FIELD_P_MINUS_2      = {0xFFFFFFFEFFFFFC2DULL, 0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFFFFFFFFFFULL};
+static const fe_t FIELD_P_PLUS_1_DIV_4 = {0xFFFFFFFFBFFFFF0CULL, 0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFFFFFFFFFFULL, 0x3FFFFFFFFFFFFFFFULL};
+static const fe_t FIELD_ONE            = {1, 0, 0, 0};
+static const fe_t CURVE_GX             = {0x59F2815B16F81798ULL, 0x029BFCDB2DCE28D9ULL, 0x55A06295CE870B07ULL, 0x79BE667EF9DCBBACULL};
+static const fe_t CURVE_GY             = {0x9C47D08FFB10D4B8ULL, 0xFD17B448A6855419ULL, 0x5DA4FBFC0E1108A8ULL, 0x483ADA7726A3C465ULL};
+// Cube root of unity modulo p, lambda*(x,y) = (beta*x,y)
+static const fe_t GLV_BETA             = {0xC1396C28719501EEULL, 0x9CF0497512F58995ULL, 0x6E64479EAC3434E9ULL, 0x7AE96A2B657C0710ULL};
+
+// GLV decomposition constants (modulo group order): cube root of unity lambda, g_1 = round(2^384*b_2/q), g_2 = round(2^384*(-b_1)/q)
+// and -b_1, -b_2 of the short basis (a_1,b_1), (a_2,b_2) of the lattice {(x,y) : x + y*lambda = 0 mod q}
+static const order_scalar_t GLV_LAMBDA   = {0xDF02967C1B23BD72ULL, 0x122E22EA20816678ULL, 0xA5261C028812645AULL, 0x5363AD4CC05C30E0ULL};
+static const order_scalar_t GLV_G1       = {0xE893209A45DBB031ULL, 0x3DAA8A1471E8CA7FULL, 0xE86C90E49284EB15ULL, 0x3086D221A7D46BCDULL};
+static const order_scalar_t GLV_G2       = {0x1571B4AE8AC47F71ULL, 0x221208AC9DF506C6ULL, 0x6F547FA90ABFE4C4ULL, 0xE4437ED6010E8828ULL};
+static const order_scalar_t GLV_MINUS_B1 = {0x6F547FA90ABFE4C3ULL, 0xE4437ED6010E8828ULL, 0x0000000000000000ULL, 0x0000000000000000ULL};
+static const order_scalar_t GLV_MINUS_B2 = {0xD765CDA83DB1562CULL, 0x8A280AC50774346DULL, 0xFFFFFFFFFFFFFFFEULL, 0xFFFFFFFFFFFFFFFFULL};
+static const order_scalar_t ORDER_HALF   = {0xDFE92F46681B20A0ULL, 0x5D576E7357A4501DULL, 0xFFFFFFFFFFFFFFFFULL, 0x7FFFFFFFFFFFFFFFULL};   // (q-1)/2
+
+// Bytes of each half exponent after GLV decomposition
+#define GLV_HALF_BYTES 17
+
+/**
+ *  Field Elements (modulo p)
+ */
+
+static uint64_t ct_is_zero (uint64_t a)               { return 1 ^ ((a | (0 - a)) >> 63); }
+static uint64_t ct_equal   (uint64_t a, uint64_t b)   { return ct_is_zero(a ^ b); }
+
+static void fe_copy      (fe_t r, const fe_t a)                    { memcpy(r, a, sizeof(fe_t)); }
+static int  fe_is_zero   (const fe_t a)                            { return (a[0] | a[1] | a[2] | a[3]) == 0; }
+static int  fe_equal     (const fe_t a, const fe_t b)              { return ((a[0] ^ b[0]) | (a[1] ^ b[1]) | (a[2] ^ b[2]) | (a[3] ^ b[3])) == 0; }
+
+static void fe_cmov (fe_t r, const fe_t a, uint64_t flag)
+{
+  uint64_t mask = 0 - flag;
+  for (int i = 0; i < 4; ++i) r[i] ^= mask & (r[i] ^ a[i]);
+}
+
+// Sets r = a mod p, for a + carry*2^256 < 2p
+static void fe_reduce_once (fe_t r, const uint64_t a[4], uint64_t carry)
+{
+  // t = a + FIELD_R = a - p (mod 2^256), which is the result when a + carry*2^256 >= p
+  uint64_t t[4];
+  uint128_t acc = (uint128_t) a[0] + FIELD_R;
+  t[0] = (uint64_t) acc; acc >>= 64;
+  for (int i = 1; i < 4; ++i) { acc += a[i]; t[i] = (uint64_t) acc; acc >>= 64; }
+
+  uint64_t mask = 0 - (uint64_t) ((acc | carry) != 0);
+  for (int i = 0; i < 4; ++i) r[i] = (t[i] & mask) | (a[i] & ~mask);
+}
+
+static void fe_add (fe_t r, const fe_t a, const fe_t b)
+{
+  uint64_t s[4];
+  uint128_t acc = 0;
+  for (int i = 0; i < 4; ++i) { acc += (uint128_t) a[i] + b[i]; s[i] = (uint64_t) acc; acc >>= 64; }
+  fe_reduce_once(r, s, (uint64_t) acc);
+}
+
+static void fe_sub (fe_t r, const fe_t a, const fe_t b)
+{
+  uint64_t d[4];
+  uint64_t borrow = 0;
+  for (int i = 0; i < 4; ++i)
+  {
+    uint128_t diff = (uint128_t) a[i] - b[i] - borrow;
+    d[i] = (uint64_t) diff;
+    borrow = (uint64_t) (diff >> 64) & 1;
+  }
+
+  // Add p back on borrow
+  uint64_t mask = 0 - borrow;
+  uint128_t acc = 0;
+  for (int i = 0; i < 4; ++i) { acc += (uint128_t) d[i] + (FIELD_P[i] & mask); r[i] = (uint64_t) acc; acc >>= 64; }
+}
+
+static void fe_negate (fe_t r, const fe_t a)
+{
+  const fe_t zero = {0, 0, 0, 0};
+  fe_sub(r, zero, a);
+}
+
+static void fe_mul (fe_t r, const fe_t a, const fe_t b)
+{
+  uint64_t t[8] = {0};
+  for (int i = 0; i < 4; ++i)
+  {
+    uint128_t acc = 0;
+    for (int j = 0; j < 4; ++j)
+    {
+      acc += (uint128_t) a[i] * b[j] + t[i+j];
+      t[i+j] = (uint64_t) acc;
+      acc >>= 64;
+    }
+    t[i+4] = (uint64_t) acc;
+  }
+
+  // Fold high half using 2^256 = FIELD_R (mod p), twice
+  uint64_t m[4];
+  uint128_t acc = 0;
+  for (int i = 0; i < 4; ++i) { acc += (uint128_t) t[i] + (uint128_t) t[i+4] * FIELD_R; m[i] = (uint64_t) acc; acc >>= 64; }
+
+  uint128_t acc_2 = (uint128_t) m[0] + (uint128_t) ((uint64_t) acc) * FIELD_R;
+  m[0] = (uint64_t) acc_2; acc_2 >>= 64;
+  for (int i = 1; i < 4; ++i) { acc_2 += m[i]; m[i] = (uint64_t) acc_2; acc_2 >>= 64; }
+
+  fe_reduce_once(r, m, (uint64_t) acc_2);
+}
+
+static void fe_sqr (fe_t r, const fe_t a) { fe_mul(r, a, a); }
+
+// Exponent is public (fixed), so variable time in exp is fine
+static void fe_pow (fe_t r, const fe_t a, const fe_t exp)
+{
+  fe_t res;
+  fe_t base;
+  fe_copy(res, FIELD_ONE);
+  fe_copy(base, a);
+
+  for (int i = 255; i >= 0; --i)
+  {
+    fe_sqr(res, res);
+    if ((exp[i / 64] >> (i % 64)) & 1) fe_mul(res, res, base);
+  }
+
+  fe_copy(r, res);
+}
+
+static void fe_inv (fe_t r, const fe_t a) { fe_pow(r, a, FIELD_P_MINUS_2); }
+
+// Returns 1 if a is a square (and r its square root), 0 otherwise
+static int fe_sqrt (fe_t r, const fe_t a)
+{
+  fe_t root;
+  fe_t check;
+  fe_pow(root, a, FIELD_P_PLUS_1_DIV_4);
+  fe_sqr(check, root);
+  fe_copy(r, root);
+  return fe_equal(check, a);
+}
+
+static void fe_to_bytes (uint8_t bytes[FIELD_BYTES], const fe_t a)
+{
+  for (int i = 0; i < FIELD_BYTES; ++i) bytes[FIELD_BYTES - 1 - i] = (uint8_t) (a[i / 8] >> (8 * (i % 8)));
+}
+
+// Returns 1 if bytes encode an element in range [0, p), 0 otherwise
+static int fe_from_bytes (fe_t r, const uint8_t bytes[FIELD_BYTES])
+{
+  memset(r, 0, sizeof(fe_t));
+  for (int i = 0; i < FIELD_BYTES; ++i) r[i / 8] |= ((uint64_t) bytes[FIELD_BYTES - 1 - i]) << (8 * (i % 8));
+
+  uint64_t borrow = 0;
+  for (int i = 0; i < 4; ++i) borrow = (uint64_t) ((((uint128_t) r[i] - FIELD_P[i] - borrow)) >> 64) & 1;
+  return borrow == 1;
+}
+
+/**
+ *  Points (Jacobian coordinates)
+ */
+
+static void point_set_infinity (point_t *r)
+{
+  memset(r, 0, sizeof(point_t));
+  r->is_infinity = 1;
+}
+
+static void point_set_affine (point_t *r, const fe_t x, const fe_t y)
+{
+  fe_copy(r->X, x);
+  fe_copy(r->Y, y);
+  fe_copy(r->Z, FIELD_ONE);
+  r->is_infinity = 0;
+}
+
+static void point_cmov (point_t *r, const point_t *a, uint64_t flag)
+{
+  fe_cmov(r->X, a->X, flag);
+  fe_cmov(r->Y, a->Y, flag);
+  fe_cmov(r->Z, a->Z, flag);
+  r->is_infinity ^= (0 - flag) & (r->is_infinity ^ a->is_infinity);
+}
+
+static void point_negate_cond (point_t *r, uint64_t flag)
+{
+  fe_t neg_Y;
+  fe_negate(neg_Y, r->Y);
+  fe_cmov(r->Y, neg_Y, flag);
+}
+
+// Returns is_on_curve for affine (x,y): y^2 = x^3 + 7
+static int point_affine_on_curve (const fe_t x, const fe_t y)
+{
+  fe_t lhs;
+  fe_t rhs;
+  const fe_t b = {CURVE_B, 0, 0, 0};
+  fe_sqr(lhs, y);
+  fe_sqr(rhs, x);
+  fe_mul(rhs, rhs, x);
+  fe_add(rhs, rhs, b);
+  return fe_equal(lhs, rhs);
+}
+
+static void point_get_affine (fe_t x, fe_t y, const point_t *a)
+{
+  if (fe_equal(a->Z, FIELD_ONE))
+  {
+    if (x) fe_copy(x, a->X);
+    if (y) fe_copy(y, a->Y);
+    return;
+  }
+
+  fe_t z_inv;
+  fe_t z_inv_2;
+  fe_inv(z_inv, a->Z);
+  fe_sqr(z_inv_2, z_inv);
+  if (x) fe_mul(x, a->X, z_inv_2);
+  if (y) { fe_mul(z_inv_2, z_inv_2, z_inv); fe_mul(y, a->Y, z_inv_2); }
+}
+
+// Constant-time (no branch on a), secp256k1 has no points of order 2 so only infinity doubles to infinity
+static void point_double (point_t *r, const point_t *a)
+{
+  uint64_t a_infinity = a->is_infinity;
+
+  // dbl-2009-l (curve a=0)
+  fe_t A, B, C, D, E, F, temp;
+  fe_sqr(A, a->X);
+  fe_sqr(B, a->Y);
+  fe_sqr(C, B);
+  fe_add(temp, a->X, B);
+  fe_sqr(temp, temp);
+  fe_sub(temp, temp, A);
+  fe_sub(temp, temp, C);
+  fe_add(D, temp, temp);
+  fe_add(E, A, A);
+  fe_add(E, E, A);
+  fe_sqr(F, E);
+
+  fe_mul(r->Z, a->Y, a->Z);
+  fe_add(r->Z, r->Z, r->Z);
+  fe_sub(r->X, F, D);
+  fe_sub(r->X, r->X, D);
+  fe_sub(temp, D, r->X);
+  fe_mul(temp, E, temp);
+  fe_add(C, C, C);
+  fe_add(C, C, C);
+  fe_add(C, C, C);
+  fe_sub(r->Y, temp, C);
+  r->is_infinity = a_infinity;
+}
+
+// Sum of a and b by add-2007-bl (mixed madd-2007-bl when b_affine), not handling a == +-b or infinity. Returns H and R, both zero iff a == b.
+static void point_add_generic (point_t *r, fe_t H, fe_t R, const point_t *a, const point_t *b, int b_affine)
+{
+  fe_t U1, U2, S1, S2, HH, HHH, V, temp;
+
+  fe_sqr(temp, a->Z);
+  fe_mul(U2, b->X, temp);
+  fe_mul(temp, temp, a->Z);
+  fe_mul(S2, b->Y, temp);
+
+  if (b_affine)
+  {
+    fe_copy(U1, a->X);
+    fe_copy(S1, a->Y);
+  }
+  else
+  {
+    fe_sqr(temp, b->Z);
+    fe_mul(U1, a->X, temp);
+    fe_mul(temp, temp, b->Z);
+    fe_mul(S1, a->Y, temp);
+  }
+
+  fe_sub(H, U2, U1);
+  fe_sub(R, S2, S1);
+
+  fe_sqr(HH, H);
+  fe_mul(HHH, H, HH);
+  fe_mul(V, U1, HH);
+
+  if (b_affine) fe_mul(r->Z, a->Z, H);
+  else { fe_mul(temp, a->Z, b->Z); fe_mul(r->Z, temp, H); }
+
+  fe_sqr(r->X, R);
+  fe_sub(r->X, r->X, HHH);
+  fe_sub(r->X, r->X, V);
+  fe_sub(r->X, r->X, V);
+  fe_sub(temp, V, r->X);
+  fe_mul(temp, R, temp);
+  fe_mul(S1, S1, HHH);
+  fe_sub(r->Y, temp, S1);
+  r->is_infinity = 0;
+}
+
+/**
+ *  Constant-time addition: computes the generic sum and the doubling of a, then selects the result of the special cases
+ *  (a == b, a == -b, infinity) by cmov. b_affine must not depend on secret data (all of b's possible values affine, as generator table).
+ */
+static void point_add_ct (point_t *r, const point_t *a, const point_t *b, int b_affine)
+{
+  point_t sum;
+  point_t dbl;
+  point_t infinity;
+  fe_t H, R;
+
+  point_add_generic(&sum, H, R, a, b, b_affine);
+  point_double(&dbl, a);
+  point_set_infinity(&infinity);
+
+  uint64_t H_zero = ct_is_zero(H[0] | H[1] | H[2] | H[3]);
+  uint64_t R_zero = ct_is_zero(R[0] | R[1] | R[2] | R[3]);
+  uint64_t a_infinity = a->is_infinity;
+  uint64_t b_infinity = b->is_infinity;
+
+  point_cmov(&sum, &dbl, H_zero & R_zero);
+  point_cmov(&sum, &infinity, H_zero & (1 ^ R_zero));
+  point_cmov(&sum, a, b_infinity);
+  point_cmov(&sum, b, a_infinity);
+
+  *r = sum;
+}
+
+static void point_add        (point_t *r, const point_t *a, const point_t *b) { point_add_ct(r, a, b, 0); }
+static void point_add_affine (point_t *r, const point_t *a, const point_t *b) { point_add_ct(r, a, b, 1); }
+
+// Variable time addition for public points, skipping the special cases and using mixed addition when b is affine (Z=1)
+static void point_add_vartime (point_t *r, const point_t *a, const point_t *b)
+{
+  if (a->is_infinity) { *r = *b; return; }
+  if (b->is_infinity) { *r = *a; return; }
+
+  fe_t H, R;
+  point_t sum;
+  point_add_generic(&sum, H, R, a, b, fe_equal(b->Z, FIELD_ONE));
+
+  if (fe_is_zero(H))
+  {
+    if (fe_is_zero(R)) point_double(r, a);
+    else point_set_infinity(r);
+    return;
+  }
+
+  *r = sum;
+}
+
+// Convert all (non-infinity) points to affine with a single field inversion (Montgomery's trick)
+static void points_make_affine (point_t **points, uint64_t count)
+{
+  fe_t *prefix = malloc(count * sizeof(fe_t));
+  fe_t acc;
+  fe_t z_inv;
+  fe_t z_inv_2;
+
+  fe_copy(acc, FIELD_ONE);
+  for (uint64_t i = 0; i < count; ++i)
+  {
+    fe_copy(prefix[i], acc);
+    if (!points[i]->is_infinity) fe_mul(acc, acc, points[i]->Z);
+  }
+
+  fe_inv(acc, acc);
+
+  for (uint64_t i = count; i-- > 0; )
+  {
+    if (points[i]->is_infinity) continue;
+
+    fe_mul(z_inv, acc, prefix[i]);
+    fe_mul(acc, acc, points[i]->Z);
+
+    fe_sqr(z_inv_2, z_inv);
+    fe_mul(points[i]->X, points[i]->X, z_inv_2);
+    fe_mul(z_inv_2, z_inv_2, z_inv);
+    fe_mul(points[i]->Y, points[i]->Y, z_inv_2);
+    fe_copy(points[i]->Z, FIELD_ONE);
+  }
+
+  free(prefix);
+}
+
+/**
+ *  Exponent decomposition
+ */
+
+// Returns window_bits bits of little-endian encoded exponent, starting at bit_pos (bits beyond exponent are 0)
+static uint64_t window_digit (const uint8_t *exp_bytes, uint64_t exp_byte_len, uint64_t bit_pos, uint64_t window_bits)
+{
+  uint64_t digit = 0;
+  for (uint64_t b = 0; b < window_bits; ++b, ++bit_pos)
+  {
+    if (bit_pos < 8*exp_byte_len) digit |= ((uint64_t) (exp_bytes[bit_pos / 8] >> (bit_pos % 8)) & 1) << b;
+  }
+  return digit;
+}
+
+// Sets r = round(k*g / 2^384), for k, g < 2^256 (fixed-width product, rounding by bit 383)
+static void glv_mul_shift_384 (order_scalar_t r, const order_scalar_t k, const order_scalar_t g)
+{
+  uint64_t l[8] = {0};
+  for (int i = 0; i < 4; ++i)
+  {
+    uint128_t acc = 0;
+    for (int j = 0; j < 4; ++j) { acc += (uint128_t) k[i] * g[j] + l[i+j]; l[i+j] = (uint64_t) acc; acc >>= 64; }
+    l[i+4] = (uint64_t) acc;
+  }
+
+  uint128_t acc = (uint128_t) l[6] + (l[5] >> 63);
+  r[0] = (uint64_t) acc;
+  r[1] = l[7] + (uint64_t) (acc >> 64);
+  r[2] = 0;
+  r[3] = 0;
+  OPENSSL_cleanse(l, sizeof(l));
+}
+
+// Sets bytes (little-endian) to |r| as signed value in (-q/2, q/2], and returns 1 if negative. |r| must fit in GLV_HALF_BYTES.
+static uint64_t glv_half_to_bytes (uint8_t bytes[GLV_HALF_BYTES], const order_scalar_t r)
+{
+  // Negative iff r > (q-1)/2, i.e. (q-1)/2 - r borrows
+  uint64_t borrow = 0;
+  for (int i = 0; i < 4; ++i) borrow = (uint64_t) (((uint128_t) ORDER_HALF[i] - r[i] - borrow) >> 64) & 1;
+
+  order_scalar_t negated;
+  order_scalar_sub(negated, ORDER_ZERO, r);
+  uint64_t mask = 0 - borrow;
+  for (uint64_t i = 0; i < GLV_HALF_BYTES; ++i)
+  {
+    uint64_t limb = (negated[i / 8] & mask) | (r[i / 8] & ~mask);
+    bytes[i] = (uint8_t) (limb >> (8 * (i % 8)));
+  }
+
+  order_scalar_clear(negated);
+  return borrow;
+}
+
+/**
+ *  Splits exp = k_1 + k_2*lambda (mod order), with |k_1|, |k_2| < 2^128 (as in libsecp256k1): c_1 = round(k*b_2/q), c_2 = round(-k*b_1/q)
+ *  by fixed-point multiplication, k_2 = -c_1*b_1 - c_2*b_2 and k_1 = k - k_2*lambda.
+ *  Outputs absolute values as little-endian bytes, and signs (1 if negative). Fixed-width and constant-time in exp (for secret exponents).
+ */
+static void glv_split (uint8_t k_1_bytes[GLV_HALF_BYTES], uint64_t *k_1_neg, uint8_t k_2_bytes[GLV_HALF_BYTES], uint64_t *k_2_neg, const scalar_t exp)
+{
+  order_scalar_t k;
+  order_scalar_t c_1;
+  order_scalar_t c_2;
+  order_scalar_t k_1;
+  order_scalar_t k_2;
+
+  order_scalar_from_scalar(k, exp);
+  glv_mul_shift_384(c_1, k, GLV_G1);
+  glv_mul_shift_384(c_2, k, GLV_G2);
+
+  order_scalar_mul(c_1, c_1, GLV_MINUS_B1);
+  order_scalar_mul(c_2, c_2, GLV_MINUS_B2);
+  order_scalar_add(k_2, c_1, c_2);
+  order_scalar_mul(k_1, k_2, GLV_LAMBDA);
+  order_scalar_sub(k_1, k, k_1);
+
+  *k_1_neg = glv_half_to_bytes(k_1_bytes, k_1);
+  *k_2_neg = glv_half_to_bytes(k_2_bytes, k_2);
+
+  order_scalar_clear(k);
+  order_scalar_clear(c_1);
+  order_scalar_clear(c_2);
+  order_scalar_clear(k_1);
+  order_scalar_clear(k_2);
+}
+
+// Sets r = lambda*a (same point order)
+static void point_endomorphism (point_t *r, const point_t *a)
+{
+  *r = *a;
+  fe_mul(r->X, a->X, GLV_BETA);
+}
+
+#define WINDOW_BITS 4
+#define WINDOW_ENTRIES ((1 << WINDOW_BITS) - 1)
+#define GLV_WINDOWS ((8*GLV_HALF_BYTES + WINDOW_BITS - 1) / WINDOW_BITS)
+#define GEN_TABLE_WINDOWS ((8*GROUP_ORDER_BYTES + WINDOW_BITS - 1) / WINDOW_BITS)
+#define PIPPENGER_MIN_COUNT 64
+
+// Constant-time r = table[digit-1] (table[0] when digit is 0)
+static void point_table_select (point_t *r, const point_t *table, uint64_t digit)
+{
+  *r = table[0];
+  for (uint64_t d = 1; d < WINDOW_ENTRIES; ++d) point_cmov(r, &table[d], ct_equal(d + 1, digit));
+}
+
+static void point_table_select_ptr (point_t *r, point_t *const *table, uint64_t digit)
+{
+  *r = *table[0];
+  for (uint64_t d = 1; d < WINDOW_ENTRIES; ++d) point_cmov(r, table[d], ct_equal(d + 1, digit));
+}
+
+/**
+ *  Computes base^exp as k_1*base + k_2*lambda(base), sharing doublings (half the doublings of plain multiplication).
+ *  Table lookups, additions (including special cases) and skipping of zero digits are constant-time.
+ */
+static void point_mul (point_t *r, const point_t *base, const scalar_t exp)
+{
+  if (base->is_infinity) { point_set_infinity(r); return; }
+
+  uint8_t k_bytes[2][GLV_HALF_BYTES];
+  uint64_t k_neg[2];
+  glv_split(k_bytes[0], &k_neg[0], k_bytes[1], &k_neg[1], exp);
+
+  point_t table[2][WINDOW_ENTRIES];
+  table[0][0] = *base;
+  for (uint64_t d = 1; d < WINDOW_ENTRIES; ++d) point_add(&table[0][d], &table[0][d-1], base);
+  for (uint64_t d = 0; d < WINDOW_ENTRIES; ++d)
+  {
+    point_endomorphism(&table[1][d], &table[0][d]);
+    point_negate_cond(&table[0][d], k_neg[0]);
+    point_negate_cond(&table[1][d], k_neg[1]);
+  }
+
+  point_t acc;
+  point_t selected;
+  point_t sum;
+  point_set_infinity(&acc);
+
+  for (uint64_t w = GLV_WINDOWS; w-- > 0; )
+  {
+    for (uint64_t b = 0; b < WINDOW_BITS; ++b) point_double(&acc, &acc);
+
+    for (uint64_t half = 0; half < 2; ++half)
+    {
+      uint64_t digit = window_digit(k_bytes[half], GLV_HALF_BYTES, w * WINDOW_BITS, WINDOW_BITS);
+      point_table_select(&selected, table[half], digit);
+      point_add(&sum, &acc, &selected);
+      point_cmov(&acc, &sum, 1 ^ ct_is_zero(digit));
+    }
+  }
+
+  *r = acc;
+
+  OPENSSL_cleanse(k_bytes, sizeof(k_bytes));
+  OPENSSL_cleanse(table, sizeof(table));
+}
+
+/**
+ *  EC Group
+ */
+
+ec_group_t ec_group_new ()
+{
+  ec_group_t ec = malloc(sizeof(*ec));
+
+  // Openssl group is kept for the group order
+  ec->group = EC_GROUP_new_by_curve_name(GROUP_ID);
+  ec->generator = group_elem_new(ec);
+  point_set_affine(ec->generator, CURVE_GX, CURVE_GY);
+
+  // Generator table holds digit * 2^(WINDOW_BITS * i) * generator for each window i and non-zero digit
+  ec->gen_table = calloc(GEN_TABLE_WINDOWS * WINDOW_ENTRIES, sizeof(gr_elem_t));
+  point_t window_base = *ec->generator;
+
+  for (uint64_t i = 0; i < GEN_TABLE_WINDOWS; ++i)
+  {
+    gr_elem_t *window = ec->gen_table + i * WINDOW_ENTRIES;
+
+    window[0] = group_elem_new(ec);
+    *window[0] = window_base;
+    for (uint64_t d = 1; d < WINDOW_ENTRIES; ++d)
+    {
+      window[d] = group_elem_new(ec);
+      point_add_vartime(window[d], window[d-1], &window_base);
+    }
+
+    for (uint64_t b = 0; b < WINDOW_BITS; ++b) point_double(&window_base, &window_base);
+  }
+
+  points_make_affine(ec->gen_table, GEN_TABLE_WINDOWS * WINDOW_ENTRIES);
+
+  return ec;
+}
+
+void ec_group_free (ec_group_t ec)
+{
+  if (!ec) return;
+
+  for (uint64_t i = 0; i < GEN_TABLE_WINDOWS * WINDOW_ENTRIES; ++i) group_elem_free(ec->gen_table[i]);
+  free(ec->gen_table);
+  group_elem_free(ec->generator);
+  EC_GROUP_free(ec->group);
+  free(ec);
+}
+
+/**
+ *  Group Elements
+ */
+
+gr_elem_t group_elem_new (const ec_group_t ec)
+{
+  (void) ec;
+  gr_elem_t el = malloc(sizeof(point_t));
+  point_set_infinity(el);
+  return el;
+}
+
+void group_elem_free (gr_elem_t el)
+{
+  if (!el) return;
+  OPENSSL_cleanse(el, sizeof(point_t));
+  free(el);
+}
+
+void group_elem_copy (gr_elem_t copy, const gr_elem_t el) { *copy = *el; }
+
+void group_elem_to_bytes (uint8_t **bytes, uint64_t byte_len, gr_elem_t el, const ec_group_t ec, int move_to_end)
+{
+  (void) ec;
+
+  // Same encoding as openssl: single zero byte for infinity, otherwise compressed
+  if (el->is_infinity)
+  {
+    if (byte_len >= 1) (*bytes)[0] = 0x00;
+  }
+  else if (byte_len >= GROUP_ELEMENT_BYTES)
+  {
+    fe_t x;
+    fe_t y;
+    point_get_affine(x, y, el);
+    (*bytes)[0] = 0x02 | (y[0] & 1);
+    fe_to_bytes(*bytes + 1, x);
+  }
+
+  if (move_to_end) *bytes += byte_len;
+}
+
+int group_elem_from_bytes (gr_elem_t el, uint8_t **bytes, uint64_t byte_len, const ec_group_t ec, int move_to_end)
+{
+  (void) ec;
+
+  const uint8_t *read_bytes = *bytes;
+  int ret = 1;
+
+  fe_t x;
+  fe_t y;
+
+  if ((byte_len == 1) && (read_bytes[0] == 0x00))
+  {
+    point_set_infinity(el);
+    ret = 0;
+  }
+  else if ((byte_len == GROUP_ELEMENT_BYTES) && ((read_bytes[0] == 0x02) || (read_bytes[0] == 0x03)) && fe_from_bytes(x, read_bytes + 1))
+  {
+    fe_t y_2;
+    const fe_t b = {CURVE_B, 0, 0, 0};
+    fe_sqr(y_2, x);
+    fe_mul(y_2, y_2, x);
+    fe_add(y_2, y_2, b);
+
+    if (fe_sqrt(y, y_2))
+    {
+      if ((y[0] & 1) != (read_bytes[0] & 1)) fe_negate(y, y);
+      point_set_affine(el, x, y);
+      ret = 0;
+    }
+  }
+  else if ((byte_len == 2*FIELD_BYTES + 1) && (read_bytes[0] == 0x04) && fe_from_bytes(x, read_bytes + 1) && fe_from_bytes(y, read_bytes + 1 + FIELD_BYTES))
+  {
+    if (point_affine_on_curve(x, y))
+    {
+      point_set_affine(el, x, y);
+      ret = 0;
+    }
+  }
+
+  if (move_to_end) *bytes += byte_len;
+  return ret;
+}
+
+void group_elem_batch_normalize (gr_elem_t *els, uint64_t count, const ec_group_t ec)
+{
+  (void) ec;
+  points_make_affine(els, count);
+}
+
+/**
+ *  Computes generator^exp by adding a single (constant-time selected) table entry per window of exp (reduced modulo group order).
+ */
+void group_generator_mul (gr_elem_t result, const scalar_t exp, const ec_group_t ec)
+{
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
+
+  scalar_t reduced_exp = BN_CTX_get(bn_ctx);
+  BN_nnmod(reduced_exp, exp, ec_group_order(ec), bn_ctx);
+
+  uint8_t exp_bytes[GROUP_ORDER_BYTES];
+  BN_bn2lebinpad(reduced_exp, exp_bytes, GROUP_ORDER_BYTES);
+
+  point_t acc;
+  point_t selected;
+  point_t sum;
+  point_set_infinity(&acc);
+
+  for (uint64_t i = 0; i < GEN_TABLE_WINDOWS; ++i)
+  {
+    uint64_t digit = window_digit(exp_bytes, GROUP_ORDER_BYTES, i * WINDOW_BITS, WINDOW_BITS);
+    point_table_select_ptr(&selected, ec->gen_table + i * WINDOW_ENTRIES, digit);
+    point_add_affine(&sum, &acc, &selected);
+    point_cmov(&acc, &sum, 1 ^ ct_is_zero(digit));
+  }
+
+  *result = acc;
+
+  OPENSSL_cleanse(exp_bytes, sizeof(exp_bytes));
+  bn_ctx_release(bn_ctx);
+}
+
+// Same table, indexed directly and skipping zero digits (public exp only)
+void group_generator_mul_vartime (gr_elem_t result, const scalar_t exp, const ec_group_t ec)
+{
+  BN_CTX *bn_ctx = bn_ctx_acquire(0);
+
+  scalar_t reduced_exp = BN_CTX_get(bn_ctx);
+  BN_nnmod(reduced_exp, exp, ec_group_order(ec), bn_ctx);
+
+  uint8_t exp_bytes[GROUP_ORDER_BYTES];
+  BN_bn2lebinpad(reduced_exp, exp_bytes, GROUP_ORDER_BYTES);
+
+  point_t acc;
+  point_set_infinity(&acc);
+
+  for (uint64_t i = 0; i < GEN_TABLE_WINDOWS; ++i)
+  {
+    uint64_t digit = window_digit(exp_bytes, GROUP_ORDER_BYTES, i * WINDOW_BITS, WINDOW_BITS);
+    if (digit) point_add_vartime(&acc, &acc, ec->gen_table[i * WINDOW_ENTRIES + digit - 1]);
+  }
+
+  *result = acc;
+
+  bn_ctx_release(bn_ctx);
+}
+
+/**
+ *  Straus (interleaved fixed windows): affine table of base^d for each base, sharing the doublings between all bases.
+ */
+static void points_multi_mul_straus (point_t *result, const point_t *bases, const uint8_t *exp_bytes, uint64_t exp_byte_len, uint64_t count)
+{
+  point_t *table = malloc(count * WINDOW_ENTRIES * sizeof(point_t));
+  point_t **table_ptrs = malloc(count * WINDOW_ENTRIES * sizeof(point_t *));
+
+  for (uint64_t i = 0; i < count; ++i)
+  {
+    point_t *base_table = table + i * WINDOW_ENTRIES;
+    base_table[0] = bases[i];
+    for (uint64_t d = 1; d < WINDOW_ENTRIES; ++d) point_add_vartime(&base_table[d], &base_table[d-1], &bases[i]);
+  }
+  for (uint64_t i = 0; i < count * WINDOW_ENTRIES; ++i) table_ptrs[i] = &table[i];
+  points_make_affine(table_ptrs, count * WINDOW_ENTRIES);
+
+  uint64_t num_windows = (8*exp_byte_len + WINDOW_BITS - 1) / WINDOW_BITS;
+
+  point_set_infinity(result);
+
+  for (uint64_t w = num_windows; w-- > 0; )
+  {
+    for (uint64_t b = 0; b < WINDOW_BITS; ++b) point_double(result, result);
+
+    for (uint64_t i = 0; i < count; ++i)
+    {
+      uint64_t digit = window_digit(exp_bytes + i * exp_byte_len, exp_byte_len, w * WINDOW_BITS, WINDOW_BITS);
+      if (digit) point_add_vartime(result, result, &table[i * WINDOW_ENTRIES + digit - 1]);
+    }
+  }
+
+  free(table_ptrs);
+  free(table);
+}
+
+/**
+ *  Pippenger (bucket method): per window, sort bases into buckets by digit, then sum buckets weighted by digit using running sums.
+ */
+static void points_multi_mul_pippenger (point_t *result, const point_t *bases, const uint8_t *exp_bytes, uint64_t exp_byte_len, uint64_t count)
+{
+  uint64_t window_bits = 2;
+  while ((1UL << (window_bits + 2)) < count) ++window_bits;
+
+  uint64_t num_windows = (8*exp_byte_len + window_bits - 1) / window_bits;
+  uint64_t num_buckets = (1UL << window_bits) - 1;
+
+  point_t *buckets = malloc(num_buckets * sizeof(point_t));
+  point_t running_sum;
+  point_t window_sum;
+
+  point_set_infinity(result);
+
+  for (uint64_t w = num_windows; w-- > 0; )
+  {
+    for (uint64_t b = 0; b < window_bits; ++b) point_double(result, result);
+
+    for (uint64_t d = 0; d < num_buckets; ++d) point_set_infinity(&buckets[d]);
+
+    for (uint64_t i = 0; i < count; ++i)
+    {
+      uint64_t digit = window_digit(exp_bytes + i * exp_byte_len, exp_byte_len, w * window_bits, window_bits);
+      if (digit) point_add_vartime(&buckets[digit - 1], &buckets[digit - 1], &bases[i]);
+    }
+
+    // window_sum = sum of d * bucket[d]
+    point_set_infinity(&running_sum);
+    point_set_infinity(&window_sum);
+    for (uint64_t d = num_buckets; d-- > 0; )
+    {
+      point_add_vartime(&running_sum, &running_sum, &buckets[d]);
+      point_add_vartime(&window_sum, &window_sum, &running_sum);
+    }
+
+    point_add_vartime(result, result, &window_sum);
+  }
+
+  free(buckets);
+}
+
+/**
+ *  Computes product of bases[i]^scalars[i]. Unit exponents are just added, generator bases use the generator table,
+ *  and the rest are split by GLV into two half-size exponents, computed together by Straus (few bases) or Pippenger (many bases).
+ */
+void group_multi_exp (gr_elem_t result, const gr_elem_t *bases, const scalar_t *scalars, uint64_t count, const ec_group_t ec)
+{
+  BN_CTX *bn_ctx = bn_ctx_acquire(0);
+
+  point_t acc;
+  point_t temp;
+  point_set_infinity(&acc);
+
+  point_t *split_bases = malloc(2 * count * sizeof(point_t));
+  uint8_t *split_exp_bytes = calloc(2 * count, GLV_HALF_BYTES);
+  uint64_t num_split = 0;
+  uint64_t k_neg[2];
+
+  for (uint64_t i = 0; i < count; ++i)
+  {
+    if (!scalars || !scalars[i])
+    {
+      point_add_vartime(&acc, &acc, bases[i]);
+    }
+    else if (bases[i] == ec->generator)
+    {
+      group_generator_mul_vartime(&temp, scalars[i], ec);
+      point_add_vartime(&acc, &acc, &temp);
+    }
+    else
+    {
+      glv_split(split_exp_bytes + num_split * GLV_HALF_BYTES, &k_neg[0], split_exp_bytes + (num_split + 1) * GLV_HALF_BYTES, &k_neg[1], scalars[i]);
+
+      split_bases[num_split] = *bases[i];
+      point_endomorphism(&split_bases[num_split + 1], bases[i]);
+      if (k_neg[0]) fe_negate(split_bases[num_split].Y, split_bases[num_split].Y);
+      if (k_neg[1]) fe_negate(split_bases[num_split + 1].Y, split_bases[num_split + 1].Y);
+
+      num_split += 2;
+    }
+  }
+
+  if (num_split > 0)
+  {
+    if (num_split >= PIPPENGER_MIN_COUNT) points_multi_mul_pippenger(&temp, split_bases, split_exp_bytes, GLV_HALF_BYTES, num_split);
+    else points_multi_mul_straus(&temp, split_bases, split_exp_bytes, GLV_HALF_BYTES, num_split);
+
+    point_add_vartime(&acc, &acc, &temp);
+  }
+
+  *result = acc;
+
+  free(split_bases);
+  free(split_exp_bytes);
+  bn_ctx_release(bn_ctx);
+}
+
+/**
+ *  Computes initial * base^exp. If initial == NULL, assume identity. If initial and base are set, exp==NULL means exp=1
+ */
+void group_operation (gr_elem_t result, const gr_elem_t initial, const gr_elem_t base, const scalar_t exp, const ec_group_t ec)
+{
+  if (!base)
+  {
+    point_set_infinity(result);
+    return;
+  }
+
+  point_t temp;
+
+  if (!exp) temp = *base;
+  else if (base == ec->generator) group_generator_mul(&temp, exp, ec);
+  else point_mul(&temp, base, exp);
+
+  if (initial) point_add(result, initial, &temp);
+  else *result = temp;
+
+  OPENSSL_cleanse(&temp, sizeof(temp));
+}
+
+int group_elem_equal (const gr_elem_t a, const gr_elem_t b, const ec_group_t ec)
+{
+  (void) ec;
+
+  if (a->is_infinity || b->is_infinity) return a->is_infinity == b->is_infinity;
+
+  // Compare X_a*Z_b^2 == X_b*Z_a^2 and Y_a*Z_b^3 == Y_b*Z_a^3
+  fe_t Za_2, Zb_2, lhs, rhs;
+  fe_sqr(Za_2, a->Z);
+  fe_sqr(Zb_2, b->Z);
+  fe_mul(lhs, a->X, Zb_2);
+  fe_mul(rhs, b->X, Za_2);
+  if (!fe_equal(lhs, rhs)) return 0;
+
+  fe_mul(Za_2, Za_2, a->Z);
+  fe_mul(Zb_2, Zb_2, b->Z);
+  fe_mul(lhs, a->Y, Zb_2);
+  fe_mul(rhs, b->Y, Za_2);
+  return fe_equal(lhs, rhs);
+}
+
+int group_elem_is_ident (const gr_elem_t a, const ec_group_t ec)
+{
+  (void) ec;
+  return a->is_infinity == 1;
+}
+
+void group_elem_get_affine (scalar_t x, scalar_t y, const gr_elem_t point, const ec_group_t ec)
+{
+  (void) ec;
+
+  if (point->is_infinity)
+  {
+    if (x) BN_zero(x);
+    if (y) BN_zero(y);
+    return;
+  }
+
+  fe_t x_fe;
+  fe_t y_fe;
+  uint8_t bytes[FIELD_BYTES];
+  point_get_affine(x_fe, y_fe, point);
+
+  fe_to_bytes(bytes, x_fe);
+  if (x) BN_bin2bn(bytes, FIELD_BYTES, x);
+  fe_to_bytes(bytes, y_fe);
+  if (y) BN_bin2bn(bytes, FIELD_BYTES, y);
+}
+
+void group_elem_get_x (scalar_t x, const gr_elem_t point, const ec_group_t ec, scalar_t modulus)
+{
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
+  group_elem_get_affine(x, NULL, point, ec);
+  BN_mod(x, x, modulus, bn_ctx);
+  bn_ctx_release(bn_ctx);
+}
+
+#endif
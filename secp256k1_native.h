@@ -0,0 +1,32 @@
+/**
+ *
+ *  Name:
+ *  secp256k1_native
+ *
+ *  Description:
+ *  Native secp256k1 field and group arithmetic, used as the backend of gr_elem_t instead of openssl EC_POINT when built with NATIVE_SECP256K1.
+ *  Field elements are 4x64-bit limbs (kept fully reduced modulo p), points are in Jacobian coordinates (affine when Z=1).
+ *  Variable-base multiplications use the GLV endomorphism lambda*(x,y) = (beta*x,y), splitting each exponent into two ~128-bit halves.
+ *  Also implements order_scalar_t arithmetic (modulo the group order, Montgomery multiplication), which is built regardless of NATIVE_SECP256K1.
+ *
+ *  Usage:
+ *  Build with "make NATIVE_SECP256K1=1". Not used directly, implements the ec group and group element functions of algebraic_elements.h.
+ *  Multiplications by (secret) exponents use constant-time table lookups and point additions/doublings (special cases selected by cmov),
+ *  but the GLV decomposition is done by BIGNUM arithmetic and isn't constant-time. group_multi_exp and group_generator_mul_vartime are variable time.
+ *
+ */
+
+#ifndef __CMP20_ECDSA_MPC_SECP256K1_NATIVE_H__
+#define __CMP20_ECDSA_MPC_SECP256K1_NATIVE_H__
+
+#include <stdint.h>
+
+typedef struct
+{
+  uint64_t X[4];
+  uint64_t Y[4];
+  uint64_t Z[4];
+  uint64_t is_infinity;
+} secp256k1_point_t;
+
+#endif
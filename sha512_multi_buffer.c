@@ -0,0 +1,175 @@
+#include "sha512_multi_buffer.h"
+
+#include <string.h>
+#include <openssl/sha.h>
+
+#define BLOCK_BYTES 128
+#define LANES 8
+// A batch costs about as much as 5-6 messages by openssl's (single buffer, AVX2) implementation, so less lanes are hashed by it
+#define MIN_LANES 6
+
+#if defined(__x86_64__) && defined(__GNUC__)
+
+#include <immintrin.h>
+
+static const uint64_t SHA512_K[80] = {
+  0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL, 0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+  0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL, 0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+  0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL, 0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+  0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL, 0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+  0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL, 0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+  0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL, 0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+  0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL, 0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+  0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL, 0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+  0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL, 0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+  0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL, 0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
+};
+
+static const uint64_t SHA512_IV[8] = {
+  0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+  0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+static uint64_t num_blocks (uint64_t msg_len)
+{
+  // Message, 0x80 byte and 128-bit length
+  return (msg_len + 1 + 16 + BLOCK_BYTES - 1) / BLOCK_BYTES;
+}
+
+static uint64_t load_be64 (const uint8_t *bytes)
+{
+  uint64_t word = 0;
+  for (int i = 0; i < 8; ++i) word = (word << 8) | bytes[i];
+  return word;
+}
+
+// Message words of (padded) block of message, by block index
+static void load_block_words (uint64_t words[16], const uint8_t *msg, uint64_t msg_len, uint64_t block)
+{
+  uint8_t padded[BLOCK_BYTES];
+  uint64_t block_start = block * BLOCK_BYTES;
+
+  if (block_start + BLOCK_BYTES <= msg_len)
+  {
+    for (int t = 0; t < 16; ++t) words[t] = load_be64(msg + block_start + 8*t);
+    return;
+  }
+
+  memset(padded, 0, BLOCK_BYTES);
+  if (block_start < msg_len) memcpy(padded, msg + block_start, msg_len - block_start);
+  if (block_start <= msg_len) padded[msg_len - block_start] = 0x80;
+  if (block == num_blocks(msg_len) - 1)
+  {
+    uint64_t bit_len = msg_len * 8;
+    for (int i = 0; i < 8; ++i) padded[BLOCK_BYTES - 1 - i] = (uint8_t) (bit_len >> (8*i));
+    padded[BLOCK_BYTES - 9] = (uint8_t) ((msg_len >> 61) & 0x07);
+  }
+
+  for (int t = 0; t < 16; ++t) words[t] = load_be64(padded + 8*t);
+}
+
+static void store_digest (uint8_t *digest, const uint64_t state[8])
+{
+  for (int i = 0; i < 8; ++i)
+    for (int b = 0; b < 8; ++b) digest[8*i + b] = (uint8_t) (state[i] >> (56 - 8*b));
+}
+
+#define AVX512_TARGET __attribute__((target("avx512f")))
+
+#define ROR8(x, n)    _mm512_ror_epi64((x), (n))
+#define ADD8(x, y)    _mm512_add_epi64((x), (y))
+#define XOR3_8(x,y,z) _mm512_ternarylogic_epi64((x), (y), (z), 0x96)
+
+AVX512_TARGET
+static void sha512_x8 (uint8_t *digests, const uint8_t *const *msgs, const uint64_t *msg_lens, uint64_t lanes)
+{
+  uint64_t lane_blocks[LANES] = {0};
+  uint64_t max_blocks = 0;
+  for (uint64_t l = 0; l < lanes; ++l)
+  {
+    lane_blocks[l] = num_blocks(msg_lens[l]);
+    if (lane_blocks[l] > max_blocks) max_blocks = lane_blocks[l];
+  }
+
+  __m512i state[8];
+  for (int i = 0; i < 8; ++i) state[i] = _mm512_set1_epi64(SHA512_IV[i]);
+
+  uint64_t words[16][LANES] = {{0}};
+  uint64_t lane_words[16];
+
+  for (uint64_t block = 0; block < max_blocks; ++block)
+  {
+    __mmask8 active = 0;
+    for (uint64_t l = 0; l < lanes; ++l)
+    {
+      if (block >= lane_blocks[l]) continue;
+      active |= 1 << l;
+      load_block_words(lane_words, msgs[l], msg_lens[l], block);
+      for (int t = 0; t < 16; ++t) words[t][l] = lane_words[t];
+    }
+
+    __m512i w[16];
+    for (int t = 0; t < 16; ++t) w[t] = _mm512_loadu_si512(words[t]);
+
+    __m512i a = state[0], b = state[1], c = state[2], d = state[3], e = state[4], f = state[5], g = state[6], h = state[7];
+
+    for (int t = 0; t < 80; ++t)
+    {
+      if (t >= 16)
+      {
+        __m512i w_15 = w[(t - 15) & 15];
+        __m512i w_2  = w[(t - 2) & 15];
+        __m512i s_0 = XOR3_8(ROR8(w_15, 1), ROR8(w_15, 8), _mm512_srli_epi64(w_15, 7));
+        __m512i s_1 = XOR3_8(ROR8(w_2, 19), ROR8(w_2, 61), _mm512_srli_epi64(w_2, 6));
+        w[t & 15] = ADD8(ADD8(w[t & 15], s_0), ADD8(w[(t - 7) & 15], s_1));
+      }
+
+      __m512i sigma_1 = XOR3_8(ROR8(e, 14), ROR8(e, 18), ROR8(e, 41));
+      __m512i ch      = _mm512_ternarylogic_epi64(e, f, g, 0xCA);
+      __m512i temp_1  = ADD8(ADD8(h, sigma_1), ADD8(ch, ADD8(_mm512_set1_epi64(SHA512_K[t]), w[t & 15])));
+      __m512i sigma_0 = XOR3_8(ROR8(a, 28), ROR8(a, 34), ROR8(a, 39));
+      __m512i maj     = _mm512_ternarylogic_epi64(a, b, c, 0xE8);
+      __m512i temp_2  = ADD8(sigma_0, maj);
+
+      h = g; g = f; f = e; e = ADD8(d, temp_1);
+      d = c; c = b; b = a; a = ADD8(temp_1, temp_2);
+    }
+
+    __m512i vars[8] = {a, b, c, d, e, f, g, h};
+    for (int i = 0; i < 8; ++i) state[i] = _mm512_mask_add_epi64(state[i], active, state[i], vars[i]);
+  }
+
+  uint64_t lane_state[8][LANES];
+  for (int i = 0; i < 8; ++i) _mm512_storeu_si512(lane_state[i], state[i]);
+  for (uint64_t l = 0; l < lanes; ++l)
+  {
+    uint64_t final_state[8];
+    for (int i = 0; i < 8; ++i) final_state[i] = lane_state[i][l];
+    store_digest(digests + l * SHA512_MULTI_BUFFER_DIGEST_BYTES, final_state);
+  }
+}
+
+void sha512_multi_buffer (uint8_t *digests, const uint8_t *const *msgs, const uint64_t *msg_lens, uint64_t count)
+{
+  __builtin_cpu_init();
+  int use_x8 = __builtin_cpu_supports("avx512f");
+
+  uint64_t i = 0;
+  while (use_x8 && count - i >= MIN_LANES)
+  {
+    uint64_t lanes = count - i < LANES ? count - i : LANES;
+    sha512_x8(digests + i * SHA512_MULTI_BUFFER_DIGEST_BYTES, msgs + i, msg_lens + i, lanes);
+    i += lanes;
+  }
+
+  for (; i < count; ++i) SHA512(msgs[i], msg_lens[i], digests + i * SHA512_MULTI_BUFFER_DIGEST_BYTES);
+}
+
+#else
+
+void sha512_multi_buffer (uint8_t *digests, const uint8_t *const *msgs, const uint64_t *msg_lens, uint64_t count)
+{
+  for (uint64_t i = 0; i < count; ++i) SHA512(msgs[i], msg_lens[i], digests + i * SHA512_MULTI_BUFFER_DIGEST_BYTES);
+}
+
+#endif
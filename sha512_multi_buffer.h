@@ -0,0 +1,26 @@
+/**
+ *
+ *  Name:
+ *  sha512_multi_buffer
+ *
+ *  Description:
+ *  Multi-buffer SHA-512: independent messages (of any lengths) hashed together, one message per SIMD lane (8 lanes, AVX-512).
+ *  Lanes whose message has less blocks are masked out of the state update, so every message gets exactly its own SHA-512 digest.
+ *
+ *  Usage:
+ *  Used by the batch fiat-shamir functions of zkp_common. Without AVX-512 at runtime (or for few messages), falls back to openssl SHA512 on each message.
+ *  Built optimized, SIMD code is enabled by target attributes only on its functions, so the rest of the object runs on any x86-64.
+ *
+ */
+
+#ifndef __CMP20_ECDSA_MPC_SHA512_MULTI_BUFFER_H__
+#define __CMP20_ECDSA_MPC_SHA512_MULTI_BUFFER_H__
+
+#include <stdint.h>
+
+#define SHA512_MULTI_BUFFER_DIGEST_BYTES 64
+
+// digests[i] (SHA512_MULTI_BUFFER_DIGEST_BYTES each, consecutive) = SHA512(msgs[i]) for i < count
+void sha512_multi_buffer (uint8_t *digests, const uint8_t *const *msgs, const uint64_t *msg_lens, uint64_t count);
+
+#endif
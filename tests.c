@@ -1,6 +1,13 @@
 #include <openssl/rand.h>
+#include <openssl/sha.h>
 #include "tests.h"
+#include "sha512_multi_buffer.h"
 #include "cmp_protocol.h"
+#include "cmp_keystore.h"
+#include "multi_lane_exp.h"
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 void test_scalars(const scalar_t range, uint64_t range_byte_len)
 {
@@ -44,6 +51,132 @@ void test_scalars(const scalar_t range, uint64_t range_byte_len)
   printBIGNUM("# ", gamma, " ==\n");
   printf("mod_inverse(alpha_s,range)\n");
 
+  BN_CTX *bn_ctx = BN_CTX_new();
+
+  // Each batch inverse matches single inverse, and batch[i] * batch_inv[i] == 1 (mod range)
+  scalar_t batch[2] = {alpha, beta};
+  scalar_t batch_inv[2] = {scalar_new(), scalar_new()};
+  scalar_batch_inv(batch_inv, batch, 2, range);
+  int batch_inv_matches = 1;
+  for (int i = 0; i < 2; ++i)
+  {
+    scalar_inv(gamma, batch[i], range);
+    batch_inv_matches &= scalar_equal(batch_inv[i], gamma);
+    BN_mod_mul(gamma, batch[i], batch_inv[i], range, bn_ctx);
+    batch_inv_matches &= BN_is_one(gamma);
+  }
+  assert(batch_inv_matches);
+  printf("# batch inverse matches: %d\n", batch_inv_matches);
+  scalar_free(batch_inv[0]);
+  scalar_free(batch_inv[1]);
+
+  // Distinct bases and exponents (beta + i, alpha_s + i), each checked against BN_mod_exp
+  scalar_t batch_bases[5];
+  scalar_t batch_exps[5];
+  scalar_t batch_exp[5];
+  for (int i = 0; i < 5; ++i)
+  {
+    batch_bases[i] = scalar_new();
+    batch_exps[i] = scalar_new();
+    batch_exp[i] = scalar_new();
+    BN_add_word(BN_copy(batch_bases[i], beta), i);
+    BN_add_word(BN_copy(batch_exps[i], alpha), i);
+  }
+  scalar_exp_batch(batch_exp, batch_bases, batch_exps, 5, range, NULL);
+  int batch_exp_matches = 1;
+  for (int i = 0; i < 5; ++i)
+  {
+    scalar_exp(gamma, batch_bases[i], batch_exps[i], range);
+    batch_exp_matches &= scalar_equal(batch_exp[i], gamma);
+    if (!BN_is_negative(batch_exps[i]))
+    {
+      BN_mod_exp(gamma, batch_bases[i], batch_exps[i], range, bn_ctx);
+      batch_exp_matches &= scalar_equal(batch_exp[i], gamma);
+    }
+  }
+  assert(batch_exp_matches);
+  printf("# batch exponentiation matches: %d\n", batch_exp_matches);
+
+  // Multi exponentiation (constant-time with bound above and below exponents' length, and vartime) against product of single exponentiations
+  scalar_t expected = scalar_new();
+  BN_one(expected);
+  for (int i = 0; i < 5; ++i) BN_mod_mul(expected, expected, batch_exp[i], range, bn_ctx);
+  scalar_multi_exp(gamma, batch_bases, batch_exps, 5, BN_num_bits(range) + 64, range, NULL);
+  assert(scalar_equal(gamma, expected));
+  scalar_multi_exp(gamma, batch_bases, batch_exps, 5, 1, range, NULL);
+  assert(scalar_equal(gamma, expected));
+  scalar_multi_exp_vartime(gamma, batch_bases, batch_exps, 5, range, NULL);
+  assert(scalar_equal(gamma, expected));
+
+  // Negative exponent of non-invertible base fails (both variants)
+  scalar_t zero_base = scalar_new();
+  scalar_t minus_one = scalar_new();
+  BN_one(minus_one);
+  BN_set_negative(minus_one, 1);
+  assert(scalar_multi_exp(gamma, &zero_base, &minus_one, 1, BN_num_bits(range), range, NULL) == 1);
+  assert(scalar_multi_exp_vartime(gamma, &zero_base, &minus_one, 1, range, NULL) == 1);
+  BN_set_negative(minus_one, 0);
+  assert(scalar_multi_exp(gamma, &zero_base, &minus_one, 1, BN_num_bits(range), range, NULL) == 0);
+  assert(BN_is_zero(gamma));
+  scalar_free(zero_base);
+  scalar_free(minus_one);
+  printf("# multi exponentiation matches: %d\n", 1);
+
+  // Fixed-base tables (also read back from bytes), constant-time and vartime, against BN_mod_exp (absolute exponents)
+  fixed_base_t tables[2];
+  tables[0] = scalar_fixed_base_new(batch_bases[0], BN_num_bits(range) + 8, range);
+  uint64_t table_byte_len;
+  scalar_fixed_base_to_bytes(NULL, &table_byte_len, NULL, BN_num_bits(range) + 8, BN_num_bytes(range), 0);
+  uint8_t *table_bytes = malloc(table_byte_len);
+  scalar_fixed_base_to_bytes(&table_bytes, &table_byte_len, tables[0], BN_num_bits(range) + 8, BN_num_bytes(range), 0);
+  tables[1] = NULL;
+  scalar_fixed_base_from_bytes(&tables[1], &table_bytes, &table_byte_len, BN_num_bits(range) + 8, range, BN_num_bytes(range), 0);
+  free(table_bytes);
+
+  scalar_t fixed_exps[2] = {batch_exps[1], batch_exps[2]};
+  BN_set_negative(fixed_exps[0], 0);
+  BN_set_negative(fixed_exps[1], 0);
+  BN_mod_exp(expected, batch_bases[0], fixed_exps[0], range, bn_ctx);
+  BN_mod_exp(gamma, batch_bases[0], fixed_exps[1], range, bn_ctx);
+  BN_mod_mul(expected, expected, gamma, range, bn_ctx);
+  assert(scalar_fixed_base_multi_exp(gamma, tables, fixed_exps, 2) == 0);
+  assert(scalar_equal(gamma, expected));
+  assert(scalar_fixed_base_multi_exp_vartime(gamma, tables, fixed_exps, 2) == 0);
+  assert(scalar_equal(gamma, expected));
+  BN_zero(fixed_exps[1]);
+  assert(scalar_fixed_base_multi_exp(gamma, &tables[1], &fixed_exps[1], 1) == 0);
+  assert(BN_is_one(gamma));
+  printf("# fixed-base exponentiation matches: %d\n", 1);
+
+  // Fixed exponent recoding (window sizes by length) of 1, 2^200, 2^300-1, |alpha_s| and a 2048-bit exponent, against BN_mod_exp
+  scalar_t fixed_exps_rec[5];
+  for (uint64_t e = 0; e < 5; ++e) fixed_exps_rec[e] = scalar_new();
+  BN_one(fixed_exps_rec[0]);
+  scalar_set_power_of_2(fixed_exps_rec[1], 200);
+  scalar_set_power_of_2(fixed_exps_rec[2], 300);
+  BN_sub_word(fixed_exps_rec[2], 1);
+  BN_copy(fixed_exps_rec[3], alpha);
+  BN_set_negative(fixed_exps_rec[3], 0);
+  BN_rand(fixed_exps_rec[4], 2048, BN_RAND_TOP_ONE, BN_RAND_BOTTOM_ANY);
+
+  for (uint64_t e = 0; e < 5; ++e)
+  {
+    fixed_exp_t recoding = scalar_fixed_exp_new(fixed_exps_rec[e]);
+    scalar_exp_fixed_exp(gamma, beta, recoding, range, NULL);
+    BN_mod_exp(expected, beta, fixed_exps_rec[e], range, bn_ctx);
+    assert(scalar_equal(gamma, expected));
+    scalar_fixed_exp_free(recoding);
+    scalar_free(fixed_exps_rec[e]);
+  }
+  printf("# fixed exponent recoding matches: %d\n", 1);
+  scalar_fixed_base_free(tables[0]);
+  scalar_fixed_base_free(tables[1]);
+  scalar_free(expected);
+
+  for (int i = 0; i < 5; ++i) scalar_free(batch_bases[i]);
+  for (int i = 0; i < 5; ++i) scalar_free(batch_exps[i]);
+  BN_CTX_free(bn_ctx);
+  for (int i = 0; i < 5; ++i) scalar_free(batch_exp[i]);
 
   free(alpha_bytes);
   scalar_free(gamma);
@@ -51,13 +184,35 @@ void test_scalars(const scalar_t range, uint64_t range_byte_len)
   scalar_free(beta);
 }
 
+// Returns whether el equals generator^exp computed by OpenSSL (EC_POINT_mul), compared by encoding
+static int equals_reference_generator_mul (const gr_elem_t el, const scalar_t exp, const ec_group_t ec)
+{
+  BN_CTX *bn_ctx = BN_CTX_new();
+  EC_POINT *expected = EC_POINT_new(ec->group);
+  EC_POINT_mul(ec->group, expected, exp, NULL, NULL, bn_ctx);
+
+  int equal = group_elem_is_ident(el, ec);
+  if (!EC_POINT_is_at_infinity(ec->group, expected))
+  {
+    uint8_t expected_bytes[GROUP_ELEMENT_BYTES];
+    uint8_t el_bytes[GROUP_ELEMENT_BYTES];
+    uint8_t *write_bytes = el_bytes;
+    EC_POINT_point2oct(ec->group, expected, POINT_CONVERSION_COMPRESSED, expected_bytes, GROUP_ELEMENT_BYTES, bn_ctx);
+    group_elem_to_bytes(&write_bytes, GROUP_ELEMENT_BYTES, el, ec, 0);
+    equal = !equal && (memcmp(expected_bytes, el_bytes, GROUP_ELEMENT_BYTES) == 0);
+  }
+
+  EC_POINT_free(expected);
+  BN_CTX_free(bn_ctx);
+  return equal;
+}
+
 void test_group_elements()
 {
   printf("# test_group_elements\n");
   printf("import secp256k1\n");
 
   ec_group_t ec = ec_group_new();
-  BN_CTX *bn_ctx = BN_CTX_secure_new();
 
   scalar_t exps[2];
   exps[0] = scalar_new();
@@ -76,11 +231,9 @@ void test_group_elements()
   group_operation(el[0], NULL, (const gr_elem_t) ec_group_generator(ec), exps[0], ec);
   
   gr_elem_t p = el[0];
-  uint64_t p_byte_len = EC_POINT_point2oct(ec, p, (POINT_CONVERSION_COMPRESSED), NULL, 0, bn_ctx);
+  uint64_t p_byte_len = GROUP_ELEMENT_BYTES;
   uint8_t *p_bytes = calloc(p_byte_len, 1);
-  printf("point2oct = %ld, p_bytes = %lu\n",
-  EC_POINT_point2oct(ec, p, ( POINT_CONVERSION_COMPRESSED), p_bytes, p_byte_len, bn_ctx),
-  p_byte_len);
+  group_elem_to_bytes(&p_bytes, p_byte_len, p, ec, 0);
   printHexBytes("p_bytes = ", p_bytes, p_byte_len, "\n", 1);
   
   gr_elem_t q = group_elem_new(ec);
@@ -88,16 +241,17 @@ void test_group_elements()
   printECPOINT("# q = ", q, ec, "\n", 0);
 
   printHexBytes("p_bytes = ", p_bytes, p_byte_len, "\n", 1);
-  printf("oct2point %d\n",  EC_POINT_oct2point(ec, q, p_bytes, p_byte_len, bn_ctx));
+  printf("from_bytes error %d\n",  group_elem_from_bytes(q, &p_bytes, p_byte_len, ec, 0));
   printECPOINT("# q = ", q, ec, "\n", 0);
 
   group_operation(q, NULL, NULL, NULL, ec);
   memset(p_bytes, 0x01, 1);
   printHexBytes("p_bytes = ", p_bytes, p_byte_len, "\n", 1);
-  printf("oct2point %d\n",  EC_POINT_oct2point(ec, q, p_bytes, p_byte_len, bn_ctx));
+  printf("from_bytes error %d\n",  group_elem_from_bytes(q, &p_bytes, p_byte_len, ec, 0));
   printECPOINT("# q = ", q, ec, "\n", 0);
 
   group_elem_free(q);
+  free(p_bytes);
 
   
   printECPOINT("# el[0] = ", el[0], ec, "\n", 0);
@@ -106,7 +260,78 @@ void test_group_elements()
   group_operation(el[1], NULL, (const gr_elem_t) ec_group_generator(ec), exps[1], ec);  
   printECPOINT("# el[1] = ", el[1], ec, "\n", 0);
   printf("el[1] = G * exps[1]\n");
-  
+
+  // Copy of generator isn't recognized as generator, so computed without generator table
+  group_elem_copy(el[2], ec_group_generator(ec));
+  group_operation_vartime(el[2], NULL, el[2], exps[1], ec);
+  assert(group_elem_equal(el[1], el[2], ec));
+  printf("generator table vs generic multiplication: %d\n", group_elem_equal(el[1], el[2], ec));
+
+  // Generator multiplication (constant-time, table and multi exponentiation) on edge cases: 0, 1, n-1, n, n+1, -1 and random
+  scalar_t edge_exps[7];
+  for (uint64_t i = 0; i < 7; ++i) edge_exps[i] = scalar_new();
+  scalar_set_ul(edge_exps[0], 0);
+  scalar_set_ul(edge_exps[1], 1);
+  BN_sub(edge_exps[2], ec_group_order(ec), BN_value_one());
+  BN_copy(edge_exps[3], ec_group_order(ec));
+  BN_add(edge_exps[4], ec_group_order(ec), BN_value_one());
+  BN_set_word(edge_exps[5], 1);
+  BN_set_negative(edge_exps[5], 1);
+  BN_copy(edge_exps[6], exps[0]);
+
+  gr_elem_t gen = ec_group_generator(ec);
+  for (uint64_t i = 0; i < 7; ++i)
+  {
+    group_generator_mul(el[2], edge_exps[i], ec);
+    assert(equals_reference_generator_mul(el[2], edge_exps[i], ec));
+    group_generator_mul_vartime(el[2], edge_exps[i], ec);
+    assert(equals_reference_generator_mul(el[2], edge_exps[i], ec));
+    group_operation(el[2], NULL, gen, edge_exps[i], ec);
+    assert(equals_reference_generator_mul(el[2], edge_exps[i], ec));
+    group_operation_vartime(el[2], NULL, gen, edge_exps[i], ec);
+    assert(equals_reference_generator_mul(el[2], edge_exps[i], ec));
+    group_multi_exp(el[2], &gen, &edge_exps[i], 1, ec);
+    assert(equals_reference_generator_mul(el[2], edge_exps[i], ec));
+  }
+  printf("# generator multiplication matches EC_POINT_mul on edge cases\n");
+
+  // Other base (GLV split in native backend): el[0]^e = generator^(exps[0]*e), for edge cases, around (q-1)/2 and random e
+  BN_CTX *bn_ctx = BN_CTX_new();
+  scalar_t product = scalar_new();
+  for (uint64_t i = 0; i < 7 + 3 + 64; ++i)
+  {
+    scalar_t e = edge_exps[6];
+    if (i < 7) e = edge_exps[i];
+    else if (i < 10)
+    {
+      BN_rshift1(e, ec_group_order(ec));
+      BN_add_word(e, i - 7);
+    }
+    else scalar_sample_in_range(e, ec_group_order(ec), 0);
+
+    BN_mod_mul(product, exps[0], e, ec_group_order(ec), bn_ctx);
+    group_operation(el[2], NULL, el[0], e, ec);
+    assert(equals_reference_generator_mul(el[2], product, ec));
+    group_operation_vartime(el[2], NULL, el[0], e, ec);
+    assert(equals_reference_generator_mul(el[2], product, ec));
+  }
+  scalar_free(product);
+  BN_CTX_free(bn_ctx);
+  BN_copy(edge_exps[6], exps[0]);
+  printf("# multiplication of other base matches EC_POINT_mul on edge cases\n");
+
+  // Addition special cases: el[0] + G^exps[0] (doubling) and el[0] + G^-exps[0] (identity)
+  BN_lshift1(edge_exps[0], exps[0]);
+  group_operation(el[2], el[0], gen, exps[0], ec);
+  assert(equals_reference_generator_mul(el[2], edge_exps[0], ec));
+  BN_copy(edge_exps[0], exps[0]);
+  BN_set_negative(edge_exps[0], 1);
+  group_operation(el[2], el[0], gen, edge_exps[0], ec);
+  assert(group_elem_is_ident(el[2], ec));
+  group_operation(el[2], el[2], gen, exps[0], ec);
+  assert(group_elem_equal(el[2], el[0], ec));
+  for (uint64_t i = 0; i < 7; ++i) scalar_free(edge_exps[i]);
+
   group_operation(el[2], el[0], el[1],(const scalar_t) BN_value_one(), ec);
   printECPOINT("# results = ", el[2], ec, "\n", 0);
   printf("el[0] + el[1]\n");
@@ -120,6 +345,264 @@ void test_group_elements()
   group_elem_free(el[0]);
   group_elem_free(el[1]);
   group_elem_free(el[2]);
+  ec_group_free(ec);
+}
+
+// BN_mod_exp of base^|exp|, inverted for negative exp
+static void plain_signed_exp (scalar_t result, const scalar_t base, const scalar_t exp, const scalar_t modulus, BN_CTX *bn_ctx)
+{
+  scalar_t abs_exp = scalar_new();
+  BN_copy(abs_exp, exp);
+  BN_set_negative(abs_exp, 0);
+  BN_mod_exp(result, base, abs_exp, modulus, bn_ctx);
+  if (BN_is_negative(exp)) BN_mod_inverse(result, result, modulus, bn_ctx);
+  scalar_free(abs_exp);
+}
+
+void test_multi_lane_exp()
+{
+  printf("# test_multi_lane_exp (IFMA available: %d)\n", multi_lane_exp_available());
+
+  BN_CTX *bn_ctx = BN_CTX_new();
+  scalar_t modulus = scalar_new();
+  scalar_t expected = scalar_new();
+  scalar_t bases[MULTI_LANE_EXP_LANES];
+  scalar_t exps[MULTI_LANE_EXP_LANES];
+  scalar_t results[MULTI_LANE_EXP_LANES];
+  for (uint64_t l = 0; l < MULTI_LANE_EXP_LANES; ++l)
+  {
+    bases[l] = scalar_new();
+    exps[l] = scalar_new();
+    results[l] = scalar_new();
+  }
+
+  // Odd moduli (also of a length not multiple of limbs), lanes of distinct bases and exponents of distinct lengths, including edge bases and exponents
+  uint64_t modulus_bits[3] = {255, 1031, 2048};
+  for (uint64_t m = 0; m < 3; ++m)
+  {
+    BN_rand(modulus, modulus_bits[m], BN_RAND_TOP_ONE, BN_RAND_BOTTOM_ODD);
+    for (uint64_t l = 0; l < MULTI_LANE_EXP_LANES; ++l)
+    {
+      scalar_sample_in_range(bases[l], modulus, 0);
+      BN_rand(exps[l], 2 * modulus_bits[m] - 37 * l, BN_RAND_TOP_ANY, BN_RAND_BOTTOM_ANY);
+    }
+    BN_zero(bases[1]);
+    BN_sub(bases[2], modulus, BN_value_one());
+    BN_zero(exps[3]);
+    BN_one(exps[4]);
+    BN_set_negative(exps[5], 1);
+    BN_set_negative(exps[6], 1);
+    while (!scalar_coprime(bases[5], modulus)) scalar_sample_in_range(bases[5], modulus, 0);
+    while (!scalar_coprime(bases[6], modulus)) scalar_sample_in_range(bases[6], modulus, 0);
+
+    // Multi-lane engine directly (absolute exponents) for any number of lanes
+    if (multi_lane_exp_available())
+    {
+      for (uint64_t count = 1; count <= MULTI_LANE_EXP_LANES; ++count)
+      {
+        multi_lane_exp(results, bases, exps, count, modulus);
+        for (uint64_t l = 0; l < count; ++l)
+        {
+          BN_copy(expected, exps[l]);
+          BN_set_negative(expected, 0);
+          BN_mod_exp(expected, bases[l], expected, modulus, bn_ctx);
+          assert(scalar_equal(results[l], expected));
+        }
+      }
+    }
+
+    // Batch exponentiation (signed exponents): multi-lane with at least MULTI_LANE_EXP_MIN_LANES, separate exponentiations below (fallback)
+    uint64_t counts[2] = {MULTI_LANE_EXP_MIN_LANES - 1, MULTI_LANE_EXP_LANES};
+    for (uint64_t c = 0; c < 2; ++c)
+    {
+      // Zero base has no inverse, not used with negative exponents
+      BN_one(bases[1]);
+      scalar_exp_batch(results, bases, exps, counts[c], modulus, NULL);
+      for (uint64_t l = 0; l < counts[c]; ++l)
+      {
+        plain_signed_exp(expected, bases[l], exps[l], modulus, bn_ctx);
+        assert(scalar_equal(results[l], expected));
+      }
+    }
+  }
+  printf("# multi-lane exponentiation matches BN_mod_exp: %d\n", 1);
+
+  for (uint64_t l = 0; l < MULTI_LANE_EXP_LANES; ++l)
+  {
+    scalar_free(bases[l]);
+    scalar_free(exps[l]);
+    scalar_free(results[l]);
+  }
+  scalar_free(modulus);
+  scalar_free(expected);
+  BN_CTX_free(bn_ctx);
+}
+
+void test_bn_ctx_pool()
+{
+  printf("# test_bn_ctx_pool\n");
+
+  #define BN_CTX_POOL_TEST_VALUES 100
+
+  // Frames larger than the secure pool make it grow (freed and recreated), until the pool holds them
+  BIGNUM *values[BN_CTX_POOL_TEST_VALUES];
+  BN_CTX *bn_ctx;
+  for (uint64_t round = 0; round < 4; ++round)
+  {
+    bn_ctx = bn_ctx_acquire(1);
+    for (uint64_t i = 0; i < BN_CTX_POOL_TEST_VALUES; ++i)
+    {
+      values[i] = BN_CTX_get(bn_ctx);
+      BN_set_word(values[i], i + 1);
+      BN_lshift(values[i], values[i], 1000);
+    }
+    bn_ctx_release(bn_ctx);
+  }
+
+  // Pool kept (same values handed out again), and released values were cleared
+  int cleared = 1;
+  for (uint64_t i = 0; i < BN_CTX_POOL_TEST_VALUES; ++i) cleared &= BN_is_zero(values[i]);
+  assert(cleared);
+
+  bn_ctx = bn_ctx_acquire(1);
+  BN_CTX *nested_ctx = bn_ctx_acquire(1);
+  assert(nested_ctx == bn_ctx);
+  int reused = 1;
+  for (uint64_t i = 0; i < BN_CTX_POOL_TEST_VALUES; ++i) reused &= (BN_CTX_get(nested_ctx) == values[i]);
+  assert(reused);
+  bn_ctx_release(nested_ctx);
+  bn_ctx_release(bn_ctx);
+  printf("# secure pool kept and cleared on outermost release: %d\n", cleared && reused);
+}
+
+void test_order_scalars()
+{
+  printf("# test_order_scalars\n");
+
+  ec_group_t ec = ec_group_new();
+  const scalar_t order = ec_group_order(ec);
+  BN_CTX *bn_ctx = BN_CTX_new();
+
+  #define NUM_ORDER_TERMS 4
+  scalar_t k = scalar_new();
+  scalar_t gamma = scalar_new();
+  scalar_t x = scalar_new();
+  scalar_t msg = scalar_new();
+  scalar_t r = scalar_new();
+  scalar_t alpha[NUM_ORDER_TERMS];
+  scalar_t beta[NUM_ORDER_TERMS];
+  scalar_t expected = scalar_new();
+  scalar_t expected_chi = scalar_new();
+  scalar_t temp = scalar_new();
+  scalar_t result = scalar_new();
+
+  scalar_sample_in_range(k, order, 0);
+  scalar_sample_in_range(gamma, order, 0);
+  scalar_sample_in_range(x, order, 0);
+  scalar_sample_in_range(msg, order, 0);
+  scalar_sample_in_range(r, order, 0);
+
+  // Presign shares come as wide and negative values (alpha ~ Paillier plaintexts, beta signed)
+  scalar_t wide_range = scalar_new();
+  scalar_set_power_of_2(wide_range, 8*PAILLIER_MODULUS_BYTES);
+  for (uint64_t i = 0; i < NUM_ORDER_TERMS; ++i)
+  {
+    alpha[i] = scalar_new();
+    beta[i] = scalar_new();
+    scalar_sample_in_range(alpha[i], wide_range, 0);
+    scalar_sample_in_range(beta[i], wide_range, 0);
+    scalar_make_signed(beta[i], wide_range);
+  }
+
+  order_scalar_t k_i, delta_i, chi_i, term;
+
+  // delta = gamma*k + sum(alpha) - sum(beta), chi = x*k + sum(alpha) - sum(beta), as in presign round 3
+  order_scalar_from_scalar(k_i, k);
+  order_scalar_from_scalar(term, gamma);
+  order_scalar_mul(delta_i, term, k_i);
+  order_scalar_from_scalar(term, x);
+  order_scalar_mul(chi_i, term, k_i);
+  BN_mod_mul(expected, gamma, k, order, bn_ctx);
+  BN_mod_mul(expected_chi, x, k, order, bn_ctx);
+
+  for (uint64_t i = 0; i < NUM_ORDER_TERMS; ++i)
+  {
+    order_scalar_from_scalar(term, alpha[i]);
+    order_scalar_add(delta_i, delta_i, term);
+    order_scalar_add(chi_i, chi_i, term);
+    order_scalar_from_scalar(term, beta[i]);
+    order_scalar_sub(delta_i, delta_i, term);
+    order_scalar_sub(chi_i, chi_i, term);
+
+    BN_mod_add(expected, expected, alpha[i], order, bn_ctx);
+    BN_mod_sub(expected, expected, beta[i], order, bn_ctx);
+    BN_mod_add(expected_chi, expected_chi, alpha[i], order, bn_ctx);
+    BN_mod_sub(expected_chi, expected_chi, beta[i], order, bn_ctx);
+  }
+
+  order_scalar_to_scalar(result, delta_i);
+  assert(scalar_equal(result, expected));
+  order_scalar_to_scalar(result, chi_i);
+  assert(scalar_equal(result, expected_chi));
+  printf("# delta and chi match BN_mod_*: 1\n");
+
+  // sigma = k*msg + chi*r, as in signing round 1
+  order_scalar_from_scalar(term, msg);
+  order_scalar_mul(delta_i, k_i, term);
+  order_scalar_from_scalar(term, r);
+  order_scalar_mul(chi_i, chi_i, term);
+  order_scalar_add(delta_i, delta_i, chi_i);
+  order_scalar_to_scalar(result, delta_i);
+
+  BN_mod_mul(expected, k, msg, order, bn_ctx);
+  BN_mod_mul(temp, expected_chi, r, order, bn_ctx);
+  BN_mod_add(expected, expected, temp, order, bn_ctx);
+  assert(scalar_equal(result, expected));
+  printf("# sigma matches BN_mod_*: 1\n");
+
+  // Inverse, and reduction of 0, n-1, n and -1
+  order_scalar_inv(term, k_i);
+  order_scalar_to_scalar(result, term);
+  BN_mod_inverse(expected, k, order, bn_ctx);
+  assert(scalar_equal(result, expected));
+
+  BN_zero(temp);
+  order_scalar_from_scalar(term, temp);
+  order_scalar_to_scalar(result, term);
+  assert(BN_is_zero(result));
+
+  BN_sub(temp, order, BN_value_one());
+  order_scalar_from_scalar(term, temp);
+  order_scalar_to_scalar(result, term);
+  assert(scalar_equal(result, temp));
+
+  order_scalar_from_scalar(term, order);
+  order_scalar_to_scalar(result, term);
+  assert(BN_is_zero(result));
+
+  BN_set_word(temp, 1);
+  BN_set_negative(temp, 1);
+  order_scalar_from_scalar(term, temp);
+  order_scalar_to_scalar(result, term);
+  BN_sub(expected, order, BN_value_one());
+  assert(scalar_equal(result, expected));
+  printf("# inverse and edge reductions match: 1\n");
+
+  order_scalar_clear(k_i);
+  order_scalar_clear(delta_i);
+  order_scalar_clear(chi_i);
+  order_scalar_clear(term);
+  for (uint64_t i = 0; i < NUM_ORDER_TERMS; ++i) { scalar_free(alpha[i]); scalar_free(beta[i]); }
+  scalar_free(wide_range);
+  scalar_free(k);
+  scalar_free(gamma);
+  scalar_free(x);
+  scalar_free(msg);
+  scalar_free(r);
+  scalar_free(expected);
+  scalar_free(expected_chi);
+  scalar_free(temp);
+  scalar_free(result);
   BN_CTX_free(bn_ctx);
   ec_group_free(ec);
 }
@@ -152,7 +635,24 @@ void test_paillier_operations(const paillier_private_key_t *priv)
 
   assert(BN_cmp(plaintext, decrypted) == 0);
 
+  // Plain formula (1 + plaintext*N) * randomness^N mod N^2
+  scalar_t private_cipher = scalar_new();
+  BN_mod_exp(private_cipher, randomness, pub->N, pub->N2, bn_ctx);
+  BN_mul(decrypted, plaintext, pub->N, bn_ctx);
+  BN_add_word(decrypted, 1);
+  BN_mod_mul(private_cipher, private_cipher, decrypted, pub->N2, bn_ctx);
+  assert(scalar_equal(private_cipher, ciphertext));
+
+  // Same ciphertexts by CRT under own key
+  paillier_encryption_encrypt_private(private_cipher, plaintext, randomness, priv);
+  assert(scalar_equal(private_cipher, ciphertext));
+  printf("# private encryption matches: %d\n", scalar_equal(private_cipher, ciphertext));
+  paillier_encryption_homomorphic_private(private_cipher, ciphertext, plaintext, ciphertext, priv);
+
   paillier_encryption_homomorphic(ciphertext, ciphertext, plaintext, ciphertext, pub);
+  assert(scalar_equal(private_cipher, ciphertext));
+  printf("# private homomorphic matches: %d\n", scalar_equal(private_cipher, ciphertext));
+  scalar_free(private_cipher);
   printBIGNUM("ciphertext = ", (ciphertext), "\n");
 
   paillier_encryption_decrypt(decrypted, ciphertext, priv);
@@ -164,6 +664,46 @@ void test_paillier_operations(const paillier_private_key_t *priv)
 
   assert(BN_cmp(randomness, decrypted) == 0);
 
+  // Short exponent randomness mode (on copy of the key), public key received as bytes
+  paillier_private_key_t *short_priv = paillier_encryption_private_new();
+  paillier_public_key_t *short_pub = paillier_encryption_public_new();
+  paillier_encryption_copy_keys(short_priv, NULL, priv, NULL);
+  paillier_encryption_short_exp_setup(short_priv);
+  paillier_encryption_copy_keys(NULL, short_pub, short_priv, NULL);
+
+  uint64_t modulus_bytes = BN_num_bytes(pub->N);
+  uint64_t pub_bytelen;
+  paillier_public_to_bytes(NULL, &pub_bytelen, NULL, modulus_bytes, 0);
+  uint8_t *pub_bytes = malloc(pub_bytelen);
+  paillier_public_to_bytes(&pub_bytes, &pub_bytelen, short_pub, modulus_bytes, 0);
+  paillier_public_from_bytes(short_pub, &pub_bytes, &pub_bytelen, modulus_bytes, 0);
+  free(pub_bytes);
+  assert(scalar_equal(short_pub->h_N, short_priv->h_N));
+  printf("# short exponent h_N from bytes matches: %d\n", scalar_equal(short_pub->h_N, short_priv->h_N));
+
+  // h_N = h^N mod N^2
+  scalar_t other_cipher = scalar_new();
+  BN_mod_exp(other_cipher, short_pub->h, short_pub->N, short_pub->N2, bn_ctx);
+  assert(scalar_equal(other_cipher, short_pub->h_N));
+
+  paillier_encryption_sample(randomness, short_pub);
+  printBIGNUM("short exponent = ", (randomness), "\n");
+  paillier_encryption_encrypt(ciphertext, plaintext, randomness, short_pub);
+  paillier_encryption_decrypt(decrypted, ciphertext, short_priv);
+  assert(BN_cmp(plaintext, decrypted) == 0);
+
+  paillier_encryption_encrypt_private(other_cipher, plaintext, randomness, short_priv);
+  assert(scalar_equal(other_cipher, ciphertext));
+  printf("# short exponent private encryption matches: %d\n", scalar_equal(other_cipher, ciphertext));
+
+  // Same as regular encryption with randomness h^x mod N
+  BN_mod_exp(randomness, short_pub->h, randomness, short_pub->N, bn_ctx);
+  paillier_encryption_encrypt(other_cipher, plaintext, randomness, pub);
+  assert(scalar_equal(other_cipher, ciphertext));
+  printf("# short exponent matches regular encryption with h^x: %d\n", scalar_equal(other_cipher, ciphertext));
+  scalar_free(other_cipher);
+
+  paillier_encryption_free_keys(short_priv, short_pub);
   paillier_encryption_free_keys(NULL, pub);
   scalar_free(plaintext);
   scalar_free(randomness);
@@ -172,6 +712,262 @@ void test_paillier_operations(const paillier_private_key_t *priv)
   BN_CTX_free(bn_ctx);
 }
 
+void test_paillier_rand_pool(const paillier_private_key_t *priv)
+{
+  printf("# test_paillier_rand_pool\n");
+
+  #define RAND_POOL_TEST_DEPTH 4
+  #define RAND_POOL_TEST_SAMPLES (3 * RAND_POOL_TEST_DEPTH)
+
+  // Pool on own copies of the keys, reference public key without pool
+  paillier_private_key_t *pool_priv = paillier_encryption_private_new();
+  paillier_public_key_t *pool_pub = paillier_encryption_public_new();
+  paillier_public_key_t *ref_pub = paillier_encryption_public_new();
+  paillier_encryption_copy_keys(pool_priv, NULL, priv, NULL);
+  paillier_encryption_copy_keys(NULL, pool_pub, pool_priv, NULL);
+  paillier_encryption_copy_keys(NULL, ref_pub, pool_priv, NULL);
+
+  paillier_encryption_pool_start(pool_pub, pool_priv, RAND_POOL_TEST_DEPTH, 1, 2);
+  for (uint64_t wait = 0; (wait < 10000) && (paillier_encryption_pool_available(pool_pub) < RAND_POOL_TEST_DEPTH); ++wait) usleep(1000);
+  printf("# pool available: %lu\n", paillier_encryption_pool_available(pool_pub));
+  assert(paillier_encryption_pool_available(pool_pub) == RAND_POOL_TEST_DEPTH);
+
+  scalar_t plaintext = scalar_new();
+  scalar_t ciphertext = scalar_new();
+  scalar_t expected = scalar_new();
+  scalar_t rho[RAND_POOL_TEST_SAMPLES];
+  scalar_t plaintexts[RAND_POOL_TEST_SAMPLES];
+  scalar_t ciphertexts[RAND_POOL_TEST_SAMPLES];
+  scalar_sample_in_range(plaintext, pool_pub->N, 0);
+
+  // More samples than depth: oldest taken pairs are dropped, and the pool may run empty (fresh sampling)
+  for (uint64_t i = 0; i < RAND_POOL_TEST_SAMPLES; ++i)
+  {
+    rho[i] = scalar_new();
+    plaintexts[i] = plaintext;
+    ciphertexts[i] = scalar_new();
+    paillier_encryption_sample(rho[i], pool_pub);
+  }
+
+  // Each rho by pool (public and private encryption), then reused after it left the taken list, against the reference key
+  for (uint64_t i = 0; i < RAND_POOL_TEST_SAMPLES; ++i)
+  {
+    paillier_encryption_encrypt(expected, plaintext, rho[i], ref_pub);
+
+    if (i % 2) paillier_encryption_encrypt(ciphertext, plaintext, rho[i], pool_pub);
+    else paillier_encryption_encrypt_private(ciphertext, plaintext, rho[i], pool_priv);
+    assert(scalar_equal(ciphertext, expected));
+
+    paillier_encryption_encrypt(ciphertext, plaintext, rho[i], pool_pub);
+    assert(scalar_equal(ciphertext, expected));
+    paillier_encryption_encrypt_private(ciphertext, plaintext, rho[i], pool_priv);
+    assert(scalar_equal(ciphertext, expected));
+  }
+
+  // Batch encryptions of pooled rho
+  for (uint64_t i = 0; i < RAND_POOL_TEST_SAMPLES; ++i) paillier_encryption_sample(rho[i], pool_pub);
+  paillier_encryption_encrypt_batch(ciphertexts, plaintexts, rho, RAND_POOL_TEST_SAMPLES / 2, pool_pub);
+  paillier_encryption_encrypt_private_batch(ciphertexts + RAND_POOL_TEST_SAMPLES / 2, plaintexts, rho + RAND_POOL_TEST_SAMPLES / 2, RAND_POOL_TEST_SAMPLES / 2, pool_priv);
+  for (uint64_t i = 0; i < RAND_POOL_TEST_SAMPLES; ++i)
+  {
+    paillier_encryption_encrypt(expected, plaintext, rho[i], ref_pub);
+    assert(scalar_equal(ciphertexts[i], expected));
+  }
+  printf("# pooled encryptions (also reused and dropped rho, batches) match: %d\n", 1);
+
+  paillier_encryption_pool_stop(pool_pub);
+  assert(paillier_encryption_pool_available(pool_pub) == 0);
+
+  for (uint64_t i = 0; i < RAND_POOL_TEST_SAMPLES; ++i) { scalar_free(rho[i]); scalar_free(ciphertexts[i]); }
+  scalar_free(plaintext);
+  scalar_free(ciphertext);
+  scalar_free(expected);
+  paillier_encryption_free_keys(pool_priv, pool_pub);
+  paillier_encryption_free_keys(NULL, ref_pub);
+}
+
+void test_paillier_aggregated_decryption(const paillier_private_key_t *priv)
+{
+  printf("# test_paillier_aggregated_decryption\n");
+
+  #define AGGREGATE_TEST_COUNT 8
+
+  BN_CTX *bn_ctx = bn_ctx_acquire(0);
+  scalar_t k = BN_CTX_get(bn_ctx);
+  scalar_t gamma = BN_CTX_get(bn_ctx);
+  scalar_t beta = BN_CTX_get(bn_ctx);
+  scalar_t K = BN_CTX_get(bn_ctx);
+  scalar_t rho = BN_CTX_get(bn_ctx);
+  scalar_t range = BN_CTX_get(bn_ctx);
+  scalar_t expected = BN_CTX_get(bn_ctx);
+  scalar_t separate = BN_CTX_get(bn_ctx);
+  scalar_t aggregated = BN_CTX_get(bn_ctx);
+  scalar_t decrypted = BN_CTX_get(bn_ctx);
+
+  paillier_public_key_t *pub = paillier_encryption_public_new();
+  paillier_encryption_copy_keys(NULL, pub, priv, NULL);
+
+  // Plaintexts of D_j as in presign: k*gamma_j + beta_j with signed k in +-2^(8I), gamma_j in [0, 2^(8|q|)), signed beta_j in +-2^(8J). Extreme negative k and first beta_j, all but last beta_j negative, so the sum is negative.
+  // Ranges shrink to fit the sum in +-N/2 for small test moduli (2^(8J) is above N of 1024 bits), 3 bits for the sum of count terms and 2 for N/2 and the k*gamma_j term.
+  uint64_t sum_bits = BN_num_bits(pub->N) - 5;
+  uint64_t beta_bits = (8*CALIGRAPHIC_J_ZKP_RANGE_BYTES < sum_bits ? 8*CALIGRAPHIC_J_ZKP_RANGE_BYTES : sum_bits);
+  uint64_t k_bits = (8*CALIGRAPHIC_I_ZKP_RANGE_BYTES + 8*GROUP_ORDER_BYTES < sum_bits ? 8*CALIGRAPHIC_I_ZKP_RANGE_BYTES : sum_bits - 8*GROUP_ORDER_BYTES);
+  assert(sum_bits > 8*GROUP_ORDER_BYTES);
+
+  scalar_t D[AGGREGATE_TEST_COUNT];
+  BN_zero(range);
+  BN_set_bit(range, k_bits);
+  BN_sub_word(range, 1);
+  BN_copy(k, range);
+  BN_set_negative(k, 1);
+  paillier_encryption_sample(rho, pub);
+  BN_nnmod(decrypted, k, pub->N, bn_ctx);
+  paillier_encryption_encrypt(K, decrypted, rho, pub);
+
+  BN_zero(expected);
+  BN_zero(separate);
+  for (uint64_t i = 0; i < AGGREGATE_TEST_COUNT; ++i)
+  {
+    D[i] = scalar_new();
+    BN_zero(range);
+    BN_set_bit(range, 8*GROUP_ORDER_BYTES);
+    scalar_sample_in_range(gamma, range, 0);
+    BN_zero(range);
+    BN_set_bit(range, beta_bits);
+    if (i == 0)
+    {
+      BN_sub_word(range, 1);
+      BN_copy(beta, range);
+    }
+    else scalar_sample_in_range(beta, range, 0);
+    BN_set_negative(beta, i != AGGREGATE_TEST_COUNT - 1);
+
+    BN_mul(decrypted, k, gamma, bn_ctx);
+    BN_add(decrypted, decrypted, beta);
+    BN_add(expected, expected, decrypted);
+
+    // D_j = K^gamma_j * Enc(beta_j)
+    paillier_encryption_sample(rho, pub);
+    BN_nnmod(decrypted, beta, pub->N, bn_ctx);
+    paillier_encryption_encrypt(D[i], decrypted, rho, pub);
+    paillier_encryption_homomorphic(D[i], K, gamma, D[i], pub);
+
+    paillier_encryption_decrypt(decrypted, D[i], priv);
+    scalar_make_signed(decrypted, pub->N);
+    BN_add(separate, separate, decrypted);
+  }
+  assert(BN_is_negative(expected));
+
+  paillier_encryption_decrypt_sum(aggregated, D, AGGREGATE_TEST_COUNT, priv);
+  scalar_make_signed(aggregated, pub->N);
+  assert(BN_cmp(separate, expected) == 0);
+  assert(BN_cmp(aggregated, separate) == 0);
+  printf("# aggregated signed alpha equals sum of separate decryptions: %d\n", BN_cmp(aggregated, separate) == 0);
+
+  // Reshares in [0, q), sum below N
+  BN_zero(separate);
+  BN_zero(range);
+  BN_set_bit(range, 8*GROUP_ORDER_BYTES);
+  for (uint64_t i = 0; i < AGGREGATE_TEST_COUNT; ++i)
+  {
+    scalar_sample_in_range(decrypted, range, 0);
+    BN_add(separate, separate, decrypted);
+    paillier_encryption_sample(rho, pub);
+    paillier_encryption_encrypt(D[i], decrypted, rho, pub);
+  }
+  paillier_encryption_decrypt_sum(aggregated, D, AGGREGATE_TEST_COUNT, priv);
+  assert(BN_cmp(aggregated, separate) == 0);
+
+  // Single and no ciphertext
+  paillier_encryption_decrypt_sum(aggregated, D, 1, priv);
+  paillier_encryption_decrypt(decrypted, D[0], priv);
+  assert(BN_cmp(aggregated, decrypted) == 0);
+  paillier_encryption_decrypt_sum(aggregated, D, 0, priv);
+  assert(BN_is_zero(aggregated));
+  printf("# aggregated reshares equal sum of separate decryptions: %d\n", 1);
+
+  for (uint64_t i = 0; i < AGGREGATE_TEST_COUNT; ++i) scalar_free(D[i]);
+  paillier_encryption_free_keys(NULL, pub);
+  bn_ctx_release(bn_ctx);
+}
+
+void test_prime_generation(uint64_t bits)
+{
+  printf("# test_prime_generation\n");
+
+  #define PRIME_GEN_TEST_COUNT 4
+
+  BN_CTX *bn_ctx = bn_ctx_acquire(0);
+  scalar_t q = BN_CTX_get(bn_ctx);
+  scalar_t p_squared = BN_CTX_get(bn_ctx);
+  scalar_t exp = BN_CTX_get(bn_ctx);
+  scalar_t result = BN_CTX_get(bn_ctx);
+  scalar_t two = BN_CTX_get(bn_ctx);
+  BN_set_word(two, 2);
+
+  prime_gen_job_t jobs[2 * PRIME_GEN_TEST_COUNT];
+  for (uint64_t i = 0; i < 2 * PRIME_GEN_TEST_COUNT; ++i)
+  {
+    jobs[i].prime = scalar_new();
+    jobs[i].bits = bits;
+    jobs[i].kind = (i < PRIME_GEN_TEST_COUNT ? PRIME_KIND_SAFE : PRIME_KIND_BLUM);
+  }
+  prime_generate_batch(jobs, 2 * PRIME_GEN_TEST_COUNT, 4);
+
+  // Single worker (sieved search isn't cancelled by other workers)
+  prime_generate(jobs[0].prime, bits, PRIME_KIND_SAFE, 1);
+
+  for (uint64_t i = 0; i < 2 * PRIME_GEN_TEST_COUNT; ++i)
+  {
+    const scalar_t p = jobs[i].prime;
+    assert((uint64_t) BN_num_bits(p) == bits);
+    assert(BN_check_prime(p, bn_ctx, NULL) == 1);
+
+    if (jobs[i].kind == PRIME_KIND_BLUM)
+    {
+      assert(BN_mod_word(p, 4) == 3);
+      continue;
+    }
+
+    // Sieved safe prime: top two bits set, q = (p-1)/2 prime, and Pocklington's condition for p-1 = 2q: q^2 > p, 2^(p-1) = 1 mod p, gcd(2^2-1, p) = 1
+    assert(BN_is_bit_set(p, bits - 2));
+    BN_rshift1(q, p);
+    assert(BN_check_prime(q, bn_ctx, NULL) == 1);
+    BN_sqr(p_squared, q, bn_ctx);
+    assert(BN_cmp(p_squared, p) > 0);
+    BN_sub(exp, p, BN_value_one());
+    BN_mod_exp(result, two, exp, p, bn_ctx);
+    assert(BN_is_one(result));
+    assert(BN_mod_word(p, 3) != 0);
+  }
+  printf("# %d safe primes (sieved, q and p prime, Pocklington's condition) and %d blum primes of %lu bits: %d\n", PRIME_GEN_TEST_COUNT, PRIME_GEN_TEST_COUNT, bits, 1);
+
+  for (uint64_t i = 0; i < 2 * PRIME_GEN_TEST_COUNT; ++i) scalar_free(jobs[i].prime);
+  bn_ctx_release(bn_ctx);
+}
+
+// Plain s^s_exp * t^t_exp mod N by BN_mod_exp (negative exponent by inverse of result)
+static void plain_ring_pedersen_commit (scalar_t result, const scalar_t s_exp, const scalar_t t_exp, const ring_pedersen_public_t *rped_pub, BN_CTX *bn_ctx)
+{
+  scalar_t abs_exp = scalar_new();
+  scalar_t t_part = scalar_new();
+
+  BN_copy(abs_exp, s_exp);
+  BN_set_negative(abs_exp, 0);
+  BN_mod_exp(result, rped_pub->s, abs_exp, rped_pub->N, bn_ctx);
+  if (BN_is_negative(s_exp)) BN_mod_inverse(result, result, rped_pub->N, bn_ctx);
+
+  BN_copy(abs_exp, t_exp);
+  BN_set_negative(abs_exp, 0);
+  BN_mod_exp(t_part, rped_pub->t, abs_exp, rped_pub->N, bn_ctx);
+  if (BN_is_negative(t_exp)) BN_mod_inverse(t_part, t_part, rped_pub->N, bn_ctx);
+
+  BN_mod_mul(result, result, t_part, rped_pub->N, bn_ctx);
+
+  scalar_free(abs_exp);
+  scalar_free(t_part);
+}
+
 void test_ring_pedersen(const scalar_t p, const scalar_t q) 
 {
   printf("# test_ring_pedersen\n");
@@ -191,9 +987,15 @@ void test_ring_pedersen(const scalar_t p, const scalar_t q)
   scalar_t s_exp = scalar_new();
   scalar_t t_exp = scalar_new();
   scalar_t rped_com = scalar_new();
+  scalar_t expected = scalar_new();
+
+  // N = p*q and s = t^lam
+  BN_mul(expected, p, q, bn_ctx);
+  assert(scalar_equal(expected, rped_pub->N));
+  BN_mod_exp(expected, rped_pub->t, rped_priv->lam, rped_pub->N, bn_ctx);
+  assert(scalar_equal(expected, rped_pub->s));
   
   scalar_sample_in_range(s_exp, rped_pub->N, 0);
-  // scalar_make_signed(s_exp, rped_pub->N);
   printBIGNUM("s_exp = ", (s_exp), "\n");
 
   scalar_sample_in_range(t_exp, rped_pub->N, 0);
@@ -201,11 +1003,54 @@ void test_ring_pedersen(const scalar_t p, const scalar_t q)
 
   ring_pedersen_commit(rped_com, s_exp, t_exp, rped_pub);
   printBIGNUM("rped_com = ", (rped_com), "\n");
+  plain_ring_pedersen_commit(expected, s_exp, t_exp, rped_pub, bn_ctx);
+  assert(scalar_equal(rped_com, expected));
+
+  // Negative exponents, by multi exponentiation and then via fixed-base tables (constant-time and vartime), and exponent too long for tables
+  scalar_make_signed(t_exp, rped_pub->N);
+  BN_set_negative(s_exp, 1);
+  plain_ring_pedersen_commit(expected, s_exp, t_exp, rped_pub, bn_ctx);
+
+  ring_pedersen_commit(rped_com, s_exp, t_exp, rped_pub);
+  assert(scalar_equal(rped_com, expected));
+  ring_pedersen_commit_vartime(rped_com, s_exp, t_exp, rped_pub);
+  assert(scalar_equal(rped_com, expected));
+
+  // Tables shorter than the bound of commitment exponents (vartime uses them, constant-time falls back)
+  ring_pedersen_public_precompute(rped_pub, BN_num_bits(rped_pub->N));
+  ring_pedersen_commit(rped_com, s_exp, t_exp, rped_pub);
+  assert(scalar_equal(rped_com, expected));
+  ring_pedersen_commit_vartime(rped_com, s_exp, t_exp, rped_pub);
+  assert(scalar_equal(rped_com, expected));
+
+  // Tables covering the bound (used by both), for negative, mixed sign and zero exponents
+  ring_pedersen_public_precompute(rped_pub, 8*RING_PED_COMMIT_EXP_BYTES);
+  for (int sign_case = 0; sign_case < 3; ++sign_case)
+  {
+    if (sign_case == 1) BN_set_negative(s_exp, 0);
+    if (sign_case == 2) BN_zero(t_exp);
+    plain_ring_pedersen_commit(expected, s_exp, t_exp, rped_pub, bn_ctx);
+    ring_pedersen_commit(rped_com, s_exp, t_exp, rped_pub);
+    assert(scalar_equal(rped_com, expected));
+    ring_pedersen_commit_vartime(rped_com, s_exp, t_exp, rped_pub);
+    assert(scalar_equal(rped_com, expected));
+  }
+
+  // Exponent beyond the tables
+  BN_set_bit(s_exp, 8*RING_PED_COMMIT_EXP_BYTES + 8);
+  BN_set_negative(s_exp, 1);
+  plain_ring_pedersen_commit(expected, s_exp, t_exp, rped_pub, bn_ctx);
+  ring_pedersen_commit(rped_com, s_exp, t_exp, rped_pub);
+  assert(scalar_equal(rped_com, expected));
+  ring_pedersen_commit_vartime(rped_com, s_exp, t_exp, rped_pub);
+  assert(scalar_equal(rped_com, expected));
+  printf("# rped_com matches BN_mod_exp commitment (multi exponentiation, fixed-base tables, too long for tables): 1\n");
 
   ring_pedersen_free_param(rped_priv, rped_pub);
   scalar_free(s_exp);
   scalar_free(t_exp);
   scalar_free(rped_com);
+  scalar_free(expected);
   BN_CTX_free(bn_ctx);
 }
 
@@ -254,6 +1099,80 @@ void test_fiat_shamir(uint64_t digest_len, uint64_t data_len)
     printf("#(%d bits = %d bytes)\n", BN_num_bits(num[i]), BN_num_bytes(num[i]));
   }
 
+  // Batch of different data (prefixes of data), each must match its own single scalar
+  #define NUM_BATCH 9
+  scalar_t batch_res[NUM_BATCH];
+  scalar_t batch_ranges[NUM_BATCH];
+  const uint8_t *batch_data[NUM_BATCH];
+  uint64_t batch_data_len[NUM_BATCH];
+  for (uint64_t i = 0; i < NUM_BATCH; ++i)
+  {
+    batch_res[i] = scalar_new();
+    batch_ranges[i] = range;
+    batch_data[i] = data;
+    batch_data_len[i] = data_len * (i + 1) / NUM_BATCH;
+  }
+  fiat_shamir_scalars_in_range_batch(batch_res, batch_ranges, batch_data, batch_data_len, NUM_BATCH);
+
+  int batch_matches = 1;
+  for (uint64_t i = 0; i < NUM_BATCH; ++i)
+  {
+    fiat_shamir_scalars_in_range(num, 1, range, batch_data[i], batch_data_len[i]);
+    batch_matches &= scalar_equal(num[0], batch_res[i]);
+    scalar_free(batch_res[i]);
+  }
+  assert(batch_matches);
+  printf("# batch scalars match: %d\n", batch_matches);
+
+#if FIAT_SHAMIR_XOF
+  // Known answer: output blocks are SHA512(seed || le64 counter) with seed = SHA512(data). Data "abc", first block pinned, then 3 blocks (last partial) by the formula.
+  static const char *xof_kat_block_0 = "0c0311fc532156eecac393cc88ccc025f13aa5d94c43f0ee9832c34d5b26daa7ded35932da2ac7f13f0223004da75cd1bd87727fcf5005c2a4d9a2db49bf2657";
+  uint8_t xof_expected[3 * SHA512_DIGEST_LENGTH];
+  uint8_t xof_digest[3 * SHA512_DIGEST_LENGTH - 7];
+  uint8_t xof_block_input[SHA512_DIGEST_LENGTH + sizeof(uint64_t)];
+  SHA512((const uint8_t *) "abc", 3, xof_block_input);
+  for (uint64_t ctr = 0; ctr < 3; ++ctr)
+  {
+    for (uint64_t i = 0; i < sizeof(uint64_t); ++i) xof_block_input[SHA512_DIGEST_LENGTH + i] = (uint8_t) (ctr >> (8*i));
+    SHA512(xof_block_input, sizeof(xof_block_input), xof_expected + ctr * SHA512_DIGEST_LENGTH);
+  }
+  for (uint64_t i = 0; i < SHA512_DIGEST_LENGTH; ++i)
+  {
+    unsigned int byte;
+    sscanf(xof_kat_block_0 + 2*i, "%2x", &byte);
+    assert(xof_expected[i] == byte);
+  }
+  fiat_shamir_bytes(xof_digest, sizeof(xof_digest), (const uint8_t *) "abc", 3);
+  assert(memcmp(xof_digest, xof_expected, sizeof(xof_digest)) == 0);
+  printf("# fiat-shamir XOF known answer matches: %d\n", 1);
+#endif
+
+  // Multi-buffer SHA-512 (full and partial lane groups, lengths around block and padding boundaries) against SHA512 on each message
+  #define NUM_SHA_MSGS 19
+  static const uint64_t sha_msg_lens[NUM_SHA_MSGS] = {0, 1, 55, 111, 112, 113, 127, 128, 129, 239, 240, 255, 256, 257, 500, 1000, 1024, 3, 2048};
+  const uint8_t *sha_msgs[NUM_SHA_MSGS];
+  uint8_t *sha_data = malloc(2048);
+  RAND_bytes(sha_data, 2048);
+  for (uint64_t i = 0; i < NUM_SHA_MSGS; ++i) sha_msgs[i] = sha_data + (i % 7);
+
+  for (uint64_t count = 1; count <= NUM_SHA_MSGS; count += 6)
+  {
+    uint8_t *sha_digests = malloc(count * SHA512_MULTI_BUFFER_DIGEST_BYTES);
+    uint64_t lens[NUM_SHA_MSGS];
+    for (uint64_t i = 0; i < count; ++i) lens[i] = (sha_msg_lens[i] + (i % 7) <= 2048 ? sha_msg_lens[i] : 2048 - (i % 7));
+    sha512_multi_buffer(sha_digests, sha_msgs, lens, count);
+
+    for (uint64_t i = 0; i < count; ++i)
+    {
+      uint8_t expected[SHA512_DIGEST_LENGTH];
+      SHA512(sha_msgs[i], lens[i], expected);
+      assert(memcmp(sha_digests + i * SHA512_MULTI_BUFFER_DIGEST_BYTES, expected, SHA512_DIGEST_LENGTH) == 0);
+    }
+    free(sha_digests);
+  }
+  printf("# multi-buffer SHA-512 matches SHA512: %d\n", 1);
+  free(sha_data);
+
   scalar_free(range);
   for (uint64_t i = 0; i < NUM_REPS; ++i) { scalar_free(num[i]);} 
   free(data);
@@ -323,6 +1242,7 @@ void test_zkp_encryption_in_range(paillier_public_key_t *paillier_pub, ring_pede
   zkp_encryption_in_range_proof_t *proof = zkp_encryption_in_range_new();
   zkp_encryption_in_range_public_t public;
   zkp_encryption_in_range_secret_t secret;
+  secret.paillier_priv = NULL;
   
   ec_group_t G = ec_group_new();
 
@@ -354,6 +1274,21 @@ void test_zkp_encryption_in_range(paillier_public_key_t *paillier_pub, ring_pede
   zkp_encryption_in_range_prove(proof, &secret, &public, aux);
   printf("# 1 == %d : valid \n", zkp_encryption_in_range_verify(proof, &public, aux));
 
+  // Non-invertible commitments (S^{-e} doesn't exist), would pass s^z_1 * t^z_3 * S^{-e} == C if the failed inversion is ignored
+  scalar_t saved_S = scalar_new();
+  scalar_t saved_C = scalar_new();
+  scalar_copy(saved_S, proof->S);
+  scalar_copy(saved_C, proof->C);
+  BN_zero(proof->S);
+  BN_zero(proof->C);
+  int is_forged_verified = zkp_encryption_in_range_verify(proof, &public, aux);
+  printf("# 0 == %d : zero S and C\n", is_forged_verified);
+  assert(!is_forged_verified);
+  scalar_copy(proof->S, saved_S);
+  scalar_copy(proof->C, saved_C);
+  scalar_free(saved_S);
+  scalar_free(saved_C);
+
   BN_add_word(secret.k, 1);
   zkp_encryption_in_range_prove(proof, &secret, &public, aux);
   printf("# 0 == %d : wrong secret.k\n", zkp_encryption_in_range_verify(proof, &public, aux));
@@ -433,6 +1368,37 @@ void execute_refresh_and_aux_info (cmp_party_t *party)
   cmp_refresh_aux_info_clean(party);
 }
 
+// Saves party to keystore and returns a new party loaded from it (as after restart), party is freed
+cmp_party_t *execute_keystore_restart (cmp_party_t *party, const char *keystore_path, const uint8_t *keystore_key)
+{
+  struct timespec time_start, time_end;
+
+  clock_gettime(CLOCK_MONOTONIC, &time_start);
+  assert(cmp_keystore_save(party, keystore_path, keystore_key) == 0);
+  clock_gettime(CLOCK_MONOTONIC, &time_end);
+
+  struct stat st;
+  stat(keystore_path, &st);
+  printf("### Keystore saved to %s.\t>>> %lu B, %.2f ms\n", keystore_path, (uint64_t) st.st_size,
+    (time_end.tv_sec - time_start.tv_sec) * 1000.0 + (time_end.tv_nsec - time_start.tv_nsec) / 1000000.0);
+
+  cmp_party_t *loaded = cmp_party_new(party->index, party->num_parties, party->parties_ids, party->sid);
+  loaded->prime_pool = party->prime_pool;
+
+  clock_gettime(CLOCK_MONOTONIC, &time_start);
+  assert(cmp_keystore_load(loaded, keystore_path, keystore_key) == 0);
+  clock_gettime(CLOCK_MONOTONIC, &time_end);
+
+  printf("### Keystore loaded (restart to ready to presign).\t>>> %.2f ms\n",
+    (time_end.tv_sec - time_start.tv_sec) * 1000.0 + (time_end.tv_nsec - time_start.tv_nsec) / 1000000.0);
+
+  assert(memcmp(loaded->sid_hash, party->sid_hash, sizeof(hash_chunk)) == 0);
+  assert(scalar_equal(loaded->secret_x, party->secret_x));
+
+  cmp_party_free(party);
+  return loaded;
+}
+
 void get_public_key(gr_elem_t pubkey, const cmp_party_t *party)
 {
   group_operation(pubkey, NULL, NULL, NULL, party->ec);
@@ -580,7 +1546,7 @@ void execute_schnorr_signing (cmp_party_t *party)
 int PRINT_VALUES;
 int PRINT_SECRETS;
 
-void test_protocol(uint64_t party_index, uint64_t num_parties, int print_values, int print_secrets)
+void test_protocol(uint64_t party_index, uint64_t num_parties, int print_values, int print_secrets, prime_pool_t *prime_pool, const char *keystore_path, const uint8_t *keystore_key)
 {
   PRINT_VALUES = print_values;
   PRINT_SECRETS = print_secrets;
@@ -593,6 +1559,7 @@ void test_protocol(uint64_t party_index, uint64_t num_parties, int print_values,
   
   // Initialize Parties
   cmp_party_t *party = cmp_party_new(party_index, num_parties, party_ids, sid);
+  party->prime_pool = prime_pool;
 
   printf("\n\n### Key Generation\n\n");
   execute_key_generation(party);
@@ -600,6 +1567,12 @@ void test_protocol(uint64_t party_index, uint64_t num_parties, int print_values,
   printf("\n\n### Refrsh and Auxliarty Information\n\n");
   execute_refresh_and_aux_info(party);
 
+  if (keystore_path)
+  {
+    printf("\n\n### Keystore Save and Restart\n\n");
+    party = execute_keystore_restart(party, keystore_path, keystore_key);
+  }
+
   printf("\n\n### ECDSA PreSign\n\n");
   execute_ecdsa_presign(party);
 
@@ -21,13 +21,20 @@
 #define __CMP20_ECDSA_MPC_TESTS_H__
 
 void test_paillier_operations(const paillier_private_key_t *priv);
+void test_paillier_rand_pool(const paillier_private_key_t *priv);
+void test_paillier_aggregated_decryption(const paillier_private_key_t *priv);
+void test_prime_generation(uint64_t bits);
 void test_ring_pedersen(const scalar_t p, const scalar_t q);
-void test_fiat_shamir();
+void test_fiat_shamir(uint64_t digest_len, uint64_t data_len);
 void test_scalars(const scalar_t range, uint64_t range_byte_len);
 void test_group_elements();
+void test_order_scalars();
+void test_bn_ctx_pool();
+void test_multi_lane_exp();
 void test_zkp_schnorr();
 void test_zkp_encryption_in_range(paillier_public_key_t *paillier_pub, ring_pedersen_public_t *rped_pub, uint64_t k_range_bytes);
 
-void test_protocol(uint64_t party_index, uint64_t num_parties, int print_values, int print_secrets);
+// prime_pool (optional) is used for refresh primes. If keystore_path is set, party is saved after refresh and signs after being loaded from it.
+void test_protocol(uint64_t party_index, uint64_t num_parties, int print_values, int print_secrets, prime_pool_t *prime_pool, const char *keystore_path, const uint8_t *keystore_key);
 
 #endif
\ No newline at end of file
@@ -2,11 +2,14 @@
 #include <openssl/sha.h>
 
 #include "zkp_common.h"
+#include "sha512_multi_buffer.h"
 
 /**
  *  Fiat-Shamir / Random Oracle
  */
 
+#if !FIAT_SHAMIR_XOF
+
 #define FS_HALF 32      // Half of SHA512 64 bytes digest
 
 /** 
@@ -19,18 +22,20 @@
 
 static void fiat_shamir_bytes_from_state(uint8_t *digest, uint64_t digest_len, const uint8_t *data, uint64_t data_len, uint8_t state[FS_HALF])
 { 
-  // Initialize RH to state, so the first hash will operate on (state, data).
-  uint8_t *curr_digest = malloc(2*FS_HALF + data_len);
+  uint8_t curr_digest[2*FS_HALF];
   memcpy(curr_digest + FS_HALF, state, FS_HALF);
-  memcpy(curr_digest + 2*FS_HALF, data, data_len);
 
   uint64_t add_curr_digest_bytes;
+  SHA512_CTX sha_ctx;
 
   // Continue until remaining needed digest length is 0
   while (digest_len > 0)
   {  
-    // hash previous (RH,data) to get new (LH, RH)
-    SHA512(curr_digest + FS_HALF, FS_HALF + data_len, curr_digest);
+    // hash previous (RH,data) to get new (LH, RH), data is hashed in place (not copied after RH)
+    SHA512_Init(&sha_ctx);
+    SHA512_Update(&sha_ctx, curr_digest + FS_HALF, FS_HALF);
+    SHA512_Update(&sha_ctx, data, data_len);
+    SHA512_Final(curr_digest, &sha_ctx);
 
     add_curr_digest_bytes = (digest_len < FS_HALF ? digest_len : FS_HALF);
     
@@ -43,16 +48,85 @@ static void fiat_shamir_bytes_from_state(uint8_t *digest, uint64_t digest_len, c
 
   // Keep last RH as state for future calls on same data
   memcpy(state, curr_digest + FS_HALF, FS_HALF);
-  memset(curr_digest, 0, 2*FS_HALF + data_len);
-  free(curr_digest);
+  OPENSSL_cleanse(curr_digest, sizeof(curr_digest));
+  OPENSSL_cleanse(&sha_ctx, sizeof(sha_ctx));
+}
+
+#else
+
+/** 
+ *  XOF mode: data is absorbed once, seed = SHA512(data).
+ *  Output blocks are SHA512(seed, counter) (counter as 8 bytes little-endian), all 64 bytes of each block are used.
+ *  Every squeeze starts from a fresh block (continuing the counter), so successive squeezes on same data give new digests as the state construction above.
+ */
+
+typedef struct
+{
+  uint8_t seed[SHA512_DIGEST_LENGTH];
+  uint64_t counter;
+} fiat_shamir_xof_t;
+
+static void fiat_shamir_xof_init (fiat_shamir_xof_t *xof, const uint8_t seed[SHA512_DIGEST_LENGTH])
+{
+  memcpy(xof->seed, seed, SHA512_DIGEST_LENGTH);
+  xof->counter = 0;
+}
+
+static void fiat_shamir_xof_squeeze (uint8_t *digest, uint64_t digest_len, fiat_shamir_xof_t *xof)
+{
+  uint8_t block_input[SHA512_DIGEST_LENGTH + sizeof(uint64_t)];
+  uint8_t block[SHA512_DIGEST_LENGTH];
+  memcpy(block_input, xof->seed, SHA512_DIGEST_LENGTH);
+
+  while (digest_len > 0)
+  {
+    for (uint64_t i = 0; i < sizeof(uint64_t); ++i) block_input[SHA512_DIGEST_LENGTH + i] = (uint8_t) (xof->counter >> (8*i));
+    xof->counter++;
+    SHA512(block_input, sizeof(block_input), block);
+
+    uint64_t add_bytes = (digest_len < SHA512_DIGEST_LENGTH ? digest_len : SHA512_DIGEST_LENGTH);
+    memcpy(digest, block, add_bytes);
+    digest += add_bytes;
+    digest_len -= add_bytes;
+  }
+
+  OPENSSL_cleanse(block_input, sizeof(block_input));
+  OPENSSL_cleanse(block, sizeof(block));
+}
+
+// Rejection sampling a scalar until fits in range, each try from fresh output
+static void fiat_shamir_xof_scalar_in_range (scalar_t result, const scalar_t range, uint8_t *result_bytes, fiat_shamir_xof_t *xof)
+{
+  uint64_t num_bits = BN_num_bits(range);
+  uint64_t num_bytes = BN_num_bytes(range);
+
+  BN_copy(result, range);
+  while (BN_cmp(result, range) != -1)
+  {
+    fiat_shamir_xof_squeeze(result_bytes, num_bytes, xof);
+    BN_bin2bn(result_bytes, num_bytes, result);
+    BN_mask_bits(result, num_bits);
+  }
 }
 
+#endif
+
 void fiat_shamir_bytes(uint8_t *digest, uint64_t digest_len, const uint8_t *data, uint64_t data_len)
 {
+#if FIAT_SHAMIR_XOF
+  uint8_t seed[SHA512_DIGEST_LENGTH];
+  fiat_shamir_xof_t xof;
+  SHA512(data, data_len, seed);
+  fiat_shamir_xof_init(&xof, seed);
+  fiat_shamir_xof_squeeze(digest, digest_len, &xof);
+  OPENSSL_cleanse(seed, sizeof(seed));
+  OPENSSL_cleanse(&xof, sizeof(xof));
+#else
   // Start from default (agreed upon) state of all zeros
   uint8_t fs_state[FS_HALF] = {0};
   fiat_shamir_bytes_from_state(digest, digest_len, data, data_len, fs_state);
   memset(fs_state, 0, FS_HALF);
+#endif
 }
 
 /** 
@@ -62,12 +136,24 @@ void fiat_shamir_bytes(uint8_t *digest, uint64_t digest_len, const uint8_t *data
 
 void fiat_shamir_scalars_in_range(scalar_t *results, uint64_t num_res, const scalar_t range, const uint8_t *data, uint64_t data_len)
 {
-  uint64_t num_bits = BN_num_bits(range);
   uint64_t num_bytes = BN_num_bytes(range);
+  uint8_t *result_bytes = calloc(num_bytes, 1);
+
+#if FIAT_SHAMIR_XOF
+  uint8_t seed[SHA512_DIGEST_LENGTH];
+  fiat_shamir_xof_t xof;
+  SHA512(data, data_len, seed);
+  fiat_shamir_xof_init(&xof, seed);
+
+  for (uint64_t i_res = 0; i_res < num_res; ++i_res) fiat_shamir_xof_scalar_in_range(results[i_res], range, result_bytes, &xof);
+
+  OPENSSL_cleanse(seed, sizeof(seed));
+  OPENSSL_cleanse(&xof, sizeof(xof));
+#else
+  uint64_t num_bits = BN_num_bits(range);
 
   // Start from default (agreed upon) state of all zeros
   uint8_t fs_state[FS_HALF] = {0};
-  uint8_t *result_bytes = calloc(num_bytes, 1);
 
   for (uint64_t i_res = 0; i_res < num_res; ++i_res)
   {
@@ -85,7 +171,175 @@ void fiat_shamir_scalars_in_range(scalar_t *results, uint64_t num_res, const sca
   }
 
   memset(fs_state, 0, FS_HALF);
+#endif
+
+  free(result_bytes);
+}
+
+#if FIAT_SHAMIR_XOF
+
+/** 
+ *  Same as fiat_shamir_scalars_in_range (single scalar) on each data.
+ *  All data are absorbed together (multi-buffer SHA512), then each scalar is expanded from its own seed.
+ */
+
+void fiat_shamir_scalars_in_range_batch(scalar_t *results, const scalar_t *ranges, const uint8_t *const *data, const uint64_t *data_len, uint64_t count)
+{
+  uint8_t *seeds = malloc(count * SHA512_MULTI_BUFFER_DIGEST_BYTES);
+  sha512_multi_buffer(seeds, data, data_len, count);
+
+  fiat_shamir_xof_t xof;
+  for (uint64_t i = 0; i < count; ++i)
+  {
+    uint8_t *result_bytes = calloc(BN_num_bytes(ranges[i]), 1);
+    fiat_shamir_xof_init(&xof, seeds + i * SHA512_MULTI_BUFFER_DIGEST_BYTES);
+    fiat_shamir_xof_scalar_in_range(results[i], ranges[i], result_bytes, &xof);
+    free(result_bytes);
+  }
+
+  OPENSSL_cleanse(&xof, sizeof(xof));
+  free(seeds);
+}
+
+#else
+
+/** 
+ *  Same as fiat_shamir_scalars_in_range (single scalar) on each data.
+ *  Every iteration hashes (RH,data) of all data which still need bytes together, so each gets the same digests as computed alone.
+ */
+
+void fiat_shamir_scalars_in_range_batch(scalar_t *results, const scalar_t *ranges, const uint8_t *const *data, const uint64_t *data_len, uint64_t count)
+{
+  // Per data: (RH,data) buffer starting from default state of all zeros, result bytes and how many are already collected
+  uint8_t **curr_input    = calloc(count, sizeof(uint8_t *));
+  uint64_t *curr_len      = calloc(count, sizeof(uint64_t));
+  uint8_t **result_bytes  = calloc(count, sizeof(uint8_t *));
+  uint64_t *num_bytes     = calloc(count, sizeof(uint64_t));
+  uint64_t *filled_bytes  = calloc(count, sizeof(uint64_t));
+  uint64_t *pending       = calloc(count, sizeof(uint64_t));
+  const uint8_t **hash_input = calloc(count, sizeof(uint8_t *));
+  uint64_t *hash_len      = calloc(count, sizeof(uint64_t));
+  uint8_t *digests        = malloc(count * SHA512_MULTI_BUFFER_DIGEST_BYTES);
+
+  uint64_t num_pending = count;
+  for (uint64_t i = 0; i < count; ++i)
+  {
+    curr_len[i] = FS_HALF + data_len[i];
+    curr_input[i] = calloc(curr_len[i], 1);
+    memcpy(curr_input[i] + FS_HALF, data[i], data_len[i]);
+
+    num_bytes[i] = BN_num_bytes(ranges[i]);
+    result_bytes[i] = calloc(num_bytes[i], 1);
+    pending[i] = i;
+  }
+
+  while (num_pending > 0)
+  {
+    for (uint64_t p = 0; p < num_pending; ++p)
+    {
+      hash_input[p] = curr_input[pending[p]];
+      hash_len[p] = curr_len[pending[p]];
+    }
+
+    sha512_multi_buffer(digests, hash_input, hash_len, num_pending);
+
+    uint64_t still_pending = 0;
+    for (uint64_t p = 0; p < num_pending; ++p)
+    {
+      uint64_t i = pending[p];
+      uint8_t *digest = digests + p * SHA512_MULTI_BUFFER_DIGEST_BYTES;
+
+      // Collect LH, and keep RH as next state
+      uint64_t add_bytes = (num_bytes[i] - filled_bytes[i] < FS_HALF ? num_bytes[i] - filled_bytes[i] : FS_HALF);
+      memcpy(result_bytes[i] + filled_bytes[i], digest, add_bytes);
+      filled_bytes[i] += add_bytes;
+      memcpy(curr_input[i], digest + FS_HALF, FS_HALF);
+
+      if (filled_bytes[i] == num_bytes[i])
+      {
+        BN_bin2bn(result_bytes[i], num_bytes[i], results[i]);
+        BN_mask_bits(results[i], BN_num_bits(ranges[i]));
+        filled_bytes[i] = 0;
+
+        // Rejection sampling, next scalar continues from last state
+        if (BN_cmp(results[i], ranges[i]) == -1) continue;
+      }
+
+      pending[still_pending++] = i;
+    }
+    num_pending = still_pending;
+  }
+
+  for (uint64_t i = 0; i < count; ++i)
+  {
+    free(curr_input[i]);
+    free(result_bytes[i]);
+  }
+  free(curr_input);
+  free(curr_len);
   free(result_bytes);
+  free(num_bytes);
+  free(filled_bytes);
+  free(pending);
+  free(hash_input);
+  free(hash_len);
+  free(digests);
+}
+
+#endif
+
+/**
+ *  Batched Challenges
+ */
+
+zkp_challenge_batch_t *zkp_challenge_batch_new (uint64_t max_count)
+{
+  zkp_challenge_batch_t *batch = malloc(sizeof(*batch));
+
+  batch->count = 0;
+  batch->max_count = max_count;
+  batch->fs_data = calloc(max_count, sizeof(uint8_t *));
+  batch->fs_data_len = calloc(max_count, sizeof(uint64_t));
+  batch->ranges = calloc(max_count, sizeof(scalar_t));
+  batch->challenges = calloc(max_count, sizeof(scalar_t));
+
+  for (uint64_t i = 0; i < max_count; ++i) batch->challenges[i] = scalar_new();
+
+  return batch;
+}
+
+void zkp_challenge_batch_free (zkp_challenge_batch_t *batch)
+{
+  if (!batch) return;
+
+  for (uint64_t i = 0; i < batch->max_count; ++i)
+  {
+    free(batch->fs_data[i]);
+    scalar_free(batch->challenges[i]);
+  }
+  free(batch->fs_data);
+  free(batch->fs_data_len);
+  free(batch->ranges);
+  free(batch->challenges);
+  free(batch);
+}
+
+uint64_t zkp_challenge_batch_add (zkp_challenge_batch_t *batch, uint8_t *fs_data, uint64_t fs_data_len, const scalar_t range)
+{
+  assert(batch->count < batch->max_count);
+
+  batch->fs_data[batch->count] = fs_data;
+  batch->fs_data_len[batch->count] = fs_data_len;
+  batch->ranges[batch->count] = range;
+
+  return batch->count++;
+}
+
+void zkp_challenge_batch_compute (zkp_challenge_batch_t *batch)
+{
+  fiat_shamir_scalars_in_range_batch(batch->challenges, batch->ranges, (const uint8_t *const *) batch->fs_data, batch->fs_data_len, batch->count);
+
+  for (uint64_t i = 0; i < batch->count; ++i) scalar_make_signed(batch->challenges[i], batch->ranges[i]);
 }
 
 /**
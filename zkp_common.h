@@ -11,6 +11,7 @@
  *  zkp_aux_info_t contains info which is used (hashed) to generate a zkp challenge, this info defines the "session" of a zkp instantiation (but not the data of the zkp).
  *  The user of aux_info should encode the relevant values into bytes to be kept in the structure's info, but can update and extend the initial info bytes.
  *  fiat_shamir_<...> deterministically generates wanted number of pseudo-uniform bytes/scalars in range from an initial public data "seed".
+ *  By default (FIAT_SHAMIR_XOF) data is hashed once, and output is expanded from its digest. The previous construction (rehashing data for each output block) is kept for compatibility.
  * 
  */
 
@@ -23,17 +24,34 @@
 #include "paillier_cryptosystem.h"
 #include "ring_pedersen_parameters.h"
 
+// Refresh derives ring pedersen parameters from the paillier primes (same modulus as paillier key, as in CMP), instead of separate safe primes (can be set at build)
+#ifndef RING_PED_FROM_PAILLIER_PRIMES
+#define RING_PED_FROM_PAILLIER_PRIMES 0
+#endif
+
 #define PAILLIER_MODULUS_BYTES (8*GROUP_ORDER_BYTES)
+#if RING_PED_FROM_PAILLIER_PRIMES
+#define RING_PED_MODULUS_BYTES PAILLIER_MODULUS_BYTES
+#else
 #define RING_PED_MODULUS_BYTES (2*GROUP_ORDER_BYTES)
+#endif
 
 #define STATISTICAL_SECURITY 80
 
+// Fiat-Shamir absorbs data once (SHA512 digest) and expands it by SHA512 in counter mode, instead of rehashing data for every 32 output bytes (can be set at build, 0 for previous construction)
+#ifndef FIAT_SHAMIR_XOF
+#define FIAT_SHAMIR_XOF 1
+#endif
+
 #define EPS_ZKP_SLACK_PARAMETER_BYTES (2*GROUP_ORDER_BYTES)
 #define ELL_ZKP_RANGE_PARAMETER_BYTES (GROUP_ORDER_BYTES)
 // #define ELL_PRIME_ZKP_RANGE_PARAMETER_BYTES (5*GROUP_ORDER_BYTES)
 #define CALIGRAPHIC_I_ZKP_RANGE_BYTES (ELL_ZKP_RANGE_PARAMETER_BYTES)
 #define CALIGRAPHIC_J_ZKP_RANGE_BYTES (EPS_ZKP_SLACK_PARAMETER_BYTES + ELL_ZKP_RANGE_PARAMETER_BYTES*3)
 
+// Bound on ring-Pedersen commitment exponents in range proofs (widest is gamma in range 2^(J+eps)*N_hat, plus e*mu)
+#define RING_PED_COMMIT_EXP_BYTES (CALIGRAPHIC_J_ZKP_RANGE_BYTES + EPS_ZKP_SLACK_PARAMETER_BYTES + RING_PED_MODULUS_BYTES + 1)
+
 typedef struct
 {
   uint8_t *info;
@@ -53,5 +71,27 @@ void zkp_aux_info_update_move (zkp_aux_info_t *aux, uint64_t *at_pos, const void
 
 void fiat_shamir_bytes            (uint8_t *digest, uint64_t digest_len, const uint8_t *data, uint64_t data_len);
 void fiat_shamir_scalars_in_range (scalar_t *results, uint64_t num_res, const scalar_t range, const uint8_t *data, uint64_t data_len);
+// Same as fiat_shamir_scalars_in_range with num_res=1 on each data[i] (range[i]) for i < count, hashing all together (multi-buffer SHA512)
+void fiat_shamir_scalars_in_range_batch (scalar_t *results, const scalar_t *ranges, const uint8_t *const *data, const uint64_t *data_len, uint64_t count);
+
+// Challenges of many proofs (possibly of different types), computed together. Proof verifiers add their Fiat-Shamir data (zkp_<...>_verify_add_challenge),
+// then zkp_challenge_batch_compute sets all challenges, and zkp_<...>_verify_batched completes each verification with its challenge (by index).
+typedef struct
+{
+  uint64_t count;
+  uint64_t max_count;
+  uint8_t **fs_data;
+  uint64_t *fs_data_len;
+  scalar_t *ranges;
+  scalar_t *challenges;
+} zkp_challenge_batch_t;
+
+zkp_challenge_batch_t *
+         zkp_challenge_batch_new     (uint64_t max_count);
+void     zkp_challenge_batch_free    (zkp_challenge_batch_t *batch);
+// Takes ownership of (allocated) fs_data, returns index of challenge
+uint64_t zkp_challenge_batch_add     (zkp_challenge_batch_t *batch, uint8_t *fs_data, uint64_t fs_data_len, const scalar_t range);
+// Sets each challenge in its range, made signed (as computed by proofs' own challenge functions)
+void     zkp_challenge_batch_compute (zkp_challenge_batch_t *batch);
 
 #endif
\ No newline at end of file
@@ -33,6 +33,7 @@ typedef struct
 {  
   scalar_t k;       // k_range_bytes
   scalar_t rho;     // PAILLIER_MODULUS_BYTES
+  const paillier_private_key_t *paillier_priv;    // Optional (NULL): key of paillier_pub, to encrypt by CRT
 } zkp_encryption_in_range_secret_t; 
 
 typedef struct
@@ -51,6 +52,10 @@ zkp_encryption_in_range_proof_t *
 void zkp_encryption_in_range_free             (zkp_encryption_in_range_proof_t *proof);
 void zkp_encryption_in_range_prove            (zkp_encryption_in_range_proof_t *proof, const zkp_encryption_in_range_secret_t *secret, const zkp_encryption_in_range_public_t *public, const zkp_aux_info_t *aux);
 int  zkp_encryption_in_range_verify           (const zkp_encryption_in_range_proof_t *proof, const zkp_encryption_in_range_public_t *public, const zkp_aux_info_t *aux);
+// Batched verification: adds proof's challenge to batch (returns its index), after zkp_challenge_batch_compute verifies with it (same result as _verify)
+uint64_t
+     zkp_encryption_in_range_verify_add_challenge (zkp_challenge_batch_t *batch, const zkp_encryption_in_range_proof_t *proof, const zkp_encryption_in_range_public_t *public, const zkp_aux_info_t *aux);
+int  zkp_encryption_in_range_verify_batched      (const zkp_encryption_in_range_proof_t *proof, const zkp_encryption_in_range_public_t *public, const zkp_challenge_batch_t *batch, uint64_t index);
 void zkp_encryption_in_range_proof_to_bytes   (uint8_t **bytes, uint64_t *byte_len, const zkp_encryption_in_range_proof_t *proof, uint64_t k_range_bytes, int move_to_end);
 void zkp_encryption_in_range_proof_from_bytes (zkp_encryption_in_range_proof_t *proof, uint8_t **bytes, uint64_t *byte_len, uint64_t k_range_bytes, const scalar_t N0, int move_to_end);
 
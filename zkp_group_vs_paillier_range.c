@@ -28,7 +28,7 @@ void  zkp_group_vs_paillier_range_free   (zkp_group_vs_paillier_range_proof_t *p
   free(proof);
 }
 
-void zkp_group_vs_paillier_range_challenge (scalar_t e, const zkp_group_vs_paillier_range_proof_t *proof, const zkp_group_vs_paillier_range_public_t *public, const zkp_aux_info_t *aux)
+static uint8_t *zkp_group_vs_paillier_range_challenge_data (uint64_t *fs_data_len_out, const zkp_group_vs_paillier_range_proof_t *proof, const zkp_group_vs_paillier_range_public_t *public, const zkp_aux_info_t *aux)
 {
   // Fiat-Shamir on paillier_N, rped_N_s_t, g, X, C, Y, A, D, S
 
@@ -53,6 +53,15 @@ void zkp_group_vs_paillier_range_challenge (scalar_t e, const zkp_group_vs_paill
 
   assert(fs_data + fs_data_len == data_pos);
 
+  *fs_data_len_out = fs_data_len;
+  return fs_data;
+}
+
+void zkp_group_vs_paillier_range_challenge (scalar_t e, const zkp_group_vs_paillier_range_proof_t *proof, const zkp_group_vs_paillier_range_public_t *public, const zkp_aux_info_t *aux)
+{
+  uint64_t fs_data_len;
+  uint8_t *fs_data = zkp_group_vs_paillier_range_challenge_data(&fs_data_len, proof, public, aux);
+
   fiat_shamir_scalars_in_range(&e, 1, ec_group_order(public->G), fs_data, fs_data_len);
   scalar_make_signed(e, ec_group_order(public->G));
 
@@ -64,16 +73,17 @@ void zkp_group_vs_paillier_range_prove (zkp_group_vs_paillier_range_proof_t *pro
 {
   assert((unsigned) BN_num_bytes(secret->x) <= public->x_range_bytes);
   
-  BN_CTX *bn_ctx = BN_CTX_secure_new();
-
-  scalar_t alpha_range = scalar_new();
-  scalar_t gamma_range = scalar_new();
-  scalar_t mu_range    = scalar_new();
-  scalar_t alpha       = scalar_new();
-  scalar_t gamma       = scalar_new();
-  scalar_t mu          = scalar_new();
-  scalar_t r           = scalar_new();
-  scalar_t e           = scalar_new();
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
+  arena_t arena = arena_new();
+
+  scalar_t alpha_range = arena_scalar_new(arena);
+  scalar_t gamma_range = arena_scalar_new(arena);
+  scalar_t mu_range    = arena_scalar_new(arena);
+  scalar_t alpha       = arena_scalar_new(arena);
+  scalar_t gamma       = arena_scalar_new(arena);
+  scalar_t mu          = arena_scalar_new(arena);
+  scalar_t r           = arena_scalar_new(arena);
+  scalar_t e           = arena_scalar_new(arena);
   
   BN_set_bit(alpha_range, 8*public->x_range_bytes + 8*EPS_ZKP_SLACK_PARAMETER_BYTES);
   scalar_sample_in_range(alpha, alpha_range, 0);
@@ -91,8 +101,9 @@ void zkp_group_vs_paillier_range_prove (zkp_group_vs_paillier_range_proof_t *pro
 
   group_operation(proof->Y, NULL, public->g, alpha, public->G);
 
-  paillier_encryption_sample(r, public->paillier_pub);  
-  paillier_encryption_encrypt(proof->A, alpha, r, public->paillier_pub);
+  paillier_encryption_sample_mask(r, public->paillier_pub);
+  if (secret->paillier_priv) paillier_encryption_encrypt_private(proof->A, alpha, r, secret->paillier_priv);
+  else paillier_encryption_encrypt(proof->A, alpha, r, public->paillier_pub);
 
   ring_pedersen_commit(proof->S, secret->x, mu, public->rped_pub);
   ring_pedersen_commit(proof->D, alpha, gamma, public->rped_pub);
@@ -102,63 +113,81 @@ void zkp_group_vs_paillier_range_prove (zkp_group_vs_paillier_range_proof_t *pro
   BN_mul(proof->z_1, e, secret->x, bn_ctx);
   BN_add(proof->z_1, alpha, proof->z_1);
 
-  scalar_exp(proof->z_2, secret->rho, e, public->paillier_pub->N);
-  BN_mod_mul(proof->z_2, r, proof->z_2, public->paillier_pub->N, bn_ctx);
+  paillier_encryption_randomness_response(proof->z_2, r, secret->rho, e, public->paillier_pub);
 
   BN_mul(proof->z_3, e, mu, bn_ctx);
   BN_add(proof->z_3, gamma, proof->z_3);
   
-  scalar_free(e);
-  scalar_free(r);
-  scalar_free(mu);
-  scalar_free(gamma);
-  scalar_free(alpha);
-  scalar_free(mu_range);
-  scalar_free(gamma_range);
-  scalar_free(alpha_range);
-  BN_CTX_free(bn_ctx);
+  arena_free(arena);
+  bn_ctx_release(bn_ctx);
 }
 
-int   zkp_group_vs_paillier_range_verify (const zkp_group_vs_paillier_range_proof_t *proof, const zkp_group_vs_paillier_range_public_t *public, const zkp_aux_info_t *aux)
+// Verification with given (signed) challenge of the proof
+static int zkp_group_vs_paillier_range_verify_with_challenge (const zkp_group_vs_paillier_range_proof_t *proof, const zkp_group_vs_paillier_range_public_t *public, const scalar_t challenge)
 {
   scalar_t z_1_range = scalar_new();
   BN_set_bit(z_1_range, 8*public->x_range_bytes + 8*EPS_ZKP_SLACK_PARAMETER_BYTES - 1);     // -1 since comparing signed range
 
   int is_verified = (BN_ucmp(proof->z_1, z_1_range) < 0);
 
+  // Commitments must be units (else S^{-e} doesn't exist)
+  is_verified &= scalar_coprime(proof->S, public->rped_pub->N) && scalar_coprime(proof->D, public->rped_pub->N) && scalar_coprime(proof->A, public->paillier_pub->N);
+
   scalar_t e = scalar_new();
-  zkp_group_vs_paillier_range_challenge(e, proof, public, aux);
+  scalar_copy(e, challenge);
 
   scalar_t lhs_value = scalar_new();
-  scalar_t rhs_value = scalar_new();
+  scalar_negate(e, e);
 
-  paillier_encryption_encrypt(lhs_value, proof->z_1, proof->z_2, public->paillier_pub);
-  scalar_exp(rhs_value, public->C, e, public->paillier_pub->N2);
-  scalar_mul(rhs_value, proof->A, rhs_value, public->paillier_pub->N2);
-  is_verified &= scalar_equal(lhs_value, rhs_value);
+  // Check Enc(z_1, z_2) * C^{-e} == A
+  is_verified &= (paillier_encryption_encrypt_multi_exp_vartime(lhs_value, proof->z_1, proof->z_2, &public->C, &e, 1, public->paillier_pub) == 0);
+  is_verified &= scalar_equal(lhs_value, proof->A);
 
-  ring_pedersen_commit(lhs_value, proof->z_1, proof->z_3, public->rped_pub);
-  scalar_exp(rhs_value, proof->S, e, public->rped_pub->N);
-  scalar_mul(rhs_value, proof->D, rhs_value, public->rped_pub->N);
-  is_verified &= scalar_equal(lhs_value, rhs_value);
+  // Check s^z_1 * t^z_3 * S^{-e} == D
+  is_verified &= (ring_pedersen_commit_multi_exp_vartime(lhs_value, proof->z_1, proof->z_3, &proof->S, &e, 1, public->rped_pub) == 0);
+  is_verified &= scalar_equal(lhs_value, proof->D);
+
+  // Check g^z_1 * X^{-e} == Y
+  gr_elem_t bases[2] = {public->g, public->X};
+  scalar_t  exps[2]  = {proof->z_1, e};
 
   gr_elem_t lhs_gr_elem = group_elem_new(public->G);
-  gr_elem_t rhs_gr_elem = group_elem_new(public->G);
-  
-  group_operation(lhs_gr_elem, NULL, public->g, proof->z_1, public->G);
-  group_operation(rhs_gr_elem, proof->Y, public->X, e, public->G);
-  is_verified &= group_elem_equal(lhs_gr_elem, rhs_gr_elem, public->G);
+  group_multi_exp(lhs_gr_elem, bases, exps, 2, public->G);
+  is_verified &= group_elem_equal(lhs_gr_elem, proof->Y, public->G);
 
   scalar_free(e);
   scalar_free(lhs_value);
-  scalar_free(rhs_value);
   scalar_free(z_1_range);
   group_elem_free(lhs_gr_elem);
-  group_elem_free(rhs_gr_elem);
 
   return is_verified;
 }
 
+int zkp_group_vs_paillier_range_verify (const zkp_group_vs_paillier_range_proof_t *proof, const zkp_group_vs_paillier_range_public_t *public, const zkp_aux_info_t *aux)
+{
+  scalar_t e = scalar_new();
+  zkp_group_vs_paillier_range_challenge(e, proof, public, aux);
+
+  int is_verified = zkp_group_vs_paillier_range_verify_with_challenge(proof, public, e);
+
+  scalar_free(e);
+
+  return is_verified;
+}
+
+uint64_t zkp_group_vs_paillier_range_verify_add_challenge (zkp_challenge_batch_t *batch, const zkp_group_vs_paillier_range_proof_t *proof, const zkp_group_vs_paillier_range_public_t *public, const zkp_aux_info_t *aux)
+{
+  uint64_t fs_data_len;
+  uint8_t *fs_data = zkp_group_vs_paillier_range_challenge_data(&fs_data_len, proof, public, aux);
+
+  return zkp_challenge_batch_add(batch, fs_data, fs_data_len, ec_group_order(public->G));
+}
+
+int zkp_group_vs_paillier_range_verify_batched (const zkp_group_vs_paillier_range_proof_t *proof, const zkp_group_vs_paillier_range_public_t *public, const zkp_challenge_batch_t *batch, uint64_t index)
+{
+  return zkp_group_vs_paillier_range_verify_with_challenge(proof, public, batch->challenges[index]);
+}
+
 void zkp_group_vs_paillier_range_proof_to_bytes(uint8_t **bytes, uint64_t *byte_len, const zkp_group_vs_paillier_range_proof_t *proof, uint64_t x_range_bytes, const ec_group_t G, int move_to_end)
 { 
   uint64_t needed_byte_len = GROUP_ELEMENT_BYTES + 3*RING_PED_MODULUS_BYTES + 3*PAILLIER_MODULUS_BYTES + 2*x_range_bytes + 2*EPS_ZKP_SLACK_PARAMETER_BYTES;
@@ -36,6 +36,7 @@ typedef struct
 {
   scalar_t x;     // x_range_bytes + EPS_ZKP_SLACK_PARAMETER_BYTES
   scalar_t rho;   // PAILLIER_MODULUS_BYTES
+  const paillier_private_key_t *paillier_priv;    // Optional (NULL): key of paillier_pub, to encrypt by CRT
 
 } zkp_group_vs_paillier_range_secret_t;
 
@@ -56,6 +57,10 @@ zkp_group_vs_paillier_range_proof_t *
 void zkp_group_vs_paillier_range_free             (zkp_group_vs_paillier_range_proof_t *proof);
 void zkp_group_vs_paillier_range_prove            (zkp_group_vs_paillier_range_proof_t *proof, const zkp_group_vs_paillier_range_secret_t *secret, const zkp_group_vs_paillier_range_public_t *public, const zkp_aux_info_t *aux);
 int  zkp_group_vs_paillier_range_verify           (const zkp_group_vs_paillier_range_proof_t *proof, const zkp_group_vs_paillier_range_public_t *public, const zkp_aux_info_t *aux);
+// Batched verification: adds proof's challenge to batch (returns its index), after zkp_challenge_batch_compute verifies with it (same result as _verify)
+uint64_t
+     zkp_group_vs_paillier_range_verify_add_challenge (zkp_challenge_batch_t *batch, const zkp_group_vs_paillier_range_proof_t *proof, const zkp_group_vs_paillier_range_public_t *public, const zkp_aux_info_t *aux);
+int  zkp_group_vs_paillier_range_verify_batched      (const zkp_group_vs_paillier_range_proof_t *proof, const zkp_group_vs_paillier_range_public_t *public, const zkp_challenge_batch_t *batch, uint64_t index);
 void zkp_group_vs_paillier_range_proof_to_bytes   (uint8_t **bytes, uint64_t *byte_len, const zkp_group_vs_paillier_range_proof_t *proof, uint64_t x_range_bytes, const ec_group_t G, int move_to_end);
 void zkp_group_vs_paillier_range_proof_from_bytes (zkp_group_vs_paillier_range_proof_t *proof, uint8_t **bytes, uint64_t *byte_len, uint64_t x_range_bytes, const scalar_t N0, const ec_group_t G, int move_to_end);
 
@@ -40,7 +40,7 @@ void  zkp_oper_group_commit_range_free   (zkp_oper_group_commit_range_proof_t *p
   free(proof);
 }
 
-void zkp_oper_group_commit_range_challenge (scalar_t e, const zkp_oper_group_commit_range_proof_t *proof, const zkp_oper_group_commit_range_public_t *public, const zkp_aux_info_t *aux)
+static uint8_t *zkp_oper_group_commit_range_challenge_data (uint64_t *fs_data_len_out, const zkp_oper_group_commit_range_proof_t *proof, const zkp_oper_group_commit_range_public_t *public, const zkp_aux_info_t *aux)
 {
   // Fiat-Shamir on paillier_N_0 paillier_N_1, rped_N_s_t, g, C, D, Y, X, A, B_x, B_y, E, F, S, T
 
@@ -70,6 +70,15 @@ void zkp_oper_group_commit_range_challenge (scalar_t e, const zkp_oper_group_com
 
   assert(fs_data + fs_data_len == data_pos);
 
+  *fs_data_len_out = fs_data_len;
+  return fs_data;
+}
+
+void zkp_oper_group_commit_range_challenge (scalar_t e, const zkp_oper_group_commit_range_proof_t *proof, const zkp_oper_group_commit_range_public_t *public, const zkp_aux_info_t *aux)
+{
+  uint64_t fs_data_len;
+  uint8_t *fs_data = zkp_oper_group_commit_range_challenge_data(&fs_data_len, proof, public, aux);
+
   fiat_shamir_scalars_in_range(&e, 1, ec_group_order(public->G), fs_data, fs_data_len);
   scalar_make_signed(e, ec_group_order(public->G));
 
@@ -82,22 +91,23 @@ void zkp_oper_group_commit_range_prove (zkp_oper_group_commit_range_proof_t *pro
   assert((unsigned) BN_num_bytes(secret->x) <= public->x_range_bytes);
   assert((unsigned) BN_num_bytes(secret->y) <= public->y_range_bytes);
 
-  BN_CTX *bn_ctx = BN_CTX_secure_new();
-
-  scalar_t alpha_range = scalar_new();
-  scalar_t beta_range  = scalar_new();
-  scalar_t gamma_range = scalar_new();    // Also delta range
-  scalar_t mu_range    = scalar_new();    // Also m range
-  scalar_t alpha       = scalar_new();
-  scalar_t beta        = scalar_new();
-  scalar_t gamma       = scalar_new();
-  scalar_t delta       = scalar_new();
-  scalar_t mu          = scalar_new();
-  scalar_t m           = scalar_new();
-  scalar_t r           = scalar_new();
-  scalar_t r_y         = scalar_new();
-  scalar_t e           = scalar_new();
-  scalar_t temp        = scalar_new();
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
+  arena_t arena = arena_new();
+
+  scalar_t alpha_range = arena_scalar_new(arena);
+  scalar_t beta_range  = arena_scalar_new(arena);
+  scalar_t gamma_range = arena_scalar_new(arena);    // Also delta range
+  scalar_t mu_range    = arena_scalar_new(arena);    // Also m range
+  scalar_t alpha       = arena_scalar_new(arena);
+  scalar_t beta        = arena_scalar_new(arena);
+  scalar_t gamma       = arena_scalar_new(arena);
+  scalar_t delta       = arena_scalar_new(arena);
+  scalar_t mu          = arena_scalar_new(arena);
+  scalar_t m           = arena_scalar_new(arena);
+  scalar_t r           = arena_scalar_new(arena);
+  scalar_t r_y         = arena_scalar_new(arena);
+  scalar_t e           = arena_scalar_new(arena);
+  scalar_t temp        = arena_scalar_new(arena);
 
   BN_set_bit(alpha_range, 8*public->x_range_bytes + 8*EPS_ZKP_SLACK_PARAMETER_BYTES);
   scalar_sample_in_range(alpha, alpha_range, 0);
@@ -123,12 +133,13 @@ void zkp_oper_group_commit_range_prove (zkp_oper_group_commit_range_proof_t *pro
   
   group_operation(proof->B_x, NULL, public->g, alpha, public->G);
 
-  paillier_encryption_sample(r_y, public->paillier_pub_1);
-  paillier_encryption_encrypt(proof->B_y, beta, r_y, public->paillier_pub_1);
+  paillier_encryption_sample_mask(r_y, public->paillier_pub_1);
+  if (secret->paillier_priv_1) paillier_encryption_encrypt_private(proof->B_y, beta, r_y, secret->paillier_priv_1);
+  else paillier_encryption_encrypt(proof->B_y, beta, r_y, public->paillier_pub_1);
 
-  paillier_encryption_sample(r, public->paillier_pub_0);
+  paillier_encryption_sample_mask(r, public->paillier_pub_0);
   paillier_encryption_encrypt(temp, beta, r, public->paillier_pub_0);
-  scalar_exp(proof->A, public->C, alpha, public->paillier_pub_0->N2);
+  scalar_exp_mont(proof->A, public->C, alpha, public->paillier_pub_0->N2, public->paillier_pub_0->mont_N2);
   scalar_mul(proof->A, proof->A, temp, public->paillier_pub_0->N2);
 
   ring_pedersen_commit(proof->E, alpha, gamma, public->rped_pub);
@@ -150,31 +161,16 @@ void zkp_oper_group_commit_range_prove (zkp_oper_group_commit_range_proof_t *pro
   BN_mul(temp, e, mu, bn_ctx);
   BN_add(proof->z_4, delta, temp);
 
-  scalar_exp(temp, secret->rho, e, public->paillier_pub_0->N);
-  scalar_mul(proof->w, r, temp, public->paillier_pub_0->N);
+  paillier_encryption_randomness_response(proof->w, r, secret->rho, e, public->paillier_pub_0);
+  paillier_encryption_randomness_response(proof->w_y, r_y, secret->rho_y, e, public->paillier_pub_1);
 
-  scalar_exp(temp, secret->rho_y, e, public->paillier_pub_1->N);
-  scalar_mul(proof->w_y, r_y, temp, public->paillier_pub_1->N);
 
-  scalar_free(temp);
-  scalar_free(e);
-  scalar_free(r_y);
-  scalar_free(r);
-  scalar_free(m);
-  scalar_free(mu);
-  scalar_free(delta);
-  scalar_free(gamma);
-  scalar_free(beta);
-  scalar_free(alpha);
-  scalar_free(mu_range);
-  scalar_free(gamma_range);
-  scalar_free(beta_range);
-  scalar_free(alpha_range);
-
-  BN_CTX_free(bn_ctx);
+  arena_free(arena);
+  bn_ctx_release(bn_ctx);
 }
 
-int zkp_oper_group_commit_range_verify  (const zkp_oper_group_commit_range_proof_t *proof, const zkp_oper_group_commit_range_public_t *public, const zkp_aux_info_t *aux)
+// Verification with given (signed) challenge of the proof
+static int zkp_oper_group_commit_range_verify_with_challenge (const zkp_oper_group_commit_range_proof_t *proof, const zkp_oper_group_commit_range_public_t *public, const scalar_t challenge)
 {
   scalar_t z_1_range = scalar_new();
   scalar_t z_2_range = scalar_new();
@@ -183,54 +179,77 @@ int zkp_oper_group_commit_range_verify  (const zkp_oper_group_commit_range_proof
 
   int is_verified = (BN_ucmp(proof->z_1, z_1_range) < 0) && (BN_ucmp(proof->z_2, z_2_range) < 0);
 
+  // Commitments must be units (else S^{-e}, T^{-e} don't exist)
+  is_verified &= scalar_coprime(proof->S, public->rped_pub->N) && scalar_coprime(proof->T, public->rped_pub->N)
+              && scalar_coprime(proof->E, public->rped_pub->N) && scalar_coprime(proof->F, public->rped_pub->N)
+              && scalar_coprime(proof->A, public->paillier_pub_0->N) && scalar_coprime(proof->B_y, public->paillier_pub_1->N);
+
   scalar_t e = scalar_new();
-  zkp_oper_group_commit_range_challenge(e, proof, public, aux);
+  scalar_copy(e, challenge);
 
   scalar_t lhs_value = scalar_new();
-  scalar_t rhs_value = scalar_new();
-  scalar_t temp = scalar_new();
-
-  paillier_encryption_encrypt(lhs_value, proof->z_2, proof->w_y, public->paillier_pub_1);
-  scalar_exp(temp, public->Y, e, public->paillier_pub_1->N2);
-  scalar_mul(rhs_value, proof->B_y, temp, public->paillier_pub_1->N2);
-  is_verified &= scalar_equal(lhs_value, rhs_value);
-
-  paillier_encryption_encrypt(temp, proof->z_2, proof->w, public->paillier_pub_0);
-  scalar_exp(lhs_value, public->C, proof->z_1, public->paillier_pub_0->N2);
-  scalar_mul(lhs_value, lhs_value, temp, public->paillier_pub_0->N2);
-  scalar_exp(temp, public->D, e, public->paillier_pub_0->N2);
-  scalar_mul(rhs_value, proof->A, temp, public->paillier_pub_0->N2);
-  is_verified &= scalar_equal(lhs_value, rhs_value);
-
-  ring_pedersen_commit(lhs_value, proof->z_1, proof->z_3, public->rped_pub);
-  scalar_exp(temp, proof->S, e, public->rped_pub->N);
-  scalar_mul(rhs_value, proof->E, temp, public->rped_pub->N);
-  is_verified &= scalar_equal(lhs_value, rhs_value);
-
-  ring_pedersen_commit(lhs_value, proof->z_2, proof->z_4, public->rped_pub);
-  scalar_exp(temp, proof->T, e, public->rped_pub->N);
-  scalar_mul(rhs_value, proof->F, temp, public->rped_pub->N);
-  is_verified &= scalar_equal(lhs_value, rhs_value);
+  scalar_negate(e, e);
 
-  gr_elem_t lhs_gr_elem = group_elem_new(public->G);
-  gr_elem_t rhs_gr_elem = group_elem_new(public->G);
+  // Check Enc_1(z_2, w_y) * Y^{-e} == B_y
+  is_verified &= (paillier_encryption_encrypt_multi_exp_vartime(lhs_value, proof->z_2, proof->w_y, &public->Y, &e, 1, public->paillier_pub_1) == 0);
+  is_verified &= scalar_equal(lhs_value, proof->B_y);
+
+  // Check C^z_1 * Enc_0(z_2, w) * D^{-e} == A
+  scalar_t enc_bases[2] = {public->C, public->D};
+  scalar_t enc_exps[2]  = {proof->z_1, e};
+  is_verified &= (paillier_encryption_encrypt_multi_exp_vartime(lhs_value, proof->z_2, proof->w, enc_bases, enc_exps, 2, public->paillier_pub_0) == 0);
+  is_verified &= scalar_equal(lhs_value, proof->A);
+
+  // Check s^z_1 * t^z_3 * S^{-e} == E
+  is_verified &= (ring_pedersen_commit_multi_exp_vartime(lhs_value, proof->z_1, proof->z_3, &proof->S, &e, 1, public->rped_pub) == 0);
+  is_verified &= scalar_equal(lhs_value, proof->E);
 
-  group_operation(lhs_gr_elem, NULL, public->g, proof->z_1, public->G);
-  group_operation(rhs_gr_elem, proof->B_x, public->X, e, public->G);
-  is_verified &= group_elem_equal(lhs_gr_elem, rhs_gr_elem, public->G);
+  // Check s^z_2 * t^z_4 * T^{-e} == F
+  is_verified &= (ring_pedersen_commit_multi_exp_vartime(lhs_value, proof->z_2, proof->z_4, &proof->T, &e, 1, public->rped_pub) == 0);
+  is_verified &= scalar_equal(lhs_value, proof->F);
+
+  // Check g^z_1 * X^{-e} == B_x
+  gr_elem_t bases[2] = {public->g, public->X};
+  scalar_t  exps[2]  = {proof->z_1, e};
+
+  gr_elem_t lhs_gr_elem = group_elem_new(public->G);
+  group_multi_exp(lhs_gr_elem, bases, exps, 2, public->G);
+  is_verified &= group_elem_equal(lhs_gr_elem, proof->B_x, public->G);
 
   scalar_free(e);
-  scalar_free(temp);
   scalar_free(lhs_value);
-  scalar_free(rhs_value);
   scalar_free(z_1_range);
   scalar_free(z_2_range);
   group_elem_free(lhs_gr_elem);
-  group_elem_free(rhs_gr_elem);
 
   return is_verified;
 }
 
+int zkp_oper_group_commit_range_verify (const zkp_oper_group_commit_range_proof_t *proof, const zkp_oper_group_commit_range_public_t *public, const zkp_aux_info_t *aux)
+{
+  scalar_t e = scalar_new();
+  zkp_oper_group_commit_range_challenge(e, proof, public, aux);
+
+  int is_verified = zkp_oper_group_commit_range_verify_with_challenge(proof, public, e);
+
+  scalar_free(e);
+
+  return is_verified;
+}
+
+uint64_t zkp_oper_group_commit_range_verify_add_challenge (zkp_challenge_batch_t *batch, const zkp_oper_group_commit_range_proof_t *proof, const zkp_oper_group_commit_range_public_t *public, const zkp_aux_info_t *aux)
+{
+  uint64_t fs_data_len;
+  uint8_t *fs_data = zkp_oper_group_commit_range_challenge_data(&fs_data_len, proof, public, aux);
+
+  return zkp_challenge_batch_add(batch, fs_data, fs_data_len, ec_group_order(public->G));
+}
+
+int zkp_oper_group_commit_range_verify_batched (const zkp_oper_group_commit_range_proof_t *proof, const zkp_oper_group_commit_range_public_t *public, const zkp_challenge_batch_t *batch, uint64_t index)
+{
+  return zkp_oper_group_commit_range_verify_with_challenge(proof, public, batch->challenges[index]);
+}
+
 void zkp_oper_group_commit_range_proof_to_bytes (uint8_t **bytes, uint64_t *byte_len, const zkp_oper_group_commit_range_proof_t *proof, uint64_t x_range_bytes, uint64_t y_range_bytes, const ec_group_t G, int move_to_end)
 {
   uint64_t needed_byte_len = GROUP_ELEMENT_BYTES + 6*RING_PED_MODULUS_BYTES + 6*PAILLIER_MODULUS_BYTES + 3*x_range_bytes + y_range_bytes + 4*EPS_ZKP_SLACK_PARAMETER_BYTES;
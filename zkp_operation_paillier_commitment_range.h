@@ -42,6 +42,7 @@ typedef struct
     scalar_t rho;     // PAILLIER_MODULUS_BYTES
     scalar_t rho_x;   // PAILLIER_MODULUS_BYTES
     scalar_t rho_y;   // PAILLIER_MODULUS_BYTES
+    const paillier_private_key_t *paillier_priv_1;  // Optional (NULL): key of paillier_pub_1, to encrypt by CRT
 } zkp_oper_paillier_commit_range_secret_t;
 
 typedef struct
@@ -70,6 +71,10 @@ zkp_oper_paillier_commit_range_proof_t*
 void zkp_oper_paillier_commit_range_free             (zkp_oper_paillier_commit_range_proof_t *proof);
 void zkp_oper_paillier_commit_range_prove            (zkp_oper_paillier_commit_range_proof_t *proof, const zkp_oper_paillier_commit_range_secret_t *secret, const zkp_oper_paillier_commit_range_public_t *public, const zkp_aux_info_t *aux);
 int  zkp_oper_paillier_commit_range_verify           (const zkp_oper_paillier_commit_range_proof_t *proof, const zkp_oper_paillier_commit_range_public_t *public, const zkp_aux_info_t *aux);
+// Batched verification: adds proof's challenge to batch (returns its index), after zkp_challenge_batch_compute verifies with it (same result as _verify)
+uint64_t
+     zkp_oper_paillier_commit_range_verify_add_challenge (zkp_challenge_batch_t *batch, const zkp_oper_paillier_commit_range_proof_t *proof, const zkp_oper_paillier_commit_range_public_t *public, const zkp_aux_info_t *aux);
+int  zkp_oper_paillier_commit_range_verify_batched      (const zkp_oper_paillier_commit_range_proof_t *proof, const zkp_oper_paillier_commit_range_public_t *public, const zkp_challenge_batch_t *batch, uint64_t index);
 void zkp_oper_paillier_commit_range_proof_to_bytes   (uint8_t **bytes, uint64_t *byte_len, const zkp_oper_paillier_commit_range_proof_t *proof, uint64_t x_range_bytes, uint64_t y_range_bytes, int move_to_end);
 void zkp_oper_paillier_commit_range_proof_from_bytes (zkp_oper_paillier_commit_range_proof_t *proof, uint8_t **bytes, uint64_t *byte_len, uint64_t x_range_bytes, uint64_t y_range_bytes, const scalar_t N0, const scalar_t N1, int move_to_end);
 
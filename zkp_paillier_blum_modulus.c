@@ -60,12 +60,13 @@ void  zkp_paillier_blum_prove  (zkp_paillier_blum_modulus_proof_t *proof, const
 {
   assert(BN_num_bytes(private->N) == PAILLIER_MODULUS_BYTES);
 
-  BN_CTX *bn_ctx = BN_CTX_secure_new();
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
+  arena_t arena = arena_new();
 
   // Generate w with (-1, 1) Jacobi signs wrt (p,q) by CRT
 
-  scalar_t p_crt = scalar_new();
-  scalar_t q_crt = scalar_new();
+  scalar_t p_crt = arena_scalar_new(arena);
+  scalar_t q_crt = arena_scalar_new(arena);
 
   BN_mod_inverse(p_crt, private->p, private->q, bn_ctx);
   BN_mod_inverse(q_crt, private->q, private->p, bn_ctx);
@@ -74,24 +75,28 @@ void  zkp_paillier_blum_prove  (zkp_paillier_blum_modulus_proof_t *proof, const
   BN_mod_sub(proof->w, p_crt, q_crt, private->N, bn_ctx);
 
   scalar_t y[STATISTICAL_SECURITY];
-  for (uint64_t i = 0; i < STATISTICAL_SECURITY; ++i) y[i] = scalar_new();
+  for (uint64_t i = 0; i < STATISTICAL_SECURITY; ++i) y[i] = arena_scalar_new(arena);
 
   zkp_paillier_blum_challenge(y, proof, private->N, aux);
 
-  scalar_t N_inverse_mod_phiN = scalar_new();
+  scalar_t N_inverse_mod_phiN = arena_scalar_new(arena);
   BN_mod_inverse(N_inverse_mod_phiN, private->N, private->phi_N, bn_ctx);    // To compute z[i]
 
   // Taking each y[i] 4th root (by exponent which is ((p-1)/4)^2 mod (p -1) - double sqrt
   // Checking result^4 = y[i] or -y[i], which defined the legendre symbol
 
-  scalar_t p_minus_1 = BN_dup(private->p);
-  scalar_t q_minus_1 = BN_dup(private->q);
+  scalar_t p_minus_1 = arena_scalar_new(arena);
+  scalar_t q_minus_1 = arena_scalar_new(arena);
+  BN_copy(p_minus_1, private->p);
+  BN_copy(q_minus_1, private->q);
 
   BN_sub_word(p_minus_1, 1);
   BN_sub_word(q_minus_1, 1);
 
-  scalar_t p_exp_4th = BN_dup(private->p);
-  scalar_t q_exp_4th = BN_dup(private->q);
+  scalar_t p_exp_4th = arena_scalar_new(arena);
+  scalar_t q_exp_4th = arena_scalar_new(arena);
+  BN_copy(p_exp_4th, private->p);
+  BN_copy(q_exp_4th, private->q);
 
   BN_add_word(p_exp_4th, 1);
   BN_div_word(p_exp_4th, 4);
@@ -101,20 +106,20 @@ void  zkp_paillier_blum_prove  (zkp_paillier_blum_modulus_proof_t *proof, const
   BN_div_word(q_exp_4th, 4);
   BN_mod_sqr(q_exp_4th, q_exp_4th, q_minus_1, bn_ctx);
 
-  scalar_t temp = scalar_new();
-  scalar_t y_mod_p = scalar_new();
-  scalar_t y_mod_q = scalar_new();
-  scalar_t p_4th_root = scalar_new();
-  scalar_t q_4th_root = scalar_new();
-  scalar_t p_computed_y = scalar_new();   // The 4th root, to the 4th power, gives y up to legendre symbol mod prime
-  scalar_t q_computed_y = scalar_new();
+  scalar_t temp = arena_scalar_new(arena);
+  scalar_t y_mod_p = arena_scalar_new(arena);
+  scalar_t y_mod_q = arena_scalar_new(arena);
+  scalar_t p_4th_root = arena_scalar_new(arena);
+  scalar_t q_4th_root = arena_scalar_new(arena);
+  scalar_t p_computed_y = arena_scalar_new(arena);   // The 4th root, to the 4th power, gives y up to legendre symbol mod prime
+  scalar_t q_computed_y = arena_scalar_new(arena);
 
   uint8_t legendre_p;   // 0 is QR, 1 if QNR
   uint8_t legendre_q;
 
   for (uint64_t i = 0; i < STATISTICAL_SECURITY; ++i)
   {
-    BN_mod_exp(proof->z[i], y[i], N_inverse_mod_phiN, private->N, bn_ctx);
+    scalar_exp_mont(proof->z[i], y[i], N_inverse_mod_phiN, private->N, private->mont_N);
 
     // Compute potential 4th root modulo prime, a get legendre symbol 0/1 using 4th power
     BN_mod(y_mod_p, y[i], private->p, bn_ctx);
@@ -139,29 +144,13 @@ void  zkp_paillier_blum_prove  (zkp_paillier_blum_modulus_proof_t *proof, const
     proof->b[i] = legendre_q != legendre_p;
   }
 
-  for (uint64_t i = 0; i < STATISTICAL_SECURITY; ++i) scalar_free(y[i]);
-
-  scalar_free(N_inverse_mod_phiN);
-  scalar_free(p_computed_y);
-  scalar_free(q_computed_y);
-  scalar_free(p_4th_root);
-  scalar_free(q_4th_root);
-  scalar_free(q_exp_4th);
-  scalar_free(p_exp_4th);
-  scalar_free(p_minus_1);
-  scalar_free(q_minus_1);
-  scalar_free(y_mod_q);
-  scalar_free(y_mod_p);
-  scalar_free(p_crt);
-  scalar_free(q_crt);
-  scalar_free(temp);
-  
-  BN_CTX_free(bn_ctx);
+  arena_free(arena);
+  bn_ctx_release(bn_ctx);
 }
 
 int   zkp_paillier_blum_verify (zkp_paillier_blum_modulus_proof_t *proof, const paillier_public_key_t *public, const zkp_aux_info_t *aux)
 {
-  BN_CTX *bn_ctx = BN_CTX_secure_new();
+  BN_CTX *bn_ctx = bn_ctx_acquire(0);
 
   // Check composite odd number of required byte-length
   int is_verified = BN_is_odd(public->N);
@@ -177,7 +166,7 @@ int   zkp_paillier_blum_verify (zkp_paillier_blum_modulus_proof_t *proof, const
 
   for (uint64_t i = 0; i < STATISTICAL_SECURITY; ++i)
   {
-    BN_mod_exp(lhs_value, proof->z[i], public->N, public->N, bn_ctx);
+    scalar_exp_vartime(lhs_value, proof->z[i], public->N, public->N, public->mont_N);
     is_verified &= scalar_equal(lhs_value, y[i]);
 
     BN_mod_sqr(lhs_value, proof->x[i], public->N, bn_ctx);
@@ -189,7 +178,7 @@ int   zkp_paillier_blum_verify (zkp_paillier_blum_modulus_proof_t *proof, const
 
   for (uint64_t i = 0; i < STATISTICAL_SECURITY; ++i) scalar_free(y[i]);
   scalar_free(lhs_value);
-  BN_CTX_free(bn_ctx);
+  bn_ctx_release(bn_ctx);
 
   return is_verified;
 }
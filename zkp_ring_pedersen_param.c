@@ -53,19 +53,24 @@ void  zkp_ring_pedersen_param_prove (zkp_ring_pedersen_param_proof_t *proof, con
 {
   assert(BN_num_bytes(private->N) == RING_PED_MODULUS_BYTES);
   
-  BN_CTX *bn_ctx = BN_CTX_secure_new();
+  BN_CTX *bn_ctx = bn_ctx_acquire(1);
 
   // Sample initial a_i as z_i (and computie commitment A[i]), so later will just add e_i*lam for final z_i.
   for (uint64_t i = 0; i < STATISTICAL_SECURITY; ++i)
   {
     scalar_sample_in_range(proof->z[i], private->phi_N, 0);
-    BN_mod_exp(proof->A[i], private->t, proof->z[i], private->N, bn_ctx);
+    scalar_exp_mont(proof->A[i], private->t, proof->z[i], private->N, private->mont_N);
   }
 
   ring_pedersen_public_t public;
   public.N = private->N;
   public.s = private->s;
   public.t = private->t;
+  public.mont_N = private->mont_N;
+  public.s_table = NULL;
+  public.t_table = NULL;
+  public.s_inv_table = NULL;
+  public.t_inv_table = NULL;
 
   uint8_t e[STATISTICAL_SECURITY];     // coin flips by LSB
   zkp_ring_pedersen_param_challenge(e, proof, &public, aux);
@@ -75,7 +80,7 @@ void  zkp_ring_pedersen_param_prove (zkp_ring_pedersen_param_proof_t *proof, con
     if (e[i] & 0x01) BN_mod_add(proof->z[i], proof->z[i], private->lam, private->phi_N, bn_ctx);
   }
 
-  BN_CTX_free(bn_ctx);
+  bn_ctx_release(bn_ctx);
 }
 
 int   zkp_ring_pedersen_param_verify (const zkp_ring_pedersen_param_proof_t *proof, const ring_pedersen_public_t *public, const zkp_aux_info_t *aux)
@@ -83,7 +88,7 @@ int   zkp_ring_pedersen_param_verify (const zkp_ring_pedersen_param_proof_t *pro
   uint8_t e[STATISTICAL_SECURITY];
   zkp_ring_pedersen_param_challenge(e, proof, public, aux);
 
-  BN_CTX *bn_ctx = BN_CTX_secure_new();
+  BN_CTX *bn_ctx = bn_ctx_acquire(0);
   
   scalar_t lhs_value = scalar_new();
   scalar_t rhs_value = scalar_new();
@@ -93,7 +98,7 @@ int   zkp_ring_pedersen_param_verify (const zkp_ring_pedersen_param_proof_t *pro
 
   for (uint64_t i = 0; i < STATISTICAL_SECURITY; ++i)
   {
-    BN_mod_exp(lhs_value, public->t, proof->z[i], public->N, bn_ctx);
+    scalar_exp_vartime(lhs_value, public->t, proof->z[i], public->N, public->mont_N);
 
     temp = (scalar_t) BN_value_one();
     if (e[i] & 0x01) temp = public->s;
@@ -105,7 +110,7 @@ int   zkp_ring_pedersen_param_verify (const zkp_ring_pedersen_param_proof_t *pro
 
   scalar_free(lhs_value);
   scalar_free(rhs_value);
-  BN_CTX_free(bn_ctx);
+  bn_ctx_release(bn_ctx);
 
   return is_verified;
 }
@@ -45,18 +45,25 @@ void zkp_schnoor_challenge(scalar_t e, const zkp_schnorr_proof_t *proof, const z
 
 void  zkp_schnorr_prove (zkp_schnorr_proof_t *proof, const scalar_t alpha, const zkp_schnorr_secret_t *secret, const zkp_schnorr_public_t *public, const zkp_aux_info_t *aux)
 {
-  BN_CTX *bn_ctx = BN_CTX_secure_new();
   scalar_t e = scalar_new();
 
   group_operation(proof->A, NULL, public->g, alpha, public->G);
 
   zkp_schnoor_challenge(e, proof, public, aux);
 
-  BN_mod_mul(proof->z, e, secret->x, ec_group_order(public->G), bn_ctx);
-  BN_mod_add(proof->z, proof->z, alpha, ec_group_order(public->G), bn_ctx);
-
+  // z = e*x + alpha, as fixed-width scalars
+  order_scalar_t z;
+  order_scalar_t temp;
+  order_scalar_from_scalar(z, e);
+  order_scalar_from_scalar(temp, secret->x);
+  order_scalar_mul(z, z, temp);
+  order_scalar_from_scalar(temp, alpha);
+  order_scalar_add(z, z, temp);
+  order_scalar_to_scalar(proof->z, z);
+
+  order_scalar_clear(z);
+  order_scalar_clear(temp);
   scalar_free(e);
-  BN_CTX_free(bn_ctx);
 }
 
 int   zkp_schnorr_verify (const zkp_schnorr_proof_t *proof, const zkp_schnorr_public_t *public, const zkp_aux_info_t *aux)
@@ -64,16 +71,17 @@ int   zkp_schnorr_verify (const zkp_schnorr_proof_t *proof, const zkp_schnorr_pu
   scalar_t e = scalar_new();
   zkp_schnoor_challenge(e, proof, public, aux);
 
-  gr_elem_t lhs_value = group_elem_new(public->G);
-  gr_elem_t rhs_value = group_elem_new(public->G);
+  // Check g^z * X^{-e} == A
+  scalar_negate(e, e);
+  gr_elem_t bases[2] = {public->g, public->X};
+  scalar_t  exps[2]  = {proof->z, e};
 
-  group_operation(lhs_value, NULL, public->g, proof->z, public->G);
-  group_operation(rhs_value, proof->A, public->X, e, public->G);
-  int is_verified = group_elem_equal(lhs_value, rhs_value, public->G);
+  gr_elem_t lhs_value = group_elem_new(public->G);
+  group_multi_exp(lhs_value, bases, exps, 2, public->G);
+  int is_verified = group_elem_equal(lhs_value, proof->A, public->G);
 
   scalar_free(e);
   group_elem_free(lhs_value);
-  group_elem_free(rhs_value);
 
   return is_verified;
 }